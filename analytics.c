@@ -17,6 +17,7 @@
  *   5. Division by zero               — guarded in all rate calculations
  *   6. Sample buffer overflow         — bounded by MAX_QUEUE_SAMPLES check
  *   7. Double stop_sampling           — guarded by sampling_active flag
+ *   8. Torn reads of the live rates   — seqlock retry in analytics_get_rates
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -26,6 +27,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <math.h>
 
 #include "analytics.h"
 #include "utils.h"
@@ -33,66 +35,146 @@
 /* --- Internal Helpers --- */
 
 /*
- * Background Sampling Thread.
- * Periodically wakes up to record queue depth.
- * Runs independently of Producer/Consumer threads.
+ * Returns 1 while the warm-up window is still running.
+ * The clock is only read until the window has been seen to pass;
+ * after that this is a single flag test on the hot path.
+ */
+static int in_warmup(Analytics *analytics)
+{
+    if (!analytics->warmup_active) return 0;
+    if (time_elapsed() < analytics->warmup_end) return 1;
+    analytics->warmup_active = 0;
+    return 0;
+}
+
+/* Time constants of the EWMA windows, indexed by EwmaWindow */
+static const double ewma_tau_sec[EWMA_NUM_WINDOWS] = { 1.0, 10.0, 60.0 };
+static const char *ewma_names[EWMA_NUM_WINDOWS] = { "1s", "10s", "60s" };
+
+/*
+ * Folds one observation into every window.
+ * alpha = 1 - e^(-dt/tau) keeps the decay correct when a tick runs late.
+ * The first observation seeds the windows, so a short run does not
+ * report a 60s average still ramping up from zero.
+ */
+static void ewma_update(double *windows, double value, double dt, int first)
+{
+    int i;
+    for (i = 0; i < EWMA_NUM_WINDOWS; i++) {
+        if (first) {
+            windows[i] = value;
+        } else {
+            windows[i] += (1.0 - exp(-dt / ewma_tau_sec[i])) * (value - windows[i]);
+        }
+    }
+}
+
+/*
+ * Publishes a new set of rates (single writer: the sampler).
+ * Seqlock: the sequence is odd while the copy is in progress, so
+ * readers retry instead of blocking the hot path or the sampler.
+ */
+static void publish_rates(Analytics *analytics, const AnalyticsRates *rates)
+{
+    __atomic_add_fetch(&analytics->rates_seq, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    analytics->rates = *rates;
+    __atomic_add_fetch(&analytics->rates_seq, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Reads the live counters and advances the EWMA windows by one tick.
+ * Called only from the sampling thread; 'prev' and 'rates' are its
+ * private working state.
+ */
+static void update_rates(Analytics *analytics, LiveCounters *prev,
+                         AnalyticsRates *rates, double dt)
+{
+    LiveCounters cur;
+    int first = (rates->ticks == 0);
+
+    if (dt <= 0.0) return;
+
+    cur.produced = __atomic_load_n(&analytics->live.produced, __ATOMIC_RELAXED);
+    cur.consumed = __atomic_load_n(&analytics->live.consumed, __ATOMIC_RELAXED);
+    cur.producer_blocks = __atomic_load_n(&analytics->live.producer_blocks, __ATOMIC_RELAXED);
+    cur.consumer_blocks = __atomic_load_n(&analytics->live.consumer_blocks, __ATOMIC_RELAXED);
+    cur.latency_count = __atomic_load_n(&analytics->live.latency_count, __ATOMIC_RELAXED);
+    cur.latency_sum_us = __atomic_load_n(&analytics->live.latency_sum_us, __ATOMIC_RELAXED);
+
+    ewma_update(rates->produce_rate, (double)(cur.produced - prev->produced) / dt, dt, first);
+    ewma_update(rates->consume_rate, (double)(cur.consumed - prev->consumed) / dt, dt, first);
+    ewma_update(rates->producer_block_rate,
+                (double)(cur.producer_blocks - prev->producer_blocks) / dt, dt, first);
+    ewma_update(rates->consumer_block_rate,
+                (double)(cur.consumer_blocks - prev->consumer_blocks) / dt, dt, first);
+    ewma_update(rates->occupancy, (double)queue_get_count(analytics->queue_ptr), dt, first);
+
+    /* Latency only moves when messages were delivered this tick;
+     * an idle tick is "no information", not "zero latency". */
+    if (cur.latency_count > prev->latency_count) {
+        double mean_ms = (double)(cur.latency_sum_us - prev->latency_sum_us) /
+                         (double)(cur.latency_count - prev->latency_count) / 1000.0;
+        ewma_update(rates->latency_ms, mean_ms, dt, prev->latency_count == 0);
+    }
+
+    *prev = cur;
+    rates->updated_at = time_elapsed();
+    rates->ticks++;
+    publish_rates(analytics, rates);
+}
+
+/*
+ * Records one QueueSample and updates the occupancy aggregates.
  *
  * Error handling:
- *   - NULL arg check on entry (defensive)
  *   - Mutex lock/unlock failures logged but non-fatal
  *     (sampling data may be slightly inconsistent but won't crash)
  *   - Sample buffer overflow prevented by MAX_QUEUE_SAMPLES bound
  */
-static void *sampling_thread_func(void *arg)
+static void take_sample(Analytics *analytics)
 {
-    Analytics *analytics = (Analytics *)arg;
     QueueSample sample;
     int occupancy;
 
-    if (analytics == NULL) {
-        fprintf(stderr, "[ERROR] sampling_thread: NULL argument\n");
-        return NULL;
-    }
-
-    DBG(DBG_INFO, "%s", "Analytics sampler started");
+    /* 1. Snapshot Queue State
+     * queue_get_count reads without mutex — acceptable for sampling.
+     * The value may be slightly stale but this is a monitoring thread,
+     * not a decision-making thread. */
+    occupancy = queue_get_count(analytics->queue_ptr);
 
-    while (analytics->sampling_active) {
-        /* 1. Snapshot Queue State
-         * queue_get_count reads without mutex — acceptable for sampling.
-         * The value may be slightly stale but this is a monitoring thread,
-         * not a decision-making thread. */
-        occupancy = queue_get_count(analytics->queue_ptr);
-
-        /* 2. Lock analytics mutex to safely update shared data */
-        if (pthread_mutex_lock(&analytics->mutex) != 0) {
-            /* Error handling: Mutex lock failed — skip this sample.
-             * Missing one sample is better than corrupting the data. */
-            fprintf(stderr, "[WARN] sampling_thread: mutex lock failed, "
-                    "skipping sample\n");
-            sleep(SAMPLE_INTERVAL_SEC);
-            continue;
-        }
+    /* 2. Lock analytics mutex to safely update shared data */
+    if (pthread_mutex_lock(&analytics->mutex) != 0) {
+        /* Error handling: Mutex lock failed — skip this sample.
+         * Missing one sample is better than corrupting the data. */
+        fprintf(stderr, "[WARN] sampling_thread: mutex lock failed, "
+                "skipping sample\n");
+        return;
+    }
 
-        /* 3. Record Time-Series Data (bounded by MAX_QUEUE_SAMPLES) */
-        if (analytics->num_samples < MAX_QUEUE_SAMPLES) {
-            sample.timestamp = time_elapsed();
-            sample.occupancy = occupancy;
-            sample.capacity = analytics->queue_capacity;
-
-            int cur_produced = analytics->total_produced;
-            int cur_consumed = analytics->total_consumed;
-            sample.produced = cur_produced - analytics->prev_produced;
-            sample.consumed = cur_consumed - analytics->prev_consumed;
-            analytics->prev_produced = cur_produced;
-            analytics->prev_consumed = cur_consumed;
-
-            analytics->queue_samples[analytics->num_samples] = sample;
-            analytics->num_samples++;
-        }
-        /* else: buffer full — silently stop recording new samples.
-         * Existing samples are preserved for the report. */
+    /* 3. Record Time-Series Data (bounded by MAX_QUEUE_SAMPLES) */
+    if (analytics->num_samples < MAX_QUEUE_SAMPLES) {
+        sample.timestamp = time_elapsed();
+        sample.occupancy = occupancy;
+        sample.capacity = analytics->queue_capacity;
+
+        int cur_produced = analytics->total_produced;
+        int cur_consumed = analytics->total_consumed;
+        sample.produced = cur_produced - analytics->prev_produced;
+        sample.consumed = cur_consumed - analytics->prev_consumed;
+        analytics->prev_produced = cur_produced;
+        analytics->prev_consumed = cur_consumed;
+
+        analytics->queue_samples[analytics->num_samples] = sample;
+        analytics->num_samples++;
+    }
+    /* else: buffer full — silently stop recording new samples.
+     * Existing samples are preserved for the report. */
 
-        /* 4. Update Aggregates */
+    /* 4. Update Aggregates (skipped during the warm-up window;
+     * the time series above still shows the startup transient) */
+    if (!in_warmup(analytics)) {
+        analytics->aggregate_samples++;
         analytics->queue_occupancy_sum += occupancy;
 
         if (occupancy > analytics->queue_max_occupancy) {
@@ -110,18 +192,65 @@ static void *sampling_thread_func(void *arg)
         if (occupancy == 0) {
             analytics->queue_empty_count++;
         }
+    }
+
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        /* Error handling: Mutex unlock failed — other threads may
+         * deadlock on the analytics mutex. Log the error. */
+        fprintf(stderr, "[ERROR] sampling_thread: mutex unlock failed\n");
+    }
+
+    DBG(DBG_TRACE, "Analytics sample: occupancy=%d/%d (%d samples)",
+        occupancy, analytics->queue_capacity, analytics->num_samples);
+}
+
+/*
+ * Background Sampling Thread.
+ * Wakes every EWMA_TICK_MS to advance the live rates, and records a
+ * queue-depth sample every EWMA_TICKS_PER_SAMPLE ticks (1/sec).
+ * Runs independently of Producer/Consumer threads.
+ *
+ * Error handling:
+ *   - NULL arg check on entry (defensive)
+ *   - dt measured per tick, so a late wake-up does not skew the rates
+ */
+static void *sampling_thread_func(void *arg)
+{
+    Analytics *analytics = (Analytics *)arg;
+    LiveCounters prev;
+    AnalyticsRates rates;
+    double last_tick, now;
+    int tick = 0;
+
+    if (analytics == NULL) {
+        fprintf(stderr, "[ERROR] sampling_thread: NULL argument\n");
+        return NULL;
+    }
 
-        if (pthread_mutex_unlock(&analytics->mutex) != 0) {
-            /* Error handling: Mutex unlock failed — other threads may
-             * deadlock on the analytics mutex. Log the error. */
-            fprintf(stderr, "[ERROR] sampling_thread: mutex unlock failed\n");
+    DBG(DBG_INFO, "%s", "Analytics sampler started");
+
+    memset(&prev, 0, sizeof(prev));
+    memset(&rates, 0, sizeof(rates));
+    last_tick = time_elapsed();
+
+    while (analytics->sampling_active) {
+        /* Warm-up over: restart the exact occupancy window (to within
+         * one tick) so it covers the same period as the aggregates */
+        if (analytics->occupancy_reset_pending && !in_warmup(analytics)) {
+            queue_occupancy_reset(analytics->queue_ptr);
+            analytics->occupancy_reset_pending = 0;
         }
 
-        DBG(DBG_TRACE, "Analytics sample: occupancy=%d/%d (%d samples)",
-            occupancy, analytics->queue_capacity, analytics->num_samples);
+        if (tick == 0) take_sample(analytics);
 
-        /* 5. Wait for next interval */
-        sleep(SAMPLE_INTERVAL_SEC);
+        /* Wait for next tick */
+        sleep_us(EWMA_TICK_MS * 1000LL);
+
+        now = time_elapsed();
+        update_rates(analytics, &prev, &rates, now - last_tick);
+        last_tick = now;
+
+        tick = (tick + 1) % EWMA_TICKS_PER_SAMPLE;
     }
 
     DBG(DBG_INFO, "%s", "Analytics sampler stopped");
@@ -253,6 +382,55 @@ void analytics_stop_sampling(Analytics *analytics)
     }
 }
 
+/*
+ * Marks the start of measurement.
+ * Called by main when the start gate opens, so runtime and rates are
+ * measured from the moment all workers begin together.
+ */
+void analytics_mark_start(Analytics *analytics, double warmup_seconds)
+{
+    if (analytics == NULL) return;
+
+    analytics->start_time = time_elapsed();
+    analytics->warmup_seconds = (warmup_seconds > 0.0) ? warmup_seconds : 0.0;
+    analytics->warmup_end = analytics->start_time + analytics->warmup_seconds;
+    analytics->warmup_active = (analytics->warmup_seconds > 0.0);
+
+    /* Exact occupancy starts with the workers; with a warm-up the
+     * sampler restarts it again once the window has passed */
+    queue_occupancy_reset(analytics->queue_ptr);
+    analytics->occupancy_reset_pending = analytics->warmup_active;
+}
+
+/* --- Public API: Live Rates --- */
+
+/*
+ * Seqlock reader: copy, then confirm the sequence did not move.
+ * Never blocks; a reader racing the sampler simply copies again.
+ */
+int analytics_get_rates(const Analytics *analytics, AnalyticsRates *out)
+{
+    unsigned int seq_before, seq_after;
+
+    if (analytics == NULL || out == NULL) return -1;
+
+    do {
+        seq_before = __atomic_load_n(&analytics->rates_seq, __ATOMIC_ACQUIRE);
+        if (seq_before & 1U) continue; /* writer mid-update */
+        *out = analytics->rates;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq_after = __atomic_load_n(&analytics->rates_seq, __ATOMIC_RELAXED);
+    } while ((seq_before & 1U) || seq_before != seq_after);
+
+    return (out->ticks > 0) ? 0 : -1;
+}
+
+const char *analytics_ewma_window_name(EwmaWindow window)
+{
+    if ((int)window < 0 || (int)window >= EWMA_NUM_WINDOWS) return "?";
+    return ewma_names[window];
+}
+
 /* --- Public API: Event Recording --- */
 
 /*
@@ -268,6 +446,8 @@ void analytics_stop_sampling(Analytics *analytics)
 
 void analytics_record_produce(Analytics *analytics) {
     if (!analytics) return;
+    __atomic_fetch_add(&analytics->live.produced, 1, __ATOMIC_RELAXED);
+    if (in_warmup(analytics)) return;
     if (pthread_mutex_lock(&analytics->mutex) != 0) {
         fprintf(stderr, "[WARN] analytics_record_produce: mutex lock failed\n");
         return;
@@ -280,6 +460,8 @@ void analytics_record_produce(Analytics *analytics) {
 
 void analytics_record_consume(Analytics *analytics) {
     if (!analytics) return;
+    __atomic_fetch_add(&analytics->live.consumed, 1, __ATOMIC_RELAXED);
+    if (in_warmup(analytics)) return;
     if (pthread_mutex_lock(&analytics->mutex) != 0) {
         fprintf(stderr, "[WARN] analytics_record_consume: mutex lock failed\n");
         return;
@@ -292,6 +474,8 @@ void analytics_record_consume(Analytics *analytics) {
 
 void analytics_record_producer_block(Analytics *analytics) {
     if (!analytics) return;
+    __atomic_fetch_add(&analytics->live.producer_blocks, 1, __ATOMIC_RELAXED);
+    if (in_warmup(analytics)) return;
     if (pthread_mutex_lock(&analytics->mutex) != 0) {
         fprintf(stderr, "[WARN] analytics_record_producer_block: mutex lock failed\n");
         return;
@@ -304,6 +488,8 @@ void analytics_record_producer_block(Analytics *analytics) {
 
 void analytics_record_consumer_block(Analytics *analytics) {
     if (!analytics) return;
+    __atomic_fetch_add(&analytics->live.consumer_blocks, 1, __ATOMIC_RELAXED);
+    if (in_warmup(analytics)) return;
     if (pthread_mutex_lock(&analytics->mutex) != 0) {
         fprintf(stderr, "[WARN] analytics_record_consumer_block: mutex lock failed\n");
         return;
@@ -316,6 +502,7 @@ void analytics_record_consumer_block(Analytics *analytics) {
 
 void analytics_record_producer_wait(Analytics *analytics, long wait_ms) {
     if (!analytics) return;
+    if (in_warmup(analytics)) return;
     if (pthread_mutex_lock(&analytics->mutex) != 0) return;
     analytics->total_producer_wait_ms += wait_ms;
     if (wait_ms > analytics->max_producer_wait_ms)
@@ -327,6 +514,7 @@ void analytics_record_producer_wait(Analytics *analytics, long wait_ms) {
 
 void analytics_record_consumer_wait(Analytics *analytics, long wait_ms) {
     if (!analytics) return;
+    if (in_warmup(analytics)) return;
     if (pthread_mutex_lock(&analytics->mutex) != 0) return;
     analytics->total_consumer_wait_ms += wait_ms;
     if (wait_ms > analytics->max_consumer_wait_ms)
@@ -336,8 +524,83 @@ void analytics_record_consumer_wait(Analytics *analytics, long wait_ms) {
     }
 }
 
-void analytics_record_latency(Analytics *analytics, long latency_ms) {
+void analytics_record_class_enqueue(Analytics *analytics, int priority,
+                                    int was_blocked, long wait_ms) {
+    ClassStats *cs;
     if (!analytics) return;
+    if (in_warmup(analytics)) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) return;
+    cs = &analytics->class_stats[queue_priority_class(priority)];
+    cs->enqueued++;
+    if (was_blocked) {
+        cs->blocked++;
+        cs->wait_total_ms += wait_ms;
+        if (wait_ms > cs->wait_max_ms) cs->wait_max_ms = wait_ms;
+    }
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_class_enqueue: mutex unlock failed\n");
+    }
+}
+
+void analytics_record_produce_batch(Analytics *analytics, const Message *msgs, int n,
+                                    int was_blocked, long wait_ms) {
+    ClassStats *cs;
+    int i;
+    if (!analytics || msgs == NULL || n < 1) return;
+    __atomic_fetch_add(&analytics->live.produced, n, __ATOMIC_RELAXED);
+    if (in_warmup(analytics)) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[WARN] analytics_record_produce_batch: mutex lock failed\n");
+        return;
+    }
+    analytics->total_produced += n;
+    for (i = 0; i < n; i++) {
+        analytics->class_stats[queue_priority_class(msgs[i].priority)].enqueued++;
+    }
+    if (was_blocked) {
+        cs = &analytics->class_stats[queue_priority_class(msgs[0].priority)];
+        cs->blocked++;
+        cs->wait_total_ms += wait_ms;
+        if (wait_ms > cs->wait_max_ms) cs->wait_max_ms = wait_ms;
+    }
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_produce_batch: mutex unlock failed\n");
+    }
+}
+
+/* One round trip of an RPC client, from enqueue to taking the reply */
+void analytics_record_rpc(Analytics *analytics, long long rtt_us) {
+    if (!analytics) return;
+    if (in_warmup(analytics)) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) return;
+    analytics->rpc_replies++;
+    histogram_record(&analytics->rpc_rtt_hist, rtt_us);
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_rpc: mutex unlock failed\n");
+    }
+}
+
+/* One dequeue critical section that removed 'items' messages */
+void analytics_record_dequeue_lock(Analytics *analytics, int items) {
+    if (!analytics || items < 1) return;
+    if (in_warmup(analytics)) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) return;
+    analytics->dequeue_locks++;
+    analytics->dequeue_lock_items += items;
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_dequeue_lock: mutex unlock failed\n");
+    }
+}
+
+void analytics_record_latency(Analytics *analytics, long latency_ms,
+                              long long queue_us, long long corrected_us) {
+    if (!analytics) return;
+    if (queue_us >= 0) {
+        __atomic_fetch_add(&analytics->live.latency_count, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&analytics->live.latency_sum_us,
+                           (unsigned long long)queue_us, __ATOMIC_RELAXED);
+    }
+    if (in_warmup(analytics)) return;
     if (pthread_mutex_lock(&analytics->mutex) != 0) {
         fprintf(stderr, "[WARN] analytics_record_latency: mutex lock failed\n");
         return;
@@ -348,13 +611,181 @@ void analytics_record_latency(Analytics *analytics, long latency_ms) {
         analytics->max_latency_ms = latency_ms;
     if (latency_ms < analytics->min_latency_ms)
         analytics->min_latency_ms = latency_ms;
+    histogram_record(&analytics->queue_latency_hist, queue_us);
+    histogram_record(&analytics->corrected_latency_hist, corrected_us);
     if (pthread_mutex_unlock(&analytics->mutex) != 0) {
         fprintf(stderr, "[ERROR] analytics_record_latency: mutex unlock failed\n");
     }
 }
 
+void analytics_record_open_loop(Analytics *analytics, long long scheduled,
+                                long long missed) {
+    if (!analytics) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) return;
+    analytics->scheduled_sends += scheduled;
+    analytics->missed_slots += missed;
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_open_loop: mutex unlock failed\n");
+    }
+}
+
+void analytics_record_spawn(Analytics *analytics, long long spawn_us) {
+    if (!analytics) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) return;
+    analytics->spawn_count++;
+    analytics->spawn_total_us += spawn_us;
+    if (spawn_us > analytics->spawn_max_us)
+        analytics->spawn_max_us = spawn_us;
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_spawn: mutex unlock failed\n");
+    }
+}
+
+void analytics_record_first_op(Analytics *analytics, long long since_release_us) {
+    if (!analytics) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) return;
+    analytics->first_op_count++;
+    analytics->first_op_total_us += since_release_us;
+    if (since_release_us > analytics->first_op_max_us)
+        analytics->first_op_max_us = since_release_us;
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_first_op: mutex unlock failed\n");
+    }
+}
+
+/*
+ * Accumulates one thread's hardware counters into the role totals.
+ *
+ * Error handling: A sample with no valid counters still counts the
+ * thread (and keeps its errno) so the report can say perf was tried
+ * but denied, instead of silently omitting the section.
+ */
+void analytics_record_perf(Analytics *analytics, int is_consumer,
+                           const PerfSample *sample)
+{
+    PerfTotals *t;
+    int i;
+
+    if (!analytics || !sample) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[WARN] analytics_record_perf: mutex lock failed\n");
+        return;
+    }
+
+    t = is_consumer ? &analytics->consumer_perf : &analytics->producer_perf;
+    t->threads++;
+    if (t->open_errno == 0) t->open_errno = sample->open_errno;
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (!sample->valid[i]) continue;
+        t->totals[i] += sample->values[i];
+        t->valid_threads[i]++;
+    }
+
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_perf: mutex unlock failed\n");
+    }
+}
+
+void analytics_record_epoll(Analytics *analytics, long long wakeups,
+                            long long empty_wakeups)
+{
+    if (!analytics) return;
+    if (pthread_mutex_lock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[WARN] analytics_record_epoll: mutex lock failed\n");
+        return;
+    }
+    analytics->epoll_wakeups += wakeups;
+    analytics->empty_wakeups += empty_wakeups;
+    if (pthread_mutex_unlock(&analytics->mutex) != 0) {
+        fprintf(stderr, "[ERROR] analytics_record_epoll: mutex unlock failed\n");
+    }
+}
+
 /* --- Public API: Reporting --- */
 
+/*
+ * Formats one per-message counter cell ("n/a" when any thread of the
+ * role could not count it — a partial sum would under-report).
+ */
+static void format_perf_cell(char *buf, size_t size, const PerfTotals *t,
+                             int id, int messages)
+{
+    if (t->threads == 0 || t->valid_threads[id] != t->threads || messages <= 0) {
+        snprintf(buf, size, "n/a");
+    } else {
+        snprintf(buf, size, "%.1f", (double)t->totals[id] / messages);
+    }
+}
+
+/*
+ * Prints one row of the latency distribution table (values in ms).
+ */
+static void print_latency_row(const char *label, const Histogram *h)
+{
+    printf("  %-26s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", label,
+           histogram_mean(h) / 1000.0,
+           histogram_percentile(h, 50.0) / 1000.0,
+           histogram_percentile(h, 90.0) / 1000.0,
+           histogram_percentile(h, 99.0) / 1000.0,
+           histogram_percentile(h, 99.9) / 1000.0,
+           h->max / 1000.0);
+}
+
+/*
+ * Prints the hardware counter table, normalised per message.
+ * Producers are divided by messages produced, consumers by consumed.
+ */
+static void print_perf_section(const Analytics *analytics)
+{
+    const PerfTotals *p = &analytics->producer_perf;
+    const PerfTotals *c = &analytics->consumer_perf;
+    char p_cell[32], c_cell[32];
+    int i, any_valid = 0;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (p->valid_threads[i] > 0 || c->valid_threads[i] > 0) any_valid = 1;
+    }
+
+    printf("\nHARDWARE COUNTERS (per message)\n");
+
+    if (!any_valid) {
+        int err = p->open_errno ? p->open_errno : c->open_errno;
+        printf("  Unavailable: perf_event_open failed (%s, perf_event_paranoid=%d)\n",
+               err ? strerror(err) : "no samples", perf_paranoid_level());
+        printf("  Hint: run as root or lower kernel.perf_event_paranoid\n");
+        return;
+    }
+
+    printf("  %-18s %-14s %-14s\n", "Counter", "Producer", "Consumer");
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        format_perf_cell(p_cell, sizeof(p_cell), p, i, analytics->total_produced);
+        format_perf_cell(c_cell, sizeof(c_cell), c, i, analytics->total_consumed);
+        printf("  %-18s %-14s %-14s\n", perf_counter_name((PerfCounterId)i),
+               p_cell, c_cell);
+    }
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (p->valid_threads[i] != p->threads || c->valid_threads[i] != c->threads) {
+            int err = p->open_errno ? p->open_errno : c->open_errno;
+            printf("  (n/a = event not supported here: %s)\n",
+                   err ? strerror(err) : "not scheduled");
+            break;
+        }
+    }
+
+    /* Instructions per cycle is the quickest "why is it faster" signal */
+    if (p->valid_threads[PERF_CYCLES] > 0 && p->totals[PERF_CYCLES] > 0 &&
+        p->valid_threads[PERF_INSTRUCTIONS] == p->valid_threads[PERF_CYCLES]) {
+        printf("  Producer IPC:      %.2f\n",
+               (double)p->totals[PERF_INSTRUCTIONS] / p->totals[PERF_CYCLES]);
+    }
+    if (c->valid_threads[PERF_CYCLES] > 0 && c->totals[PERF_CYCLES] > 0 &&
+        c->valid_threads[PERF_INSTRUCTIONS] == c->valid_threads[PERF_CYCLES]) {
+        printf("  Consumer IPC:      %.2f\n",
+               (double)c->totals[PERF_INSTRUCTIONS] / c->totals[PERF_CYCLES]);
+    }
+}
+
 /*
  * Freezes metrics and calculates final timing.
  *
@@ -372,7 +803,768 @@ void analytics_finalise(Analytics *analytics)
     }
 
     analytics->end_time = time_elapsed();
-    analytics->total_runtime = analytics->end_time - analytics->start_time;
+
+    analytics->occupancy_valid =
+        (queue_occupancy_snapshot(analytics->queue_ptr, &analytics->occupancy) == 0);
+    queue_flow_stats(analytics->queue_ptr, &analytics->flow);
+    if (analytics->timewheel_ptr != NULL) {
+        timewheel_stats(analytics->timewheel_ptr, &analytics->timer);
+    }
+    queue_expiry_stats(analytics->queue_ptr, &analytics->expiry);
+    if (analytics->lease_ptr != NULL) {
+        lease_stats(analytics->lease_ptr, &analytics->leases);
+    }
+    queue_filter_stats(analytics->queue_ptr, &analytics->filter);
+    queue_coalesce_stats(analytics->queue_ptr, &analytics->coalesce);
+    queue_partition_stats(analytics->queue_ptr, &analytics->partition);
+    if (analytics->spill_ptr != NULL) {
+        spill_stats(analytics->spill_ptr, &analytics->spill);
+    }
+    queue_ready_stats(analytics->queue_ptr, &analytics->ready);
+    if (analytics->sink_ptr != NULL) {
+        sink_stats(analytics->sink_ptr, &analytics->sink);
+    }
+    if (analytics->ingest_ptr != NULL) {
+        ingest_stats(analytics->ingest_ptr, &analytics->ingest);
+    }
+    if (analytics->listener_ptr != NULL) {
+        listener_stats(analytics->listener_ptr, &analytics->listen);
+    }
+    if (analytics->rpc_ptr != NULL) {
+        rpc_stats(analytics->rpc_ptr, &analytics->rpc);
+    }
+    if (analytics->topic_ptr != NULL) {
+        topic_stats(analytics->topic_ptr, &analytics->topic, analytics->topic_groups);
+    }
+    if (analytics->queue_ptr->policy == QUEUE_POLICY_MLFQ) {
+        queue_policy_stats(analytics->queue_ptr, &analytics->mlfq);
+    }
+
+    /* Rates are computed over the measured window only */
+    analytics->total_runtime = analytics->end_time - analytics->warmup_end;
+    if (analytics->warmup_end < analytics->start_time) {
+        analytics->total_runtime = analytics->end_time - analytics->start_time;
+    }
+    if (analytics->total_runtime < 0.0) analytics->total_runtime = 0.0;
+}
+
+/* One row of the episode table: count, mean, p99, max in ms */
+static void print_episode_row(const char *label, const Histogram *h)
+{
+    if (h->total == 0) {
+        printf("  %-16s %8d\n", label, 0);
+        return;
+    }
+    printf("  %-16s %8llu %10.3f %10.3f %10.3f\n", label, h->total,
+           histogram_mean(h) / 1000.0,
+           histogram_percentile(h, 99.0) / 1000.0,
+           h->max / 1000.0);
+}
+
+/*
+ * Per-class enqueue outcome. With a reservation, the high class should
+ * show a much lower block rate than the normal class under a flood.
+ */
+static void print_class_section(const Analytics *analytics)
+{
+    int c;
+
+    if (analytics->reserved_slots > 0) {
+        printf("\nPRIORITY CLASSES (%d of %d slots reserved for priority >= %d)\n",
+               analytics->reserved_slots, analytics->queue_capacity, RESERVED_PRIORITY_MIN);
+    } else {
+        printf("\nPRIORITY CLASSES (no reservation)\n");
+    }
+    printf("  %-8s %9s %9s %8s %11s %10s\n",
+           "Class", "Enqueued", "Blocked", "Block %", "Avg Wait", "Max Wait");
+    for (c = 0; c < PRIO_NUM_CLASSES; c++) {
+        const ClassStats *cs = &analytics->class_stats[c];
+        printf("  %-8s %9lld %9lld %7.1f%% %8.1f ms %7ld ms\n",
+               queue_priority_class_name((PriorityClass)c), cs->enqueued, cs->blocked,
+               cs->enqueued > 0 ? (double)cs->blocked / cs->enqueued * 100.0 : 0.0,
+               cs->blocked > 0 ? (double)cs->wait_total_ms / cs->blocked : 0.0,
+               cs->wait_max_ms);
+    }
+}
+
+/*
+ * Slot admission cost. Semaphore mode pays at least one sem op per
+ * enqueue plus one sem_post per dequeue; credit mode pays one atomic
+ * grab per batch and one atomic add per dequeue. Stranded credits are
+ * the fairness cost: a producer found the pool empty while others
+ * still held unspent credits.
+ */
+static void print_flow_section(const Analytics *analytics)
+{
+    const QueueFlowStats *f = &analytics->flow;
+    double per_msg;
+
+    if (f->enqueues == 0) return;
+
+    printf("\nFLOW CONTROL (%s)\n",
+           analytics->credit_batch > 0 ? "credits" : "slot semaphore");
+    if (analytics->credit_batch == 0) {
+        per_msg = (double)f->slot_sem_ops / f->enqueues;
+        printf("  Slot Sem Ops:     %lld for %lld enqueues (%.2f per message)\n",
+               f->slot_sem_ops, f->enqueues, per_msg);
+        return;
+    }
+
+    per_msg = (double)(f->credit_grabs + f->credit_returns) / f->enqueues;
+    printf("  Credit Batch:     up to %d per grab\n", analytics->credit_batch);
+    printf("  Atomic Steps:     %lld grabs + %lld returns for %lld enqueues (%.2f per message)\n",
+           f->credit_grabs, f->credit_returns, f->enqueues, per_msg);
+    printf("  Credits:          %lld granted, %.2f per grab, %lld returned unused\n",
+           f->credits_granted,
+           f->credit_grabs > 0 ? (double)f->credits_granted / f->credit_grabs : 0.0,
+           f->credits_returned_unused);
+    if (f->grab_blocks > 0) {
+        printf("  Stranded:         %lld of %lld empty-pool waits had credits idle elsewhere "
+               "(avg %.1f)\n", f->stranded_blocks, f->grab_blocks,
+               f->stranded_blocks > 0 ? (double)f->stranded_sum / f->stranded_blocks : 0.0);
+    } else {
+        printf("  Stranded:         0 (pool never ran dry)\n");
+    }
+}
+
+/*
+ * Delayed delivery through the timing wheel. Lateness is the time from
+ * a message's not_before deadline to its insertion in the ready queue:
+ * tick rounding and timer wake-up jitter, plus any wait for a queue slot.
+ */
+static void print_delay_section(const Analytics *analytics)
+{
+    const TimerStats *t = &analytics->timer;
+
+    printf("\nSCHEDULED DELIVERY (timing wheel, %d x %d slots, %d us tick)\n",
+           TW_LEVELS, TW_SLOTS, TIMER_TICK_US);
+    printf("  Max Delay:        %d ms\n", analytics->max_delay_ms);
+    printf("  Scheduled:        %lld (peak %d pending, %lld pool-full waits)\n",
+           t->scheduled, t->max_pending, t->pool_full_waits);
+    printf("  Promoted:         %lld (%d still delayed, %lld cascades, "
+           "%lld waited for a slot)\n",
+           t->promoted, t->pending, t->cascaded, t->blocked_promotions);
+    if (t->lateness_us.total == 0) {
+        printf("  Lateness:         no messages delivered\n");
+        return;
+    }
+    printf("  Lateness (ms):    mean %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+           histogram_mean(&t->lateness_us) / 1000.0,
+           histogram_percentile(&t->lateness_us, 50.0) / 1000.0,
+           histogram_percentile(&t->lateness_us, 90.0) / 1000.0,
+           histogram_percentile(&t->lateness_us, 99.0) / 1000.0,
+           t->lateness_us.max / 1000.0);
+}
+
+/*
+ * TTL drops per priority. Items dropped at dequeue cost a consumer a
+ * scan; swept items were reclaimed before any consumer reached them.
+ * The sweeper's longest lock hold shows the batch bound in practice.
+ */
+static void print_expiry_section(const Analytics *analytics)
+{
+    const QueueExpiryStats *e = &analytics->expiry;
+    long long total_deq = 0, total_swept = 0;
+    int p;
+
+    printf("\nEXPIRED MESSAGES (TTL %d ms)\n", analytics->ttl_ms);
+    printf("  %-8s %11s %9s %9s\n", "Priority", "At Dequeue", "Swept", "Total");
+    for (p = PRIORITY_MAX; p >= PRIORITY_MIN; p--) {
+        if (e->at_dequeue[p] + e->swept[p] == 0) continue;
+        printf("  %-8d %11lld %9lld %9lld\n", p, e->at_dequeue[p], e->swept[p],
+               e->at_dequeue[p] + e->swept[p]);
+        total_deq += e->at_dequeue[p];
+        total_swept += e->swept[p];
+    }
+    printf("  %-8s %11lld %9lld %9lld", "All", total_deq, total_swept,
+           total_deq + total_swept);
+    if (analytics->total_produced > 0) {
+        printf(" (%.1f%% of produced)",
+               (double)(total_deq + total_swept) / analytics->total_produced * 100.0);
+    }
+    printf("\n");
+    printf("  Sweeper:          %lld passes, max lock hold %lld us (<= %d items/pass)\n",
+           e->sweeps, e->sweep_hold_max_us, TTL_SWEEP_BATCH);
+    if (e->phantom_wakeups > 0) {
+        printf("  Phantom Wakeups:  %lld (consumer woke for an item already dropped)\n",
+               e->phantom_wakeups);
+    }
+}
+
+/*
+ * Selective receive. Candidates per dequeue is what the position
+ * indexes made the consumer look at; the queue depth is what a plain
+ * scan would have walked. Stale wake-ups lost the race for the item.
+ */
+static void print_filter_section(const Analytics *analytics)
+{
+    const QueueFilterStats *f = &analytics->filter;
+
+    printf("\nSELECTIVE RECEIVE (%d filtered consumer%s)\n", analytics->filtered_consumers,
+           analytics->filtered_consumers == 1 ? "" : "s");
+    printf("  Filtered Dequeues: %lld\n", f->dequeues);
+    if (f->dequeues > 0) {
+        double cand = (double)f->candidates / f->dequeues;
+        double depth = (double)f->depth_sum / f->dequeues;
+        printf("  Index Lookups:    %.2f candidates examined vs %.2f queued per dequeue",
+               cand, depth);
+        if (depth > 0.0) printf(" (%.0f%% skipped)", (1.0 - cand / depth) * 100.0);
+        printf("\n");
+    }
+    printf("  Waits:            %lld (%lld targeted wake-ups, %lld stale)\n",
+           f->waits, f->targeted_wakeups, f->stale_wakeups);
+}
+
+/*
+ * Key coalescing. Each folded update is a slot that was never taken
+ * (or handed straight back) and a dequeue no consumer had to do; the
+ * saving is measured against the deliveries that would otherwise have
+ * been made. Probes per lookup show how well the key index hashes.
+ */
+static void print_coalesce_section(const Analytics *analytics)
+{
+    const QueueCoalesceStats *c = &analytics->coalesce;
+    long long updates = c->stored + c->coalesced;
+
+    printf("\nKEY COALESCING (%d keys)\n", analytics->coalesce_keys);
+    printf("  Keyed Updates:    %lld (%lld stored, %lld coalesced)\n",
+           updates, c->stored, c->coalesced);
+    if (updates > 0) {
+        printf("  Coalescing Ratio: %.1f%% of updates folded into a queued message\n",
+               (double)c->coalesced / updates * 100.0);
+    }
+    printf("  Slots Saved:      %lld (%lld never took one, %lld handed straight back)\n",
+           c->coalesced, c->without_slot, c->slot_returned);
+    if (c->coalesced + analytics->total_consumed > 0) {
+        printf("  Dequeues Saved:   %lld (%.1f%% of consumer work, %d consumed)\n",
+               c->coalesced,
+               (double)c->coalesced / (c->coalesced + analytics->total_consumed) * 100.0,
+               analytics->total_consumed);
+    }
+    printf("  Priority Raised:  %lld folds, max %d updates in one message\n",
+           c->priority_raised, c->max_merged);
+    if (c->lookups > 0) {
+        printf("  Key Index:        %.2f probes per lookup (%d buckets)\n",
+               (double)c->probes / c->lookups, COALESCE_HASH_SIZE);
+    }
+}
+
+/*
+ * Partitioned delivery. Skew compares the busiest partition with the
+ * mean: parallelism is capped by how evenly the keys spread. Every
+ * message costs one partition lease; a hand-off is a lease taken by a
+ * different consumer than the last, and the gap is how long a
+ * partition with backlog waited between release and the next lease.
+ */
+static void print_partition_section(const Analytics *analytics)
+{
+    const QueuePartitionStats *ps = &analytics->partition;
+    long long total = 0, busiest = 0;
+    int p, c, owners, hot = 0;
+
+    printf("\nPARTITIONS (%d, per-key FIFO, keyed by %s)\n", analytics->partitions,
+           analytics->partition_by_key ? "message key" : "producer");
+    printf("  %-9s %9s %7s %10s %10s\n", "Partition", "Arrivals", "Share", "Delivered",
+           "Consumers");
+    for (p = 0; p < analytics->partitions; p++) total += ps->arrivals[p];
+    for (p = 0; p < analytics->partitions; p++) {
+        for (owners = 0, c = 1; c <= MAX_CONSUMERS; c++) {
+            if (ps->owners[p] & (1u << c)) owners++;
+        }
+        printf("  %-9d %9lld %6.1f%% %10lld %10d\n", p, ps->arrivals[p],
+               total > 0 ? (double)ps->arrivals[p] / total * 100.0 : 0.0,
+               ps->delivered[p], owners);
+        if (ps->arrivals[p] > busiest) {
+            busiest = ps->arrivals[p];
+            hot = p;
+        }
+    }
+    if (total > 0) {
+        printf("  Skew:             %.2fx mean arrivals in the busiest partition (%d)\n",
+               (double)busiest * analytics->partitions / total, hot);
+    }
+    printf("  Leases:           %lld (one per message), %lld hand-offs to another consumer",
+           ps->acquisitions, ps->handoffs);
+    if (ps->acquisitions > 0) {
+        printf(" (%.1f%%)", (double)ps->handoffs / ps->acquisitions * 100.0);
+    }
+    printf("\n");
+    if (ps->handoff_us.total > 0) {
+        printf("  Hand-off Gap:     p50 %.3f ms, p99 %.3f ms, max %.3f ms (%lld backlogged releases)\n",
+               histogram_percentile(&ps->handoff_us, 50.0) / 1000.0,
+               histogram_percentile(&ps->handoff_us, 99.0) / 1000.0,
+               ps->handoff_us.max / 1000.0, (long long)ps->handoff_us.total);
+    }
+    printf("  Lease Waits:      %lld (items queued, all in partitions other consumers held)\n",
+           ps->lease_waits);
+}
+
+/* Formats a microsecond histogram as "p50 a ms, p99 b ms, max c ms" */
+static void print_ms_tail(const Histogram *h)
+{
+    printf("p50 %.3f ms, p99 %.3f ms, max %.3f ms",
+           histogram_percentile(h, 50.0) / 1000.0, histogram_percentile(h, 99.0) / 1000.0,
+           h->max / 1000.0);
+}
+
+/*
+ * File sink. Throughput is over the measured run; device bandwidth is
+ * bytes over the writer's busy time. A group is everything sealed when
+ * the writer woke: one io_uring submission or one writev. Commit
+ * latency runs from the first record in a buffer to its write (and
+ * fdatasync) completing, so the fsync line shows what syncing adds.
+ */
+static void print_sink_section(const Analytics *analytics)
+{
+    const SinkStats *sk = &analytics->sink;
+
+    printf("\nFILE SINK (%s via %s%s)\n", analytics->sink_ptr->path,
+           sink_backend_name(analytics->sink_ptr),
+           analytics->sink_ptr->sync ? " + fdatasync" : "");
+    printf("  Written:          %lld records, %.1f KB", sk->records, sk->bytes / 1024.0);
+    if (analytics->total_runtime > 0.0) {
+        printf(" (%.1f KB/s over the run)", sk->bytes / 1024.0 / analytics->total_runtime);
+    }
+    printf("\n");
+    if (sk->busy_us > 0) {
+        printf("  Write Bandwidth:  %.1f MB/s while writing (%.1f%% of the run busy)\n",
+               (double)sk->bytes / sk->busy_us,
+               analytics->total_runtime > 0.0 ?
+               sk->busy_us / 1e4 / analytics->total_runtime : 0.0);
+    }
+    printf("  Group Commits:    %lld (%lld system calls)", sk->commits, sk->submissions);
+    if (sk->commits > 0) {
+        printf(", %.2f buffers and %.1f records per group (p99 %lld records)",
+               histogram_mean(&sk->batch_buffers), histogram_mean(&sk->batch_records),
+               histogram_percentile(&sk->batch_records, 99.0));
+    }
+    printf("\n");
+    if (sk->write_us.total > 0) {
+        printf("  Write Time:       ");
+        print_ms_tail(&sk->write_us);
+        printf(" per group\n");
+    }
+    if (sk->fsync_us.total > 0) {
+        printf("  fdatasync:        ");
+        print_ms_tail(&sk->fsync_us);
+        printf(" (mean %.3f ms)\n", histogram_mean(&sk->fsync_us) / 1000.0);
+    }
+    if (sk->commit_us.total > 0) {
+        printf("  Commit Latency:   ");
+        print_ms_tail(&sk->commit_us);
+        printf(" (first append to %s)\n", analytics->sink_ptr->sync ? "durable" : "written");
+    }
+    printf("  Buffer Stalls:    %lld appends waited for a free buffer", sk->stalls);
+    if (sk->write_errors > 0) printf(", %lld failed writes", sk->write_errors);
+    printf("\n");
+}
+
+/*
+ * Request/response. The clients are closed-loop with a fixed number of
+ * requests in flight, so the reply rate is the most this configuration
+ * sustains; by Little's law it should equal outstanding / mean RTT.
+ */
+static void print_rpc_section(const Analytics *analytics)
+{
+    const RpcStats *rs = &analytics->rpc;
+    const RpcTable *t = analytics->rpc_ptr;
+    double mean_us = histogram_mean(&analytics->rpc_rtt_hist);
+    int in_flight = t->num_clients * t->max_outstanding;
+    int i;
+
+    printf("\nREQUEST / RESPONSE (%d client%s, %d outstanding each)\n",
+           t->num_clients, t->num_clients == 1 ? "" : "s", t->max_outstanding);
+    printf("  Requests:         %lld sent, %lld replies, %d unanswered at stop",
+           rs->requests, rs->replies, rs->unanswered);
+    if (rs->stale > 0) printf(", %lld stale replies", rs->stale);
+    printf("\n");
+    if (analytics->rpc_replies == 0 || analytics->total_runtime <= 0.0) {
+        printf("  Round Trip:       no replies in the measured window\n");
+        return;
+    }
+    printf("  Sustained Rate:   %.1f req/s (closed loop, %d requests in flight)\n",
+           analytics->rpc_replies / analytics->total_runtime, in_flight);
+    printf("  Round Trip:       mean %.3f ms, ", mean_us / 1000.0);
+    print_ms_tail(&analytics->rpc_rtt_hist);
+    printf("\n");
+    if (mean_us > 0.0) {
+        printf("  Little's Law:     %d in flight / %.3f ms mean RTT = %.1f req/s\n",
+               in_flight, mean_us / 1000.0, in_flight * 1e6 / mean_us);
+    }
+    printf("  Per Client:      ");
+    for (i = 0; i < t->num_clients; i++) {
+        printf(" P%d %lld (%.2f ms)", i + 1, rs->client_replies[i],
+               rs->client_mean_rtt_us[i] / 1000.0);
+    }
+    printf("\n");
+}
+
+/*
+ * MLFQ policy. Each class's level is where its observed service time
+ * left it at the end of the run (the last periodic reset may have
+ * moved everything back to level 0 shortly before).
+ */
+static void print_mlfq_section(const Analytics *analytics)
+{
+    const QueueMlfq *m = &analytics->mlfq;
+    long long quantum = m->quantum_us;
+    int c, level;
+
+    printf("\nDEQUEUE POLICY (MLFQ, %d levels)\n", MLFQ_LEVELS);
+    printf("  Quanta:          ");
+    for (level = 0; level < MLFQ_LEVELS; level++) {
+        printf(" L%d %.3f ms", level, quantum / 1000.0);
+        quantum *= MLFQ_QUANTUM_FACTOR;
+    }
+    printf("\n");
+    printf("  Moves:            %lld demotions, %lld promotions, %lld resets (every %d ms)\n",
+           m->demotions, m->promotions, m->resets, MLFQ_RESET_MS);
+    for (c = PRIORITY_MAX; c >= PRIORITY_MIN; c--) {
+        if (m->charged[c] == 0) continue;
+        printf("  Class %d:          level %d, %lld served, mean service %.3f ms\n",
+               c, m->level[c], m->charged[c], (double)m->service_us[c] / m->charged[c] / 1000.0);
+    }
+}
+
+/*
+ * Topic fan-out. Lag is how far a group trails the publishers; the
+ * slowest group holds the log's oldest slot, so its stalls are the
+ * publishes it held up. Memory compares the one shared log with what
+ * a queue per group would need to hold the same messages.
+ */
+static void print_topic_section(const Analytics *analytics)
+{
+    const TopicStats *ts = &analytics->topic;
+    const Topic *t = analytics->topic_ptr;
+    size_t slot_bytes = (size_t)t->capacity * sizeof(Message);
+    long long delivered = 0;
+    int g;
+
+    for (g = 0; g < t->num_groups; g++) delivered += analytics->topic_groups[g].delivered;
+
+    printf("\nTOPIC FAN-OUT (%d group%s, shared log of %d slots)\n",
+           t->num_groups, t->num_groups == 1 ? "" : "s", t->capacity);
+    printf("  Published:        %lld messages, %lld deliveries over all groups, "
+           "%lld publishes waited for the slowest group\n",
+           ts->published, delivered, ts->blocked_publishes);
+    printf("  Log:              peak %d retained, %lld slots reclaimed by the min cursor\n",
+           ts->peak_retained, ts->reclaimed);
+    for (g = 0; g < t->num_groups; g++) {
+        const TopicGroupStats *gs = &analytics->topic_groups[g];
+        printf("  Group %-2d (%d c):   %lld read, lag now %lld, mean %.1f, max %lld",
+               g + 1, gs->consumers, gs->delivered, gs->lag,
+               ts->published > 0 ? (double)gs->lag_sum / ts->published : 0.0, gs->max_lag);
+        if (gs->stalls > 0) printf(", slowest for %lld stalls", gs->stalls);
+        printf("\n");
+    }
+    printf("  Memory:           %.1f KB of message slots shared; a queue per group "
+           "would hold %.1f KB (%d x %.1f KB)\n",
+           slot_bytes / 1024.0, t->num_groups * slot_bytes / 1024.0,
+           t->num_groups, slot_bytes / 1024.0);
+    printf("                    structures: %.1f KB topic vs %.1f KB for %d Queue instances\n",
+           sizeof(Topic) / 1024.0, t->num_groups * sizeof(Queue) / 1024.0, t->num_groups);
+    printf("  Copies Avoided:   %lld message copies (%.1f KB) a queue per group would have made\n",
+           ts->published * (t->num_groups - 1),
+           ts->published * (t->num_groups - 1) * (double)sizeof(Message) / 1024.0);
+}
+
+/*
+ * Socket listener. Frames per read shows how much each wake-up
+ * carried; paused time is how long the listener sat in a full-queue
+ * enqueue, during which no client was read (their sends see EAGAIN).
+ */
+static void print_listen_section(const Analytics *analytics)
+{
+    const ListenStats *ls = &analytics->listen;
+
+    printf("\nSOCKET LISTENER (%s, %lld client%s)\n", analytics->listener_ptr->path,
+           ls->accepted, ls->accepted == 1 ? "" : "s");
+    printf("  Clients:          %lld accepted, peak %d at once, %lld refused, %lld protocol errors\n",
+           ls->accepted, ls->peak_conns, ls->refused, ls->protocol_errors);
+    printf("  Frames:           %lld enqueued", ls->frames);
+    if (analytics->total_runtime > 0.0) {
+        printf(" (%.0f frames/s over the run)", ls->frames / analytics->total_runtime);
+    }
+    if (ls->bad_frames > 0) printf(", %lld with a bad priority skipped", ls->bad_frames);
+    if (ls->abandoned > 0) printf(", %lld read but not stored at shutdown", ls->abandoned);
+    printf("\n");
+    printf("  Reads:            %lld read() calls over %lld wake-ups", ls->reads, ls->wakeups);
+    if (ls->reads > 0) {
+        printf(", %.1f frames per read (p99 %lld)", histogram_mean(&ls->batch_frames),
+               histogram_percentile(&ls->batch_frames, 99.0));
+    }
+    printf("\n");
+    printf("  Back-Pressure:    %lld batches waited for free slots, reading paused %.3f ms",
+           ls->pushbacks, ls->paused_us / 1e3);
+    if (analytics->total_runtime > 0.0) {
+        printf(" (%.1f%% of the run)", ls->paused_us / 1e4 / analytics->total_runtime);
+    }
+    printf("\n");
+}
+
+/*
+ * Ingestion source. Parse speed is bytes over the time spent in the
+ * parser alone (summed over the reading producers, so per thread);
+ * the ingest rate is bytes over first parse to end of input, which
+ * also pays for read(), batch enqueues and waiting for free slots.
+ */
+static void print_ingest_section(const Analytics *analytics)
+{
+    const IngestStats *is = &analytics->ingest;
+    const Ingest *in = analytics->ingest_ptr;
+    long long span_us = is->end_us - is->start_us;
+
+    printf("\nINGEST SOURCE (%s via %s, %d reader%s)\n",
+           strcmp(in->path, "-") == 0 ? "stdin" : in->path, ingest_mode_name(in),
+           in->num_readers, in->num_readers == 1 ? "" : "s");
+    printf("  Input:            %.1f KB, %lld message lines (%lld malformed, %lld blank/comment)\n",
+           is->bytes / 1024.0, is->lines, is->malformed, is->skipped);
+    printf("  Parsed:           %lld messages in %.3f ms of parser time", is->messages,
+           is->parse_ns / 1e6);
+    if (is->parse_ns > 0) {
+        printf(" (%.2f GB/s, %.1f M msg/s per thread)",
+               (double)is->bytes / is->parse_ns, is->messages * 1e3 / is->parse_ns);
+    }
+    printf("\n");
+    if (is->end_us > 0 && span_us > 0) {
+        printf("  Ingest Rate:      %.1f MB/s, %.0f msg/s (first parse to end of input)\n",
+               (double)is->bytes / span_us, is->messages * 1e6 / span_us);
+    } else if (is->end_us == 0) {
+        printf("  Ingest Rate:      input not finished when the run stopped\n");
+    }
+    printf("  Batch Enqueues:   %lld", is->batches);
+    if (is->batches > 0) {
+        printf(" (%.1f messages per batch, %.1f%% blocked, %.3f ms enqueuing)",
+               (double)is->messages / is->batches, 100.0 * is->blocked_batches / is->batches,
+               is->enqueue_us / 1e3);
+    }
+    printf("\n");
+    if (in->mode == INGEST_STREAM) {
+        printf("  Reads:            %lld read() calls", is->reads);
+        if (is->reads > 0) printf(", %.1f KB per call", is->bytes / 1024.0 / is->reads);
+        printf(", %.3f ms reading\n", is->read_ns / 1e6);
+    } else {
+        printf("  Reads:            none (file mapped, %lu KB)\n",
+               (unsigned long)(in->map_bytes / 1024));
+    }
+}
+
+/*
+ * Epoll readiness. Level mode writes the eventfd only on the empty to
+ * non-empty edge and drains it on the way back, so writes per message
+ * fall as the queue stays busy; edge mode writes on every arrival.
+ * Empty wake-ups are consumers woken for an item another one took.
+ */
+static void print_epoll_section(const Analytics *analytics)
+{
+    const QueueReadyStats *r = &analytics->ready;
+    long long consumed = analytics->total_consumed;
+
+    printf("\nEPOLL READINESS (%s-triggered eventfd)\n",
+           analytics->epoll_mode - 1 == QUEUE_READY_EDGE ? "edge" : "level");
+    printf("  Eventfd Writes:   %lld", r->signals);
+    if (analytics->total_produced > 0) {
+        printf(" (%.3f per message)", (double)r->signals / analytics->total_produced);
+    }
+    printf(", %lld drained on empty", r->clears);
+    if (r->write_failures > 0) printf(", %lld failed", r->write_failures);
+    printf("\n");
+    printf("  Wake-ups:         %lld", analytics->epoll_wakeups);
+    if (consumed > 0) {
+        printf(" (%.3f per message)", (double)analytics->epoll_wakeups / consumed);
+    }
+    printf(", %lld empty", analytics->empty_wakeups);
+    if (analytics->epoll_wakeups > 0) {
+        printf(" (%.1f%%)", (double)analytics->empty_wakeups / analytics->epoll_wakeups * 100.0);
+    }
+    printf("\n");
+}
+
+/*
+ * Disk spill-over. Volume is what the full ring pushed to the file
+ * (arrivals plus evicted low-priority messages); copy bandwidth is
+ * bytes over the time spent in memcpy to and from the mapping, while
+ * the sustained rate spreads the volume over the run. Residence is
+ * the latency the disk tier added to each message that went through it.
+ */
+static void print_spill_section(const Analytics *analytics)
+{
+    const SpillStats *sp = &analytics->spill;
+    int p, first = 1;
+
+    printf("\nDISK SPILL-OVER (%d records, %lu bytes each, mmapped file)\n",
+           analytics->spill_ptr->capacity, (unsigned long)sizeof(SpillRecord));
+    printf("  Spilled:          %lld messages (%lld arrivals, %lld evicted by a higher priority)",
+           sp->spilled, sp->spilled - sp->evictions, sp->evictions);
+    if (analytics->total_produced > 0) {
+        printf(", %.1f%% of produced",
+               (double)(sp->spilled - sp->evictions) / analytics->total_produced * 100.0);
+    }
+    printf("\n");
+    printf("  By Priority:     ");
+    for (p = PRIORITY_MAX; p >= PRIORITY_MIN; p--) {
+        if (sp->spilled_by_priority[p] == 0) continue;
+        printf("%s P%d=%lld", first ? "" : ",", p, sp->spilled_by_priority[p]);
+        first = 0;
+    }
+    printf("%s\n", first ? " none" : "");
+    printf("  Refilled:         %lld (%d still on disk, peak %d)\n",
+           sp->refilled, sp->pending, sp->max_pending);
+    printf("  Volume:           %.1f KB written, %.1f KB read",
+           sp->bytes_written / 1024.0, sp->bytes_read / 1024.0);
+    if (analytics->total_runtime > 0.0) {
+        printf(" (%.1f KB/s sustained)",
+               (sp->bytes_written + sp->bytes_read) / 1024.0 / analytics->total_runtime);
+    }
+    printf("\n");
+    if (sp->write_ns > 0 || sp->read_ns > 0) {
+        printf("  Copy Bandwidth:   write %.1f MB/s, read %.1f MB/s (page cache)\n",
+               sp->write_ns > 0 ? sp->bytes_written * 1000.0 / sp->write_ns : 0.0,
+               sp->read_ns > 0 ? sp->bytes_read * 1000.0 / sp->read_ns : 0.0);
+    }
+    if (sp->residence_us.total > 0) {
+        printf("  Disk Residence:   mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms "
+               "(latency added)\n",
+               histogram_mean(&sp->residence_us) / 1000.0,
+               histogram_percentile(&sp->residence_us, 50.0) / 1000.0,
+               histogram_percentile(&sp->residence_us, 99.0) / 1000.0,
+               sp->residence_us.max / 1000.0);
+    }
+    printf("  Spill File Full:  %lld enqueues blocked instead\n", sp->full_blocks);
+}
+
+/*
+ * At-least-once delivery. Every lease beyond the first per message is
+ * the price of the guarantee: redeliveries after a nack or a timeout,
+ * and late acks whose work was thrown away. Ack time is lease to ack.
+ */
+static void print_delivery_section(const Analytics *analytics)
+{
+    const LeaseStats *l = &analytics->leases;
+    int p, i, first = 1;
+
+    printf("\nDELIVERY (at-least-once, ack within %d ms, dead-letter after %d)\n",
+           analytics->ack_timeout_ms, analytics->max_deliveries);
+    printf("  Leases:           %lld (peak %d in flight, %d still in flight)\n",
+           l->leases, l->max_in_flight, l->in_flight);
+    printf("  Acked:            %lld", l->acks);
+    if (l->acks > 0) {
+        printf(" (%.2f deliveries per acked message, max %lld)",
+               histogram_mean(&l->deliveries), l->deliveries.max);
+    }
+    printf("\n");
+    printf("  Nacked:           %lld (injected failure rate %d%%)\n",
+           l->nacks, analytics->fail_pct);
+    printf("  Timed Out:        %lld (%lld late acks, work done twice)\n",
+           l->timeouts, l->late_acks);
+    printf("  Redelivered:      %lld\n", l->redeliveries);
+    printf("  Dead-lettered:    %lld", l->dead_lettered);
+    if (analytics->total_produced > 0) {
+        printf(" (%.1f%% of produced)",
+               (double)l->dead_lettered / analytics->total_produced * 100.0);
+    }
+    for (p = PRIORITY_MAX; p >= PRIORITY_MIN; p--) {
+        if (l->dead_by_priority[p] == 0) continue;
+        printf("%s pri %d: %lld", first ? " |" : ",", p, l->dead_by_priority[p]);
+        first = 0;
+    }
+    printf("\n");
+    for (i = 0; i < l->recent_dead_count; i++) {
+        const Message *m = &l->recent_dead[i];
+        printf("  %s P%d data=%d (pri %d, %d deliveries)\n",
+               i == 0 ? "Latest DLQ:      " : "                 ",
+               m->producer_id, m->data, m->priority, m->attempts);
+    }
+    if (l->table_full > 0) {
+        printf("  Unleased:         %lld (lease table full, delivered at-most-once)\n",
+               l->table_full);
+    }
+    if (l->ack_us.total > 0) {
+        printf("  Ack Time (ms):    mean %.2f  p50 %.2f  p99 %.2f  max %.2f\n",
+               histogram_mean(&l->ack_us) / 1000.0,
+               histogram_percentile(&l->ack_us, 50.0) / 1000.0,
+               histogram_percentile(&l->ack_us, 99.0) / 1000.0,
+               l->ack_us.max / 1000.0);
+    }
+}
+
+/*
+ * Exact time-weighted occupancy, depth distribution, full/empty
+ * episode durations, and a Little's law cross-check (L = lambda * W)
+ * using the consume rate and the mean enqueue -> dequeue latency.
+ */
+static void print_occupancy_section(const Analytics *analytics, double sampled_mean)
+{
+    const QueueOccupancy *occ = &analytics->occupancy;
+    long long window_us = queue_occupancy_window_us(occ);
+    double mean, lambda, wait_sec, predicted, items;
+    int depth;
+
+    if (window_us <= 0) return;
+    mean = queue_occupancy_mean(occ);
+
+    printf("\nOCCUPANCY (exact, time-weighted over %.2f sec)\n", window_us / 1e6);
+    printf("  Mean Depth:       %.3f items (1 Hz samples: %.2f)\n", mean, sampled_mean);
+    printf("  %-8s %9s\n", "Depth", "% of time");
+    for (depth = 0; depth <= analytics->queue_capacity && depth <= MAX_QUEUE_SIZE; depth++) {
+        if (occ->depth_us[depth] == 0) continue;
+        printf("  %-8d %8.2f%%\n", depth,
+               (double)occ->depth_us[depth] / (double)window_us * 100.0);
+    }
+
+    printf("  %-16s %8s %10s %10s %10s\n", "Episodes (ms)", "Count", "Mean", "p99", "Max");
+    print_episode_row("Full", &occ->full_episodes);
+    print_episode_row("Empty", &occ->empty_episodes);
+
+    /* Little's law: mean depth = arrival rate * mean time in queue.
+     * Messages still queued at the end count with their time so far,
+     * otherwise a short run's tail makes the check look wrong. */
+    items = (double)analytics->queue_latency_hist.total + occ->residual_items;
+    if (items > 0.0) {
+        lambda = items / (window_us / 1e6);
+        wait_sec = (analytics->queue_latency_hist.sum + (double)occ->residual_us) /
+                   items / 1e6;
+        predicted = lambda * wait_sec;
+        printf("  Little's Law:     L = %.3f measured vs lambda*W = %.2f/s x %.3f ms = %.3f",
+               mean, lambda, wait_sec * 1000.0, predicted);
+        if (mean > 0.0) {
+            printf(" (%+.1f%%)", (predicted - mean) / mean * 100.0);
+        }
+        printf("\n");
+    }
+}
+
+/* One row of the live-rates table: value per EWMA window */
+static void print_rates_row(const char *label, const double *windows)
+{
+    int i;
+    printf("  %-22s", label);
+    for (i = 0; i < EWMA_NUM_WINDOWS; i++) printf(" %10.2f", windows[i]);
+    printf("\n");
+}
+
+/*
+ * Final values of the sliding windows, as the TUI last showed them.
+ * Unlike the totals above these include the warm-up window.
+ */
+static void print_rates_section(const Analytics *analytics)
+{
+    AnalyticsRates rates;
+    int i;
+
+    if (analytics_get_rates(analytics, &rates) != 0) return;
+
+    printf("\nLIVE RATES (EWMA at shutdown)\n");
+    printf("  %-22s", "Window");
+    for (i = 0; i < EWMA_NUM_WINDOWS; i++)
+        printf(" %10s", analytics_ewma_window_name((EwmaWindow)i));
+    printf("\n");
+    print_rates_row("Produced (msg/sec)", rates.produce_rate);
+    print_rates_row("Consumed (msg/sec)", rates.consume_rate);
+    print_rates_row("Producer blocks/sec", rates.producer_block_rate);
+    print_rates_row("Consumer blocks/sec", rates.consumer_block_rate);
+    print_rates_row("Occupancy (items)", rates.occupancy);
+    print_rates_row("Latency (ms)", rates.latency_ms);
 }
 
 /*
@@ -391,10 +1583,10 @@ void analytics_print_summary(const Analytics *analytics)
     if (!analytics) return;
 
     /* Calculate derived metrics with division-by-zero guards */
-    if (analytics->num_samples > 0) {
-        avg_occupancy = (double)analytics->queue_occupancy_sum / analytics->num_samples;
-        percent_full = (double)analytics->queue_full_count / analytics->num_samples * 100.0;
-        percent_empty = (double)analytics->queue_empty_count / analytics->num_samples * 100.0;
+    if (analytics->aggregate_samples > 0) {
+        avg_occupancy = (double)analytics->queue_occupancy_sum / analytics->aggregate_samples;
+        percent_full = (double)analytics->queue_full_count / analytics->aggregate_samples * 100.0;
+        percent_empty = (double)analytics->queue_empty_count / analytics->aggregate_samples * 100.0;
 
         /* Guard against queue_capacity == 0 (should never happen but defensive) */
         if (analytics->queue_capacity > 0) {
@@ -424,20 +1616,51 @@ void analytics_print_summary(const Analytics *analytics)
     printf("  Queue Capacity:   %-5d Runtime:          %.2f sec\n",
            analytics->queue_capacity, analytics->total_runtime);
 
+    printf("\nSTARTUP\n");
+    printf("  Spawn Phase:      %.2f ms (%d threads parked at the start gate)\n",
+           analytics->spawn_phase_us / 1000.0, analytics->spawn_count);
+    if (analytics->spawn_count > 0) {
+        printf("  Spawn Latency:    avg %.1f us, max %lld us (create -> running)\n",
+               (double)analytics->spawn_total_us / analytics->spawn_count,
+               analytics->spawn_max_us);
+    }
+    if (analytics->first_op_count > 0) {
+        printf("  First Operation:  avg %.2f ms, max %.2f ms (release -> first op)\n",
+               (double)analytics->first_op_total_us / analytics->first_op_count / 1000.0,
+               analytics->first_op_max_us / 1000.0);
+    }
+    if (analytics->warmup_seconds > 0.0) {
+        printf("  Warm-up Window:   %.1f sec excluded from aggregates\n",
+               analytics->warmup_seconds);
+    }
+
     printf("\nQUEUE METRICS\n");
     printf("  Avg Occupancy:    %.2f items (%.1f%% Utilisation)\n", avg_occupancy, utilisation);
     printf("  Peak Occupancy:   %d items\n", analytics->queue_max_occupancy);
     printf("  Time Full:        %.1f%%\n", percent_full);
     printf("  Time Empty:       %.1f%%\n", percent_empty);
 
+    if (analytics->occupancy_valid) {
+        print_occupancy_section(analytics, avg_occupancy);
+    }
+
     printf("\nTHROUGHPUT\n");
     printf("  Produced:         %d (%.2f msg/sec)\n", analytics->total_produced, p_rate);
     printf("  Consumed:         %d (%.2f msg/sec)\n", analytics->total_consumed, c_rate);
+    if (analytics->dequeue_locks > 0) {
+        printf("  Dequeue Locks:    %lld (%.2f items/lock, batch up to %d)\n",
+               analytics->dequeue_locks,
+               (double)analytics->dequeue_lock_items / analytics->dequeue_locks,
+               analytics->batch_size > 1 ? analytics->batch_size : 1);
+    }
 
     printf("\nBLOCKING EVENTS\n");
     printf("  Producer Blocks:  %d (Queue Full)\n", analytics->total_producer_blocks);
     printf("  Consumer Blocks:  %d (Queue Empty)\n", analytics->total_consumer_blocks);
 
+    print_class_section(analytics);
+    print_flow_section(analytics);
+
     printf("\nWAIT TIME (semaphore blocking duration)\n");
     if (analytics->total_producer_blocks > 0) {
         printf("  Producer Avg Wait: %.1f ms\n",
@@ -465,6 +1688,92 @@ void analytics_print_summary(const Analytics *analytics)
         printf("  No messages consumed.\n");
     }
 
+    if (analytics->queue_latency_hist.total > 0) {
+        printf("\nLATENCY DISTRIBUTION (ms)\n");
+        printf("  %-26s %8s %8s %8s %8s %8s %8s\n",
+               "Measured from", "Mean", "p50", "p90", "p99", "p99.9", "Max");
+        print_latency_row("Enqueue (uncorrected)", &analytics->queue_latency_hist);
+        if (analytics->open_loop_rate > 0) {
+            print_latency_row("Intended send (corrected)",
+                              &analytics->corrected_latency_hist);
+        }
+        if (analytics->rpc_rtt_hist.total > 0) {
+            print_latency_row("Round trip (to reply)", &analytics->rpc_rtt_hist);
+        }
+    }
+
+    if (analytics->timewheel_ptr != NULL) {
+        print_delay_section(analytics);
+    }
+
+    if (analytics->ttl_ms > 0) {
+        print_expiry_section(analytics);
+    }
+
+    if (analytics->filtered_consumers > 0) {
+        print_filter_section(analytics);
+    }
+
+    if (analytics->coalesce_keys > 0) {
+        print_coalesce_section(analytics);
+    }
+
+    if (analytics->partitions > 0) {
+        print_partition_section(analytics);
+    }
+
+    if (analytics->spill_ptr != NULL) {
+        print_spill_section(analytics);
+    }
+
+    if (analytics->epoll_mode > 0) {
+        print_epoll_section(analytics);
+    }
+
+    if (analytics->ingest_ptr != NULL) {
+        print_ingest_section(analytics);
+    }
+    if (analytics->listener_ptr != NULL) {
+        print_listen_section(analytics);
+    }
+    if (analytics->rpc_ptr != NULL) {
+        print_rpc_section(analytics);
+    }
+    if (analytics->topic_ptr != NULL) {
+        print_topic_section(analytics);
+    }
+    if (analytics->mlfq.quantum_us > 0) {
+        print_mlfq_section(analytics);
+    }
+    if (analytics->sink_ptr != NULL) {
+        print_sink_section(analytics);
+    }
+
+    if (analytics->lease_ptr != NULL) {
+        print_delivery_section(analytics);
+    }
+
+    if (analytics->open_loop_rate > 0) {
+        printf("\nOPEN-LOOP LOAD\n");
+        printf("  Offered Rate:     %d msg/sec per producer (%d total)\n",
+               analytics->open_loop_rate,
+               analytics->open_loop_rate * analytics->num_producers);
+        printf("  Scheduled Sends:  %lld\n", analytics->scheduled_sends);
+        if (analytics->scheduled_sends > 0) {
+            printf("  Missed Slots:     %lld (%.1f%% sent > 1 interval late)\n",
+                   analytics->missed_slots,
+                   (double)analytics->missed_slots / analytics->scheduled_sends * 100.0);
+        } else {
+            printf("  Missed Slots:     0\n");
+        }
+    }
+
+    if (analytics->perf_enabled) {
+        print_perf_section(analytics);
+    }
+
+    print_rates_section(analytics);
+
     if (analytics->num_samples > 0) {
         printf("\nTHROUGHPUT OVER TIME (per second)\n");
         printf("  %-8s %-10s %-10s\n", "Time", "Produced", "Consumed");
@@ -495,8 +1804,13 @@ void analytics_print_recommendations(const Analytics *analytics)
 
     if (!analytics) return;
 
-    if (analytics->num_samples > 0 && analytics->queue_capacity > 0) {
-        avg_occupancy = (double)analytics->queue_occupancy_sum / analytics->num_samples;
+    if (analytics->occupancy_valid && analytics->queue_capacity > 0 &&
+        queue_occupancy_window_us(&analytics->occupancy) > 0) {
+        /* Prefer the exact time-weighted mean over 1 Hz samples */
+        avg_occupancy = queue_occupancy_mean(&analytics->occupancy);
+        utilisation = avg_occupancy / analytics->queue_capacity * 100.0;
+    } else if (analytics->aggregate_samples > 0 && analytics->queue_capacity > 0) {
+        avg_occupancy = (double)analytics->queue_occupancy_sum / analytics->aggregate_samples;
         utilisation = avg_occupancy / analytics->queue_capacity * 100.0;
     } else {
         utilisation = 0.0;
@@ -506,6 +1820,8 @@ void analytics_print_recommendations(const Analytics *analytics)
     if (analytics->total_runtime > 0.0) {
         p_rate = analytics->total_produced / analytics->total_runtime;
         c_rate = analytics->total_consumed / analytics->total_runtime;
+        /* Fan-out: every group consumes each message once */
+        if (analytics->topic_ptr != NULL) c_rate /= analytics->topic_ptr->num_groups;
     } else {
         p_rate = 0.0;
         c_rate = 0.0;
@@ -514,9 +1830,9 @@ void analytics_print_recommendations(const Analytics *analytics)
 
     /* Recommendation Logic — rate-aware */
 
-    if (analytics->num_samples > 0 &&
+    if (analytics->aggregate_samples > 0 &&
         analytics->total_producer_blocks > 0 &&
-        (double)analytics->queue_full_count / analytics->num_samples > 0.1) {
+        (double)analytics->queue_full_count / analytics->aggregate_samples > 0.1) {
 
         if (rate_ratio > 1.5) {
             /* Rate imbalance is the root cause, not queue size */
@@ -531,9 +1847,9 @@ void analytics_print_recommendations(const Analytics *analytics)
             reason = "Queue too small for burst traffic";
         }
 
-    } else if (analytics->num_samples > 0 &&
+    } else if (analytics->aggregate_samples > 0 &&
                analytics->total_consumer_blocks > 0 &&
-               (double)analytics->queue_empty_count / analytics->num_samples > 0.3) {
+               (double)analytics->queue_empty_count / analytics->aggregate_samples > 0.3) {
 
         if (rate_ratio < 0.7) {
             /* Producers can't keep up */
@@ -567,7 +1883,8 @@ void analytics_print_recommendations(const Analytics *analytics)
     printf("\nOPTIMIZATION RECOMMENDATION\n");
     printf("------------------------------------------------------------\n");
     printf("  Produce Rate:     %.2f msg/sec\n", p_rate);
-    printf("  Consume Rate:     %.2f msg/sec\n", c_rate);
+    printf("  Consume Rate:     %.2f msg/sec%s\n", c_rate,
+           analytics->topic_ptr != NULL ? " (per group)" : "");
     if (c_rate > 0.0 && p_rate > c_rate)
         printf("  Rate Balance:     Producers %.1fx faster\n", rate_ratio);
     else if (p_rate > 0.0 && c_rate > p_rate)
@@ -14,6 +14,16 @@
 #include <pthread.h>
 #include "config.h"
 #include "queue.h"
+#include "perfcount.h"
+#include "histogram.h"
+#include "timewheel.h"
+#include "lease.h"
+#include "spill.h"
+#include "sink.h"
+#include "ingest.h"
+#include "listener.h"
+#include "rpc.h"
+#include "topic.h"
 
 /* --- Constants --- */
 
@@ -22,6 +32,11 @@
 #define MAX_QUEUE_SAMPLES       600
 #define SAMPLE_INTERVAL_SEC     1
 
+// The sampler wakes every EWMA_TICK_MS to update the sliding-window rates;
+// every EWMA_TICKS_PER_SAMPLE-th tick also records a QueueSample.
+#define EWMA_TICK_MS            250
+#define EWMA_TICKS_PER_SAMPLE   (SAMPLE_INTERVAL_SEC * 1000 / EWMA_TICK_MS)
+
 /* --- Data Structures --- */
 
 /*
@@ -36,6 +51,68 @@ typedef struct {
     int consumed;               // Messages consumed this interval
 } QueueSample;
 
+/*
+ * Exponentially weighted windows (time constants 1s, 10s, 60s).
+ * Indexes the per-window arrays in AnalyticsRates.
+ */
+typedef enum {
+    EWMA_1S = 0,
+    EWMA_10S,
+    EWMA_60S,
+    EWMA_NUM_WINDOWS
+} EwmaWindow;
+
+/*
+ * Live sliding-window rates, refreshed by the sampler every EWMA_TICK_MS.
+ * Read with analytics_get_rates(), which never takes the analytics mutex.
+ */
+typedef struct {
+    double produce_rate[EWMA_NUM_WINDOWS];        // msg/sec
+    double consume_rate[EWMA_NUM_WINDOWS];        // msg/sec
+    double producer_block_rate[EWMA_NUM_WINDOWS]; // blocks/sec
+    double consumer_block_rate[EWMA_NUM_WINDOWS]; // blocks/sec
+    double occupancy[EWMA_NUM_WINDOWS];           // items in queue
+    double latency_ms[EWMA_NUM_WINDOWS];          // mean enqueue -> dequeue
+    double updated_at;          // time_elapsed() of the last update
+    unsigned long ticks;        // Updates so far (0 = no data yet)
+} AnalyticsRates;
+
+/*
+ * Raw event counts feeding the EWMA windows.
+ * Bumped with relaxed atomic adds (no mutex) and never gated by the
+ * warm-up window, so live rates also cover the startup transient.
+ */
+typedef struct {
+    unsigned long long produced;
+    unsigned long long consumed;
+    unsigned long long producer_blocks;
+    unsigned long long consumer_blocks;
+    unsigned long long latency_count;
+    unsigned long long latency_sum_us;
+} LiveCounters;
+
+/*
+ * Hardware counter totals for one thread role (producers or consumers).
+ * Summed across threads; divided by message count when reported.
+ */
+typedef struct {
+    unsigned long long totals[PERF_NUM_COUNTERS];
+    int valid_threads[PERF_NUM_COUNTERS]; // Threads that reported each counter
+    int threads;                // Threads that reported at all
+    int open_errno;             // First perf_event_open failure (0 = none)
+} PerfTotals;
+
+/*
+ * Enqueue outcome for one admission class (see PriorityClass).
+ * Shows whether a reservation keeps the high class unblocked.
+ */
+typedef struct {
+    long long enqueued;         // Successful enqueues
+    long long blocked;          // Of those, how many had to wait
+    long long wait_total_ms;    // Time spent blocked (sum)
+    long wait_max_ms;           // Worst single wait
+} ClassStats;
+
 /*
  * Central storage for all performance metrics.
  * Thread-safe: Protected by its own mutex.
@@ -52,11 +129,94 @@ typedef struct {
     long long queue_occupancy_sum; // For calculating average
     int queue_full_count;       // Samples where Queue == Capacity
     int queue_empty_count;      // Samples where Queue == 0
+
+    /* Exact Occupancy (copied from the queue at finalise) */
+    QueueOccupancy occupancy;
+    int occupancy_valid;            // 1 if the snapshot succeeded
+    volatile int occupancy_reset_pending; // Restart the window after warm-up
     
     /* Throughput Stats */
     int total_produced;
     int total_consumed;
     
+    /* Batch Dequeue (--batch) */
+    int batch_size;                 // Max items per dequeue lock (1 = single)
+    long long dequeue_locks;        // Dequeue critical sections entered
+    long long dequeue_lock_items;   // Items removed under those locks
+
+    /* Priority Classes (--reserve) */
+    int reserved_slots;             // Slots held back for the high class
+    ClassStats class_stats[PRIO_NUM_CLASSES];
+
+    /* Slot Admission (--credits; copied from the queue at finalise) */
+    int credit_batch;               // Credits per grab (0 = semaphore mode)
+    QueueFlowStats flow;
+
+    /* Delayed Delivery (--delay; copied from the wheel at finalise) */
+    TimingWheel *timewheel_ptr;     // NULL unless --delay is active
+    int max_delay_ms;
+    TimerStats timer;
+
+    /* Message TTL (--ttl; copied from the queue at finalise) */
+    int ttl_ms;                     // 0 = no expiry
+    QueueExpiryStats expiry;
+
+    /* Selective Receive (--filter; copied from the queue at finalise) */
+    int filtered_consumers;         // Consumers with a filter (0 = section off)
+    QueueFilterStats filter;
+
+    /* Key Coalescing (--coalesce; copied from the queue at finalise) */
+    int coalesce_keys;              // Key space (0 = section off)
+    QueueCoalesceStats coalesce;
+
+    /* Partitioned Delivery (--partitions; copied from the queue at finalise) */
+    int partitions;                 // 0 = section off
+    int partition_by_key;           // 1 = keyed by message key, 0 = by producer
+    QueuePartitionStats partition;
+
+    /* Disk Spill-Over (--spill; copied from the store at finalise) */
+    SpillStore *spill_ptr;          // NULL = producers block on a full ring
+    SpillStats spill;
+
+    /* Epoll Readiness (--epoll; eventfd counters copied from the queue at finalise) */
+    int epoll_mode;                 // 0 = section off, else QueueReadyMode + 1
+    QueueReadyStats ready;
+    long long epoll_wakeups;        // Summed over consumers at exit
+    long long empty_wakeups;
+
+    /* File Sink (--sink; copied from the sink at finalise) */
+    Sink *sink_ptr;                 // NULL = consumers persist nothing
+    SinkStats sink;
+
+    /* Ingestion Source (--source; summed from the readers at finalise) */
+    Ingest *ingest_ptr;             // NULL = producers generate messages
+    IngestStats ingest;
+
+    /* Socket Listener (--listen; copied from the listener at finalise) */
+    Listener *listener_ptr;         // NULL = producer threads
+    ListenStats listen;
+
+    /* Request/Response (--rpc; round trips recorded live, totals copied at finalise) */
+    RpcTable *rpc_ptr;              // NULL = fire-and-forget producers
+    RpcStats rpc;
+    Histogram rpc_rtt_hist;         // Request enqueued -> reply taken (us)
+    long long rpc_replies;          // Replies in the measured window
+
+    /* Dequeue Policy (--policy mlfq; copied from the queue at finalise) */
+    QueueMlfq mlfq;
+
+    /* Pub/Sub Fan-Out (--groups; copied from the topic at finalise) */
+    Topic *topic_ptr;               // NULL = one queue, each message consumed once
+    TopicStats topic;
+    TopicGroupStats topic_groups[MAX_GROUPS];
+
+    /* At-Least-Once Delivery (--ack-timeout; copied from the leases at finalise) */
+    LeaseTable *lease_ptr;          // NULL = at-most-once
+    int ack_timeout_ms;
+    int max_deliveries;
+    int fail_pct;
+    LeaseStats leases;
+
     /* Bottleneck Stats */
     int total_producer_blocks;
     int total_consumer_blocks;
@@ -76,11 +236,43 @@ typedef struct {
     long max_latency_ms;            // Worst-case latency
     long min_latency_ms;            // Best-case latency
     int latency_count;              // Number of latency samples
+
+    /* Latency Distributions (microseconds) */
+    Histogram queue_latency_hist;     // Actual enqueue -> dequeue (uncorrected)
+    Histogram corrected_latency_hist; // Intended send -> dequeue (open-loop corrected)
+
+    /* Open-Loop Load (--open-loop) */
+    int open_loop_rate;             // Per-producer arrivals/sec (0 = closed loop)
+    long long scheduled_sends;      // Arrivals due according to the schedule
+    long long missed_slots;         // Arrivals sent more than one interval late
+
+    /* Live Rates (EWMA, published by the sampler under a seqlock) */
+    LiveCounters live;
+    volatile unsigned int rates_seq; // Odd while the sampler is writing
+    AnalyticsRates rates;
+
+    /* Hardware Counters (--perf) */
+    int perf_enabled;               // 1 if threads were asked to count
+    PerfTotals producer_perf;
+    PerfTotals consumer_perf;
     
     /* Timing Context */
     double start_time;
     double end_time;
-    double total_runtime;
+    double total_runtime;           // Measured window (excludes warm-up)
+
+    /* Startup & Warm-up */
+    double warmup_seconds;          // --warmup window excluded from aggregates
+    double warmup_end;              // time_elapsed() when measurement begins
+    volatile int warmup_active;     // 1 until warmup_end has passed
+    int aggregate_samples;          // Samples included in occupancy aggregates
+    long long spawn_phase_us;       // First pthread_create -> start gate release
+    int spawn_count;                // Threads that reported a spawn latency
+    long long spawn_total_us;       // pthread_create -> thread running (sum)
+    long long spawn_max_us;
+    int first_op_count;             // Threads that completed at least one op
+    long long first_op_total_us;    // Gate release -> first completed op (sum)
+    long long first_op_max_us;
     
     /* System Config (for report context) */
     int num_producers;
@@ -112,11 +304,17 @@ int analytics_init(Analytics *analytics, Queue *queue,
  */
 int analytics_destroy(Analytics *analytics);
 
+/*
+ * Marks the start of measurement (called when the start gate opens).
+ * Events in the first 'warmup_seconds' are excluded from all aggregates.
+ */
+void analytics_mark_start(Analytics *analytics, double warmup_seconds);
+
 /* --- Background Sampling --- */
 
 /*
- * Spawns a dedicated thread that wakes up every SAMPLE_INTERVAL_SEC
- * to record the current queue depth.
+ * Spawns a dedicated thread that wakes up every EWMA_TICK_MS to update
+ * the live rates, and records the queue depth every SAMPLE_INTERVAL_SEC.
  */
 int analytics_start_sampling(Analytics *analytics);
 
@@ -125,6 +323,19 @@ int analytics_start_sampling(Analytics *analytics);
  */
 void analytics_stop_sampling(Analytics *analytics);
 
+/* --- Live Rates --- */
+
+/*
+ * Copies the latest EWMA rates into 'out' without taking the analytics
+ * mutex (seqlock read; retries if the sampler is mid-update).
+ * Cheap enough for every TUI frame or an external exporter.
+ * Returns: 0 on success, -1 if no rates have been published yet.
+ */
+int analytics_get_rates(const Analytics *analytics, AnalyticsRates *out);
+
+/* Short label for a window ("1s", "10s", "60s"). */
+const char *analytics_ewma_window_name(EwmaWindow window);
+
 /* --- Event Recording (Thread-Safe) --- */
 
 // Called by Producer threads
@@ -132,11 +343,42 @@ void analytics_record_produce(Analytics *analytics);
 void analytics_record_producer_block(Analytics *analytics);
 void analytics_record_producer_wait(Analytics *analytics, long wait_ms);
 
+// Called by producers after each successful enqueue (per-class block rate)
+void analytics_record_class_enqueue(Analytics *analytics, int priority,
+                                    int was_blocked, long wait_ms);
+
+// Called by ingesting producers after each batch enqueue (--source):
+// produce + class counts for all n messages under one lock, the wait
+// charged to the first one
+void analytics_record_produce_batch(Analytics *analytics, const Message *msgs, int n,
+                                    int was_blocked, long wait_ms);
+
+// Called by RPC clients for each reply taken (--rpc)
+void analytics_record_rpc(Analytics *analytics, long long rtt_us);
+
 // Called by Consumer threads
 void analytics_record_consume(Analytics *analytics);
 void analytics_record_consumer_block(Analytics *analytics);
 void analytics_record_consumer_wait(Analytics *analytics, long wait_ms);
-void analytics_record_latency(Analytics *analytics, long latency_ms);
+void analytics_record_latency(Analytics *analytics, long latency_ms,
+                              long long queue_us, long long corrected_us);
+void analytics_record_dequeue_lock(Analytics *analytics, int items);
+
+// Called by open-loop producers once, when their loop exits
+void analytics_record_open_loop(Analytics *analytics, long long scheduled,
+                                long long missed);
+
+// Called by either role during startup (spawn cost and first completed op)
+void analytics_record_spawn(Analytics *analytics, long long spawn_us);
+void analytics_record_first_op(Analytics *analytics, long long since_release_us);
+
+// Called by epoll-mode consumers once, when their loop exits (--epoll only)
+void analytics_record_epoll(Analytics *analytics, long long wakeups,
+                            long long empty_wakeups);
+
+// Called by either role once, when its loop exits (--perf only)
+void analytics_record_perf(Analytics *analytics, int is_consumer,
+                           const PerfSample *sample);
 
 /* --- Reporting & Export --- */
 
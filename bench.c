@@ -0,0 +1,1028 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * bench.c: Benchmark Mode Implementation
+ * * Trial harness: fresh queue, open-loop producers, fixed-service consumers.
+ * * Saturation finder: exponential ramp, then binary search for the knee.
+ * * Scaling sweep: unthrottled pinned trials at doubling thread counts.
+ * * Wake-up benchmark: one-message ping-pong per consumer wait path.
+ * * Policy comparison: mixed short/long jobs under each dequeue policy.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer arguments         — all public functions check inputs
+ *   2. Queue/gate init failure        — trial aborted, resources released
+ *   3. pthread_create failure         — already-created workers stopped,
+ *                                       released through the gate and joined
+ *   4. Ctrl+C during a search         — checked between and within trials,
+ *                                       partial curve still reported
+ *   5. CSV file I/O errors            — fopen checked, fprintf errors tracked
+ *   6. Division by zero               — guarded in all rate calculations
+ *   7. Affinity failure (cpuset/VM)   — logged once, worker runs unpinned
+ */
+
+#define _GNU_SOURCE /* Required for pthread_setaffinity_np / CPU_SET */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "bench.h"
+#include "config.h"
+#include "queue.h"
+#include "lease.h"
+#include "utils.h"
+
+/* --- Internal Types --- */
+
+/*
+ * Per-thread context for one trial.
+ * Producers use rate/phase; consumers use service_us and latency.
+ */
+typedef struct {
+    int id;
+    Queue *queue;
+    StartGate *gate;
+    volatile sig_atomic_t *stop;
+    int cpu;                    // Core to pin to (-1 = unpinned)
+    int unthrottled;            // Producer: enqueue back-to-back (closed loop)
+    int rate;                   // Producer: arrivals/sec (0 = idle)
+    long long phase_us;         // Producer: offset of the first arrival
+    int service_us;             // Consumer: busy time per message
+    int long_service_us;        // Consumer: busy time for odd classes (0 = service_us)
+    int credit_batch;           // Producer: slot credits per grab (0 = semaphore)
+    LeaseTable *leases;         // Consumer: lease + ack each message (NULL = off)
+    long long count;            // Messages produced / consumed
+    long long blocks;           // Producer: enqueues that waited
+    Histogram latency;          // Consumer: intended send -> dequeue (us)
+    Histogram short_latency;    // Consumer, mixed service: even classes only
+    Histogram long_latency;     // Consumer, mixed service: odd classes only
+    Histogram op_ns;            // Cost of each enqueue/dequeue call (ns)
+} BenchWorker;
+
+/*
+ * Queue backends compared by the scaling sweep.
+ * Each row is the same ring with a different admission path; new
+ * backends add a row here and a switch in the trial config.
+ */
+typedef struct {
+    const char *name;
+    const char *description;
+    int credit_batch;           // Passed through to BenchTrialConfig
+    int ack_timeout_ms;         // Passed through to BenchTrialConfig
+} BenchBackend;
+
+static const BenchBackend bench_backends[] = {
+    { "mutex-ring",  "mutex + counting semaphores, priority scan", 0, 0 },
+    { "credit-ring", "mutex ring, producers bank slot credits (batch 8)", BENCH_CREDIT_BATCH, 0 },
+    { "lease-ring",  "mutex ring, at-least-once: lease + ack per message", 0,
+      BENCH_ACK_TIMEOUT_MS }
+};
+#define BENCH_NUM_BACKENDS ((int)(sizeof(bench_backends) / sizeof(bench_backends[0])))
+
+/* Large (histograms), so kept out of the thread stacks */
+static BenchWorker bench_producers[MAX_PRODUCERS];
+static BenchWorker bench_consumers[MAX_CONSUMERS];
+
+/* --- Internal Helpers --- */
+
+/* Nanosecond monotonic clock for per-op timing */
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Pins the calling thread to w->cpu.
+ * Error handling: failure (restricted cpuset, container) is reported
+ * once per process; the trial still runs, just unpinned.
+ */
+static void pin_worker(const BenchWorker *w)
+{
+    static int warned = 0;
+    cpu_set_t set;
+
+    if (w->cpu < 0) return;
+
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0 && !warned) {
+        warned = 1;
+        fprintf(stderr, "[WARN] bench: could not pin to CPU %d, running unpinned\n", w->cpu);
+    }
+}
+
+/* Process CPU time (user + system) in microseconds */
+static long long process_cpu_us(void)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return (long long)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+           ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+/* Spins for 'usec' to model per-message work without yielding the CPU */
+static void busy_wait_us(long long usec)
+{
+    long long until;
+
+    if (usec <= 0) return;
+    until = time_now_us() + usec;
+    while (time_now_us() < until) {
+        /* spin */
+    }
+}
+
+/*
+ * Rate-controlled producer: arrival k is due at start + phase + k/rate.
+ * A late arrival is sent at once and keeps its intended time, so the
+ * measured latency includes any backlog in front of the queue.
+ */
+static void *bench_producer_thread(void *arg)
+{
+    BenchWorker *w = (BenchWorker *)arg;
+    long long start_us, intended_us = 0, arrivals = 0, op_start;
+    int blocked, result, credits = 0;
+    Message msg;
+
+    pin_worker(w);
+    start_us = start_gate_arrive_and_wait(w->gate);
+    if (start_us == 0) start_us = time_now_us();
+    if (w->rate <= 0 && !w->unthrottled) return NULL;
+
+    while (!*(w->stop)) {
+        if (!w->unthrottled) {
+            intended_us = start_us + w->phase_us +
+                          (long long)((double)arrivals * 1000000.0 / w->rate);
+            while (!*(w->stop)) {
+                long long remaining_us = intended_us - time_now_us();
+                if (remaining_us <= 0) break;
+                if (credits > 0 && remaining_us >= CREDIT_IDLE_RETURN_MS * 1000LL) {
+                    queue_credit_return(w->queue, credits);
+                    credits = 0;
+                }
+                sleep_us(remaining_us < 100000 ? remaining_us : 100000);
+            }
+            if (*(w->stop)) break;
+            arrivals++;
+        }
+
+        msg = message_create(random_range(DATA_RANGE_MIN, DATA_RANGE_MAX),
+                             random_range(PRIORITY_MIN, PRIORITY_MAX), w->id);
+        if (!w->unthrottled) msg.intended_us = intended_us;
+
+        blocked = 0;
+        op_start = now_ns();
+        if (w->credit_batch > 0) {
+            if (credits == 0) {
+                credits = queue_credit_acquire(w->queue, w->credit_batch, &blocked, NULL);
+                if (credits < 1) break;
+            }
+            credits--;
+            result = queue_enqueue_credit(w->queue, msg, NULL, NULL);
+        } else {
+            result = queue_enqueue_safe(w->queue, msg, &blocked, NULL);
+        }
+        if (result != 0) break;
+        histogram_record(&w->op_ns, now_ns() - op_start);
+        w->count++;
+        if (blocked) w->blocks++;
+    }
+
+    if (credits > 0) queue_credit_return(w->queue, credits);
+    return NULL;
+}
+
+/*
+ * Fixed-service consumer: dequeue, record latency, busy for service_us.
+ * In at-least-once mode the message is leased after the dequeue and
+ * acked after the service time; both calls count towards the op cost.
+ * With mixed service, odd classes are busy for long_service_us, and the
+ * busy time is reported to the queue's dequeue policy.
+ */
+static void *bench_consumer_thread(void *arg)
+{
+    BenchWorker *w = (BenchWorker *)arg;
+    Message msg;
+    Lease lease;
+    long long now_us, op_start, op_ns, latency_us;
+    int is_long;
+
+    pin_worker(w);
+    start_gate_arrive_and_wait(w->gate);
+
+    while (!*(w->stop)) {
+        op_start = now_ns();
+        if (queue_dequeue_safe(w->queue, &msg, NULL, NULL) != 0) break;
+        if (w->leases) lease_acquire(w->leases, &msg, &lease);
+        op_ns = now_ns() - op_start;
+        now_us = time_now_us();
+        latency_us = now_us - msg.intended_us;
+        histogram_record(&w->latency, latency_us);
+        is_long = (w->long_service_us > 0 && (msg.priority & 1));
+        if (w->long_service_us > 0) {
+            histogram_record(is_long ? &w->long_latency : &w->short_latency, latency_us);
+        }
+        busy_wait_us(is_long ? w->long_service_us : w->service_us);
+        queue_policy_charge(w->queue, &msg, time_now_us() - now_us);
+        if (w->leases && lease.slot >= 0) {
+            op_start = now_ns();
+            lease_ack(w->leases, lease);
+            op_ns += now_ns() - op_start;
+        }
+        histogram_record(&w->op_ns, op_ns);
+        w->count++;
+    }
+
+    return NULL;
+}
+
+/* Sleeps for 'ms' in short chunks so an abort is seen promptly */
+static int trial_sleep(int ms, volatile sig_atomic_t *abort_flag)
+{
+    long long until = time_now_us() + (long long)ms * 1000LL;
+    long long remaining;
+
+    while ((remaining = until - time_now_us()) > 0) {
+        if (abort_flag != NULL && !*abort_flag) return -1;
+        sleep_us(remaining < 50000 ? remaining : 50000);
+    }
+    return 0;
+}
+
+/* --- Public API: Single Trial --- */
+
+/*
+ * Error handling: Partial thread creation is unwound by stopping the
+ * trial, opening the gate (so parked workers can exit) and joining
+ * only the threads that exist. Queue and gate are always destroyed.
+ */
+int bench_run_trial(const BenchTrialConfig *cfg, volatile sig_atomic_t *abort_flag,
+                    BenchPoint *out)
+{
+    static Queue queue;
+    static LeaseTable leases;
+    StartGate gate;
+    pthread_t p_threads[MAX_PRODUCERS], c_threads[MAX_CONSUMERS];
+    volatile sig_atomic_t stop = 0;
+    Histogram latency, enq_ns, deq_ns;
+    int np = 0, nc = 0, i, result = 0;
+    int ncpu = bench_online_cpus();
+    long long start_us, elapsed_us, cpu_start_us;
+
+    if (cfg == NULL || out == NULL) return -1;
+    memset(out, 0, sizeof(*out));
+    out->offered_rate = cfg->offered_rate;
+
+    if (queue_init(&queue, cfg->queue_size, cfg->aging_interval) != 0) return -1;
+    if (queue_set_policy(&queue, cfg->policy, cfg->mlfq_quantum_us) != 0 ||
+        (cfg->credit_batch > 0 && queue_enable_credits(&queue) != 0)) {
+        queue_destroy(&queue);
+        return -1;
+    }
+    if (cfg->ack_timeout_ms > 0) {
+        if (lease_init(&leases, &queue, cfg->ack_timeout_ms, DEFAULT_MAX_DELIVERIES) != 0) {
+            queue_destroy(&queue);
+            return -1;
+        }
+        if (lease_start(&leases) != 0) {
+            lease_destroy(&leases);
+            queue_destroy(&queue);
+            return -1;
+        }
+    }
+    if (start_gate_init(&gate) != 0) {
+        if (cfg->ack_timeout_ms > 0) {
+            lease_stop(&leases);
+            lease_destroy(&leases);
+        }
+        queue_destroy(&queue);
+        return -1;
+    }
+
+    /* Spread the offered load: the first (rate % n) producers take one extra */
+    for (i = 0; i < cfg->num_producers; i++) {
+        BenchWorker *w = &bench_producers[i];
+        memset(w, 0, sizeof(*w));
+        w->id = i + 1;
+        w->queue = &queue;
+        w->gate = &gate;
+        w->stop = &stop;
+        w->cpu = cfg->pin_threads ? i % ncpu : -1;
+        w->unthrottled = (cfg->offered_rate <= 0);
+        w->credit_batch = cfg->credit_batch;
+        histogram_init(&w->op_ns);
+        w->rate = cfg->offered_rate / cfg->num_producers +
+                  (i < cfg->offered_rate % cfg->num_producers ? 1 : 0);
+        if (w->rate > 0) {
+            w->phase_us = (1000000LL / w->rate) * i / cfg->num_producers;
+        }
+        if (pthread_create(&p_threads[i], NULL, bench_producer_thread, w) != 0) {
+            fprintf(stderr, "[ERROR] bench: producer %d pthread_create failed\n", i + 1);
+            result = -1;
+            break;
+        }
+        np++;
+    }
+
+    for (i = 0; result == 0 && i < cfg->num_consumers; i++) {
+        BenchWorker *w = &bench_consumers[i];
+        memset(w, 0, sizeof(*w));
+        w->id = i + 1;
+        w->queue = &queue;
+        w->gate = &gate;
+        w->stop = &stop;
+        w->service_us = cfg->service_us;
+        w->long_service_us = cfg->long_service_us;
+        w->leases = (cfg->ack_timeout_ms > 0) ? &leases : NULL;
+        w->cpu = cfg->pin_threads ? (cfg->num_producers + i) % ncpu : -1;
+        histogram_init(&w->latency);
+        histogram_init(&w->short_latency);
+        histogram_init(&w->long_latency);
+        histogram_init(&w->op_ns);
+        if (pthread_create(&c_threads[i], NULL, bench_consumer_thread, w) != 0) {
+            fprintf(stderr, "[ERROR] bench: consumer %d pthread_create failed\n", i + 1);
+            result = -1;
+            break;
+        }
+        nc++;
+    }
+
+    /* Release everyone together, hold the load, then stop */
+    start_gate_wait_arrivals(&gate, np + nc);
+    cpu_start_us = process_cpu_us();
+    start_us = start_gate_open(&gate);
+    if (result == 0 && trial_sleep(cfg->duration_ms, abort_flag) != 0) result = -1;
+    elapsed_us = time_now_us() - start_us;
+    if (elapsed_us > 0) {
+        out->cpu_util_pct = (double)(process_cpu_us() - cpu_start_us) /
+                            ((double)elapsed_us * ncpu) * 100.0;
+    }
+
+    stop = 1;
+    queue_shutdown(&queue);
+    for (i = 0; i < np; i++) pthread_join(p_threads[i], NULL);
+    for (i = 0; i < nc; i++) pthread_join(c_threads[i], NULL);
+
+    start_gate_destroy(&gate);
+    if (cfg->ack_timeout_ms > 0) {
+        lease_stop(&leases);
+        lease_destroy(&leases);
+    }
+    queue_policy_stats(&queue, &out->mlfq);
+    queue_destroy(&queue);
+    if (result != 0) return -1;
+
+    /* Aggregate */
+    histogram_init(&latency);
+    histogram_init(&enq_ns);
+    histogram_init(&deq_ns);
+    for (i = 0; i < np; i++) {
+        out->produced += bench_producers[i].count;
+        out->blocks += bench_producers[i].blocks;
+        histogram_merge(&enq_ns, &bench_producers[i].op_ns);
+    }
+    histogram_init(&out->short_latency);
+    histogram_init(&out->long_latency);
+    for (i = 0; i < nc; i++) {
+        out->consumed += bench_consumers[i].count;
+        histogram_merge(&latency, &bench_consumers[i].latency);
+        histogram_merge(&out->short_latency, &bench_consumers[i].short_latency);
+        histogram_merge(&out->long_latency, &bench_consumers[i].long_latency);
+        histogram_merge(&deq_ns, &bench_consumers[i].op_ns);
+    }
+
+    if (elapsed_us > 0) out->achieved_rate = out->consumed * 1e6 / (double)elapsed_us;
+    if (out->produced > 0) out->block_pct = (double)out->blocks / out->produced * 100.0;
+    out->p50_us = histogram_percentile(&latency, 50.0);
+    out->p90_us = histogram_percentile(&latency, 90.0);
+    out->p99_us = histogram_percentile(&latency, 99.0);
+    out->p999_us = histogram_percentile(&latency, 99.9);
+    out->max_us = latency.max;
+    out->enq_p50_ns = histogram_percentile(&enq_ns, 50.0);
+    out->enq_p99_ns = histogram_percentile(&enq_ns, 99.0);
+    out->enq_p999_ns = histogram_percentile(&enq_ns, 99.9);
+    out->deq_p50_ns = histogram_percentile(&deq_ns, 50.0);
+    out->deq_p99_ns = histogram_percentile(&deq_ns, 99.0);
+    out->deq_p999_ns = histogram_percentile(&deq_ns, 99.9);
+
+    return 0;
+}
+
+int bench_online_cpus(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n < 1) ? 1 : (int)n;
+}
+
+/* --- Saturation Finder --- */
+
+static void print_point_header(void)
+{
+    printf("  %-6s %10s %10s %9s %9s %9s %8s  %s\n",
+           "Trial", "Offered/s", "Achieved/s", "p50 ms", "p99 ms", "Max ms",
+           "Blocked", "Result");
+}
+
+static void print_point(int trial, const BenchPoint *pt)
+{
+    printf("  %-6d %10d %10.1f %9.3f %9.3f %9.3f %7.1f%%  %s\n",
+           trial, pt->offered_rate, pt->achieved_rate,
+           pt->p50_us / 1000.0, pt->p99_us / 1000.0, pt->max_us / 1000.0,
+           pt->block_pct, pt->passed ? "PASS" : "FAIL");
+    fflush(stdout);
+}
+
+static int compare_points(const void *a, const void *b)
+{
+    const BenchPoint *pa = (const BenchPoint *)a;
+    const BenchPoint *pb = (const BenchPoint *)b;
+    return (pa->offered_rate > pb->offered_rate) - (pa->offered_rate < pb->offered_rate);
+}
+
+/*
+ * Writes the load-latency curve, sorted by offered rate.
+ *
+ * Error handling: Same as analytics_export_csv — fopen failure reported
+ * via perror, write errors counted, file always closed.
+ */
+static int write_curve_csv(const char *filename, BenchPoint *points, int n)
+{
+    FILE *fp;
+    int i, write_errors = 0;
+
+    qsort(points, (size_t)n, sizeof(BenchPoint), compare_points);
+
+    fp = fopen(filename, "w");
+    if (!fp) {
+        perror("[ERROR] bench: fopen failed");
+        return -1;
+    }
+
+    if (fprintf(fp, "OfferedRate,AchievedRate,P50_ms,P90_ms,P99_ms,P999_ms,"
+                "Max_ms,BlockPct,Produced,Consumed,Result\n") < 0) {
+        fprintf(stderr, "[ERROR] bench: failed writing CSV header\n");
+        fclose(fp);
+        return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (fprintf(fp, "%d,%.1f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%lld,%lld,%s\n",
+                    points[i].offered_rate, points[i].achieved_rate,
+                    points[i].p50_us / 1000.0, points[i].p90_us / 1000.0,
+                    points[i].p99_us / 1000.0, points[i].p999_us / 1000.0,
+                    points[i].max_us / 1000.0, points[i].block_pct,
+                    points[i].produced, points[i].consumed,
+                    points[i].passed ? "PASS" : "FAIL") < 0) {
+            write_errors++;
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        perror("[ERROR] bench: fclose failed");
+        return -1;
+    }
+    if (write_errors > 0) {
+        fprintf(stderr, "[WARN] bench: %d CSV write errors (file may be incomplete)\n",
+                write_errors);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Error handling: A failed trial (thread or init failure) ends the
+ * search; whatever was measured so far is still printed and exported.
+ * The positional timeout caps the whole search.
+ */
+int bench_run_saturation(const RuntimeParams *params, volatile sig_atomic_t *running)
+{
+    static BenchPoint points[BENCH_MAX_TRIALS];
+    BenchTrialConfig cfg;
+    BenchPoint *pt, *first_fail = NULL;
+    int n = 0, rate, lo = 0, hi = 0, knee, max_rate;
+    double deadline;
+    char filename[256];
+
+    if (params == NULL) return -1;
+
+    cfg.num_producers = params->num_producers;
+    cfg.num_consumers = params->num_consumers;
+    cfg.queue_size = params->queue_size;
+    cfg.aging_interval = params->aging_interval;
+    cfg.duration_ms = params->trial_ms;
+    cfg.service_us = params->service_us;
+    cfg.pin_threads = 0;
+    cfg.credit_batch = params->credit_batch;
+    cfg.ack_timeout_ms = params->ack_timeout_ms;
+    cfg.policy = QUEUE_POLICY_PRIORITY;
+    cfg.mlfq_quantum_us = 0;
+    cfg.long_service_us = 0;
+
+    max_rate = MAX_OPEN_LOOP_RATE * params->num_producers;
+    deadline = time_elapsed() + params->timeout_seconds;
+
+    print_separator();
+    printf("SATURATION SEARCH\n");
+    print_separator();
+    printf("  Limits: p99 <= %d ms, blocked enqueues <= %d%%, %d ms per trial\n",
+           params->p99_limit_ms, params->block_limit_pct, params->trial_ms);
+    print_point_header();
+
+    /* Phase 1: exponential ramp until the first failure.
+     * Phase 2: binary search between last pass (lo) and first fail (hi). */
+    rate = BENCH_START_RATE;
+    while (n < BENCH_MAX_TRIALS && *running && time_elapsed() < deadline) {
+        cfg.offered_rate = rate;
+        pt = &points[n];
+        if (bench_run_trial(&cfg, running, pt) != 0) break;
+        pt->passed = pt->consumed > 0 &&
+                     pt->p99_us <= (long long)params->p99_limit_ms * 1000LL &&
+                     pt->block_pct <= (double)params->block_limit_pct;
+        print_point(++n, pt);
+
+        if (pt->passed) {
+            lo = rate;
+        } else {
+            hi = rate;
+        }
+
+        if (hi == 0) {
+            if (rate >= max_rate) break;      /* never failed */
+            rate = (rate > max_rate / 2) ? max_rate : rate * 2;
+        } else {
+            if (hi - lo <= 1 || (hi - lo) * 100 <= lo * BENCH_RESOLUTION_PCT) break;
+            rate = lo + (hi - lo) / 2;
+        }
+    }
+
+    knee = lo;
+    for (int i = 0; i < n; i++) {
+        if (points[i].offered_rate == hi) first_fail = &points[i];
+    }
+
+    print_separator();
+    printf("SATURATION POINT\n");
+    print_separator();
+    if (n == 0) {
+        printf("  No trials completed.\n");
+        return -1;
+    }
+    if (knee == 0) {
+        printf("  Knee:             not found (lowest rate %d msg/sec already fails)\n",
+               BENCH_START_RATE);
+    } else {
+        printf("  Knee:             %d msg/sec (highest passing offered load)\n", knee);
+    }
+    if (first_fail != NULL) {
+        printf("  First Failure:    %d msg/sec (p99 %.3f ms, %.1f%% blocked)\n",
+               first_fail->offered_rate, first_fail->p99_us / 1000.0,
+               first_fail->block_pct);
+    } else {
+        printf("  First Failure:    none up to %d msg/sec\n", lo);
+    }
+    printf("  Trials:           %d%s\n", n,
+           (!*running || time_elapsed() >= deadline) ? " (stopped early)" : "");
+
+    snprintf(filename, sizeof(filename), "saturation_p%d_c%d_q%d.csv",
+             params->num_producers, params->num_consumers, params->queue_size);
+    if (write_curve_csv(filename, points, n) == 0) {
+        printf("  Curve CSV:        %s\n", filename);
+    } else {
+        fprintf(stderr, "[WARN] Saturation CSV export failed\n");
+    }
+
+    return 0;
+}
+
+/* --- Scaling Sweep --- */
+
+/*
+ * Writes one row per (backend, thread count).
+ *
+ * Error handling: Same as write_curve_csv.
+ */
+static int write_scaling_csv(const char *filename, const BenchPoint *points,
+                             const int *backend_of, const int *threads_of, int n)
+{
+    FILE *fp;
+    int i, write_errors = 0;
+
+    fp = fopen(filename, "w");
+    if (!fp) {
+        perror("[ERROR] bench: fopen failed");
+        return -1;
+    }
+
+    if (fprintf(fp, "Backend,Producers,Consumers,Throughput,EnqP50_ns,EnqP99_ns,"
+                "EnqP999_ns,DeqP50_ns,DeqP99_ns,DeqP999_ns,CpuPct,Speedup\n") < 0) {
+        fprintf(stderr, "[ERROR] bench: failed writing CSV header\n");
+        fclose(fp);
+        return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        /* Speedup is relative to the same backend's first (1x1) row */
+        const BenchPoint *base = &points[i];
+        int j;
+        for (j = 0; j < i; j++) {
+            if (backend_of[j] == backend_of[i]) { base = &points[j]; break; }
+        }
+        if (fprintf(fp, "%s,%d,%d,%.1f,%lld,%lld,%lld,%lld,%lld,%lld,%.1f,%.2f\n",
+                    bench_backends[backend_of[i]].name, threads_of[i], threads_of[i],
+                    points[i].achieved_rate,
+                    points[i].enq_p50_ns, points[i].enq_p99_ns, points[i].enq_p999_ns,
+                    points[i].deq_p50_ns, points[i].deq_p99_ns, points[i].deq_p999_ns,
+                    points[i].cpu_util_pct,
+                    base->achieved_rate > 0 ? points[i].achieved_rate / base->achieved_rate : 0.0) < 0) {
+            write_errors++;
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        perror("[ERROR] bench: fclose failed");
+        return -1;
+    }
+    if (write_errors > 0) {
+        fprintf(stderr, "[WARN] bench: %d CSV write errors (file may be incomplete)\n",
+                write_errors);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Error handling: A failed trial ends the sweep for every backend;
+ * completed rows are still printed and exported. Ctrl+C is checked
+ * inside each trial.
+ */
+int bench_run_scaling(const RuntimeParams *params, volatile sig_atomic_t *running)
+{
+    static BenchPoint points[BENCH_NUM_BACKENDS * BENCH_MAX_SCALE_STEPS];
+    int backend_of[BENCH_NUM_BACKENDS * BENCH_MAX_SCALE_STEPS];
+    int threads_of[BENCH_NUM_BACKENDS * BENCH_MAX_SCALE_STEPS];
+    int steps[BENCH_MAX_SCALE_STEPS];
+    BenchTrialConfig cfg;
+    int ncpu, limit, num_steps = 0, n = 0, b, s, t, failed = 0;
+    char filename[256];
+
+    if (params == NULL) return -1;
+
+    /* Thread counts per side: 1, 2, 4 .. limit, always ending on limit */
+    ncpu = bench_online_cpus();
+    limit = params->scale_max > 0 ? params->scale_max : ncpu;
+    if (limit > MAX_PRODUCERS) limit = MAX_PRODUCERS;
+    if (limit > MAX_CONSUMERS) limit = MAX_CONSUMERS;
+    for (t = 1; t < limit && num_steps < BENCH_MAX_SCALE_STEPS - 1; t *= 2) {
+        steps[num_steps++] = t;
+    }
+    steps[num_steps++] = limit;
+
+    cfg.queue_size = params->queue_size;
+    cfg.aging_interval = params->aging_interval;
+    cfg.offered_rate = 0;
+    cfg.duration_ms = params->trial_ms;
+    cfg.service_us = params->service_us;
+    cfg.pin_threads = 1;
+    cfg.policy = QUEUE_POLICY_PRIORITY;
+    cfg.mlfq_quantum_us = 0;
+    cfg.long_service_us = 0;
+
+    print_separator();
+    printf("SCALING\n");
+    print_separator();
+    printf("  %d online core%s, %d ms per trial, unthrottled producers, pinned threads\n",
+           ncpu, ncpu == 1 ? "" : "s", params->trial_ms);
+    printf("  %-12s %5s %12s %9s %9s %9s %9s %6s %8s\n",
+           "Backend", "PxC", "Msgs/sec", "Enq p50", "Enq p99", "Deq p50", "Deq p99",
+           "CPU%", "Speedup");
+    printf("  %-12s %5s %12s %9s %9s %9s %9s\n",
+           "", "", "", "(ns)", "(ns)", "(ns)", "(ns)");
+
+    for (b = 0; b < BENCH_NUM_BACKENDS && !failed; b++) {
+        double base_rate = 0.0;
+        for (s = 0; s < num_steps && *running; s++) {
+            BenchPoint *pt = &points[n];
+            char pxc[16];
+
+            cfg.num_producers = steps[s];
+            cfg.num_consumers = steps[s];
+            cfg.credit_batch = bench_backends[b].credit_batch;
+            cfg.ack_timeout_ms = bench_backends[b].ack_timeout_ms;
+            if (bench_run_trial(&cfg, running, pt) != 0) {
+                failed = 1;
+                break;
+            }
+            if (s == 0) base_rate = pt->achieved_rate;
+            backend_of[n] = b;
+            threads_of[n] = steps[s];
+            n++;
+
+            snprintf(pxc, sizeof(pxc), "%dx%d", steps[s], steps[s]);
+            printf("  %-12s %5s %12.0f %9lld %9lld %9lld %9lld %5.0f%% %7.2fx\n",
+                   bench_backends[b].name, pxc, pt->achieved_rate,
+                   pt->enq_p50_ns, pt->enq_p99_ns, pt->deq_p50_ns, pt->deq_p99_ns,
+                   pt->cpu_util_pct,
+                   base_rate > 0 ? pt->achieved_rate / base_rate : 0.0);
+            fflush(stdout);
+        }
+    }
+
+    if (n == 0) {
+        printf("  No trials completed.\n");
+        return -1;
+    }
+    for (b = 0; b < BENCH_NUM_BACKENDS; b++) {
+        printf("  %-12s %s\n", bench_backends[b].name, bench_backends[b].description);
+    }
+    if (ncpu < limit) {
+        printf("  Note: %d threads per side share %d core%s; speedup is bounded by the cores.\n",
+               limit, ncpu, ncpu == 1 ? "" : "s");
+    }
+
+    snprintf(filename, sizeof(filename), "scaling_q%d.csv", params->queue_size);
+    if (write_scaling_csv(filename, points, backend_of, threads_of, n) == 0) {
+        printf("  Scaling CSV:      %s\n", filename);
+    } else {
+        fprintf(stderr, "[WARN] Scaling CSV export failed\n");
+    }
+
+    return failed ? -1 : 0;
+}
+
+/* --- Wake-Up Latency Benchmark --- */
+
+/*
+ * Consumer wait paths compared by --wakeup-bench. Each path gets a
+ * fresh queue; the epoll paths enable its readiness eventfd first.
+ */
+typedef struct {
+    const char *name;
+    int use_epoll;
+    QueueReadyMode mode;
+} WakeupPath;
+
+static const WakeupPath wakeup_paths[] = {
+    { "sem_wait",    0, QUEUE_READY_LEVEL },
+    { "epoll-level", 1, QUEUE_READY_LEVEL },
+    { "epoll-edge",  1, QUEUE_READY_EDGE }
+};
+#define WAKEUP_NUM_PATHS ((int)(sizeof(wakeup_paths) / sizeof(wakeup_paths[0])))
+
+/* One ping-pong run (static: the queue and histograms are large) */
+typedef struct {
+    Queue queue;
+    const WakeupPath *path;
+    ConsumerEpoll ep;
+    sem_t done;                 // Consumer -> driver: message taken
+    long long sent_ns;          // Stamp taken just before the enqueue
+    int rounds;
+    int failed;                 // Consumer stopped early
+    Histogram wake_ns;          // Enqueue start -> consumer running again
+    Histogram enqueue_ns;       // Cost of the enqueue (incl. the eventfd write)
+} WakeupRun;
+
+static WakeupRun wakeup_run;
+
+static void *wakeup_consumer_thread(void *arg)
+{
+    WakeupRun *run = (WakeupRun *)arg;
+    Message msg;
+    int i, result;
+
+    for (i = 0; i < run->rounds; i++) {
+        if (run->path->use_epoll) {
+            result = consumer_epoll_dequeue(&run->ep, &run->queue, &msg, NULL, NULL);
+        } else {
+            result = queue_dequeue_safe(&run->queue, &msg, NULL, NULL);
+        }
+        if (result != 0) {
+            run->failed = 1;
+            sem_post(&run->done);
+            break;
+        }
+        histogram_record(&run->wake_ns,
+                         now_ns() - __atomic_load_n(&run->sent_ns, __ATOMIC_ACQUIRE));
+        sem_post(&run->done);
+    }
+    return NULL;
+}
+
+/*
+ * Runs 'rounds' ping-pongs on one path: the driver pauses long enough
+ * for the consumer to be asleep, stamps, enqueues one message and
+ * waits for the consumer to report it taken.
+ * Returns: 0 on success, -1 on setup failure.
+ */
+static int run_wakeup_path(WakeupRun *run, const WakeupPath *path, int queue_size,
+                           int aging_interval, int rounds, volatile sig_atomic_t *running)
+{
+    pthread_t tid;
+    long long t0;
+    int i;
+
+    memset(run, 0, sizeof(*run));
+    run->path = path;
+    run->rounds = rounds;
+    run->ep.epoll_fd = -1;
+    histogram_init(&run->wake_ns);
+    histogram_init(&run->enqueue_ns);
+
+    if (queue_init(&run->queue, queue_size, aging_interval) != 0) return -1;
+    if (sem_init(&run->done, 0, 0) != 0) {
+        fprintf(stderr, "[ERROR] bench_run_wakeup: sem_init failed\n");
+        queue_destroy(&run->queue);
+        return -1;
+    }
+    if (path->use_epoll &&
+        (queue_enable_ready_fd(&run->queue, path->mode) < 0 ||
+         consumer_epoll_open(&run->ep, &run->queue) != 0)) {
+        sem_destroy(&run->done);
+        queue_destroy(&run->queue);
+        return -1;
+    }
+    if (pthread_create(&tid, NULL, wakeup_consumer_thread, run) != 0) {
+        fprintf(stderr, "[ERROR] bench_run_wakeup: pthread_create failed\n");
+        consumer_epoll_close(&run->ep);
+        sem_destroy(&run->done);
+        queue_destroy(&run->queue);
+        return -1;
+    }
+
+    for (i = 0; i < rounds && *running && !run->failed; i++) {
+        Message msg = message_create(i, PRIORITY_MIN, 0);
+
+        sleep_us(WAKEUP_SETTLE_US);
+        t0 = now_ns();
+        __atomic_store_n(&run->sent_ns, t0, __ATOMIC_RELEASE);
+        if (queue_enqueue_safe(&run->queue, msg, NULL, NULL) != 0) break;
+        histogram_record(&run->enqueue_ns, now_ns() - t0);
+        while (sem_wait(&run->done) != 0) { /* EINTR */ }
+    }
+
+    /* Releases the consumer if the loop stopped early */
+    queue_shutdown(&run->queue);
+    pthread_join(tid, NULL);
+    consumer_epoll_close(&run->ep);
+    sem_destroy(&run->done);
+    return 0;
+}
+
+/*
+ * Wake-up latency (--wakeup-bench). Prints, per consumer wait path,
+ * the enqueue-to-running latency percentiles, the enqueue cost and the
+ * wake-ups and eventfd writes each message took.
+ */
+int bench_run_wakeup(const RuntimeParams *params, volatile sig_atomic_t *running)
+{
+    QueueReadyStats ready;
+    int p, completed = 0;
+
+    if (params == NULL || running == NULL) return -1;
+
+    print_separator();
+    printf("WAKE-UP LATENCY (%d round%s per path, %d us pause before each)\n",
+           params->wakeup_rounds, params->wakeup_rounds == 1 ? "" : "s", WAKEUP_SETTLE_US);
+    print_separator();
+    printf("  %-12s %8s %8s %8s %8s %9s %9s %9s\n",
+           "Path", "p50", "p90", "p99", "max", "Enq p50", "Wake-ups", "Eventfd");
+    printf("  %-12s %8s %8s %8s %8s %9s %9s %9s\n",
+           "", "(us)", "(us)", "(us)", "(us)", "(ns)", "/msg", "writes/msg");
+
+    for (p = 0; p < WAKEUP_NUM_PATHS && *running; p++) {
+        WakeupRun *run = &wakeup_run;
+        const Histogram *h = &run->wake_ns;
+        char wakeups[16], writes[16];
+        double n;
+
+        if (run_wakeup_path(run, &wakeup_paths[p], params->queue_size,
+                            params->aging_interval, params->wakeup_rounds, running) != 0) {
+            fprintf(stderr, "[ERROR] bench_run_wakeup: %s path could not be set up\n",
+                    wakeup_paths[p].name);
+            continue;
+        }
+        queue_ready_stats(&run->queue, &ready);
+        n = h->total > 0 ? (double)h->total : 1.0;
+        if (wakeup_paths[p].use_epoll) {
+            snprintf(wakeups, sizeof(wakeups), "%.2f", run->ep.wakeups / n);
+            snprintf(writes, sizeof(writes), "%.2f", ready.signals / n);
+        } else {
+            snprintf(wakeups, sizeof(wakeups), "-");
+            snprintf(writes, sizeof(writes), "-");
+        }
+        printf("  %-12s %8.1f %8.1f %8.1f %8.1f %9lld %9s %9s\n",
+               wakeup_paths[p].name,
+               histogram_percentile(h, 50.0) / 1000.0, histogram_percentile(h, 90.0) / 1000.0,
+               histogram_percentile(h, 99.0) / 1000.0, h->max / 1000.0,
+               histogram_percentile(&run->enqueue_ns, 50.0), wakeups, writes);
+        fflush(stdout);
+        queue_destroy(&run->queue);
+        if (h->total > 0) completed++;
+    }
+
+    if (completed == 0) {
+        printf("  No paths completed.\n");
+        return -1;
+    }
+    printf("  Wake-up = enqueue start to the blocked consumer running again.\n");
+    return 0;
+}
+
+/* --- Dequeue Policy Comparison --- */
+
+static void print_policy_row(const char *name, const BenchPoint *pt)
+{
+    const Histogram *s = &pt->short_latency, *l = &pt->long_latency;
+
+    printf("  %-9s %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+           name, pt->achieved_rate,
+           histogram_mean(s) / 1000.0, histogram_percentile(s, 50.0) / 1000.0,
+           histogram_percentile(s, 99.0) / 1000.0,
+           histogram_mean(l) / 1000.0, histogram_percentile(l, 50.0) / 1000.0,
+           histogram_percentile(l, 99.0) / 1000.0);
+    fflush(stdout);
+}
+
+/*
+ * Error handling: A failed trial ends the comparison; the rows already
+ * measured are still printed. Both policies get the same offered load
+ * and service times, so only the dequeue order differs.
+ */
+int bench_run_policy(const RuntimeParams *params, volatile sig_atomic_t *running)
+{
+    static BenchPoint points[2];
+    static const QueuePolicy policies[2] = { QUEUE_POLICY_PRIORITY, QUEUE_POLICY_MLFQ };
+    BenchTrialConfig cfg;
+    const QueueMlfq *m;
+    double mean_service_us;
+    int n, c;
+
+    if (params == NULL || running == NULL) return -1;
+
+    cfg.num_producers = params->num_producers;
+    cfg.num_consumers = params->num_consumers;
+    cfg.queue_size = params->queue_size;
+    cfg.aging_interval = params->aging_interval;
+    cfg.duration_ms = params->trial_ms;
+    cfg.service_us = params->service_us > 0 ? params->service_us : BENCH_SHORT_SERVICE_US;
+    cfg.long_service_us = cfg.service_us * BENCH_LONG_JOB_FACTOR;
+    cfg.pin_threads = 0;
+    cfg.credit_batch = 0;
+    cfg.ack_timeout_ms = 0;
+    cfg.mlfq_quantum_us = params->mlfq_quantum_us;
+
+    /* Half the classes are long, so the mean job is (short + long) / 2 */
+    mean_service_us = (cfg.service_us + cfg.long_service_us) / 2.0;
+    cfg.offered_rate = (int)(params->num_consumers * 1e6 / mean_service_us *
+                             BENCH_POLICY_LOAD_PCT / 100.0);
+    if (cfg.offered_rate < 1) cfg.offered_rate = 1;
+
+    print_separator();
+    printf("DEQUEUE POLICY COMPARISON\n");
+    print_separator();
+    printf("  Jobs: even classes short (%d us), odd classes long (%d us)\n",
+           cfg.service_us, cfg.long_service_us);
+    printf("  Load: %d msg/s = %d%% of the capacity of %d consumer%s, %d ms per trial, "
+           "MLFQ quantum %d us\n",
+           cfg.offered_rate, BENCH_POLICY_LOAD_PCT, cfg.num_consumers,
+           cfg.num_consumers == 1 ? "" : "s", cfg.duration_ms, cfg.mlfq_quantum_us);
+    printf("  %-9s %10s %9s %9s %9s %9s %9s %9s\n",
+           "Policy", "Achieved/s", "Short avg", "p50", "p99", "Long avg", "p50", "p99");
+    printf("  %-9s %10s %9s %9s %9s %9s %9s %9s\n",
+           "", "", "(ms)", "(ms)", "(ms)", "(ms)", "(ms)", "(ms)");
+
+    for (n = 0; n < 2 && *running; n++) {
+        cfg.policy = policies[n];
+        if (bench_run_trial(&cfg, running, &points[n]) != 0) break;
+        print_policy_row(queue_policy_name(policies[n]), &points[n]);
+    }
+
+    if (n < 2) {
+        printf("  Comparison incomplete (%d of 2 trials).\n", n);
+        return -1;
+    }
+
+    m = &points[1].mlfq;
+    printf("  MLFQ:      %lld demotions, %lld promotions, %lld resets; levels at the end:",
+           m->demotions, m->promotions, m->resets);
+    for (c = PRIORITY_MIN; c <= PRIORITY_MAX; c++) printf(" %d", m->level[c]);
+    printf("\n");
+    printf("  Short p99: %.3f -> %.3f ms under MLFQ; long p99: %.3f -> %.3f ms\n",
+           histogram_percentile(&points[0].short_latency, 99.0) / 1000.0,
+           histogram_percentile(&points[1].short_latency, 99.0) / 1000.0,
+           histogram_percentile(&points[0].long_latency, 99.0) / 1000.0,
+           histogram_percentile(&points[1].long_latency, 99.0) / 1000.0);
+    printf("  Latency = intended send to dequeue (queueing only, service excluded).\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * bench.h: Benchmark Mode Declarations
+ * * Runs short, self-contained load trials against a fresh queue.
+ * * Each trial uses rate-controlled (open-loop) producers and consumers
+ * * with a fixed service time, instead of the sleeping simulation loops.
+ * * Saturation finder (--saturate): ramps then binary-searches the
+ * * offered load for the highest rate that meets the latency/block limits.
+ * * Scaling sweep (--scale): unthrottled trials at 1, 2, 4 .. N threads
+ * * per side, pinned to cores, compared per queue backend.
+ * * Wake-up benchmark (--wakeup-bench): ping-pongs one message at a time
+ * * to compare sem_wait against epoll on the queue's readiness eventfd.
+ * * Policy comparison (--policy-bench): the same mixed short/long job
+ * * load under the priority and the MLFQ dequeue policy.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <signal.h>
+#include "cli.h"
+#include "histogram.h"
+
+/* --- Constants --- */
+
+#define BENCH_START_RATE        100   // First offered load (msg/sec, total)
+#define BENCH_MAX_TRIALS        64    // Hard cap on trials per search
+#define BENCH_RESOLUTION_PCT    5     // Binary search stops within 5% of the knee
+#define BENCH_MAX_SCALE_STEPS   8     // 1, 2, 4 .. 128 threads per side (capped by config.h)
+#define BENCH_CREDIT_BATCH      8     // Credits per grab for the credit-ring backend
+#define BENCH_ACK_TIMEOUT_MS    1000  // Visibility timeout for the lease-ring backend
+#define BENCH_POLICY_LOAD_PCT   85    // Policy comparison: offered load vs consumer capacity
+#define BENCH_LONG_JOB_FACTOR   10    // Long jobs (odd classes) take 10x the short service
+#define BENCH_SHORT_SERVICE_US  200   // Short service when --service-us is 0
+
+/* --- Data Structures --- */
+
+/*
+ * One trial: a fixed offered load held for duration_ms.
+ */
+typedef struct {
+    int num_producers;
+    int num_consumers;
+    int queue_size;
+    int aging_interval;         // Passed through to queue_init
+    int offered_rate;           // Total arrivals/sec (0 = unthrottled, closed loop)
+    int duration_ms;            // Measured trial length
+    int service_us;             // Consumer busy time per message
+    int pin_threads;            // 1 = pin each worker to its own core (round robin)
+    int credit_batch;           // Producer slot credits per grab (0 = semaphore)
+    int ack_timeout_ms;         // Consumers lease + ack each message (0 = at-most-once)
+    QueuePolicy policy;         // Dequeue ranking
+    int mlfq_quantum_us;        // Level-0 quantum when policy is MLFQ
+    int long_service_us;        // Odd classes take this long instead (0 = all service_us)
+} BenchTrialConfig;
+
+/*
+ * Result of one trial (one point on the load-latency curve).
+ * Latency is measured from the intended send time, so a backlog in
+ * front of the queue shows up (coordinated-omission corrected).
+ */
+typedef struct {
+    int offered_rate;
+    double achieved_rate;       // Dequeued msg/sec
+    long long produced;
+    long long consumed;
+    long long blocks;           // Enqueues that had to wait for a slot
+    double block_pct;           // blocks / produced * 100
+    long long p50_us;
+    long long p90_us;
+    long long p99_us;
+    long long p999_us;
+    long long max_us;
+    long long enq_p50_ns;       // Per-op cost of queue_enqueue_safe (incl. blocking)
+    long long enq_p99_ns;
+    long long enq_p999_ns;
+    long long deq_p50_ns;       // Per-op cost of queue_dequeue_safe (incl. blocking,
+                                // plus lease and ack in at-least-once mode)
+    long long deq_p99_ns;
+    long long deq_p999_ns;
+    double cpu_util_pct;        // Process CPU time / (wall time x online cores)
+    int passed;                 // 1 if within the p99 and block limits
+    Histogram short_latency;    // Mixed service (long_service_us > 0): even classes
+    Histogram long_latency;     // ...and odd classes, as 'latency' above
+    QueueMlfq mlfq;             // Class levels and moves at the end (MLFQ policy)
+} BenchPoint;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Runs one trial on a private queue and fills 'out'.
+ * Stops early (returns -1) if *abort_flag is cleared.
+ * Returns: 0 on success, -1 on init/thread failure or abort.
+ */
+int bench_run_trial(const BenchTrialConfig *cfg, volatile sig_atomic_t *abort_flag,
+                    BenchPoint *out);
+
+/*
+ * Saturation finder (--saturate).
+ * Doubles the offered load from BENCH_START_RATE until a trial breaks
+ * the p99 or block-rate limit, then binary-searches between the last
+ * passing and first failing rate. Prints the curve and knee point and
+ * writes the curve as CSV. 'running' is the global stop flag (Ctrl+C).
+ * Returns: 0 on success, -1 on failure.
+ */
+int bench_run_saturation(const RuntimeParams *params, volatile sig_atomic_t *running);
+
+/*
+ * Scaling sweep (--scale).
+ * For each queue backend, runs unthrottled trials with 1, 2, 4 ..
+ * producers and as many consumers, up to the online core count (or
+ * --scale-max), and reports throughput, per-op latency percentiles and
+ * CPU utilisation as a table plus CSV.
+ * Returns: 0 on success, -1 on failure.
+ */
+int bench_run_scaling(const RuntimeParams *params, volatile sig_atomic_t *running);
+
+/*
+ * Wake-up latency benchmark (--wakeup-bench).
+ * For sem_wait and for epoll on a level- and an edge-triggered
+ * readiness eventfd, a blocked consumer is woken --wakeup-bench times
+ * by a single enqueue; prints latency percentiles, enqueue cost and
+ * wake-ups / eventfd writes per message.
+ * Returns: 0 on success, -1 if no path completed.
+ */
+int bench_run_wakeup(const RuntimeParams *params, volatile sig_atomic_t *running);
+
+/*
+ * Dequeue policy comparison (--policy-bench).
+ * Odd classes are long jobs (BENCH_LONG_JOB_FACTOR x the short service
+ * time), even classes short; the offered load is BENCH_POLICY_LOAD_PCT
+ * of the consumers' capacity. One trial per policy, then a table of
+ * mean and tail queueing latency per job kind.
+ * Returns: 0 on success, -1 if a trial failed.
+ */
+int bench_run_policy(const RuntimeParams *params, volatile sig_atomic_t *running);
+
+/* Number of online CPUs (at least 1). */
+int bench_online_cpus(void);
+
+#endif /* BENCH_H */
@@ -28,7 +28,7 @@ void print_usage(const char *program_name)
 {
     printf("\nELE430 Producer-Consumer Model - Usage\n");
     print_separator();
-    printf("Usage: %s [-h] [-v] [-d <level>] [-s <seed>] [-a <ms>] [-p <sec>] [-c <sec>]\n", program_name);
+    printf("Usage: %s [-h] [-v] [-d <level>] [-s <seed>] [-a <ms>] [-p <sec>] [-c <sec>] [long options]\n", program_name);
     printf("       %*s <producers> <consumers> <queue_size> <timeout>\n", (int)strlen(program_name) + 7, "");
     printf("\nArguments:\n");
     printf("  -h, --help  - Show this help message and exit\n");
@@ -42,6 +42,57 @@ void print_usage(const char *program_name)
     printf("  consumers   - Number of consumer threads  [%d to %d]\n", MIN_CONSUMERS, MAX_RUNTIME_CONSUMERS);
     printf("  queue_size  - Maximum queue capacity      [%d to %d]\n", MIN_QUEUE_SIZE, MAX_QUEUE_SIZE);
     printf("  timeout     - Runtime in seconds          [minimum %d]\n", MIN_TIMEOUT);
+    printf("\nLong Options:\n");
+    printf("  --perf              - Hardware counters (cycles, instructions, misses) per message\n");
+    printf("  --open-loop <rate>  - Open-loop producers: <rate> arrivals/sec each [1 to %d]\n", MAX_OPEN_LOOP_RATE);
+    printf("  --warmup <sec>      - Exclude the first <sec> seconds from the report [0 to timeout-1]\n");
+    printf("  --batch <k>         - Consumers take up to <k> top items per lock [1 to %d]\n",
+           MAX_BATCH_SIZE);
+    printf("  --reserve <pct>     - Reserve <pct>%% of slots for priorities %d-%d [0 to %d]\n",
+           RESERVED_PRIORITY_MIN, PRIORITY_MAX, MAX_RESERVE_PCT);
+    printf("  --credits <n>       - Producers grab up to <n> slot credits at once [1 to %d]\n",
+           MAX_CREDIT_BATCH);
+    printf("  --delay <ms>        - Deliver each message 0..<ms> ms after creation [1 to %d]\n",
+           MAX_DELAY_MS);
+    printf("  --ttl <ms>          - Drop messages not consumed within <ms> ms [1 to %d]\n",
+           MAX_TTL_MS);
+    printf("  --ack-timeout <ms>  - At-least-once: redeliver if not acked within <ms> [1 to %d]\n",
+           MAX_ACK_TIMEOUT_MS);
+    printf("  --max-deliveries <n> - Dead-letter after <n> deliveries [1 to %d] (default: %d)\n",
+           MAX_DELIVERIES_LIMIT, DEFAULT_MAX_DELIVERIES);
+    printf("  --fail-pct <pct>    - Consumers nack <pct>%% of deliveries [0 to 100]\n");
+    printf("  --filter <c:spec>   - Consumer <c> only takes matching messages (repeatable);\n");
+    printf("                        spec = band 'lo-hi', producers 'p1,3', or both 'p1,3/lo-hi'\n");
+    printf("  --coalesce <keys>   - Key messages 1..<keys>; a queued key is updated in place [1 to %d]\n",
+           MAX_COALESCE_KEYS);
+    printf("  --partitions <n>    - Per-key FIFO: hash keys (or producers) to <n> leased partitions [1 to %d]\n",
+           MAX_PARTITIONS);
+    printf("  --spill <n>         - Full ring spills up to <n> messages to an mmapped file [1 to %d]\n",
+           MAX_SPILL_MESSAGES);
+    printf("  --epoll <mode>      - Consumers wait in epoll_wait on a queue eventfd ('level' or 'edge')\n");
+    printf("  --sink <path>       - Consumers append processed messages to <path> (group commit)\n");
+    printf("  --sink-backend <b>  - Sink writes with 'uring' (default, registered buffers) or 'writev'\n");
+    printf("  --sink-sync         - fdatasync the sink after every group commit\n");
+    printf("  --source <path>     - Producers parse 'data[,priority]' lines from <path> ('-' = stdin)\n");
+    printf("  --listen <path>     - No producer threads: accept frames from clients on a Unix socket\n");
+    printf("  --rpc <n>           - Producers are closed-loop clients with <n> requests awaiting replies [1 to %d]\n",
+           RPC_MAX_OUTSTANDING);
+    printf("  --groups <g>        - Pub/sub: every message goes to each of <g> consumer groups [1 to consumers]\n");
+    printf("  --policy <p>        - Dequeue policy: 'priority' (static + aging, default) or 'mlfq'\n");
+    printf("  --mlfq-quantum <us> - MLFQ level-0 quantum, x%d per level [1 to %d] (default: %d)\n",
+           MLFQ_QUANTUM_FACTOR, MAX_MLFQ_QUANTUM_US, DEFAULT_MLFQ_QUANTUM_US);
+    printf("  --policy-bench      - Compare both policies on mixed short/long jobs (--service-us = short)\n");
+    printf("  --saturate          - Find the max sustainable rate (timeout = search budget)\n");
+    printf("  --service-us <us>   - Benchmark consumer work per message [0 to %d]\n", MAX_SERVICE_US);
+    printf("  --p99-limit <ms>    - Saturation p99 latency limit (default: %d)\n", DEFAULT_P99_LIMIT_MS);
+    printf("  --block-limit <pct> - Saturation blocked-enqueue limit (default: %d)\n", DEFAULT_BLOCK_LIMIT_PCT);
+    printf("  --trial-ms <ms>     - Benchmark trial length [%d to %d] (default: %d)\n",
+           MIN_TRIAL_MS, MAX_TRIAL_MS, DEFAULT_TRIAL_MS);
+    printf("  --scale             - Sweep 1, 2, 4 .. N threads per side, report scaling\n");
+    printf("  --scale-max <n>     - Largest thread count in the sweep [1 to %d] (default: cores)\n",
+           MAX_CONSUMERS);
+    printf("  --wakeup-bench <n>  - Compare sem_wait vs epoll wake-up latency over <n> rounds [1 to %d]\n",
+           MAX_WAKEUP_ROUNDS);
     printf("\nExample:\n  %s -v 5 3 10 60\n", program_name);
     printf("\nSignals:\n  Ctrl+C (SIGINT)  - Graceful shutdown\n  SIGTERM          - Graceful shutdown\n");
 }
@@ -82,6 +133,88 @@ void print_startup_info(const RuntimeParams *params)
         printf("  Aging:        Disabled\n");
     else
         printf("  Aging:        %d ms\n", params->aging_interval);
+    if (params->perf_enabled)
+        printf("  Perf Counters: Enabled\n");
+    if (params->open_loop_rate > 0)
+        printf("  Load Model:   Open loop, %d msg/sec per producer\n", params->open_loop_rate);
+    if (params->warmup_seconds > 0)
+        printf("  Warm-up:      %d seconds (excluded from report)\n", params->warmup_seconds);
+    if (params->batch_size > 1)
+        printf("  Batch Dequeue: Up to %d items per lock\n", params->batch_size);
+    if (params->reserve_pct > 0)
+        printf("  Reserved:     %d%% of slots for priority >= %d\n",
+               params->reserve_pct, RESERVED_PRIORITY_MIN);
+    if (params->credit_batch > 0)
+        printf("  Flow Control: Credits, up to %d per grab\n", params->credit_batch);
+    if (params->max_delay_ms > 0)
+        printf("  Delivery:     Delayed 0-%d ms via timing wheel\n", params->max_delay_ms);
+    if (params->ttl_ms > 0)
+        printf("  Message TTL:  %d ms (expired items dropped and swept)\n", params->ttl_ms);
+    if (params->ack_timeout_ms > 0)
+        printf("  Delivery:     At-least-once, ack within %d ms, dead-letter after %d, %d%% nacked\n",
+               params->ack_timeout_ms,
+               params->max_deliveries > 0 ? params->max_deliveries : DEFAULT_MAX_DELIVERIES,
+               params->fail_pct);
+    if (params->coalesce_keys > 0)
+        printf("  Coalescing:   %d keys (a queued key's message is replaced in place)\n",
+               params->coalesce_keys);
+    if (params->partitions > 0)
+        printf("  Partitions:   %d, keyed by %s (FIFO per partition, one consumer at a time)\n",
+               params->partitions, params->coalesce_keys > 0 ? "message key" : "producer");
+    if (params->spill_capacity > 0)
+        printf("  Spill-Over:   Up to %d messages to an mmapped file in %s when full\n",
+               params->spill_capacity, SPILL_DIR);
+    if (params->sink_path[0] != '\0')
+        printf("  File Sink:    %s (%s%s)\n", params->sink_path,
+               params->sink_backend == SINK_WRITEV ? "writev group commit" : "io_uring",
+               params->sink_sync ? ", fdatasync per group" : "");
+    if (params->source_path[0] != '\0')
+        printf("  Source:       %s (parsed lines, batch enqueue; the run ends when it is drained)\n",
+               strcmp(params->source_path, "-") == 0 ? "stdin" : params->source_path);
+    if (params->listen_path[0] != '\0')
+        printf("  Listener:     %s (socket clients replace the %d producers; see ./loadgen)\n",
+               params->listen_path, params->num_producers);
+    if (params->rpc_outstanding > 0)
+        printf("  Request/Reply: %d outstanding per producer (replies after processing, no think time)\n",
+               params->rpc_outstanding);
+    if (params->groups > 0)
+        printf("  Fan-Out:      %d consumer groups over one shared log (consumer i joins group (i-1) %% %d)\n",
+               params->groups, params->groups);
+    if (params->policy == QUEUE_POLICY_MLFQ)
+        printf("  Policy:       MLFQ, %d levels, quantum %d us x%d per level, reset every %d ms\n",
+               MLFQ_LEVELS, params->mlfq_quantum_us, MLFQ_QUANTUM_FACTOR, MLFQ_RESET_MS);
+    if (params->epoll_mode > 0)
+        printf("  Consumer Wait: epoll_wait on the queue's eventfd (%s-triggered)\n",
+               params->epoll_mode - 1 == QUEUE_READY_EDGE ? "edge" : "level");
+    {
+        int i;
+        char desc[96];
+        for (i = 0; i < MAX_CONSUMERS; i++) {
+            if (!params->has_filter[i]) continue;
+            queue_filter_describe(&params->consumer_filter[i], desc, sizeof(desc));
+            printf("  Filter:       Consumer %d takes %s\n", i + 1, desc);
+        }
+    }
+    if (params->saturate) {
+        printf("  Benchmark:    Saturation search, %d ms trials, %d us service time\n",
+               params->trial_ms, params->service_us);
+        printf("  Limits:       p99 <= %d ms, blocked <= %d%%\n",
+               params->p99_limit_ms, params->block_limit_pct);
+    }
+    if (params->scale) {
+        if (params->scale_max > 0)
+            printf("  Benchmark:    Scaling sweep up to %dx%d threads, %d ms trials\n",
+                   params->scale_max, params->scale_max, params->trial_ms);
+        else
+            printf("  Benchmark:    Scaling sweep up to the core count, %d ms trials\n",
+                   params->trial_ms);
+    }
+    if (params->wakeup_rounds > 0)
+        printf("  Benchmark:    Wake-up latency, %d ping-pong rounds per path\n",
+               params->wakeup_rounds);
+    if (params->policy_bench)
+        printf("  Benchmark:    Dequeue policy comparison, %d ms trials, MLFQ quantum %d us\n",
+               params->trial_ms, params->mlfq_quantum_us);
     printf("\n");
 }
 
@@ -120,6 +253,128 @@ static int safe_strtoi(const char *str, int *out)
     return 0;
 }
 
+/*
+ * Parses "<option> <value>" for long options taking an integer.
+ * On success advances *arg_idx past both tokens.
+ * Returns 0 on success, -1 (with an error message) if the value is
+ * missing, non-numeric, or outside [min, max].
+ */
+static int parse_int_option(int argc, char *argv[], int *arg_idx,
+                            int min, int max, int *out)
+{
+    const char *option = argv[*arg_idx];
+    int tmp;
+
+    if (*arg_idx + 1 >= argc) {
+        fprintf(stderr, "Error: %s requires an argument\n", option);
+        return -1;
+    }
+    if (safe_strtoi(argv[*arg_idx + 1], &tmp) != 0 || tmp < min || tmp > max) {
+        fprintf(stderr, "Error: %s requires a numeric argument in [%d, %d]\n",
+                option, min, max);
+        return -1;
+    }
+
+    *out = tmp;
+    *arg_idx += 2;
+    return 0;
+}
+
+/*
+ * Parses a non-negative decimal at *p and advances past it.
+ * Returns 0 on success, -1 if no digit is there or it overflows.
+ */
+static int parse_spec_number(const char **p, int *out)
+{
+    long value = 0;
+
+    if (**p < '0' || **p > '9') return -1;
+    while (**p >= '0' && **p <= '9') {
+        value = value * 10 + (**p - '0');
+        if (value > INT_MAX) return -1;
+        (*p)++;
+    }
+    *out = (int)value;
+    return 0;
+}
+
+/*
+ * Parses "--filter <consumer>:<spec>". The spec is one or two terms
+ * separated by '/': a priority band "lo-hi" (or a single priority) and
+ * a producer list "p1,2,3". Omitted terms accept everything.
+ * Returns 0 on success, -1 (with an error message) on a malformed spec.
+ */
+static int parse_filter_option(int argc, char *argv[], int *arg_idx, RuntimeParams *params)
+{
+    MessageFilter f;
+    const char *p;
+    int consumer, lo, hi, id;
+
+    if (*arg_idx + 1 >= argc) {
+        fprintf(stderr, "Error: --filter requires <consumer>:<spec>\n");
+        return -1;
+    }
+    p = argv[*arg_idx + 1];
+
+    if (parse_spec_number(&p, &consumer) != 0 || *p != ':' ||
+        consumer < 1 || consumer > MAX_CONSUMERS) {
+        fprintf(stderr, "Error: --filter needs a consumer number in [1, %d] before ':'\n",
+                MAX_CONSUMERS);
+        return -1;
+    }
+    p++;
+
+    f.producer_mask = 0;
+    f.min_priority = PRIORITY_MIN;
+    f.max_priority = PRIORITY_MAX;
+
+    while (*p != '\0') {
+        if (*p == 'p') {
+            p++;
+            do {
+                if (*p == ',') p++;
+                if (parse_spec_number(&p, &id) != 0 || id < 1 || id > MAX_PRODUCERS) {
+                    fprintf(stderr, "Error: --filter producer ids must be in [1, %d]\n",
+                            MAX_PRODUCERS);
+                    return -1;
+                }
+                f.producer_mask |= 1u << id;
+            } while (*p == ',');
+        } else {
+            if (parse_spec_number(&p, &lo) != 0) {
+                fprintf(stderr, "Error: --filter spec '%s' is malformed\n", argv[*arg_idx + 1]);
+                return -1;
+            }
+            hi = lo;
+            if (*p == '-') {
+                p++;
+                if (parse_spec_number(&p, &hi) != 0) {
+                    fprintf(stderr, "Error: --filter band needs 'lo-hi'\n");
+                    return -1;
+                }
+            }
+            if (lo < PRIORITY_MIN || hi > PRIORITY_MAX || lo > hi) {
+                fprintf(stderr, "Error: --filter band must satisfy %d <= lo <= hi <= %d\n",
+                        PRIORITY_MIN, PRIORITY_MAX);
+                return -1;
+            }
+            f.min_priority = lo;
+            f.max_priority = hi;
+        }
+        if (*p == '/') {
+            p++;
+        } else if (*p != '\0') {
+            fprintf(stderr, "Error: --filter spec '%s' is malformed\n", argv[*arg_idx + 1]);
+            return -1;
+        }
+    }
+
+    params->consumer_filter[consumer - 1] = f;
+    params->has_filter[consumer - 1] = 1;
+    *arg_idx += 2;
+    return 0;
+}
+
 int parse_arguments(int argc, char *argv[], RuntimeParams *params)
 {
     int tmp;
@@ -134,6 +389,41 @@ int parse_arguments(int argc, char *argv[], RuntimeParams *params)
     params->aging_interval = AGING_INTERVAL_MS;
     params->max_producer_wait = MAX_PRODUCER_WAIT;
     params->max_consumer_wait = MAX_CONSUMER_WAIT;
+    params->perf_enabled = 0;
+    params->open_loop_rate = 0;
+    params->warmup_seconds = 0;
+    params->saturate = 0;
+    params->service_us = 0;
+    params->p99_limit_ms = DEFAULT_P99_LIMIT_MS;
+    params->block_limit_pct = DEFAULT_BLOCK_LIMIT_PCT;
+    params->trial_ms = DEFAULT_TRIAL_MS;
+    params->scale = 0;
+    params->scale_max = 0;
+    params->batch_size = 1;
+    params->reserve_pct = 0;
+    params->credit_batch = 0;
+    params->max_delay_ms = 0;
+    params->ttl_ms = 0;
+    params->ack_timeout_ms = 0;
+    params->max_deliveries = 0;
+    params->fail_pct = 0;
+    memset(params->consumer_filter, 0, sizeof(params->consumer_filter));
+    memset(params->has_filter, 0, sizeof(params->has_filter));
+    params->coalesce_keys = 0;
+    params->partitions = 0;
+    params->spill_capacity = 0;
+    params->epoll_mode = 0;
+    params->wakeup_rounds = 0;
+    params->rpc_outstanding = 0;
+    params->groups = 0;
+    params->policy = QUEUE_POLICY_PRIORITY;
+    params->mlfq_quantum_us = DEFAULT_MLFQ_QUANTUM_US;
+    params->policy_bench = 0;
+    params->sink_path[0] = '\0';
+    params->sink_backend = SINK_URING;
+    params->sink_sync = 0;
+    params->source_path[0] = '\0';
+    params->listen_path[0] = '\0';
     /* Check for not enough arguments first */
     if (argc < 2) return -1;
 
@@ -145,6 +435,170 @@ int parse_arguments(int argc, char *argv[], RuntimeParams *params)
         } else if (strcmp(argv[arg_idx], "-v") == 0) {
             params->tui_enabled = 1;
             arg_idx++;
+        } else if (strcmp(argv[arg_idx], "--perf") == 0) {
+            params->perf_enabled = 1;
+            arg_idx++;
+        } else if (strcmp(argv[arg_idx], "--open-loop") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_OPEN_LOOP_RATE,
+                                 &params->open_loop_rate) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--warmup") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 0, INT_MAX,
+                                 &params->warmup_seconds) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--batch") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_BATCH_SIZE,
+                                 &params->batch_size) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--reserve") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 0, MAX_RESERVE_PCT,
+                                 &params->reserve_pct) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--credits") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_CREDIT_BATCH,
+                                 &params->credit_batch) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--delay") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_DELAY_MS,
+                                 &params->max_delay_ms) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--ttl") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_TTL_MS,
+                                 &params->ttl_ms) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--ack-timeout") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_ACK_TIMEOUT_MS,
+                                 &params->ack_timeout_ms) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--max-deliveries") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_DELIVERIES_LIMIT,
+                                 &params->max_deliveries) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--fail-pct") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 0, 100,
+                                 &params->fail_pct) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--filter") == 0) {
+            if (parse_filter_option(argc, argv, &arg_idx, params) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--partitions") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_PARTITIONS,
+                                 &params->partitions) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--coalesce") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_COALESCE_KEYS,
+                                 &params->coalesce_keys) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--spill") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_SPILL_MESSAGES,
+                                 &params->spill_capacity) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--epoll") == 0) {
+            if (arg_idx + 1 >= argc) {
+                fprintf(stderr, "Error: --epoll requires 'level' or 'edge'\n");
+                return -1;
+            }
+            if (strcmp(argv[arg_idx + 1], "level") == 0) {
+                params->epoll_mode = QUEUE_READY_LEVEL + 1;
+            } else if (strcmp(argv[arg_idx + 1], "edge") == 0) {
+                params->epoll_mode = QUEUE_READY_EDGE + 1;
+            } else {
+                fprintf(stderr, "Error: --epoll '%s' must be 'level' or 'edge'\n",
+                        argv[arg_idx + 1]);
+                return -1;
+            }
+            arg_idx += 2;
+        } else if (strcmp(argv[arg_idx], "--sink") == 0) {
+            if (arg_idx + 1 >= argc || argv[arg_idx + 1][0] == '\0') {
+                fprintf(stderr, "Error: --sink requires a file path\n");
+                return -1;
+            }
+            if (strlen(argv[arg_idx + 1]) >= sizeof(params->sink_path)) {
+                fprintf(stderr, "Error: --sink path longer than %d characters\n",
+                        (int)sizeof(params->sink_path) - 1);
+                return -1;
+            }
+            strcpy(params->sink_path, argv[arg_idx + 1]);
+            arg_idx += 2;
+        } else if (strcmp(argv[arg_idx], "--sink-backend") == 0) {
+            if (arg_idx + 1 >= argc) {
+                fprintf(stderr, "Error: --sink-backend requires 'uring' or 'writev'\n");
+                return -1;
+            }
+            if (strcmp(argv[arg_idx + 1], "uring") == 0) {
+                params->sink_backend = SINK_URING;
+            } else if (strcmp(argv[arg_idx + 1], "writev") == 0) {
+                params->sink_backend = SINK_WRITEV;
+            } else {
+                fprintf(stderr, "Error: --sink-backend '%s' must be 'uring' or 'writev'\n",
+                        argv[arg_idx + 1]);
+                return -1;
+            }
+            arg_idx += 2;
+        } else if (strcmp(argv[arg_idx], "--source") == 0) {
+            if (arg_idx + 1 >= argc) {
+                fprintf(stderr, "Error: --source requires a file path or '-'\n");
+                return -1;
+            }
+            if (strlen(argv[arg_idx + 1]) >= sizeof(params->source_path)) {
+                fprintf(stderr, "Error: --source path longer than %d characters\n",
+                        (int)sizeof(params->source_path) - 1);
+                return -1;
+            }
+            strcpy(params->source_path, argv[arg_idx + 1]);
+            arg_idx += 2;
+        } else if (strcmp(argv[arg_idx], "--listen") == 0) {
+            if (arg_idx + 1 >= argc || argv[arg_idx + 1][0] == '\0') {
+                fprintf(stderr, "Error: --listen requires a socket path\n");
+                return -1;
+            }
+            if (strlen(argv[arg_idx + 1]) >= sizeof(params->listen_path)) {
+                fprintf(stderr, "Error: --listen path longer than %d characters\n",
+                        (int)sizeof(params->listen_path) - 1);
+                return -1;
+            }
+            strcpy(params->listen_path, argv[arg_idx + 1]);
+            arg_idx += 2;
+        } else if (strcmp(argv[arg_idx], "--sink-sync") == 0) {
+            params->sink_sync = 1;
+            arg_idx++;
+        } else if (strcmp(argv[arg_idx], "--rpc") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, RPC_MAX_OUTSTANDING,
+                                 &params->rpc_outstanding) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--groups") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_GROUPS,
+                                 &params->groups) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--policy") == 0) {
+            if (arg_idx + 1 >= argc) {
+                fprintf(stderr, "Error: --policy requires 'priority' or 'mlfq'\n");
+                return -1;
+            }
+            if (strcmp(argv[arg_idx + 1], "priority") == 0) {
+                params->policy = QUEUE_POLICY_PRIORITY;
+            } else if (strcmp(argv[arg_idx + 1], "mlfq") == 0) {
+                params->policy = QUEUE_POLICY_MLFQ;
+            } else {
+                fprintf(stderr, "Error: --policy '%s' must be 'priority' or 'mlfq'\n",
+                        argv[arg_idx + 1]);
+                return -1;
+            }
+            arg_idx += 2;
+        } else if (strcmp(argv[arg_idx], "--mlfq-quantum") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_MLFQ_QUANTUM_US,
+                                 &params->mlfq_quantum_us) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--policy-bench") == 0) {
+            params->policy_bench = 1;
+            arg_idx++;
+        } else if (strcmp(argv[arg_idx], "--wakeup-bench") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_WAKEUP_ROUNDS,
+                                 &params->wakeup_rounds) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--saturate") == 0) {
+            params->saturate = 1;
+            arg_idx++;
+        } else if (strcmp(argv[arg_idx], "--service-us") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 0, MAX_SERVICE_US,
+                                 &params->service_us) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--p99-limit") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, INT_MAX / 1000,
+                                 &params->p99_limit_ms) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--block-limit") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 0, 100,
+                                 &params->block_limit_pct) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--trial-ms") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, MIN_TRIAL_MS, MAX_TRIAL_MS,
+                                 &params->trial_ms) != 0) return -1;
+        } else if (strcmp(argv[arg_idx], "--scale") == 0) {
+            params->scale = 1;
+            arg_idx++;
+        } else if (strcmp(argv[arg_idx], "--scale-max") == 0) {
+            if (parse_int_option(argc, argv, &arg_idx, 1, MAX_CONSUMERS,
+                                 &params->scale_max) != 0) return -1;
         } else if (strcmp(argv[arg_idx], "-s") == 0) {
             if (arg_idx + 1 >= argc) {
                 fprintf(stderr, "Error: -s requires a seed argument\n");
@@ -231,6 +685,7 @@ int parse_arguments(int argc, char *argv[], RuntimeParams *params)
 int validate_parameters(const RuntimeParams *params)
 {
     int is_valid = 1;
+    int i;
 
     if (params->num_producers < MIN_PRODUCERS || params->num_producers > MAX_PRODUCERS) {
         fprintf(stderr, "Error: producers = %d is out of bounds [%d to %d]\n",
@@ -252,6 +707,159 @@ int validate_parameters(const RuntimeParams *params)
                 params->timeout_seconds, MIN_TIMEOUT);
         is_valid = 0;
     }
+    /* A warm-up covering the whole run would leave nothing to report */
+    if (params->warmup_seconds >= params->timeout_seconds) {
+        fprintf(stderr, "Error: warmup = %d must be shorter than timeout = %d\n",
+                params->warmup_seconds, params->timeout_seconds);
+        is_valid = 0;
+    }
+
+    if (params->saturate && params->scale) {
+        fprintf(stderr, "Error: --saturate and --scale are separate benchmarks, pick one\n");
+        is_valid = 0;
+    }
+    if (params->wakeup_rounds > 0 && (params->saturate || params->scale)) {
+        fprintf(stderr, "Error: --wakeup-bench is a separate benchmark from --saturate and --scale\n");
+        is_valid = 0;
+    }
+    if (params->policy_bench && (params->saturate || params->scale || params->wakeup_rounds > 0)) {
+        fprintf(stderr, "Error: --policy-bench is a separate benchmark from --saturate, --scale "
+                "and --wakeup-bench\n");
+        is_valid = 0;
+    }
+    for (i = params->num_consumers; i >= 0 && i < MAX_CONSUMERS; i++) {
+        if (!params->has_filter[i]) continue;
+        fprintf(stderr, "Error: --filter %d: only %d consumer(s) exist\n",
+                i + 1, params->num_consumers);
+        is_valid = 0;
+    }
+    /* Nacks and delivery limits only exist for leased messages */
+    if ((params->fail_pct > 0 || params->max_deliveries > 0) && params->ack_timeout_ms == 0) {
+        fprintf(stderr, "Error: --fail-pct and --max-deliveries need --ack-timeout\n");
+        is_valid = 0;
+    }
+    /* Partition leases decide which item a consumer gets: no other
+     * selection rule may override them, and a redelivery would break
+     * the partition's order */
+    if (params->partitions > 0) {
+        for (i = 0; i < MAX_CONSUMERS; i++) {
+            if (params->has_filter[i]) break;
+        }
+        if (i < MAX_CONSUMERS || params->batch_size > 1 || params->ack_timeout_ms > 0) {
+            fprintf(stderr, "Error: --partitions cannot be combined with --filter, "
+                    "--batch or --ack-timeout\n");
+            is_valid = 0;
+        }
+    }
+    /* A refill takes the queue mutex when a slot is freed; filtered and
+     * partitioned consumers free slots while holding it. Reservations,
+     * credits and coalescing all assume every queued message is in the
+     * ring. */
+    if (params->spill_capacity > 0) {
+        for (i = 0; i < MAX_CONSUMERS; i++) {
+            if (params->has_filter[i]) break;
+        }
+        if (i < MAX_CONSUMERS || params->partitions > 0 || params->reserve_pct > 0 ||
+            params->credit_batch > 0 || params->coalesce_keys > 0) {
+            fprintf(stderr, "Error: --spill cannot be combined with --filter, --partitions, "
+                    "--reserve, --credits or --coalesce\n");
+            is_valid = 0;
+        }
+    }
+
+    /* The backend and sync options only shape the sink */
+    if (params->sink_path[0] == '\0' &&
+        (params->sink_backend != SINK_URING || params->sink_sync)) {
+        fprintf(stderr, "Error: --sink-backend and --sink-sync need --sink\n");
+        is_valid = 0;
+    }
+    /* Ingested batches are admitted on the slot semaphore alone: no
+     * per-message admission rule, no schedule, and no benchmark mode */
+    if (params->source_path[0] != '\0' &&
+        (params->credit_batch > 0 || params->reserve_pct > 0 || params->spill_capacity > 0 ||
+         params->coalesce_keys > 0 || params->max_delay_ms > 0 || params->open_loop_rate > 0 ||
+         params->saturate || params->scale || params->wakeup_rounds > 0 ||
+         params->policy_bench)) {
+        fprintf(stderr, "Error: --source cannot be combined with --credits, --reserve, --spill, "
+                "--coalesce, --delay, --open-loop or a benchmark mode\n");
+        is_valid = 0;
+    }
+    /* The listener takes the producers' place and uses the same batch path */
+    if (params->listen_path[0] != '\0' &&
+        (params->source_path[0] != '\0' || params->credit_batch > 0 || params->reserve_pct > 0 ||
+         params->spill_capacity > 0 || params->coalesce_keys > 0 || params->max_delay_ms > 0 ||
+         params->open_loop_rate > 0 || params->saturate || params->scale ||
+         params->wakeup_rounds > 0 || params->policy_bench)) {
+        fprintf(stderr, "Error: --listen cannot be combined with --source, --credits, --reserve, "
+                "--spill, --coalesce, --delay, --open-loop or a benchmark mode\n");
+        is_valid = 0;
+    }
+    /* Every request must come back exactly once: nothing may drop,
+     * fold, defer or redeliver it, and the clients set their own pace */
+    if (params->rpc_outstanding > 0 &&
+        (params->source_path[0] != '\0' || params->listen_path[0] != '\0' ||
+         params->credit_batch > 0 || params->coalesce_keys > 0 || params->max_delay_ms > 0 ||
+         params->ttl_ms > 0 || params->ack_timeout_ms > 0 || params->open_loop_rate > 0 ||
+         params->saturate || params->scale || params->wakeup_rounds > 0 ||
+         params->policy_bench)) {
+        fprintf(stderr, "Error: --rpc cannot be combined with --source, --listen, --credits, "
+                "--coalesce, --delay, --ttl, --ack-timeout, --open-loop or a benchmark mode\n");
+        is_valid = 0;
+    }
+    /* Groups read the topic log in publish order through shared cursors:
+     * every queue feature that picks, holds back, folds, redelivers or
+     * reroutes a message works on the priority queue, which stays empty */
+    if (params->groups > 0) {
+        for (i = 0; i < MAX_CONSUMERS; i++) {
+            if (params->has_filter[i]) break;
+        }
+        if (params->groups > params->num_consumers) {
+            fprintf(stderr, "Error: --groups %d needs at least one consumer per group "
+                    "(have %d consumers)\n", params->groups, params->num_consumers);
+            is_valid = 0;
+        }
+        if (i < MAX_CONSUMERS || params->batch_size > 1 || params->partitions > 0 ||
+            params->reserve_pct > 0 || params->credit_batch > 0 || params->max_delay_ms > 0 ||
+            params->ttl_ms > 0 || params->ack_timeout_ms > 0 || params->coalesce_keys > 0 ||
+            params->spill_capacity > 0 || params->epoll_mode > 0 ||
+            params->source_path[0] != '\0' || params->listen_path[0] != '\0' ||
+            params->rpc_outstanding > 0 || params->saturate || params->scale ||
+            params->wakeup_rounds > 0 || params->policy_bench) {
+            fprintf(stderr, "Error: --groups cannot be combined with --filter, --batch, "
+                    "--partitions, --reserve, --credits, --delay, --ttl, --ack-timeout, "
+                    "--coalesce, --spill, --epoll, --source, --listen, --rpc or a benchmark mode\n");
+            is_valid = 0;
+        }
+    }
+    /* MLFQ only orders the priority queue's selection: partition leases
+     * always take the oldest item, the spill tier evicts and refills by
+     * static priority, groups read the topic log, and the other
+     * benchmarks build queues of their own */
+    if (params->policy == QUEUE_POLICY_MLFQ &&
+        (params->partitions > 0 || params->spill_capacity > 0 || params->groups > 0 ||
+         params->saturate || params->scale || params->wakeup_rounds > 0 || params->policy_bench)) {
+        fprintf(stderr, "Error: --policy mlfq cannot be combined with --partitions, --spill, "
+                "--groups or a benchmark mode (--policy-bench runs both policies)\n");
+        is_valid = 0;
+    }
+    if (params->mlfq_quantum_us != DEFAULT_MLFQ_QUANTUM_US &&
+        params->policy != QUEUE_POLICY_MLFQ && !params->policy_bench) {
+        fprintf(stderr, "Error: --mlfq-quantum needs --policy mlfq or --policy-bench\n");
+        is_valid = 0;
+    }
+    /* The epoll path takes the single best item without a predicate:
+     * filters and partition leases pick items inside the blocking
+     * dequeue, and batches need the semaphore to count them out */
+    if (params->epoll_mode > 0) {
+        for (i = 0; i < MAX_CONSUMERS; i++) {
+            if (params->has_filter[i]) break;
+        }
+        if (i < MAX_CONSUMERS || params->partitions > 0 || params->batch_size > 1) {
+            fprintf(stderr, "Error: --epoll cannot be combined with --filter, --partitions "
+                    "or --batch\n");
+            is_valid = 0;
+        }
+    }
 
     return is_valid ? 0 : -1;
 }
@@ -260,12 +868,22 @@ int validate_parameters(const RuntimeParams *params)
 
 void print_thread_summary(int num_producers, int num_consumers, 
                           ProducerArgs *p_args, ConsumerArgs *c_args,
-                          Queue *q)
+                          Queue *q, const BalanceExtras *extras)
 {
     int i;
     int total_produced = 0, total_consumed = 0;
     int blocked_p = 0, blocked_c = 0;
     int items_in_queue = queue_get_count(q);
+    int expired = queue_expired_total(q);
+    int coalesced = queue_coalesced_total(q);
+    int delayed = extras ? extras->delayed : 0;
+    int in_flight = extras ? extras->in_flight : 0;
+    int dead = extras ? extras->dead_lettered : 0;
+    int spilled = extras ? extras->spilled : 0;
+    int listened = extras ? extras->listened : 0;
+    int groups = extras ? extras->groups : 0;
+    int group_lag = extras ? extras->group_lag : 0;
+    int balanced;
     
     printf("\n  Queue Final State: %d/%d items\n\n", items_in_queue, queue_get_capacity(q));
     
@@ -275,6 +893,11 @@ void print_thread_summary(int num_producers, int num_consumers,
         total_produced += p_args[i].stats.messages_produced;
         blocked_p += p_args[i].stats.times_blocked;
     }
+    /* Socket clients stand in for the producer threads */
+    if (listened > 0) {
+        printf("    Socket listener: %d messages from clients\n", listened);
+        total_produced += listened;
+    }
     printf("    -> Total Produced: %d | Total Blocked: %d\n\n", total_produced, blocked_p);
     
     printf("  Consumer Statistics:\n");
@@ -286,10 +909,31 @@ void print_thread_summary(int num_producers, int num_consumers,
     printf("    -> Total Consumed: %d | Total Blocked: %d\n\n", total_consumed, blocked_c);
     
     printf("  Balance Check:\n");
-    printf("    Produced (%d) == Consumed (%d) + Queue (%d)\n", 
+    /* Fan-out: each group reads every message once, from the topic log */
+    if (groups > 0) {
+        printf("    Produced (%d) x Groups (%d) == Consumed (%d) + Lag (%d)\n",
+               total_produced, groups, total_consumed, group_lag);
+        balanced = ((long long)total_produced * groups == (long long)total_consumed + group_lag);
+        printf("    Result: %s\n\n", balanced ? "PASS" : "FAIL (Data Discrepancy)");
+        return;
+    }
+    printf("    Produced (%d) == Consumed (%d) + Queue (%d)",
            total_produced, total_consumed, items_in_queue);
+    /* Scheduled messages still in the timing wheel, and TTL drops */
+    if (delayed > 0) printf(" + Delayed (%d)", delayed);
+    if (expired > 0) printf(" + Expired (%d)", expired);
+    /* Updates folded into a message that was still queued */
+    if (coalesced > 0) printf(" + Coalesced (%d)", coalesced);
+    /* Leased but unacked, and given up on after max deliveries */
+    if (in_flight > 0) printf(" + In Flight (%d)", in_flight);
+    if (dead > 0) printf(" + Dead-lettered (%d)", dead);
+    /* Still waiting on the disk tier for a free slot */
+    if (spilled > 0) printf(" + Spilled (%d)", spilled);
+    printf("\n");
            
-    if (total_produced == total_consumed + items_in_queue) {
+    balanced = (total_produced == total_consumed + items_in_queue + delayed + expired +
+                                 coalesced + in_flight + dead + spilled);
+    if (balanced) {
         printf("    Result: PASS\n");
     } else {
         printf("    Result: FAIL (Data Discrepancy)\n");
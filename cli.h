@@ -34,8 +34,58 @@ typedef struct {
     int aging_interval;   // -a flag: aging interval in ms (0 = disabled)
     int max_producer_wait; // -p flag: max producer sleep (seconds)
     int max_consumer_wait; // -c flag: max consumer sleep (seconds)
+    int perf_enabled;     // --perf flag: hardware counters per message
+    int open_loop_rate;   // --open-loop flag: arrivals/sec per producer (0 = closed loop)
+    int warmup_seconds;   // --warmup flag: seconds excluded from aggregates
+    int saturate;         // --saturate flag: run the saturation search instead
+    int service_us;       // --service-us flag: benchmark consumer time per message
+    int p99_limit_ms;     // --p99-limit flag: saturation latency threshold
+    int block_limit_pct;  // --block-limit flag: saturation block-rate threshold
+    int trial_ms;         // --trial-ms flag: length of each benchmark trial
+    int scale;            // --scale flag: run the thread-count scaling sweep instead
+    int scale_max;        // --scale-max flag: largest threads per side (0 = core count)
+    int batch_size;       // --batch flag: max items per consumer dequeue lock
+    int reserve_pct;      // --reserve flag: % of capacity held for high priorities
+    int credit_batch;     // --credits flag: slot credits per producer grab (0 = off)
+    int max_delay_ms;     // --delay flag: schedule each message 0..N ms ahead (0 = off)
+    int ttl_ms;           // --ttl flag: drop messages not consumed within N ms (0 = off)
+    int ack_timeout_ms;   // --ack-timeout flag: lease visibility timeout (0 = at-most-once)
+    int max_deliveries;   // --max-deliveries flag: attempts before the DLQ (0 = default)
+    int fail_pct;         // --fail-pct flag: consumers nack this % of deliveries
+    MessageFilter consumer_filter[MAX_CONSUMERS]; // --filter flag: per-consumer selective receive
+    int has_filter[MAX_CONSUMERS];                // 1 = consumer i+1 is filtered
+    int coalesce_keys;    // --coalesce flag: messages update keys 1..N, folded while queued (0 = off)
+    int partitions;       // --partitions flag: per-key FIFO partitions leased by consumers (0 = off)
+    int spill_capacity;   // --spill flag: spill file records used when the ring is full (0 = block)
+    int epoll_mode;       // --epoll flag: 0 = sem_wait, else QueueReadyMode + 1
+    int wakeup_rounds;    // --wakeup-bench flag: ping-pong rounds per wake-up path (0 = off)
+    char sink_path[SINK_PATH_MAX]; // --sink flag: consumers append processed messages here ("" = off)
+    int sink_backend;     // --sink-backend flag: SinkBackend (io_uring, or writev only)
+    int sink_sync;        // --sink-sync flag: fdatasync after every group commit
+    char source_path[INGEST_PATH_MAX]; // --source flag: producers parse input from here, "-" = stdin ("" = generate)
+    char listen_path[LISTEN_PATH_MAX]; // --listen flag: socket clients replace the producers ("" = off)
+    int rpc_outstanding;  // --rpc flag: producers await replies, N requests in flight each (0 = off)
+    int groups;           // --groups flag: topic fan-out to this many consumer groups (0 = off)
+    int policy;           // --policy flag: QueuePolicy used by the consumers' dequeues
+    int mlfq_quantum_us;  // --mlfq-quantum flag: MLFQ level-0 quantum
+    int policy_bench;     // --policy-bench flag: compare the policies on mixed jobs instead
 } RuntimeParams;
 
+/*
+ * Messages held outside the ring at the end of the run, for the
+ * balance check (expired and coalesced items are counted by the
+ * queue itself).
+ */
+typedef struct {
+    int delayed;          // Still in the timing wheel (--delay)
+    int in_flight;        // Leased, not yet acked (--ack-timeout)
+    int dead_lettered;    // Moved to the dead-letter queue (--ack-timeout)
+    int spilled;          // Still on the disk tier (--spill)
+    int listened;         // Enqueued by the socket listener (--listen): produced, not by a thread
+    int groups;           // Subscriber groups (--groups): each message is consumed once per group
+    int group_lag;        // Published but not yet read, summed over the groups (--groups)
+} BalanceExtras;
+
 /* --- UI / Display Functions --- */
 
 void print_separator(void);
@@ -65,7 +115,7 @@ int validate_parameters(const RuntimeParams *params);
  */
 void print_thread_summary(int num_producers, int num_consumers, 
                           ProducerArgs *p_args, ConsumerArgs *c_args,
-                          Queue *q);
+                          Queue *q, const BalanceExtras *extras);
 
 /*
  * Generates the CSV filename string based on current parameters.
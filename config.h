@@ -49,6 +49,167 @@
 #define MAX_RUNTIME_CONSUMERS   5   // Runtime consumer limit matches system max
 #define MIN_QUEUE_SIZE          1   
 #define MIN_TIMEOUT             1   // Simulation minimum duration
+#define MAX_OPEN_LOOP_RATE      1000000 // Arrivals/sec per open-loop producer
+#define MAX_BATCH_SIZE          MAX_QUEUE_SIZE // Items per batch dequeue (--batch)
+
+/* --- Reserved Capacity (--reserve) ---
+ * Priorities >= RESERVED_PRIORITY_MIN form the high class. A reservation
+ * keeps that share of the slots out of reach of the normal class, so a
+ * low-priority flood cannot block high-priority producers.
+ */
+#define RESERVED_PRIORITY_MIN   7   // Priorities 7-9 may use reserved slots
+#define MAX_RESERVE_PCT         90  // At least one slot always stays shared
+
+/* --- Credit-Based Flow Control (--credits) ---
+ * Producers take up to N slot credits per atomic grab and bank them.
+ * Banked credits go back to the pool before any idle period at least
+ * this long, so an idle producer does not starve the others.
+ */
+#define MAX_CREDIT_BATCH        MAX_QUEUE_SIZE
+#define CREDIT_IDLE_RETURN_MS   10
+#define CREDIT_WAIT_POLL_MS     100     // Credit waiters re-check shutdown this often
+
+/* --- Delayed Delivery (--delay) ---
+ * Delayed messages wait in the timing wheel's node pool, not in the
+ * queue; producers block when the pool is full.
+ */
+#define MAX_DELAY_MS            60000   // Longest schedule-ahead per message
+#define MAX_DELAYED_MESSAGES    1024    // Wheel node pool size
+#define TIMER_TICK_US           1000    // Wheel resolution (1 ms)
+
+/* --- Message TTL (--ttl) ---
+ * Expired messages are dropped at dequeue and reclaimed by a sweeper
+ * thread. Each sweep pass holds the queue mutex for at most one batch.
+ */
+#define MAX_TTL_MS              60000
+#define TTL_SWEEP_INTERVAL_MS   10      // Sweeper sleep when nothing is left to reclaim
+#define TTL_SWEEP_BATCH         4       // Max expired items removed per lock hold
+
+/* --- At-Least-Once Delivery (--ack-timeout) ---
+ * A dequeued message is leased; unacked leases are redelivered after
+ * the visibility timeout, and dead-lettered after too many deliveries.
+ */
+#define MAX_ACK_TIMEOUT_MS      60000
+#define DEFAULT_MAX_DELIVERIES  3       // Deliveries before a message is dead-lettered
+#define MAX_DELIVERIES_LIMIT    100
+#define LEASE_SCAN_MS           2       // Reaper period for expired leases
+#define MAX_DEAD_LETTERS        256     // DLQ capacity (older entries are overwritten)
+
+/* --- Selective Receive (--filter) ---
+ * Filtered consumers find matches through per-priority and per-producer
+ * position bitmaps, so MAX_QUEUE_SIZE must fit in an unsigned int.
+ */
+#define FILTER_WAIT_POLL_MS     100     // Filtered waiters re-check shutdown this often
+
+/* --- Key Coalescing (--coalesce) ---
+ * Producers tag each message with a key; a message for a key that is
+ * still queued replaces the queued one in place. A key -> slot hash
+ * (linear probing, at most half full) finds it.
+ */
+#define MAX_COALESCE_KEYS       10000
+#define COALESCE_HASH_SIZE      64      // Power of two, >= 2 * MAX_QUEUE_SIZE
+
+/* --- Partitioned Delivery (--partitions) ---
+ * Messages hash by key (or producer id) to a partition; a consumer
+ * leases a partition for the duration of one message, so each
+ * partition is FIFO and processed by at most one consumer at a time.
+ */
+#define MAX_PARTITIONS          16
+#define PARTITION_WAIT_POLL_MS  100     // Partition waiters re-check shutdown this often
+
+/* --- Disk Spill-Over (--spill) ---
+ * When the ring is full, producers write to a memory-mapped spill file
+ * instead of blocking; consumers' freed slots pull the best spilled
+ * messages back into the ring.
+ */
+#define MAX_SPILL_MESSAGES      65536   // Spill file capacity limit (records)
+#define SPILL_DIR               "/tmp"  // Where the (unlinked) spill file is created
+
+/* --- Monitor Event Loop ---
+ * The main thread sleeps in epoll_wait on a signalfd and two timerfds
+ * (run deadline, periodic tick), so it only wakes when there is work.
+ */
+#define MONITOR_TUI_FRAME_MS    100     // Dashboard refresh period
+#define MONITOR_LOG_INTERVAL_S  10      // "seconds remaining" line period in log mode
+#define MONITOR_MAX_SOURCES     8       // Extra descriptors (control/metrics sockets)
+
+/* --- Readiness Notification (--epoll, --wakeup-bench) ---
+ * Consumers may sleep in epoll_wait on an eventfd the queue raises on
+ * arrival, instead of in sem_wait on the items semaphore.
+ */
+#define MAX_WAKEUP_ROUNDS       100000  // Ping-pong rounds per path in --wakeup-bench
+#define WAKEUP_SETTLE_US        200     // Pause before each round so the consumer is asleep
+
+/* --- File Sink (--sink) ---
+ * Consumers append a text record per processed message to staging
+ * buffers; a writer thread commits all sealed buffers as one group.
+ */
+#define SINK_NUM_BUFFERS        8       // Staging buffers (registered with io_uring)
+#define SINK_BUFFER_BYTES       65536   // Bytes per staging buffer
+#define SINK_RING_ENTRIES       16      // io_uring SQ size (>= buffers + 1 fsync)
+#define SINK_FLUSH_MS           5       // A partly filled buffer waits at most this long
+#define SINK_RECORD_MAX         96      // Longest formatted record
+#define SINK_PATH_MAX           256
+
+/* --- Ingestion Source (--source) ---
+ * Producers parse "data[,priority]" lines from a memory-mapped file
+ * (one line-aligned range each) or from stdin in large reads, and
+ * enqueue them in batches instead of generating random messages.
+ */
+#define INGEST_READ_BYTES       262144  // Stream mode: bytes per read() (per producer buffer)
+#define INGEST_LINE_MAX         64      // Longer lines are skipped as malformed
+#define INGEST_PARSE_BATCH      256     // Messages per parser call (enqueued in queue-sized batches)
+#define INGEST_DRAIN_POLL_US    1000    // After end of input: queue-empty check period
+#define INGEST_PATH_MAX         256
+
+/* --- Socket Listener (--listen) ---
+ * An epoll thread accepts local clients on a Unix domain socket and
+ * turns their fixed-size frames into batch enqueues; a full queue
+ * stops it reading, so the clients' socket buffers fill up.
+ */
+#define LISTEN_MAX_CONNS        512     // Concurrent client connections
+#define LISTEN_BATCH_FRAMES     64      // Frames per read() of one connection
+#define LISTEN_MAX_EVENTS       64      // epoll_wait batch
+#define LISTEN_BACKLOG          128
+#define LISTEN_PATH_MAX         108     // sizeof(sun_path)
+#define LISTEN_FRAME_MAGIC      0x5146  // "QF": first field of every frame
+
+/* --- Request/Response (--rpc) ---
+ * Producers become closed-loop clients: each keeps up to N requests
+ * outstanding in completion slots, and consumers answer through the
+ * client's reply queue once a request is processed.
+ */
+#define RPC_MAX_OUTSTANDING     64      // Completion slots per client
+
+/* --- Pub/Sub Fan-Out (--groups) ---
+ * Producers publish once into a shared log; every subscriber group
+ * reads all of it through its own cursor, and a slot is reused once
+ * the slowest group's cursor has passed it (min-cursor reclamation).
+ */
+#define MAX_GROUPS              MAX_CONSUMERS   // Each group needs at least one consumer
+
+/* --- Dequeue Policy (--policy) ---
+ * MLFQ replaces static priority + aging: every message class (its
+ * priority field) sits on a level, level 0 served first. A message
+ * whose observed service time overran its level's quantum demotes its
+ * class; one that would have fit the level above promotes it. Every
+ * MLFQ_RESET_MS all classes go back to level 0, so none starves.
+ */
+#define MLFQ_LEVELS             4       // Quanta q, 4q, 16q, 64q
+#define MLFQ_QUANTUM_FACTOR     4       // Quantum growth per level
+#define DEFAULT_MLFQ_QUANTUM_US 1000    // Level-0 quantum (--mlfq-quantum)
+#define MAX_MLFQ_QUANTUM_US     1000000
+#define MLFQ_RESET_MS           1000    // Periodic reset to level 0
+
+/* --- Benchmark Mode (--saturate) ---
+ * Defaults and bounds for the saturation search.
+ */
+#define DEFAULT_P99_LIMIT_MS    10      // Trial fails above this p99 latency
+#define DEFAULT_BLOCK_LIMIT_PCT 10      // Trial fails above this % of blocked enqueues
+#define DEFAULT_TRIAL_MS        1000    // Length of each load trial
+#define MIN_TRIAL_MS            50
+#define MAX_TRIAL_MS            60000
+#define MAX_SERVICE_US          1000000 // Consumer busy time per message
 
 /* --- Debug Levels --- */
 #define DBG_OFF     0
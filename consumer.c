@@ -16,18 +16,158 @@
  *   3. Dequeue failure (other)        — logged, thread exits cleanly
  *   4. Blocking detection             — reported via was_blocked from queue
  *   5. Analytics NULL pointer         — checked before every analytics call
+ *   6. Lease lost / not granted       — a late ack is counted, not
+ *                                       consumed (the redelivery will be);
+ *                                       an item that got no lease counts
+ *                                       as consumed at once (at-most-once)
+ *   7. epoll_wait EINTR / failure     — retried / reported, thread exits
  */
 
 #define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <time.h>
+#include <sched.h>
+#include <sys/epoll.h>
 
 #include "consumer.h"
 #include "config.h"
 #include "utils.h"
+#include "perfcount.h"
+
+/* --- Internal Helpers --- */
+
+/*
+ * Settles the leases of one wake-up after the simulated processing:
+ * nack with probability fail_pct, otherwise ack. Runs even when the
+ * loop is stopping, so no lease is left for the reaper at exit.
+ */
+static void settle_leases(ConsumerArgs *args, const Message *batch,
+                          const Lease *leases, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        const Message *msg = &batch[i];
+
+        if (leases[i].slot < 0) continue;
+
+        if (args->fail_pct > 0 && random_range(1, 100) <= args->fail_pct) {
+            if (lease_nack(args->leases, leases[i]) == 0) args->stats.nacks++;
+            if (!args->quiet_mode) {
+                printf("[%06.2f] Consumer %d: Nack (data=%d, delivery %d) from P%d\n",
+                       time_elapsed(), args->id, msg->data, msg->attempts,
+                       msg->producer_id);
+            }
+            continue;
+        }
+
+        if (lease_ack(args->leases, leases[i]) == 0) {
+            args->stats.messages_consumed++;
+            if (args->analytics) analytics_record_consume(args->analytics);
+        } else {
+            args->stats.late_acks++;
+            if (!args->quiet_mode) {
+                printf("[%06.2f] Consumer %d: Late ack (data=%d) from P%d, "
+                       "already redelivered\n",
+                       time_elapsed(), args->id, msg->data, msg->producer_id);
+            }
+        }
+    }
+}
+
+/* --- Public API: Epoll Wait --- */
+
+int consumer_epoll_open(ConsumerEpoll *ce, Queue *q)
+{
+    struct epoll_event ev;
+
+    if (ce == NULL || q == NULL) return -1;
+    memset(ce, 0, sizeof(*ce));
+    ce->epoll_fd = -1;
+    ce->ready_fd = queue_ready_fd(q);
+    if (ce->ready_fd < 0) {
+        fprintf(stderr, "[ERROR] consumer_epoll_open: queue has no readiness eventfd\n");
+        return -1;
+    }
+    ce->edge = (q->ready_mode == QUEUE_READY_EDGE);
+
+    ce->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (ce->epoll_fd < 0) {
+        fprintf(stderr, "[ERROR] consumer_epoll_open: epoll_create1 failed "
+                "(errno=%d: %s)\n", errno, strerror(errno));
+        return -1;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | (ce->edge ? EPOLLET : 0);
+    ev.data.fd = ce->ready_fd;
+    if (epoll_ctl(ce->epoll_fd, EPOLL_CTL_ADD, ce->ready_fd, &ev) != 0) {
+        fprintf(stderr, "[ERROR] consumer_epoll_open: epoll_ctl failed "
+                "(errno=%d: %s)\n", errno, strerror(errno));
+        close(ce->epoll_fd);
+        ce->epoll_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Always tries the queue before sleeping, so an arrival that raised
+ * the eventfd while this consumer was busy is never missed. The
+ * consumer never reads the eventfd itself: in level mode the queue
+ * drains it when it empties, in edge mode it is never reset.
+ */
+int consumer_epoll_dequeue(ConsumerEpoll *ce, Queue *q, Message *msg,
+                           int *was_blocked, long *wait_time_ms)
+{
+    struct epoll_event ev;
+    int result, n, woke = 0, blocked = 0;
+    long wait_start = 0;
+
+    if (ce == NULL || q == NULL || msg == NULL || ce->epoll_fd < 0) return -1;
+
+    for (;;) {
+        result = queue_try_dequeue(q, msg);
+        if (result != 1) break;
+        if (q->shutdown) return -1;
+        if (woke) {
+            ce->empty_wakeups++;
+            /* Level mode: the fd stays readable while another consumer
+             * finishes taking the item, or until the producer posts its
+             * token; let that thread run rather than spin on epoll_wait */
+            if (!ce->edge) sched_yield();
+        }
+
+        if (!blocked) {
+            blocked = 1;
+            wait_start = queue_get_time_ms();
+        }
+        n = epoll_wait(ce->epoll_fd, &ev, 1, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "[ERROR] consumer_epoll_dequeue: epoll_wait failed "
+                    "(errno=%d: %s)\n", errno, strerror(errno));
+            return -1;
+        }
+        ce->wakeups++;
+        woke = 1;
+    }
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms) *wait_time_ms = blocked ? queue_get_time_ms() - wait_start : 0;
+    return (result == 0) ? 0 : -1;
+}
+
+void consumer_epoll_close(ConsumerEpoll *ce)
+{
+    if (ce == NULL || ce->epoll_fd < 0) return;
+    close(ce->epoll_fd);
+    ce->epoll_fd = -1;
+}
 
 /* --- Public API --- */
 
@@ -63,9 +203,26 @@ int consumer_init_args(ConsumerArgs *args, int id, Queue *queue, volatile sig_at
     args->quiet_mode = 0;
     args->max_wait = MAX_CONSUMER_WAIT;
     args->analytics = NULL;
+    args->perf_enabled = 0;
+    args->start_gate = NULL;
+    args->spawn_us = 0;
+    args->batch_size = 1;
+    args->leases = NULL;
+    args->fail_pct = 0;
+    args->filter = NULL;
+    args->partitioned = 0;
+    args->use_epoll = 0;
+    args->sink = NULL;
+    args->rpc = NULL;
+    args->topic = NULL;
+    args->group = 0;
 
     args->stats.messages_consumed = 0;
     args->stats.times_blocked = 0;
+    args->stats.nacks = 0;
+    args->stats.late_acks = 0;
+    args->stats.epoll_wakeups = 0;
+    args->stats.empty_wakeups = 0;
 
     return 0;
 }
@@ -86,10 +243,18 @@ int consumer_init_args(ConsumerArgs *args, int id, Queue *queue, volatile sig_at
 void *consumer_thread(void *arg)
 {
     ConsumerArgs *args;
-    Message msg;
+    Message batch[MAX_BATCH_SIZE];
+    Lease leases[MAX_BATCH_SIZE];
+    int num_items, i;
     int result;
     int sleep_time;
     int was_blocked;
+    PerfCounters perf;
+    long long release_us = 0;
+    int first_op_done = 0;
+    long long dequeued_us, service_start_us;
+    int partition = -1;
+    ConsumerEpoll ep;
 
     args = (ConsumerArgs *)arg;
 
@@ -100,22 +265,74 @@ void *consumer_thread(void *arg)
         return NULL;
     }
 
+    /* Park at the start gate until every worker exists, so threads
+     * created first do not get a head start on an idle system.
+     * Spawn latency = pthread_create call -> this thread running. */
+    if (args->start_gate != NULL) {
+        if (args->analytics) {
+            analytics_record_spawn(args->analytics, time_now_us() - args->spawn_us);
+        }
+        release_us = start_gate_arrive_and_wait(args->start_gate);
+    }
+
+    /* A consumer that cannot open its epoll set falls back to sem_wait */
+    ep.epoll_fd = -1;
+    if (args->use_epoll && consumer_epoll_open(&ep, args->queue) != 0) {
+        args->use_epoll = 0;
+    }
+
     if (!args->quiet_mode) {
         printf("[%06.2f] Consumer %d: Started\n", time_elapsed(), args->id);
     }
 
     DBG(DBG_INFO, "Consumer %d: Context Loaded", args->id);
 
+    /* Optional hardware counters around the whole loop (--perf).
+     * A failed open is not an error: the report explains it. */
+    if (args->perf_enabled) {
+        perf_counters_open(&perf);
+        perf_counters_start(&perf);
+    }
+
     /* Main Lifecycle Loop
      * Continues until the main thread sets the global 'running' flag to 0. */
     while (*(args->running)) {
 
         /* Step 1: Dequeue (Blocking Operation)
          * was_blocked is set by queue_dequeue_safe using sem_trywait.
-         * This gives us accurate block detection without race conditions. */
+         * This gives us accurate block detection without race conditions.
+         * With --batch, one lock hands back up to batch_size items.
+         * With --filter, only matching items are taken (never batched).
+         * With --partitions, the item's partition stays leased to us
+         * until step 5. With --epoll, the wait is an epoll_wait on the
+         * queue's readiness eventfd. With --groups, the message comes
+         * from the topic log at the group's cursor. */
         was_blocked = 0;
         long wait_time_ms = 0;
-        result = queue_dequeue_safe(args->queue, &msg, &was_blocked, &wait_time_ms);
+        if (args->topic != NULL) {
+            result = topic_fetch(args->topic, args->group, &batch[0], &was_blocked, &wait_time_ms);
+            num_items = 1;
+        } else if (args->partitioned) {
+            result = queue_dequeue_partitioned(args->queue, args->id, &batch[0], &partition,
+                                               &was_blocked, &wait_time_ms);
+            num_items = 1;
+        } else if (args->filter != NULL) {
+            result = queue_dequeue_filtered(args->queue, args->filter, &batch[0],
+                                            &was_blocked, &wait_time_ms);
+            num_items = 1;
+        } else if (args->batch_size > 1) {
+            result = queue_dequeue_batch_safe(args->queue, batch, args->batch_size,
+                                              &was_blocked, &wait_time_ms);
+            num_items = (result > 0) ? result : 0;
+            result = (result > 0) ? 0 : -1;
+        } else if (args->use_epoll) {
+            result = consumer_epoll_dequeue(&ep, args->queue, &batch[0],
+                                            &was_blocked, &wait_time_ms);
+            num_items = 1;
+        } else {
+            result = queue_dequeue_safe(args->queue, &batch[0], &was_blocked, &wait_time_ms);
+            num_items = 1;
+        }
 
         /* Step 2: Record blocking if it occurred */
         if (was_blocked) {
@@ -127,8 +344,11 @@ void *consumer_thread(void *arg)
                 analytics_record_consumer_wait(args->analytics, wait_time_ms);
             }
             if (!args->quiet_mode) {
-                printf("[%06.2f] Consumer %d: BLOCKED (queue was empty)\n",
-                       time_elapsed(), args->id);
+                printf("[%06.2f] Consumer %d: BLOCKED (%s)\n",
+                       time_elapsed(), args->id,
+                       args->topic ? "group has read everything" :
+                       args->filter ? "no matching message" :
+                       args->partitioned ? "no free partition with work" : "queue was empty");
             }
         }
 
@@ -147,30 +367,73 @@ void *consumer_thread(void *arg)
             break;
         }
 
-        /* Step 3: Success Logging */
-        args->stats.messages_consumed++;
-        if (args->analytics) {
-            analytics_record_consume(args->analytics);
-            /* Record how long this message waited in the queue */
-            long latency = queue_get_time_ms() - msg.timestamp;
-            if (latency >= 0)
-                analytics_record_latency(args->analytics, latency);
-        }
+        /* Step 3: Success Logging
+         * Read the clock first so latency excludes our own bookkeeping */
+        dequeued_us = time_now_us();
+        if (args->analytics) analytics_record_dequeue_lock(args->analytics, num_items);
+
+        for (i = 0; i < num_items; i++) {
+            const Message *msg = &batch[i];
+            int leased = 0;
+
+            /* At-least-once: the item only counts once it is acked */
+            if (args->leases) {
+                leased = (lease_acquire(args->leases, &batch[i], &leases[i]) == 0);
+            }
+            if (!leased) args->stats.messages_consumed++;
+
+            /* Warm-up latency: gate release -> first completed operation */
+            if (!first_op_done) {
+                first_op_done = 1;
+                if (args->analytics && release_us > 0) {
+                    analytics_record_first_op(args->analytics, time_now_us() - release_us);
+                }
+            }
+            if (args->analytics) {
+                if (!leased) analytics_record_consume(args->analytics);
+                /* Record how long this message waited in the queue.
+                 * The distributions use the monotonic us stamps: from the
+                 * actual enqueue (uncorrected) and from the intended send
+                 * time (corrected for coordinated omission in open loop). */
+                long latency = queue_get_time_ms() - msg->timestamp;
+                if (latency >= 0)
+                    analytics_record_latency(args->analytics, latency,
+                                             dequeued_us - msg->enqueue_us,
+                                             dequeued_us - msg->intended_us);
+            }
+
+            /* Persist it: a copy into the open sink buffer, the writer
+             * thread does the I/O (only fails once the sink is stopped) */
+            if (args->sink) sink_append(args->sink, args->id, msg, dequeued_us);
 
-        DBG(DBG_TRACE, "Consumer %d: Read pri=%d, data=%d from P%d, queue=%d/%d",
-            args->id, msg.priority, msg.data, msg.producer_id,
-            queue_get_count(args->queue), queue_get_capacity(args->queue));
+            DBG(DBG_TRACE, "Consumer %d: Read pri=%d, data=%d from P%d, queue=%d/%d",
+                args->id, msg->priority, msg->data, msg->producer_id,
+                queue_get_count(args->queue), queue_get_capacity(args->queue));
 
-        if (!args->quiet_mode) {
-            printf("[%06.2f] Consumer %d: Read (pri=%d, data=%d) from P%d | Queue: %d/%d\n",
-                   time_elapsed(), args->id,
-                   msg.priority, msg.data, msg.producer_id,
-                   queue_get_count(args->queue), queue_get_capacity(args->queue));
+            if (!args->quiet_mode && args->topic != NULL) {
+                printf("[%06.2f] Consumer %d: Read (pri=%d, data=%d) from P%d | Group %d, lag %d\n",
+                       time_elapsed(), args->id,
+                       msg->priority, msg->data, msg->producer_id,
+                       args->group + 1, topic_lag(args->topic, args->group));
+            } else if (!args->quiet_mode) {
+                printf("[%06.2f] Consumer %d: Read (pri=%d, data=%d) from P%d | Queue: %d/%d",
+                       time_elapsed(), args->id,
+                       msg->priority, msg->data, msg->producer_id,
+                       queue_get_count(args->queue), queue_get_capacity(args->queue));
+                if (msg->attempts > 1) printf(" | Delivery %d", msg->attempts);
+                if (partition >= 0) printf(" | Partition %d", partition);
+                if (msg->merged > 0) {
+                    printf(" | Key %d, %d update%s folded", msg->key, msg->merged,
+                           msg->merged == 1 ? "" : "s");
+                }
+                printf("\n");
+            }
         }
 
         /* Step 4: Simulated Processing Time
          * Responsive sleep: wake every second to check shutdown flag.
          * This ensures threads exit promptly (within 1s) when stopped. */
+        service_start_us = time_now_us();
         if (*(args->running)) {
             sleep_time = random_range(0, args->max_wait);
 
@@ -187,6 +450,43 @@ void *consumer_thread(void *arg)
                 }
             }
         }
+
+        /* MLFQ feedback: the wake-up's processing time, split over its items */
+        if (args->queue->policy == QUEUE_POLICY_MLFQ) {
+            long long service_us = (time_now_us() - service_start_us) / num_items;
+            for (i = 0; i < num_items; i++) queue_policy_charge(args->queue, &batch[i], service_us);
+        }
+
+        /* Step 5: Ack or nack what was leased in step 3 */
+        if (args->leases) settle_leases(args, batch, leases, num_items);
+
+        /* Step 6: Only now may the partition's next message go out */
+        if (partition >= 0) {
+            queue_partition_release(args->queue, partition, args->id);
+            partition = -1;
+        }
+
+        /* Step 7: Processing is done: answer the requests */
+        if (args->rpc) {
+            for (i = 0; i < num_items; i++) rpc_reply(args->rpc, &batch[i]);
+        }
+    }
+
+    if (args->perf_enabled) {
+        PerfSample sample;
+        perf_counters_stop(&perf);
+        perf_counters_read(&perf, &sample);
+        perf_counters_close(&perf);
+        if (args->analytics) analytics_record_perf(args->analytics, 1, &sample);
+    }
+
+    if (args->use_epoll) {
+        args->stats.epoll_wakeups = (int)ep.wakeups;
+        args->stats.empty_wakeups = (int)ep.empty_wakeups;
+        if (args->analytics) {
+            analytics_record_epoll(args->analytics, ep.wakeups, ep.empty_wakeups);
+        }
+        consumer_epoll_close(&ep);
     }
 
     /* Cleanup & Exit */
@@ -204,6 +504,19 @@ void consumer_print_stats(const ConsumerArgs *args)
 {
     if (args == NULL) return;
 
-    printf("    Consumer %d: %d messages consumed, %d times blocked\n",
+    printf("    Consumer %d: %d messages consumed, %d times blocked",
            args->id, args->stats.messages_consumed, args->stats.times_blocked);
+    if (args->leases) {
+        printf(", %d nacked, %d late acks", args->stats.nacks, args->stats.late_acks);
+    }
+    if (args->use_epoll) {
+        printf(", %d epoll wake-ups (%d empty)", args->stats.epoll_wakeups,
+               args->stats.empty_wakeups);
+    }
+    if (args->filter) {
+        char desc[96];
+        queue_filter_describe(args->filter, desc, sizeof(desc));
+        printf(" [%s]", desc);
+    }
+    printf("\n");
 }
@@ -15,6 +15,11 @@
 #include <signal.h>
 #include "queue.h"
 #include "analytics.h"
+#include "lease.h"
+#include "sink.h"
+#include "rpc.h"
+#include "topic.h"
+#include "utils.h"
 
 /* --- Data Structures --- */
 
@@ -25,8 +30,25 @@
 typedef struct {
     int messages_consumed;      // Total items successfully processed
     int times_blocked;          // Count of times the thread waited for data
+    int nacks;                  // Injected failures reported (--fail-pct)
+    int late_acks;              // Acks refused: lease had already timed out
+    int epoll_wakeups;          // epoll_wait returns (--epoll)
+    int empty_wakeups;          // ... after which another consumer had the item
 } ConsumerStats;
 
+/*
+ * Epoll-driven wait (--epoll). The consumer sleeps in epoll_wait on
+ * the queue's readiness eventfd instead of in sem_wait, so the same
+ * wait can also cover the caller's sockets and timers.
+ */
+typedef struct {
+    int epoll_fd;
+    int ready_fd;               // The queue's eventfd
+    int edge;                   // 1 = registered EPOLLET (one wake-up per arrival)
+    long long wakeups;
+    long long empty_wakeups;
+} ConsumerEpoll;
+
 /*
  * Thread Arguments Container.
  * Passed via pthread_create to give the thread its context.
@@ -39,6 +61,19 @@ typedef struct {
     int quiet_mode;             // Flag for quiet mode (TUI integration)
     int max_wait;               // Max sleep between reads (seconds)
     Analytics *analytics;       // Pointer to shared analytics (may be NULL)
+    int perf_enabled;           // Count hardware events around the loop (--perf)
+    StartGate *start_gate;      // Park here until all workers exist (may be NULL)
+    long long spawn_us;         // time_now_us() just before pthread_create
+    int batch_size;             // Max items per dequeue lock (--batch, 1 = single)
+    LeaseTable *leases;         // At-least-once mode: lease + ack (NULL = off)
+    int fail_pct;               // Chance (%) to nack instead of ack (--fail-pct)
+    const MessageFilter *filter; // Selective receive (--filter, NULL = any message)
+    int partitioned;            // Lease one partition per message (--partitions)
+    int use_epoll;              // Wait on the queue's readiness eventfd (--epoll)
+    Sink *sink;                 // Append each processed message (--sink, NULL = off)
+    RpcTable *rpc;              // Answer each processed request (--rpc, NULL = off)
+    Topic *topic;               // Read the topic log through a group cursor (--groups, NULL = queue)
+    int group;                  // Subscriber group (0-based) when topic is set
 } ConsumerArgs;
 
 /* --- Function Prototypes --- */
@@ -46,9 +81,25 @@ typedef struct {
 /*
  * The Main Consumer Loop.
  * Logic:
- * 1. Dequeue highest priority item (Blocks if empty).
+ * 1. Dequeue highest priority item, or the top batch_size items in
+ *    one locked pass (Blocks if empty). A filtered consumer takes the
+ *    best item its filter accepts (Blocks until one arrives). A
+ *    partitioned consumer takes the oldest item of a partition no
+ *    other consumer holds and leases that partition.
  * 2. Log retrieval details (Consumer ID, Producer ID, Data, Priority).
- * 3. Sleep random interval (0..MAX_CONSUMER_WAIT).
+ * 3. Sleep random interval (0..MAX_CONSUMER_WAIT) once per wake-up.
+ * 4. With leases (--ack-timeout): ack each item after the sleep, or
+ *    nack it with probability fail_pct. Only acked items count as
+ *    consumed; an item whose lease ran out meanwhile was redelivered.
+ * 5. Partitioned: release the partition lease after the sleep, so the
+ *    next message of that partition cannot overtake this one.
+ * 6. With --rpc: reply to each request after the sleep, so the round
+ *    trip includes the processing.
+ * With --policy mlfq, the sleep is reported back to the queue as each
+ * item's service time, which moves the item's class between levels.
+ * With --groups, step 1 reads the next message of the consumer's group
+ * from the topic log (in publish order, shared with the group's other
+ * consumers; the other groups read the same messages independently).
  * Returns: NULL on exit.
  */
 void *consumer_thread(void *arg);
@@ -65,4 +116,22 @@ int consumer_init_args(ConsumerArgs *args, int id, Queue *queue, volatile sig_at
  */
 void consumer_print_stats(const ConsumerArgs *args);
 
+/*
+ * Opens an epoll set watching q's readiness eventfd (edge-triggered if
+ * the queue is in QUEUE_READY_EDGE mode). Further descriptors may be
+ * added to ce->epoll_fd by the caller.
+ * Returns: 0 on success, -1 if the queue has no eventfd or epoll fails.
+ */
+int consumer_epoll_open(ConsumerEpoll *ce, Queue *q);
+
+/*
+ * Takes one message, sleeping in epoll_wait while the queue is empty.
+ * Same contract as queue_dequeue_safe (was_blocked / wait_time_ms may
+ * be NULL). Returns: 0 on success, -1 on shutdown or failure.
+ */
+int consumer_epoll_dequeue(ConsumerEpoll *ce, Queue *q, Message *msg,
+                           int *was_blocked, long *wait_time_ms);
+
+void consumer_epoll_close(ConsumerEpoll *ce);
+
 #endif /* CONSUMER_H */
\ No newline at end of file
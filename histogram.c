@@ -0,0 +1,124 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * histogram.c: Log-Linear Latency Histogram Implementation
+ * * Bucket index = (exponent, top HIST_SUB_BITS mantissa bits).
+ * * Values below HIST_SUB_COUNT map 1:1 onto the first buckets.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer arguments         — all public functions check inputs
+ *   2. Negative values                — clamped to 0 (clock step-back)
+ *   3. Out-of-range values            — clamped into the last bucket
+ *   4. Empty histogram queries        — return 0 rather than garbage
+ */
+
+#include <string.h>
+
+#include "histogram.h"
+
+/* --- Internal Helpers --- */
+
+static int bucket_index(long long value)
+{
+    unsigned long long v;
+    int exponent, sub;
+
+    if (value < 0) value = 0;
+    v = (unsigned long long)value;
+
+    if (v < HIST_SUB_COUNT) return (int)v;
+
+    /* Position of the highest set bit */
+    exponent = 63 - __builtin_clzll(v);
+    if (exponent > HIST_MAX_EXP) return HIST_BUCKETS - 1;
+
+    sub = (int)(v >> (exponent - HIST_SUB_BITS)) - HIST_SUB_COUNT;
+    return (exponent - HIST_SUB_BITS + 1) * HIST_SUB_COUNT + sub;
+}
+
+/* Largest value that maps into bucket 'index' */
+static long long bucket_upper(int index)
+{
+    int exponent, sub;
+    long long low;
+
+    if (index < HIST_SUB_COUNT) return index;
+
+    exponent = index / HIST_SUB_COUNT - 1 + HIST_SUB_BITS;
+    sub = index % HIST_SUB_COUNT;
+    low = (long long)(HIST_SUB_COUNT + sub) << (exponent - HIST_SUB_BITS);
+
+    return low + (1LL << (exponent - HIST_SUB_BITS)) - 1;
+}
+
+/* --- Public API --- */
+
+void histogram_init(Histogram *h)
+{
+    if (h == NULL) return;
+    memset(h, 0, sizeof(*h));
+}
+
+void histogram_record(Histogram *h, long long value)
+{
+    if (h == NULL) return;
+    if (value < 0) value = 0;
+
+    h->counts[bucket_index(value)]++;
+    if (h->total == 0 || value < h->min) h->min = value;
+    if (h->total == 0 || value > h->max) h->max = value;
+    h->total++;
+    h->sum += (double)value;
+}
+
+void histogram_merge(Histogram *dst, const Histogram *src)
+{
+    int i;
+
+    if (dst == NULL || src == NULL || src->total == 0) return;
+
+    for (i = 0; i < HIST_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    if (dst->total == 0 || src->min < dst->min) dst->min = src->min;
+    if (dst->total == 0 || src->max > dst->max) dst->max = src->max;
+    dst->total += src->total;
+    dst->sum += src->sum;
+}
+
+long long histogram_percentile(const Histogram *h, double pct)
+{
+    unsigned long long rank, seen = 0;
+    long long value;
+    int i;
+
+    if (h == NULL || h->total == 0) return 0;
+
+    if (pct <= 0.0) return h->min;
+    if (pct >= 100.0) return h->max;
+
+    /* Nearest-rank: smallest value with at least pct% of samples <= it */
+    rank = (unsigned long long)(pct / 100.0 * (double)h->total);
+    if ((double)rank < pct / 100.0 * (double)h->total) rank++;
+    if (rank == 0) rank = 1;
+
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            value = bucket_upper(i);
+            if (value > h->max) value = h->max;
+            if (value < h->min) value = h->min;
+            return value;
+        }
+    }
+
+    return h->max;
+}
+
+double histogram_mean(const Histogram *h)
+{
+    if (h == NULL || h->total == 0) return 0.0;
+    return h->sum / (double)h->total;
+}
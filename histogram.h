@@ -0,0 +1,58 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * histogram.h: Log-Linear Latency Histogram Declarations
+ * * Fixed-size histogram for microsecond latencies, suitable for
+ * * percentile reporting (p50/p99/p99.9) without storing every sample.
+ * * Not thread-safe: callers serialise access (e.g. the analytics mutex).
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+/* --- Constants --- */
+
+/*
+ * Each power of two is split into HIST_SUB_COUNT linear sub-buckets,
+ * so any recorded value is reported within 1/16 (6.25%) of its true value.
+ * Values above 2^HIST_MAX_EXP us (~12 days) are clamped into the last bucket.
+ */
+#define HIST_SUB_BITS           4
+#define HIST_SUB_COUNT          (1 << HIST_SUB_BITS)
+#define HIST_MAX_EXP            40
+#define HIST_BUCKETS            ((HIST_MAX_EXP - HIST_SUB_BITS + 2) * HIST_SUB_COUNT)
+
+/* --- Data Structures --- */
+
+typedef struct {
+    unsigned long long counts[HIST_BUCKETS];
+    unsigned long long total;   // Number of recorded values
+    long long min;              // Exact minimum (valid if total > 0)
+    long long max;              // Exact maximum (valid if total > 0)
+    double sum;                 // For the exact mean
+} Histogram;
+
+/* --- Function Prototypes --- */
+
+/* Clears all buckets. */
+void histogram_init(Histogram *h);
+
+/* Records one value (negative values are recorded as 0). */
+void histogram_record(Histogram *h, long long value);
+
+/* Adds every bucket of 'src' into 'dst'. */
+void histogram_merge(Histogram *dst, const Histogram *src);
+
+/*
+ * Returns the value at percentile 'pct' (0-100), i.e. the upper bound
+ * of the bucket holding that rank, clamped to the exact max.
+ * Returns 0 for an empty histogram.
+ */
+long long histogram_percentile(const Histogram *h, double pct);
+
+/* Returns the exact arithmetic mean (0.0 if empty). */
+double histogram_mean(const Histogram *h);
+
+#endif /* HISTOGRAM_H */
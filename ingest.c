@@ -0,0 +1,424 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * ingest.c: Producer Ingestion Source Implementation
+ * * The parser is a single forward pass over the bytes: digits are
+ * * accumulated by hand (no scanf, no strtol, no copy of the line), and
+ * * memchr is only used to skip comments and bad lines. A mapped file
+ * * needs no lock at all: every reader owns a range that starts after a
+ * * newline. In stream mode only the read() itself is serialised; the
+ * * partial line at the end of a chunk is carried to the next reader.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer / invalid args    — checked, return -1
+ *   2. open / fstat / mmap / eventfd  — reported with errno, return -1
+ *   3. read() failure                 — reported once, the stream ends
+ *                                       for every reader (no retry)
+ *   4. Malformed input lines          — counted and skipped, never fatal
+ *                                       (bad number, priority out of
+ *                                       range, line over INGEST_LINE_MAX)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+
+#include "ingest.h"
+#include "utils.h"
+
+/* --- Internal Helpers --- */
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Accumulates decimal digits at '*p'. Stops accumulating after 10
+ * digits (the caller rejects those), but keeps consuming them.
+ * Returns: number of digits consumed.
+ */
+static int parse_digits(const char **p, const char *end, long *value)
+{
+    const char *q = *p;
+    long v = 0;
+    int digits = 0;
+
+    while (q < end && (unsigned char)(*q - '0') < 10) {
+        if (digits < 10) v = v * 10 + (*q - '0');
+        digits++;
+        q++;
+    }
+    *p = q;
+    *value = v;
+    return digits;
+}
+
+/*
+ * Parses lines from [p, end) until 'max' messages are out or the span
+ * ends. 'end' is always a line boundary (newline or end of input).
+ * A message line is "data[,priority]" with an optional '\r'; blank and
+ * '#' lines are skipped. Messages are copies of 'base' (one timestamp
+ * per call) with data and priority filled in.
+ * Returns: pointer to the first unparsed byte.
+ */
+static const char *parse_lines(IngestStats *st, const char *p, const char *end,
+                               Message *msgs, int max, int *n, const Message *base)
+{
+    while (p < end && *n < max) {
+        const char *line = p;
+        const char *q = p;
+        const char *eol;
+        long data, priority = PRIORITY_MIN;
+        int negative = 0, digits, ok;
+
+        if (*q == '-') {
+            negative = 1;
+            q++;
+        }
+        digits = parse_digits(&q, end, &data);
+        ok = (digits > 0 && digits <= 9);
+        if (ok && q < end && *q == ',') {
+            q++;
+            digits = parse_digits(&q, end, &priority);
+            ok = (digits > 0 && digits <= 2 && priority <= PRIORITY_MAX);
+        }
+        if (q < end && *q == '\r') q++;
+
+        if (ok && (q == end || *q == '\n')) {
+            eol = q;
+        } else {
+            eol = memchr(q, '\n', (size_t)(end - q));
+            if (eol == NULL) eol = end;
+            ok = 0;
+        }
+        p = (eol < end) ? eol + 1 : end;
+        st->bytes += p - line;
+
+        /* Blank lines and comments are not messages */
+        if (line == eol || (*line == '\r' && line + 1 == eol) || *line == '#') {
+            st->skipped++;
+            continue;
+        }
+
+        st->lines++;
+        if (!ok || eol - line > INGEST_LINE_MAX) {
+            st->malformed++;
+            continue;
+        }
+
+        msgs[*n] = *base;
+        msgs[*n].data = (int)(negative ? -data : data);
+        msgs[*n].priority = (int)priority;
+        (*n)++;
+        st->messages++;
+    }
+    return p;
+}
+
+/*
+ * Stream mode: gives reader 'reader' the next chunk of complete lines.
+ * Under the lock: carried partial line + one read(), then the new
+ * unfinished tail is carried on (or dropped if it is already too long).
+ * Returns: 1 if a chunk (possibly empty) was read, 0 at end of input,
+ * -1 on read failure.
+ */
+static int stream_refill(Ingest *in, int reader)
+{
+    IngestReader *r = &in->readers[reader];
+    char *buf = in->chunks[reader];
+    size_t len, start = 0, cut;
+    ssize_t got;
+    long long t0 = now_ns();
+    int rc = 1;
+
+    pthread_mutex_lock(&in->stream_mutex);
+    if (in->stream_eof) {
+        pthread_mutex_unlock(&in->stream_mutex);
+        r->eof = 1;
+        r->stats.read_ns += now_ns() - t0;
+        return 0;
+    }
+
+    memcpy(buf, in->carry, in->carry_len);
+    len = in->carry_len;
+    in->carry_len = 0;
+
+    do {
+        got = read(in->fd, buf + len, INGEST_READ_BYTES);
+    } while (got < 0 && errno == EINTR);
+    r->stats.reads++;
+
+    if (got < 0) {
+        fprintf(stderr, "[ERROR] ingest: read(%s) failed (errno=%d: %s)\n",
+                in->path, errno, strerror(errno));
+        in->stream_eof = 1;
+        pthread_mutex_unlock(&in->stream_mutex);
+        r->eof = 1;
+        return -1;
+    }
+    len += (size_t)got;
+    if (got == 0) in->stream_eof = 1;
+
+    /* Rest of a line that was already too long to carry */
+    if (in->skip_line) {
+        const char *nl = memchr(buf, '\n', len);
+        start = (nl != NULL) ? (size_t)(nl - buf) + 1 : len;
+        r->stats.bytes += (long long)start;
+        if (nl != NULL || got == 0) in->skip_line = 0;
+    }
+
+    /* Complete lines end at the last newline; at end of input the
+     * final line needs none */
+    cut = len;
+    if (got > 0) {
+        while (cut > start && buf[cut - 1] != '\n') cut--;
+        if (len - cut <= INGEST_LINE_MAX) {
+            memcpy(in->carry, buf + cut, len - cut);
+            in->carry_len = len - cut;
+        } else {
+            in->skip_line = 1;
+            r->stats.lines++;
+            r->stats.malformed++;
+            r->stats.bytes += (long long)(len - cut);
+        }
+    } else if (len == start) {
+        rc = 0;
+    }
+    pthread_mutex_unlock(&in->stream_mutex);
+
+    r->pos = buf + start;
+    r->end = buf + cut;
+    if (rc == 0) r->eof = 1;
+    r->stats.read_ns += now_ns() - t0;
+    return rc;
+}
+
+/* Advances 'pos' to just after the next newline (or to 'size'). */
+static size_t align_to_line(const char *map, size_t size, size_t pos)
+{
+    const char *nl;
+
+    if (pos == 0 || pos >= size) return pos >= size ? size : 0;
+    if (map[pos - 1] == '\n') return pos;
+    nl = memchr(map + pos, '\n', size - pos);
+    return (nl != NULL) ? (size_t)(nl - map) + 1 : size;
+}
+
+/* --- Public API --- */
+
+int ingest_open(Ingest *in, const char *path, int readers)
+{
+    struct stat st;
+    int i;
+
+    if (in == NULL || path == NULL || path[0] == '\0') {
+        fprintf(stderr, "[ERROR] ingest_open: NULL or empty argument\n");
+        return -1;
+    }
+    if (readers < 1 || readers > MAX_PRODUCERS) {
+        fprintf(stderr, "[ERROR] ingest_open: %d readers out of range [1, %d]\n",
+                readers, MAX_PRODUCERS);
+        return -1;
+    }
+    if (strlen(path) >= INGEST_PATH_MAX) {
+        fprintf(stderr, "[ERROR] ingest_open: path longer than %d characters\n",
+                INGEST_PATH_MAX - 1);
+        return -1;
+    }
+
+    memset(in, 0, sizeof(*in));
+    strcpy(in->path, path);
+    in->num_readers = readers;
+    in->active = readers;
+    in->done_fd = -1;
+
+    if (strcmp(path, "-") == 0) {
+        in->fd = STDIN_FILENO;
+    } else {
+        in->fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (in->fd < 0) {
+            fprintf(stderr, "[ERROR] ingest_open: open(%s) failed (errno=%d: %s)\n",
+                    path, errno, strerror(errno));
+            return -1;
+        }
+        in->owns_fd = 1;
+    }
+
+    if (fstat(in->fd, &st) != 0) {
+        fprintf(stderr, "[ERROR] ingest_open: fstat(%s) failed (errno=%d: %s)\n",
+                path, errno, strerror(errno));
+        ingest_close(in);
+        return -1;
+    }
+
+    /* A regular file (also stdin redirected from one) is mapped */
+    in->mode = S_ISREG(st.st_mode) ? INGEST_MMAP : INGEST_STREAM;
+    if (in->mode == INGEST_MMAP && st.st_size > 0) {
+        in->map_bytes = (size_t)st.st_size;
+        in->map = mmap(NULL, in->map_bytes, PROT_READ, MAP_PRIVATE, in->fd, 0);
+        if (in->map == MAP_FAILED) {
+            fprintf(stderr, "[ERROR] ingest_open: mmap(%s) failed (errno=%d: %s)\n",
+                    path, errno, strerror(errno));
+            in->map = NULL;
+            ingest_close(in);
+            return -1;
+        }
+        /* One forward pass: let the kernel read ahead aggressively */
+        posix_madvise(in->map, in->map_bytes, POSIX_MADV_SEQUENTIAL);
+    }
+
+    if (in->mode == INGEST_MMAP) {
+        /* An empty file leaves every range empty (pos == end == NULL) */
+        for (i = 0; i < readers && in->map != NULL; i++) {
+            size_t from = align_to_line(in->map, in->map_bytes,
+                                        in->map_bytes / (size_t)readers * (size_t)i);
+            size_t to = (i == readers - 1) ? in->map_bytes :
+                        align_to_line(in->map, in->map_bytes,
+                                      in->map_bytes / (size_t)readers * (size_t)(i + 1));
+            in->readers[i].pos = in->map + from;
+            in->readers[i].end = in->map + to;
+        }
+    } else {
+        if (pthread_mutex_init(&in->stream_mutex, NULL) != 0) {
+            fprintf(stderr, "[ERROR] ingest_open: mutex init failed\n");
+            ingest_close(in);
+            return -1;
+        }
+        in->mutex_initialized = 1;
+    }
+
+    in->done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (in->done_fd < 0) {
+        fprintf(stderr, "[ERROR] ingest_open: eventfd failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        ingest_close(in);
+        return -1;
+    }
+
+    DBG(DBG_INFO, "Ingest: %s via %s (%zu bytes mapped, %d readers)",
+        path, ingest_mode_name(in), in->map_bytes, readers);
+    return 0;
+}
+
+int ingest_next_batch(Ingest *in, int reader, Message *msgs, int max, int producer_id)
+{
+    IngestReader *r;
+    Message base;
+    long long t0;
+    int n = 0;
+
+    if (in == NULL || msgs == NULL || max < 1 || reader < 0 || reader >= in->num_readers) {
+        return -1;
+    }
+    r = &in->readers[reader];
+    if (r->stats.start_us == 0) r->stats.start_us = time_now_us();
+
+    base = message_create(0, PRIORITY_MIN, producer_id);
+    while (n < max) {
+        if (r->pos >= r->end) {
+            if (in->mode == INGEST_MMAP || r->eof) break;
+            if (stream_refill(in, reader) < 0) return (n > 0) ? n : -1;
+            continue;
+        }
+        t0 = now_ns();
+        r->pos = parse_lines(&r->stats, r->pos, r->end, msgs, max, &n, &base);
+        r->stats.parse_ns += now_ns() - t0;
+    }
+
+    if (n == 0) {
+        r->eof = 1;
+        if (r->stats.end_us == 0) r->stats.end_us = time_now_us();
+    }
+    return n;
+}
+
+void ingest_note_enqueue(Ingest *in, int reader, long long us, int blocked)
+{
+    if (in == NULL || reader < 0 || reader >= in->num_readers) return;
+    in->readers[reader].stats.enqueue_us += us;
+    in->readers[reader].stats.batches++;
+    if (blocked) in->readers[reader].stats.blocked_batches++;
+}
+
+void ingest_reader_done(Ingest *in, int reader)
+{
+    uint64_t one = 1;
+
+    if (in == NULL || reader < 0 || reader >= in->num_readers) return;
+    if (__atomic_sub_fetch(&in->active, 1, __ATOMIC_ACQ_REL) == 0 && in->done_fd >= 0) {
+        if (write(in->done_fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) {
+            fprintf(stderr, "[ERROR] ingest: eventfd write failed (errno=%d: %s)\n",
+                    errno, strerror(errno));
+        }
+    }
+}
+
+int ingest_done_fd(const Ingest *in)
+{
+    return (in != NULL) ? in->done_fd : -1;
+}
+
+const char *ingest_mode_name(const Ingest *in)
+{
+    return (in != NULL && in->mode == INGEST_STREAM) ? "stream" : "mmap";
+}
+
+void ingest_stats(const Ingest *in, IngestStats *out)
+{
+    int i;
+
+    if (in == NULL || out == NULL) return;
+    memset(out, 0, sizeof(*out));
+    for (i = 0; i < in->num_readers; i++) {
+        const IngestStats *s = &in->readers[i].stats;
+        out->bytes += s->bytes;
+        out->lines += s->lines;
+        out->messages += s->messages;
+        out->malformed += s->malformed;
+        out->skipped += s->skipped;
+        out->reads += s->reads;
+        out->parse_ns += s->parse_ns;
+        out->read_ns += s->read_ns;
+        out->enqueue_us += s->enqueue_us;
+        out->batches += s->batches;
+        out->blocked_batches += s->blocked_batches;
+        if (s->start_us > 0 && (out->start_us == 0 || s->start_us < out->start_us)) {
+            out->start_us = s->start_us;
+        }
+        if (s->end_us > out->end_us) out->end_us = s->end_us;
+    }
+}
+
+void ingest_close(Ingest *in)
+{
+    if (in == NULL) return;
+    if (in->map != NULL) {
+        munmap(in->map, in->map_bytes);
+        in->map = NULL;
+    }
+    if (in->owns_fd && in->fd >= 0) close(in->fd);
+    in->fd = -1;
+    in->owns_fd = 0;
+    if (in->done_fd >= 0) close(in->done_fd);
+    in->done_fd = -1;
+    if (in->mutex_initialized) {
+        pthread_mutex_destroy(&in->stream_mutex);
+        in->mutex_initialized = 0;
+    }
+}
@@ -0,0 +1,115 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * ingest.h: Producer Ingestion Source (mmap / stdin)
+ * * With --source, producers stop generating random messages and parse
+ * * them from input instead: one "data[,priority]" line per message.
+ * * A regular file is memory-mapped and split into one line-aligned
+ * * range per producer (no copy, no lock); stdin or a pipe is read in
+ * * INGEST_READ_BYTES chunks shared out under a mutex.
+ * * Parsed messages are handed back a batch at a time for one
+ * * queue_enqueue_batch_safe call each.
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include "config.h"
+#include "queue.h"
+
+/* --- Data Structures --- */
+
+typedef enum {
+    INGEST_MMAP = 0,            // Regular file, mapped read-only
+    INGEST_STREAM               // stdin / pipe / FIFO, read() in large chunks
+} IngestMode;
+
+/* Per-reader counters (one reader per producer, summed for the report) */
+typedef struct {
+    long long bytes;            // Input parsed (including skipped lines)
+    long long lines;            // Message lines (parsed or malformed)
+    long long messages;         // Parsed into messages
+    long long malformed;        // Bad number, priority out of range, too long
+    long long skipped;          // Blank and '#' comment lines
+    long long reads;            // read() calls (stream mode)
+    long long parse_ns;         // Time in the parser (read() excluded)
+    long long read_ns;          // Time in read() and waiting for the stream lock
+    long long enqueue_us;       // Time in batch enqueues (including blocking)
+    long long batches;          // queue_enqueue_batch_safe calls
+    long long blocked_batches;  // Batches that waited for a free slot
+    long long start_us;         // First parse (0 = never started)
+    long long end_us;           // End of input reached
+} IngestStats;
+
+typedef struct {
+    const char *pos;            // Next unparsed byte
+    const char *end;            // End of the current range / chunk
+    int eof;                    // Nothing more for this reader
+    IngestStats stats;          // Owned by the reader's producer thread
+} IngestReader;
+
+typedef struct {
+    IngestMode mode;
+    char path[INGEST_PATH_MAX]; // "-" = stdin
+    int fd;
+    int owns_fd;                // Close on destroy (not stdin)
+    char *map;                  // INGEST_MMAP: the whole file (NULL if empty)
+    size_t map_bytes;
+    int num_readers;
+    IngestReader readers[MAX_PRODUCERS];
+
+    /* INGEST_STREAM: a reader takes the lock, prepends the carried
+     * partial line, reads one chunk and carries its unfinished tail */
+    pthread_mutex_t stream_mutex;
+    int mutex_initialized;
+    char carry[INGEST_LINE_MAX];
+    size_t carry_len;
+    int skip_line;              // Carried line overflowed: drop up to the next newline
+    int stream_eof;
+    char chunks[MAX_PRODUCERS][INGEST_LINE_MAX + INGEST_READ_BYTES];
+
+    int active;                 // Readers not yet at end of input (atomic)
+    int done_fd;                // eventfd: readable once every reader finished
+} Ingest;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Opens 'path' ("-" = stdin) for 'readers' producers. A regular file
+ * is mapped and split at newlines; anything else is streamed.
+ * Returns: 0 on success, -1 on invalid input, open, mmap or eventfd failure.
+ */
+int ingest_open(Ingest *in, const char *path, int readers);
+
+/*
+ * Parses up to 'max' messages for reader 'reader' (0-based) into
+ * 'msgs', stamped as created by 'producer_id' now.
+ * Returns: messages parsed (>= 1), 0 at end of input, -1 on read error.
+ */
+int ingest_next_batch(Ingest *in, int reader, Message *msgs, int max, int producer_id);
+
+/* Adds one batch enqueue (its duration and whether it blocked) to the reader's counters. */
+void ingest_note_enqueue(Ingest *in, int reader, long long us, int blocked);
+
+/*
+ * Marks reader 'reader' finished; the last one makes done_fd readable.
+ */
+void ingest_reader_done(Ingest *in, int reader);
+
+/* Descriptor for the monitor: readable once all input was consumed. */
+int ingest_done_fd(const Ingest *in);
+
+/* "mmap" or "stream" */
+const char *ingest_mode_name(const Ingest *in);
+
+/* Sums the readers' counters (call after the producers are joined). */
+void ingest_stats(const Ingest *in, IngestStats *out);
+
+/* Unmaps the file and closes the descriptors. */
+void ingest_close(Ingest *in);
+
+#endif /* INGEST_H */
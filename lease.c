@@ -0,0 +1,312 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * lease.c: At-Least-Once Delivery Implementation
+ * * Leased messages keep their queue slot (queue_enable_leases), so a
+ * * redelivery is a plain re-insert that can never block on a full
+ * * queue. The slot is only freed by an ack or by dead-lettering.
+ * * Lock order: lease mutex, then queue mutex (consumers never hold the
+ * * queue mutex while calling in here).
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer / invalid args    — checked, return -1
+ *   2. Mutex init / pthread_create    — reported, caller cleans up
+ *   3. Table full                     — message released, delivered
+ *                                       at-most-once and counted
+ *   4. Ack/nack after the timeout     — lease generation mismatch,
+ *                                       counted as a late ack, return -1
+ *   5. Requeue failure                — message dead-lettered instead,
+ *                                       so it is never lost silently
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lease.h"
+#include "utils.h"
+
+/* --- Internal Helpers --- */
+
+/* Frees entry 'slot' and invalidates outstanding handles. Caller holds lt->mutex. */
+static void free_entry(LeaseTable *lt, int slot)
+{
+    lt->entries[slot].held = 0;
+    lt->entries[slot].generation++;
+    lt->stats.in_flight--;
+}
+
+/* Caller holds lt->mutex */
+static void dead_letter(LeaseTable *lt, Message msg)
+{
+    lt->dead[lt->dead_next] = msg;
+    lt->dead_next = (lt->dead_next + 1) % MAX_DEAD_LETTERS;
+    lt->stats.dead_lettered++;
+    if (msg.priority >= PRIORITY_MIN && msg.priority <= PRIORITY_MAX) {
+        lt->stats.dead_by_priority[msg.priority]++;
+    }
+    queue_release(lt->queue, &msg, 1);
+
+    DBG(DBG_INFO, "Lease: P%d#%d dead-lettered after %d deliveries",
+        msg.producer_id, msg.data, msg.attempts);
+}
+
+/*
+ * Redelivers a failed or timed-out message, or dead-letters it once it
+ * has used all its deliveries. Caller holds lt->mutex.
+ */
+static void redeliver(LeaseTable *lt, Message msg)
+{
+    if (msg.attempts >= lt->max_deliveries) {
+        dead_letter(lt, msg);
+        return;
+    }
+    if (queue_requeue(lt->queue, msg) != 0) {
+        fprintf(stderr, "[ERROR] lease: requeue failed, dead-lettering P%d#%d\n",
+                msg.producer_id, msg.data);
+        dead_letter(lt, msg);
+        return;
+    }
+    lt->stats.redeliveries++;
+}
+
+/* Looks up a live lease. Caller holds lt->mutex. */
+static LeaseEntry *find_lease(LeaseTable *lt, Lease lease)
+{
+    LeaseEntry *e;
+
+    if (lease.slot < 0 || lease.slot >= MAX_QUEUE_SIZE) return NULL;
+    e = &lt->entries[lease.slot];
+    if (!e->held || e->generation != lease.generation) return NULL;
+    return e;
+}
+
+static void *reaper_thread(void *arg)
+{
+    LeaseTable *lt = (LeaseTable *)arg;
+    long long now_us;
+    int i;
+
+    DBG(DBG_INFO, "%s", "Lease: reaper started");
+
+    while (!lt->stop) {
+        sleep_us(LEASE_SCAN_MS * 1000LL);
+
+        if (pthread_mutex_lock(&lt->mutex) != 0) continue;
+        now_us = time_now_us();
+        for (i = 0; i < MAX_QUEUE_SIZE; i++) {
+            LeaseEntry *e = &lt->entries[i];
+            if (!e->held || e->deadline_us > now_us) continue;
+
+            lt->stats.timeouts++;
+            free_entry(lt, i);
+            redeliver(lt, e->msg);
+        }
+        pthread_mutex_unlock(&lt->mutex);
+    }
+
+    DBG(DBG_INFO, "Lease: reaper exiting (%lld timeouts)", lt->stats.timeouts);
+    return NULL;
+}
+
+/* --- Public API --- */
+
+int lease_init(LeaseTable *lt, Queue *queue, int timeout_ms, int max_deliveries)
+{
+    int i;
+
+    if (lt == NULL || queue == NULL || timeout_ms < 1 || max_deliveries < 1) {
+        fprintf(stderr, "[ERROR] lease_init: invalid argument\n");
+        return -1;
+    }
+
+    memset(&lt->stats, 0, sizeof(lt->stats));
+    histogram_init(&lt->stats.ack_us);
+    histogram_init(&lt->stats.deliveries);
+    for (i = 0; i < MAX_QUEUE_SIZE; i++) {
+        lt->entries[i].held = 0;
+        lt->entries[i].generation = 0;
+    }
+    lt->dead_next = 0;
+    lt->queue = queue;
+    lt->timeout_ms = timeout_ms;
+    lt->max_deliveries = max_deliveries;
+    lt->thread_started = 0;
+    lt->stop = 0;
+
+    if (pthread_mutex_init(&lt->mutex, NULL) != 0) {
+        fprintf(stderr, "[ERROR] lease_init: mutex init failed\n");
+        return -1;
+    }
+
+    queue_enable_leases(queue);
+    return 0;
+}
+
+int lease_start(LeaseTable *lt)
+{
+    if (lt == NULL) return -1;
+
+    if (pthread_create(&lt->thread, NULL, reaper_thread, lt) != 0) {
+        fprintf(stderr, "[ERROR] lease_start: pthread_create failed\n");
+        return -1;
+    }
+    lt->thread_started = 1;
+    return 0;
+}
+
+/*
+ * Error handling: With no free entry (cannot happen while every leased
+ * item holds one of the capacity's slots) the slot is released at once
+ * so the queue keeps flowing; the message just loses redelivery.
+ */
+int lease_acquire(LeaseTable *lt, Message *msg, Lease *out)
+{
+    long long now_us;
+    int i;
+
+    if (out != NULL) out->slot = -1;
+    if (lt == NULL || msg == NULL || out == NULL) return -1;
+
+    msg->attempts++;
+
+    if (pthread_mutex_lock(&lt->mutex) != 0) {
+        fprintf(stderr, "[ERROR] lease_acquire: mutex lock failed\n");
+        queue_release(lt->queue, msg, 1);
+        return -1;
+    }
+
+    for (i = 0; i < MAX_QUEUE_SIZE && lt->entries[i].held; i++) { }
+    if (i == MAX_QUEUE_SIZE) {
+        lt->stats.table_full++;
+        pthread_mutex_unlock(&lt->mutex);
+        queue_release(lt->queue, msg, 1);
+        return -1;
+    }
+
+    now_us = time_now_us();
+    lt->entries[i].msg = *msg;
+    lt->entries[i].leased_us = now_us;
+    lt->entries[i].deadline_us = now_us + lt->timeout_ms * 1000LL;
+    lt->entries[i].held = 1;
+    out->slot = i;
+    out->generation = lt->entries[i].generation;
+
+    lt->stats.leases++;
+    lt->stats.in_flight++;
+    if (lt->stats.in_flight > lt->stats.max_in_flight) {
+        lt->stats.max_in_flight = lt->stats.in_flight;
+    }
+    pthread_mutex_unlock(&lt->mutex);
+    return 0;
+}
+
+int lease_ack(LeaseTable *lt, Lease lease)
+{
+    LeaseEntry *e;
+    Message msg;
+
+    if (lt == NULL) return -1;
+    if (pthread_mutex_lock(&lt->mutex) != 0) return -1;
+
+    e = find_lease(lt, lease);
+    if (e == NULL) {
+        lt->stats.late_acks++;
+        pthread_mutex_unlock(&lt->mutex);
+        return -1;
+    }
+
+    msg = e->msg;
+    histogram_record(&lt->stats.ack_us, time_now_us() - e->leased_us);
+    histogram_record(&lt->stats.deliveries, msg.attempts);
+    lt->stats.acks++;
+    free_entry(lt, lease.slot);
+    pthread_mutex_unlock(&lt->mutex);
+
+    queue_release(lt->queue, &msg, 1);
+    return 0;
+}
+
+int lease_nack(LeaseTable *lt, Lease lease)
+{
+    LeaseEntry *e;
+
+    if (lt == NULL) return -1;
+    if (pthread_mutex_lock(&lt->mutex) != 0) return -1;
+
+    e = find_lease(lt, lease);
+    if (e == NULL) {
+        pthread_mutex_unlock(&lt->mutex);
+        return -1;
+    }
+
+    lt->stats.nacks++;
+    free_entry(lt, lease.slot);
+    redeliver(lt, e->msg);
+    pthread_mutex_unlock(&lt->mutex);
+    return 0;
+}
+
+void lease_stop(LeaseTable *lt)
+{
+    if (lt == NULL || !lt->thread_started) return;
+
+    lt->stop = 1;
+    if (pthread_join(lt->thread, NULL) != 0) {
+        fprintf(stderr, "[ERROR] lease_stop: pthread_join failed\n");
+    }
+    lt->thread_started = 0;
+}
+
+int lease_stats(LeaseTable *lt, LeaseStats *out)
+{
+    int i, idx;
+
+    if (lt == NULL || out == NULL) return -1;
+
+    if (pthread_mutex_lock(&lt->mutex) != 0) return -1;
+    *out = lt->stats;
+
+    /* Newest dead letters first */
+    out->recent_dead_count = 0;
+    for (i = 0; i < LEASE_RECENT_DEAD && i < lt->stats.dead_lettered; i++) {
+        idx = (lt->dead_next - 1 - i + MAX_DEAD_LETTERS) % MAX_DEAD_LETTERS;
+        out->recent_dead[i] = lt->dead[idx];
+        out->recent_dead_count++;
+    }
+    pthread_mutex_unlock(&lt->mutex);
+    return 0;
+}
+
+int lease_in_flight(LeaseTable *lt)
+{
+    int n;
+
+    if (lt == NULL) return 0;
+    if (pthread_mutex_lock(&lt->mutex) != 0) return 0;
+    n = lt->stats.in_flight;
+    pthread_mutex_unlock(&lt->mutex);
+    return n;
+}
+
+int lease_dead_total(LeaseTable *lt)
+{
+    int n;
+
+    if (lt == NULL) return 0;
+    if (pthread_mutex_lock(&lt->mutex) != 0) return 0;
+    n = (int)lt->stats.dead_lettered;
+    pthread_mutex_unlock(&lt->mutex);
+    return n;
+}
+
+void lease_destroy(LeaseTable *lt)
+{
+    if (lt == NULL) return;
+    pthread_mutex_destroy(&lt->mutex);
+}
@@ -0,0 +1,125 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * lease.h: At-Least-Once Delivery (Leases, Ack/Nack, Dead Letters)
+ * * A consumer leases each message it dequeues and must ack it within
+ * * the visibility timeout. A nack or an expired lease puts the message
+ * * back into the queue; after max_deliveries attempts it goes to the
+ * * dead-letter queue instead. A reaper thread expires the leases.
+ */
+
+#ifndef LEASE_H
+#define LEASE_H
+
+#include <pthread.h>
+#include <signal.h>
+#include "config.h"
+#include "queue.h"
+#include "histogram.h"
+
+/* --- Constants --- */
+
+#define LEASE_RECENT_DEAD       5   // Dead letters copied out for the report
+
+/* --- Data Structures --- */
+
+/*
+ * Handle for one delivery. The generation changes whenever the entry
+ * is freed, so an ack for a lease that already timed out is detected.
+ */
+typedef struct {
+    int slot;                   // Entry index (-1 = not leased)
+    unsigned int generation;    // Entry generation when leased
+} Lease;
+
+typedef struct {
+    Message msg;                // Leased copy (attempts already counted)
+    long long leased_us;        // When the consumer got it
+    long long deadline_us;      // Redelivered if not acked by then
+    unsigned int generation;
+    int held;                   // 1 = in flight
+} LeaseEntry;
+
+typedef struct {
+    long long leases;           // Deliveries handed to consumers
+    long long acks;             // Leases acked in time
+    long long nacks;            // Failures reported by consumers
+    long long timeouts;         // Leases that ran past the visibility timeout
+    long long redeliveries;     // Messages put back into the queue
+    long long late_acks;        // Acks after the timeout (work done twice)
+    long long dead_lettered;    // Moved to the DLQ after max_deliveries
+    long long dead_by_priority[PRIORITY_MAX + 1];
+    long long table_full;       // No free entry: delivered at-most-once
+    int in_flight;              // Leased, not yet acked
+    int max_in_flight;
+    Histogram ack_us;           // Lease to ack time
+    Histogram deliveries;       // Deliveries needed per acked message
+    Message recent_dead[LEASE_RECENT_DEAD]; // Newest first
+    int recent_dead_count;
+} LeaseStats;
+
+typedef struct {
+    LeaseEntry entries[MAX_QUEUE_SIZE]; // Leased items hold a slot, so
+                                        // capacity bounds the in-flight count
+    Message dead[MAX_DEAD_LETTERS];     // Dead-letter ring
+    int dead_next;              // Next DLQ write position
+    Queue *queue;
+    int timeout_ms;             // Visibility timeout
+    int max_deliveries;         // Attempts before dead-lettering
+    pthread_mutex_t mutex;
+    pthread_t thread;
+    int thread_started;
+    volatile sig_atomic_t stop; // Set by lease_stop
+    LeaseStats stats;
+} LeaseTable;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Prepares an empty lease table for 'queue' and puts the queue in
+ * lease mode (queue_enable_leases). Call before any thread uses it.
+ * Returns: 0 on success, -1 on invalid input or mutex init failure.
+ */
+int lease_init(LeaseTable *lt, Queue *queue, int timeout_ms, int max_deliveries);
+
+/* Starts the reaper thread. Returns: 0 on success, -1 on failure. */
+int lease_start(LeaseTable *lt);
+
+/*
+ * Leases a just-dequeued message: counts the delivery in msg->attempts
+ * and starts its visibility timeout.
+ * If the table is full the message is released at once (at-most-once).
+ * Returns: 0 on success, -1 if not leased (out->slot = -1).
+ */
+int lease_acquire(LeaseTable *lt, Message *msg, Lease *out);
+
+/*
+ * Confirms processing: frees the message's slot for good.
+ * Returns: 0 on success, -1 if the lease was lost (already redelivered).
+ */
+int lease_ack(LeaseTable *lt, Lease lease);
+
+/*
+ * Reports a failed delivery: the message is redelivered at once, or
+ * dead-lettered if it has used up max_deliveries.
+ * Returns: 0 on success, -1 if the lease was lost.
+ */
+int lease_nack(LeaseTable *lt, Lease lease);
+
+/* Stops and joins the reaper thread (no-op if it never started). */
+void lease_stop(LeaseTable *lt);
+
+/* Copies the statistics. Returns: 0 on success, -1 on failure. */
+int lease_stats(LeaseTable *lt, LeaseStats *out);
+
+/* Messages leased and not yet acked. */
+int lease_in_flight(LeaseTable *lt);
+
+/* Messages moved to the dead-letter queue. */
+int lease_dead_total(LeaseTable *lt);
+
+void lease_destroy(LeaseTable *lt);
+
+#endif /* LEASE_H */
@@ -0,0 +1,350 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * listener.c: Unix-Domain-Socket Ingestion Front-End Implementation
+ * * One thread, one level-triggered epoll set: the listening socket,
+ * * every client, and a stop eventfd. A ready client gets exactly one
+ * * read() of up to LISTEN_BATCH_FRAMES frames; a frame cut short by
+ * * the read is kept and completed by the next one. The frames go in
+ * * with blocking batch enqueues, so while the queue is full nothing
+ * * else is read and the kernel socket buffers absorb the pressure.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer / invalid args    — checked, return -1
+ *   2. socket / bind / epoll failures — reported with errno, return -1
+ *   3. A non-socket file at 'path'    — refused, never unlinked
+ *   4. Client errors                  — hang-up or read error closes the
+ *                                       connection; a frame with a bad
+ *                                       magic drops it (stream out of
+ *                                       sync); a bad priority skips the
+ *                                       frame. None of them stop the loop
+ *   5. Too many clients               — accepted and closed at once
+ *   6. Enqueue failure (shutdown)     — ends the loop
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "listener.h"
+#include "utils.h"
+
+/* epoll tags: anything below these is a connection slot */
+#define LSN_TAG_STOP        0xFFFFFFFEu
+#define LSN_TAG_ACCEPT      0xFFFFFFFFu
+
+/* --- Internal Helpers --- */
+
+static int set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return -1;
+    if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) return -1;
+    return fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static int watch(Listener *l, int fd, uint32_t tag)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = tag;
+    return epoll_ctl(l->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static void close_conn(Listener *l, int slot)
+{
+    ListenConn *c = &l->conns[slot];
+
+    epoll_ctl(l->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    c->partial_len = 0;
+    l->num_conns--;
+    l->stats.closed++;
+}
+
+/* Accepts until the backlog is empty (the listening socket is non-blocking). */
+static void accept_all(Listener *l)
+{
+    int fd, slot;
+
+    for (;;) {
+        fd = accept(l->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "[WARN] listener: accept failed (errno=%d: %s)\n",
+                        errno, strerror(errno));
+            }
+            return;
+        }
+
+        for (slot = 0; slot < LISTEN_MAX_CONNS && l->conns[slot].fd >= 0; slot++) {
+        }
+        if (slot == LISTEN_MAX_CONNS || set_nonblocking(fd) != 0 ||
+            watch(l, fd, (uint32_t)slot) != 0) {
+            close(fd);
+            l->stats.refused++;
+            continue;
+        }
+
+        l->conns[slot].fd = fd;
+        l->conns[slot].partial_len = 0;
+        l->num_conns++;
+        l->stats.accepted++;
+        if (l->num_conns > l->stats.peak_conns) l->stats.peak_conns = l->num_conns;
+    }
+}
+
+/*
+ * One read() from connection 'slot', then every whole frame in it is
+ * enqueued before this returns (blocking while the queue is full).
+ * Messages carry producer id 1 + slot % MAX_PRODUCERS, so partitions
+ * and producer filters still spread over the clients.
+ * Returns: 0 to keep serving, -1 once the queue has shut down.
+ */
+static int serve_conn(Listener *l, int slot)
+{
+    ListenConn *c = &l->conns[slot];
+    unsigned char buf[sizeof(ListenFrame) * LISTEN_BATCH_FRAMES];
+    Message msgs[LISTEN_BATCH_FRAMES];
+    Message base;
+    ListenFrame frame;
+    ssize_t got;
+    size_t len, off;
+    int n = 0, done, stored, blocked, out_of_sync = 0;
+    long wait_ms;
+    long long t0, t1;
+
+    memcpy(buf, c->partial, (size_t)c->partial_len);
+    len = (size_t)c->partial_len;
+    do {
+        got = read(c->fd, buf + len, sizeof(buf) - len);
+    } while (got < 0 && errno == EINTR);
+
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    if (got <= 0) {
+        /* Hang-up (0) or a reset: the connection is finished */
+        close_conn(l, slot);
+        return 0;
+    }
+    l->stats.reads++;
+    len += (size_t)got;
+
+    base = message_create(0, PRIORITY_MIN, 1 + slot % MAX_PRODUCERS);
+    for (off = 0; off + sizeof(frame) <= len; off += sizeof(frame)) {
+        memcpy(&frame, buf + off, sizeof(frame));
+        if (frame.magic != LISTEN_FRAME_MAGIC) {
+            out_of_sync = 1;
+            break;
+        }
+        if (frame.priority > PRIORITY_MAX) {
+            l->stats.bad_frames++;
+            continue;
+        }
+        msgs[n] = base;
+        msgs[n].data = frame.data;
+        msgs[n].priority = frame.priority;
+        n++;
+    }
+    histogram_record(&l->stats.batch_frames, (long long)(off / sizeof(frame)));
+
+    if (out_of_sync) {
+        l->stats.protocol_errors++;
+        close_conn(l, slot);
+    } else {
+        c->partial_len = (int)(len - off);
+        memcpy(c->partial, buf + off, (size_t)c->partial_len);
+    }
+
+    /* Nothing else is read until these are stored: back-pressure */
+    for (done = 0; done < n; done += stored) {
+        t0 = time_now_us();
+        stored = queue_enqueue_batch_safe(l->queue, msgs + done, n - done, &blocked, &wait_ms);
+        if (stored < 0) {
+            l->stats.abandoned += n - done;
+            return -1;
+        }
+        t1 = time_now_us();
+        if (blocked) {
+            l->stats.pushbacks++;
+            l->stats.paused_us += t1 - t0;
+        }
+        l->stats.frames += stored;
+        __atomic_fetch_add(&l->enqueued, stored, __ATOMIC_RELAXED);
+        if (l->on_batch != NULL) l->on_batch(msgs + done, stored, blocked, wait_ms, l->on_batch_arg);
+    }
+    return 0;
+}
+
+static void *listener_thread(void *arg)
+{
+    Listener *l = (Listener *)arg;
+    struct epoll_event events[LISTEN_MAX_EVENTS];
+    int n, i;
+    uint32_t tag;
+
+    for (;;) {
+        n = epoll_wait(l->epoll_fd, events, LISTEN_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "[ERROR] listener: epoll_wait failed (errno=%d: %s)\n",
+                    errno, strerror(errno));
+            break;
+        }
+        l->stats.wakeups++;
+
+        for (i = 0; i < n; i++) {
+            tag = events[i].data.u32;
+            if (tag == LSN_TAG_STOP) goto out;
+            if (tag == LSN_TAG_ACCEPT) {
+                accept_all(l);
+            } else if (l->conns[tag].fd >= 0 && serve_conn(l, (int)tag) < 0) {
+                goto out;
+            }
+        }
+    }
+
+out:
+    DBG(DBG_INFO, "Listener: exiting (%lld frames from %lld clients)",
+        l->stats.frames, l->stats.accepted);
+    return NULL;
+}
+
+/* --- Public API --- */
+
+int listener_init(Listener *l, const char *path, Queue *q,
+                  ListenerBatchFn on_batch, void *on_batch_arg)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int i;
+
+    if (l == NULL || path == NULL || path[0] == '\0' || q == NULL) {
+        fprintf(stderr, "[ERROR] listener_init: NULL or empty argument\n");
+        return -1;
+    }
+    if (strlen(path) >= LISTEN_PATH_MAX) {
+        fprintf(stderr, "[ERROR] listener_init: socket path longer than %d characters\n",
+                LISTEN_PATH_MAX - 1);
+        return -1;
+    }
+
+    memset(l, 0, sizeof(*l));
+    strcpy(l->path, path);
+    l->queue = q;
+    l->on_batch = on_batch;
+    l->on_batch_arg = on_batch_arg;
+    l->listen_fd = -1;
+    l->epoll_fd = -1;
+    l->stop_fd = -1;
+    for (i = 0; i < LISTEN_MAX_CONNS; i++) l->conns[i].fd = -1;
+    histogram_init(&l->stats.batch_frames);
+
+    /* A stale socket from an earlier run is replaced; anything else is not ours */
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "[ERROR] listener_init: %s exists and is not a socket\n", path);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    l->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (l->listen_fd < 0) {
+        fprintf(stderr, "[ERROR] listener_init: socket failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (bind(l->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(l->listen_fd, LISTEN_BACKLOG) != 0 || set_nonblocking(l->listen_fd) != 0) {
+        fprintf(stderr, "[ERROR] listener_init: bind/listen on %s failed (errno=%d: %s)\n",
+                path, errno, strerror(errno));
+        /* Not listening: whatever is at 'path' now is not ours to remove */
+        close(l->listen_fd);
+        l->listen_fd = -1;
+        return -1;
+    }
+
+    l->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    l->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (l->epoll_fd < 0 || l->stop_fd < 0 ||
+        watch(l, l->listen_fd, LSN_TAG_ACCEPT) != 0 || watch(l, l->stop_fd, LSN_TAG_STOP) != 0) {
+        fprintf(stderr, "[ERROR] listener_init: epoll setup failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        listener_destroy(l);
+        return -1;
+    }
+
+    if (pthread_create(&l->thread, NULL, listener_thread, l) != 0) {
+        fprintf(stderr, "[ERROR] listener_init: pthread_create failed\n");
+        listener_destroy(l);
+        return -1;
+    }
+    l->thread_started = 1;
+    DBG(DBG_INFO, "Listener: accepting on %s", path);
+    return 0;
+}
+
+void listener_stop(Listener *l)
+{
+    uint64_t one = 1;
+
+    if (l == NULL || !l->thread_started) return;
+    if (write(l->stop_fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) {
+        fprintf(stderr, "[ERROR] listener_stop: eventfd write failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+    }
+    pthread_join(l->thread, NULL);
+    l->thread_started = 0;
+}
+
+void listener_destroy(Listener *l)
+{
+    int i;
+
+    if (l == NULL) return;
+    listener_stop(l);
+    for (i = 0; i < LISTEN_MAX_CONNS; i++) {
+        if (l->conns[i].fd >= 0) close_conn(l, i);
+    }
+    if (l->listen_fd >= 0) {
+        close(l->listen_fd);
+        l->listen_fd = -1;
+        unlink(l->path);
+    }
+    if (l->epoll_fd >= 0) close(l->epoll_fd);
+    if (l->stop_fd >= 0) close(l->stop_fd);
+    l->epoll_fd = -1;
+    l->stop_fd = -1;
+}
+
+void listener_stats(const Listener *l, ListenStats *out)
+{
+    if (l == NULL || out == NULL) return;
+    *out = l->stats;
+}
+
+int listener_enqueued(const Listener *l)
+{
+    return (l != NULL) ? __atomic_load_n(&l->enqueued, __ATOMIC_RELAXED) : 0;
+}
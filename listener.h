@@ -0,0 +1,102 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * listener.h: Unix-Domain-Socket Ingestion Front-End
+ * * With --listen, no producer threads run: local clients (see loadgen.c)
+ * * connect to a Unix stream socket and send fixed-size frames, and a
+ * * single epoll thread turns them into batch enqueues. It does one
+ * * read() per ready connection and stores what that read returned
+ * * before reading again, so a full queue stops all reads and the
+ * * clients feel it as a full socket buffer (back-pressure).
+ */
+
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "config.h"
+#include "queue.h"
+#include "histogram.h"
+
+/* --- Data Structures --- */
+
+/* One request on the wire (native byte order: both ends are local) */
+typedef struct {
+    uint16_t magic;             // LISTEN_FRAME_MAGIC (anything else: stream out of sync)
+    uint8_t priority;           // PRIORITY_MIN..PRIORITY_MAX
+    uint8_t flags;              // Reserved, 0
+    int32_t data;
+} ListenFrame;
+
+/*
+ * Called after every batch enqueue with the messages stored (for the
+ * analytics, which this module does not know about).
+ */
+typedef void (*ListenerBatchFn)(const Message *msgs, int n, int was_blocked,
+                                long wait_ms, void *arg);
+
+typedef struct {
+    int fd;                     // -1 = free slot
+    unsigned char partial[sizeof(ListenFrame)]; // Frame split across reads
+    int partial_len;
+} ListenConn;
+
+typedef struct {
+    long long accepted;
+    long long closed;           // Client hung up (or was dropped)
+    long long refused;          // Over LISTEN_MAX_CONNS: closed at once
+    long long protocol_errors;  // Bad magic: connection dropped
+    long long frames;           // Turned into messages and enqueued
+    long long bad_frames;       // Priority out of range: skipped
+    long long abandoned;        // Read but not stored: the queue shut down first
+    long long reads;            // read() calls that returned data
+    long long wakeups;          // epoll_wait returns
+    long long pushbacks;        // Batches that waited for free slots
+    long long paused_us;        // Reading stopped for a full queue
+    int peak_conns;
+    Histogram batch_frames;     // Frames per read()
+} ListenStats;
+
+typedef struct {
+    char path[LISTEN_PATH_MAX];
+    int listen_fd;
+    int epoll_fd;
+    int stop_fd;                // eventfd: listener_stop wakes the loop
+    Queue *queue;
+    ListenerBatchFn on_batch;   // May be NULL
+    void *on_batch_arg;
+    ListenConn conns[LISTEN_MAX_CONNS];
+    int num_conns;
+    pthread_t thread;
+    int thread_started;
+    int enqueued;               // Messages stored (atomic: read by the report)
+    ListenStats stats;          // Owned by the listener thread; read after listener_stop
+} Listener;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Binds and listens on 'path' (an existing socket file is replaced),
+ * then starts the epoll thread. Messages go to 'q'; 'on_batch' (may be
+ * NULL) runs in the listener thread after each batch enqueue.
+ * Returns: 0 on success, -1 on invalid input, socket or thread failure.
+ */
+int listener_init(Listener *l, const char *path, Queue *q,
+                  ListenerBatchFn on_batch, void *on_batch_arg);
+
+/* Wakes the loop through stop_fd and joins it (the queue should be shut down first). */
+void listener_stop(Listener *l);
+
+/* Closes every connection and the socket, and removes the socket file. */
+void listener_destroy(Listener *l);
+
+/* Copies the counters (call after listener_stop). */
+void listener_stats(const Listener *l, ListenStats *out);
+
+/* Messages the listener has enqueued so far. */
+int listener_enqueued(const Listener *l);
+
+#endif /* LISTENER_H */
@@ -0,0 +1,281 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * loadgen.c: Socket Load Generator for --listen
+ * * Usage: loadgen [-b frames_per_write] [-n frames_per_conn]
+ * *                <socket> <connections> <seconds>
+ * * Opens <connections> non-blocking connections to the model's socket
+ * * and keeps all of them writing from one epoll loop until <seconds>
+ * * pass (or every connection sent its -n frames). A send() that
+ * * returns EAGAIN means the socket buffer is full: the model is not
+ * * reading, i.e. it is pushing back. Reports frames/s, MB/s and how
+ * * often that happened.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. Bad arguments              — usage message, exit 1
+ *   2. Socket not there yet       — connect retried for LOADGEN_CONNECT_MS
+ *   3. Server closes a connection — EPIPE/ECONNRESET: that connection
+ *                                   stops, the others carry on (MSG_NOSIGNAL,
+ *                                   so no SIGPIPE)
+ *   4. Partial writes             — the unsent tail goes first next time,
+ *                                   so frames are never split or lost
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#include "config.h"
+#include "listener.h"
+
+#define LOADGEN_MAX_BATCH       1024    // -b upper bound (frames per send)
+#define LOADGEN_DEFAULT_BATCH   16
+#define LOADGEN_CONNECT_MS      3000    // Wait this long for the model to listen
+#define LOADGEN_MAX_SECONDS     3600
+
+/* --- Data Structures --- */
+
+typedef struct {
+    int fd;                     // -1 = finished
+    long long sent;             // Whole frames handed to the kernel
+    size_t pending_off;         // Bytes of the current batch already sent (partial write)
+    int pending_frames;         // Frames in the current batch (0 = build a new one)
+    long long eagain;
+} Conn;
+
+static Conn conns[LISTEN_MAX_CONNS];
+static ListenFrame batch[LOADGEN_MAX_BATCH];
+
+/* --- Internal Helpers --- */
+
+static long long now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int parse_count(const char *s, int min, int max, int *out)
+{
+    char *end;
+    long v;
+
+    errno = 0;
+    v = strtol(s, &end, 10);
+    if (errno != 0 || end == s || *end != '\0' || v < min || v > max) return -1;
+    *out = (int)v;
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-b frames_per_write] [-n frames_per_conn] "
+            "<socket> <connections> <seconds>\n", prog);
+    fprintf(stderr, "  -b <n>  Frames per send() [1 to %d] (default: %d)\n",
+            LOADGEN_MAX_BATCH, LOADGEN_DEFAULT_BATCH);
+    fprintf(stderr, "  -n <n>  Stop each connection after <n> frames (default: until <seconds>)\n");
+    fprintf(stderr, "  connections: 1 to %d, seconds: 1 to %d\n", LISTEN_MAX_CONNS,
+            LOADGEN_MAX_SECONDS);
+}
+
+/* Blocking connect, retried while the socket does not exist yet. */
+static int connect_to(const char *path)
+{
+    struct sockaddr_un addr;
+    long long give_up = now_us() + LOADGEN_CONNECT_MS * 1000LL;
+    struct timespec pause = {0, 10 * 1000000L};
+    int fd, flags;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    for (;;) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            fprintf(stderr, "[ERROR] loadgen: socket failed (errno=%d: %s)\n",
+                    errno, strerror(errno));
+            return -1;
+        }
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) break;
+        close(fd);
+        if ((errno != ENOENT && errno != ECONNREFUSED && errno != EAGAIN) || now_us() > give_up) {
+            fprintf(stderr, "[ERROR] loadgen: connect to %s failed (errno=%d: %s)\n",
+                    path, errno, strerror(errno));
+            return -1;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Sends until the connection would block, finishes or fails.
+ * Returns: 1 while it is still open, 0 once it is finished.
+ */
+static int pump(Conn *c, int slot, int batch_frames, long long limit, long long *closed_by_server)
+{
+    ssize_t n;
+    size_t bytes;
+    int i, frames;
+
+    for (;;) {
+        if (c->pending_frames == 0) {
+            frames = batch_frames;
+            if (limit > 0 && limit - c->sent < frames) frames = (int)(limit - c->sent);
+            if (frames == 0) return 0;
+            c->pending_frames = frames;
+            c->pending_off = 0;
+        }
+        frames = c->pending_frames;
+
+        /* Frame i of this batch is message number sent + i of this connection */
+        for (i = 0; i < frames; i++) {
+            batch[i].magic = LISTEN_FRAME_MAGIC;
+            batch[i].priority = (uint8_t)((slot + c->sent + i) % (PRIORITY_MAX + 1));
+            batch[i].flags = 0;
+            batch[i].data = (int32_t)((c->sent + i) % (DATA_RANGE_MAX + 1));
+        }
+        bytes = (size_t)frames * sizeof(ListenFrame);
+
+        n = send(c->fd, (const char *)batch + c->pending_off, bytes - c->pending_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                c->eagain++;
+                return 1;
+            }
+            (*closed_by_server)++;
+            return 0;
+        }
+        c->pending_off += (size_t)n;
+        if (c->pending_off < bytes) continue;
+        c->sent += frames;
+        c->pending_frames = 0;
+    }
+}
+
+/* --- Main --- */
+
+int main(int argc, char *argv[])
+{
+    const char *path;
+    int num_conns, seconds, batch_frames = LOADGEN_DEFAULT_BATCH, limit_arg = 0;
+    long long limit = 0, sent = 0, eagain = 0, closed_by_server = 0;
+    long long start, deadline, elapsed;
+    int arg_idx = 1, epfd, i, n, open_conns;
+    struct epoll_event ev, events[LISTEN_MAX_EVENTS];
+
+    while (arg_idx < argc && argv[arg_idx][0] == '-' && argv[arg_idx][1] != '\0') {
+        if (arg_idx + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[arg_idx], "-b") == 0) {
+            if (parse_count(argv[arg_idx + 1], 1, LOADGEN_MAX_BATCH, &batch_frames) != 0) {
+                fprintf(stderr, "Error: -b must be 1 to %d\n", LOADGEN_MAX_BATCH);
+                return 1;
+            }
+        } else if (strcmp(argv[arg_idx], "-n") == 0) {
+            if (parse_count(argv[arg_idx + 1], 1, 1000000000, &limit_arg) != 0) {
+                fprintf(stderr, "Error: -n must be a positive frame count\n");
+                return 1;
+            }
+            limit = limit_arg;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+        arg_idx += 2;
+    }
+    if (argc - arg_idx != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    path = argv[arg_idx];
+    if (strlen(path) >= LISTEN_PATH_MAX ||
+        parse_count(argv[arg_idx + 1], 1, LISTEN_MAX_CONNS, &num_conns) != 0 ||
+        parse_count(argv[arg_idx + 2], 1, LOADGEN_MAX_SECONDS, &seconds) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    epfd = epoll_create1(0);
+    if (epfd < 0) {
+        fprintf(stderr, "[ERROR] loadgen: epoll_create1 failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+    for (i = 0; i < num_conns; i++) {
+        memset(&conns[i], 0, sizeof(conns[i]));
+        conns[i].fd = connect_to(path);
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLOUT;
+        ev.data.u32 = (uint32_t)i;
+        if (conns[i].fd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, conns[i].fd, &ev) != 0) {
+            fprintf(stderr, "[ERROR] loadgen: connection %d failed\n", i + 1);
+            return 1;
+        }
+    }
+
+    /* Level-triggered EPOLLOUT: a connection is served whenever it has room */
+    open_conns = num_conns;
+    start = now_us();
+    deadline = start + seconds * 1000000LL;
+    while (open_conns > 0 && now_us() < deadline) {
+        n = epoll_wait(epfd, events, LISTEN_MAX_EVENTS,
+                       (int)((deadline - now_us()) / 1000) + 1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "[ERROR] loadgen: epoll_wait failed (errno=%d: %s)\n",
+                    errno, strerror(errno));
+            break;
+        }
+        for (i = 0; i < n; i++) {
+            Conn *c = &conns[events[i].data.u32];
+            if (c->fd < 0) continue;
+            if (!pump(c, (int)events[i].data.u32, batch_frames, limit, &closed_by_server)) {
+                epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+                close(c->fd);
+                c->fd = -1;
+                open_conns--;
+            }
+        }
+    }
+    elapsed = now_us() - start;
+
+    for (i = 0; i < num_conns; i++) {
+        sent += conns[i].sent;
+        eagain += conns[i].eagain;
+        if (conns[i].fd >= 0) close(conns[i].fd);
+    }
+    close(epfd);
+
+    printf("loadgen: sent %lld frames over %d connection%s in %.2f s "
+           "(%.0f frames/s, %.2f MB/s, %d frames per write)\n",
+           sent, num_conns, num_conns == 1 ? "" : "s", elapsed / 1e6,
+           elapsed > 0 ? sent * 1e6 / elapsed : 0.0,
+           elapsed > 0 ? (double)sent * sizeof(ListenFrame) / elapsed : 0.0, batch_frames);
+    printf("loadgen: pushback %lld full-buffer writes (EAGAIN), %lld connection%s closed by the server\n",
+           eagain, closed_by_server, closed_by_server == 1 ? "" : "s");
+    return 0;
+}
@@ -27,6 +27,8 @@
 #include <unistd.h>
 #include <signal.h>
 #include <time.h>
+#include <stdint.h>
+#include <sys/epoll.h>
 
 #include "config.h"
 #include "utils.h"
@@ -36,11 +38,33 @@
 #include "producer.h"
 #include "consumer.h"
 #include "tui.h"
+#include "bench.h"
+#include "timewheel.h"
+#include "sweeper.h"
+#include "lease.h"
+#include "spill.h"
+#include "monitor.h"
+#include "sink.h"
+#include "ingest.h"
+#include "listener.h"
+#include "rpc.h"
+#include "topic.h"
 
 /* --- Global State --- */
 
 static Queue shared_queue;
 static Analytics analytics;
+static StartGate start_gate;
+static TimingWheel timer_wheel;
+static Sweeper expiry_sweeper;
+static LeaseTable lease_table;
+static SpillStore spill_store;
+static Sink file_sink;
+static Ingest source_input;
+static Listener socket_listener;
+static RpcTable rpc_table;
+static Topic fanout_topic;
+static Monitor monitor;
 static RuntimeParams runtime_params;
 
 /* Lifecycle Flags
@@ -65,6 +89,16 @@ static int num_consumers_created = 0;
 /* Init Flags for Cleanup — track which resources need releasing */
 static int queue_initialized = 0;
 static int analytics_initialized = 0;
+static int start_gate_initialized = 0;
+static int timewheel_initialized = 0;
+static int lease_initialized = 0;
+static int spill_initialized = 0;
+static int sink_initialized = 0;
+static int ingest_initialized = 0;
+static int listener_initialized = 0;
+static int rpc_initialized = 0;
+static int topic_initialized = 0;
+static int monitor_initialized = 0;
 
 /* --- Local Prototypes --- */
 static int create_producers(int num_producers);
@@ -75,13 +109,19 @@ static void signal_handler(int signum);
 static void initiate_shutdown(void);
 static void finalize_shutdown(void);
 static void cleanup_resources(void);
+static void monitor_tick(long long tick, void *arg);
+static int on_source_drained(int fd, unsigned int events, void *arg);
+static void drain_after_source(void);
+static void on_listener_batch(const Message *msgs, int n, int was_blocked,
+                              long wait_ms, void *arg);
 
 /* --- Main Execution --- */
 
 int main(int argc, char *argv[])
 {
-    int elapsed = 0;
+    int i;
     char csv_filename[256];
+    long long spawn_start_us;
 
     /* 1. Initialisation */
     time_start();
@@ -118,6 +158,41 @@ int main(int argc, char *argv[])
     print_startup_info(&runtime_params);
     print_compiled_defaults();
 
+    /* Benchmark mode: each trial builds its own queue and threads,
+     * so none of the simulation state below is initialised */
+    if (runtime_params.saturate) {
+        if (bench_run_saturation(&runtime_params, &running) != 0) {
+            printf("\n[Execution Complete. Exit: FAILURE]\n\n");
+            return EXIT_FAILURE;
+        }
+        printf("\n[Execution Complete. Exit: SUCCESS]\n\n");
+        return EXIT_SUCCESS;
+    }
+    if (runtime_params.scale) {
+        if (bench_run_scaling(&runtime_params, &running) != 0) {
+            printf("\n[Execution Complete. Exit: FAILURE]\n\n");
+            return EXIT_FAILURE;
+        }
+        printf("\n[Execution Complete. Exit: SUCCESS]\n\n");
+        return EXIT_SUCCESS;
+    }
+    if (runtime_params.wakeup_rounds > 0) {
+        if (bench_run_wakeup(&runtime_params, &running) != 0) {
+            printf("\n[Execution Complete. Exit: FAILURE]\n\n");
+            return EXIT_FAILURE;
+        }
+        printf("\n[Execution Complete. Exit: SUCCESS]\n\n");
+        return EXIT_SUCCESS;
+    }
+    if (runtime_params.policy_bench) {
+        if (bench_run_policy(&runtime_params, &running) != 0) {
+            printf("\n[Execution Complete. Exit: FAILURE]\n\n");
+            return EXIT_FAILURE;
+        }
+        printf("\n[Execution Complete. Exit: SUCCESS]\n\n");
+        return EXIT_SUCCESS;
+    }
+
     /* 3. System Initialisation
      * Error handling: Each init function can fail (mutex/semaphore creation).
      * On failure, we clean up any already-initialised resources and exit. */
@@ -125,6 +200,14 @@ int main(int argc, char *argv[])
     printf("INITIALISATION\n");
     print_separator();
 
+    /* From here on SIGINT/SIGTERM are blocked in every thread and read
+     * by the monitor loop; a signal during start-up waits for it */
+    if (monitor_init(&monitor) != 0) {
+        fprintf(stderr, "[ERROR] Failed to set up the monitor event loop\n");
+        return EXIT_FAILURE;
+    }
+    monitor_initialized = 1;
+
     if (queue_init(&shared_queue, runtime_params.queue_size, runtime_params.aging_interval) != 0) {
         fprintf(stderr, "[ERROR] Failed to initialise queue\n");
         return EXIT_FAILURE;
@@ -132,6 +215,38 @@ int main(int argc, char *argv[])
     queue_initialized = 1;
     printf("  Queue initialized.\n");
 
+    if (runtime_params.policy != QUEUE_POLICY_PRIORITY) {
+        if (queue_set_policy(&shared_queue, (QueuePolicy)runtime_params.policy,
+                             runtime_params.mlfq_quantum_us) != 0) {
+            fprintf(stderr, "[ERROR] Failed to set the dequeue policy\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        printf("  Dequeue policy: %s.\n", queue_policy_name((QueuePolicy)runtime_params.policy));
+    }
+
+    if (runtime_params.credit_batch > 0) {
+        if (queue_enable_credits(&shared_queue) != 0) {
+            fprintf(stderr, "[ERROR] Failed to enable credit flow control\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        printf("  Credit flow control enabled (%d per grab).\n", runtime_params.credit_batch);
+    }
+
+    /* Reserved share rounds up, but one slot always stays shared */
+    if (runtime_params.reserve_pct > 0) {
+        int reserved = (runtime_params.queue_size * runtime_params.reserve_pct + 99) / 100;
+        if (reserved > runtime_params.queue_size - 1) reserved = runtime_params.queue_size - 1;
+        if (queue_set_reserve(&shared_queue, reserved) != 0) {
+            fprintf(stderr, "[ERROR] Failed to reserve queue capacity\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        printf("  Reserved %d of %d slots for priority >= %d.\n",
+               reserved, runtime_params.queue_size, RESERVED_PRIORITY_MIN);
+    }
+
     if (analytics_init(&analytics, &shared_queue,
                        runtime_params.num_producers, runtime_params.num_consumers) != 0) {
         fprintf(stderr, "[ERROR] Failed to initialise analytics\n");
@@ -139,31 +254,266 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
     analytics_initialized = 1;
+    analytics.perf_enabled = runtime_params.perf_enabled;
+    analytics.open_loop_rate = runtime_params.open_loop_rate;
+    analytics.batch_size = runtime_params.batch_size;
+    analytics.reserved_slots = shared_queue.reserved_slots;
+    analytics.credit_batch = runtime_params.credit_batch;
     printf("  Analytics initialized.\n");
 
+    /* Delayed delivery: the timer thread promotes due messages into the
+     * queue, so it must exist before any producer schedules one */
+    if (runtime_params.max_delay_ms > 0) {
+        if (timewheel_init(&timer_wheel, &shared_queue) != 0) {
+            fprintf(stderr, "[ERROR] Failed to initialise timing wheel\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        timewheel_initialized = 1;
+        if (timewheel_start(&timer_wheel) != 0) {
+            fprintf(stderr, "[ERROR] Failed to start timer thread\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        analytics.timewheel_ptr = &timer_wheel;
+        analytics.max_delay_ms = runtime_params.max_delay_ms;
+        printf("  Timing wheel started (%d levels x %d slots, %d us tick).\n",
+               TW_LEVELS, TW_SLOTS, TIMER_TICK_US);
+    }
+
+    /* Message TTL: consumers drop expired items at dequeue; the sweeper
+     * reclaims them even when no consumer comes */
+    if (runtime_params.ttl_ms > 0) {
+        queue_enable_expiry(&shared_queue);
+        analytics.ttl_ms = runtime_params.ttl_ms;
+        if (sweeper_start(&expiry_sweeper, &shared_queue) != 0) {
+            fprintf(stderr, "[WARN] Sweeper failed to start, expired items "
+                    "are only dropped at dequeue\n");
+            /* Non-fatal: dequeue still skips expired items */
+        } else {
+            printf("  Expiry sweeper started (TTL %d ms, %d items per pass).\n",
+                   runtime_params.ttl_ms, TTL_SWEEP_BATCH);
+        }
+    }
+
+    /* Selective receive: filtered consumers need the position indexes */
+    for (i = 0; i < runtime_params.num_consumers; i++) {
+        if (runtime_params.has_filter[i]) analytics.filtered_consumers++;
+    }
+    if (analytics.filtered_consumers > 0) {
+        queue_enable_filters(&shared_queue);
+        printf("  Selective receive indexes enabled (%d filtered consumer%s).\n",
+               analytics.filtered_consumers, analytics.filtered_consumers == 1 ? "" : "s");
+    }
+
+    /* Key coalescing: an update for a key that is still queued replaces it */
+    if (runtime_params.coalesce_keys > 0) {
+        queue_enable_coalescing(&shared_queue);
+        analytics.coalesce_keys = runtime_params.coalesce_keys;
+        printf("  Key coalescing enabled (%d keys, %d-bucket index).\n",
+               runtime_params.coalesce_keys, COALESCE_HASH_SIZE);
+    }
+
+    /* Partitioned delivery: consumers lease a partition per message */
+    if (runtime_params.partitions > 0) {
+        if (queue_enable_partitions(&shared_queue, runtime_params.partitions) != 0) {
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        analytics.partitions = runtime_params.partitions;
+        analytics.partition_by_key = (runtime_params.coalesce_keys > 0);
+        printf("  Partitioned delivery enabled (%d partitions, keyed by %s).\n",
+               runtime_params.partitions,
+               runtime_params.coalesce_keys > 0 ? "message key" : "producer");
+    }
+
+    /* Disk spill-over: a full ring overflows into an mmapped file */
+    if (runtime_params.spill_capacity > 0) {
+        if (spill_init(&spill_store, &shared_queue, runtime_params.spill_capacity) != 0) {
+            fprintf(stderr, "[ERROR] Failed to create spill file\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        spill_initialized = 1;
+        analytics.spill_ptr = &spill_store;
+        printf("  Spill file mapped (%d records, %lu KB, unlinked).\n",
+               runtime_params.spill_capacity,
+               (unsigned long)(spill_store.map_bytes / 1024));
+    }
+
+    /* Epoll readiness: the queue raises an eventfd consumers sleep on */
+    if (runtime_params.epoll_mode > 0) {
+        QueueReadyMode mode = (QueueReadyMode)(runtime_params.epoll_mode - 1);
+        if (queue_enable_ready_fd(&shared_queue, mode) < 0) {
+            fprintf(stderr, "[ERROR] Failed to create the readiness eventfd\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        analytics.epoll_mode = runtime_params.epoll_mode;
+        printf("  Readiness eventfd created (%s-triggered).\n",
+               mode == QUEUE_READY_EDGE ? "edge" : "level");
+    }
+
+    /* File sink: consumers append what they process, a writer thread
+     * commits the staging buffers in groups */
+    if (runtime_params.sink_path[0] != '\0') {
+        if (sink_init(&file_sink, runtime_params.sink_path,
+                      (SinkBackend)runtime_params.sink_backend, runtime_params.sink_sync) != 0) {
+            fprintf(stderr, "[ERROR] Failed to open the file sink\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        sink_initialized = 1;
+        analytics.sink_ptr = &file_sink;
+        printf("  File sink open (%s via %s, %d x %d KB buffers%s).\n",
+               runtime_params.sink_path, sink_backend_name(&file_sink), SINK_NUM_BUFFERS,
+               SINK_BUFFER_BYTES / 1024, runtime_params.sink_sync ? ", fdatasync per group" : "");
+    }
+
+    /* Ingestion source: producers parse input instead of generating;
+     * the monitor stops when the last of them reaches the end */
+    if (runtime_params.source_path[0] != '\0') {
+        if (ingest_open(&source_input, runtime_params.source_path,
+                        runtime_params.num_producers) != 0) {
+            fprintf(stderr, "[ERROR] Failed to open the ingestion source\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        ingest_initialized = 1;
+        analytics.ingest_ptr = &source_input;
+        if (monitor_watch(&monitor, ingest_done_fd(&source_input), EPOLLIN,
+                          on_source_drained, NULL) != 0) {
+            fprintf(stderr, "[ERROR] Failed to watch the ingestion source\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        if (source_input.mode == INGEST_MMAP) {
+            printf("  Source mapped (%s, %lu KB, %d line-aligned range%s).\n",
+                   strcmp(runtime_params.source_path, "-") == 0 ? "stdin" : runtime_params.source_path,
+                   (unsigned long)(source_input.map_bytes / 1024),
+                   runtime_params.num_producers, runtime_params.num_producers == 1 ? "" : "s");
+        } else {
+            printf("  Source streamed (%s, %d KB reads).\n",
+                   strcmp(runtime_params.source_path, "-") == 0 ? "stdin" : runtime_params.source_path,
+                   INGEST_READ_BYTES / 1024);
+        }
+    }
+
+    /* At-least-once delivery: consumers lease what they dequeue and the
+     * reaper redelivers leases that are not acked in time */
+    if (runtime_params.ack_timeout_ms > 0) {
+        int max_deliveries = runtime_params.max_deliveries > 0 ?
+                             runtime_params.max_deliveries : DEFAULT_MAX_DELIVERIES;
+        if (lease_init(&lease_table, &shared_queue, runtime_params.ack_timeout_ms,
+                       max_deliveries) != 0) {
+            fprintf(stderr, "[ERROR] Failed to initialise lease table\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        lease_initialized = 1;
+        if (lease_start(&lease_table) != 0) {
+            fprintf(stderr, "[ERROR] Failed to start lease reaper\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        analytics.lease_ptr = &lease_table;
+        analytics.ack_timeout_ms = runtime_params.ack_timeout_ms;
+        analytics.max_deliveries = max_deliveries;
+        analytics.fail_pct = runtime_params.fail_pct;
+        printf("  Lease reaper started (ack within %d ms, %d deliveries max).\n",
+               runtime_params.ack_timeout_ms, max_deliveries);
+    }
+
+    /* Request/response: one client (completion slots + reply queue)
+     * per producer; consumers answer each request they process */
+    if (runtime_params.rpc_outstanding > 0) {
+        if (rpc_init(&rpc_table, runtime_params.num_producers,
+                     runtime_params.rpc_outstanding) != 0) {
+            fprintf(stderr, "[ERROR] Failed to initialise the reply queues\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        rpc_initialized = 1;
+        analytics.rpc_ptr = &rpc_table;
+        printf("  Reply queues ready (%d client%s, %d completion slot%s each).\n",
+               runtime_params.num_producers, runtime_params.num_producers == 1 ? "" : "s",
+               runtime_params.rpc_outstanding, runtime_params.rpc_outstanding == 1 ? "" : "s");
+    }
+
+    /* Pub/sub: producers publish to one log as deep as the queue would
+     * be, and each consumer group reads all of it */
+    if (runtime_params.groups > 0) {
+        if (topic_init(&fanout_topic, runtime_params.queue_size, runtime_params.groups) != 0) {
+            fprintf(stderr, "[ERROR] Failed to initialise the topic log\n");
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        topic_initialized = 1;
+        analytics.topic_ptr = &fanout_topic;
+        printf("  Topic log ready (%d slots, %d subscriber group%s).\n",
+               runtime_params.queue_size, runtime_params.groups,
+               runtime_params.groups == 1 ? "" : "s");
+    }
+
+    if (start_gate_init(&start_gate) != 0) {
+        fprintf(stderr, "[ERROR] Failed to initialise start gate\n");
+        cleanup_resources();
+        return EXIT_FAILURE;
+    }
+    start_gate_initialized = 1;
+
     /* 4. Thread Spawning
+     * Every worker parks at the start gate; the gate opens once all of
+     * them are running, so measurement starts with the full thread set.
      * Error handling: If any thread fails to create, we shut down
-     * immediately and join whatever threads were already created.
+     * immediately, open the gate so the parked threads can see the stop
+     * flag, and join whatever threads were already created.
      * num_producers_created/num_consumers_created track exactly
      * how many threads need joining. */
     print_separator();
     printf("SIMULATION START\n");
     print_separator();
 
-    if (create_producers(runtime_params.num_producers) != 0 ||
+    /* With --listen, socket clients take the producers' place */
+    spawn_start_us = time_now_us();
+    if (create_producers(runtime_params.listen_path[0] != '\0' ? 0 :
+                         runtime_params.num_producers) != 0 ||
         create_consumers(runtime_params.num_consumers) != 0) {
         fprintf(stderr, "[ERROR] Thread creation failed\n");
         initiate_shutdown();
+        start_gate_open(&start_gate);
         finalize_shutdown();
         wait_for_threads();
         cleanup_resources();
         return EXIT_FAILURE;
     }
 
+    start_gate_wait_arrivals(&start_gate, num_producers_created + num_consumers_created);
+
     if (analytics_start_sampling(&analytics) != 0) {
         fprintf(stderr, "[WARN] Analytics sampling thread failed to start\n");
         /* Non-fatal: simulation can run without sampling */
     }
+    analytics_mark_start(&analytics, runtime_params.warmup_seconds);
+    analytics.spawn_phase_us = start_gate_open(&start_gate) - spawn_start_us;
+
+    /* Socket listener: opened once the consumers run, so the first
+     * client's frames are measured like any producer's */
+    if (runtime_params.listen_path[0] != '\0') {
+        if (listener_init(&socket_listener, runtime_params.listen_path, &shared_queue,
+                          on_listener_batch, &analytics) != 0) {
+            fprintf(stderr, "[ERROR] Failed to start the socket listener\n");
+            initiate_shutdown();
+            finalize_shutdown();
+            wait_for_threads();
+            cleanup_resources();
+            return EXIT_FAILURE;
+        }
+        listener_initialized = 1;
+        analytics.listener_ptr = &socket_listener;
+        printf("  Listening on %s (up to %d clients, %d frames per read).\n",
+               runtime_params.listen_path, LISTEN_MAX_CONNS, LISTEN_BATCH_FRAMES);
+    }
     printf("  All threads active. Running for %d seconds...\n", runtime_params.timeout_seconds);
 
     /* 5. Runtime Loop (Monitor) */
@@ -175,32 +525,17 @@ int main(int argc, char *argv[])
         print_separator();
     }
 
-    while (elapsed < runtime_params.timeout_seconds && running) {
-        if (runtime_params.tui_enabled) {
-            /* TUI MODE — refresh at 100ms intervals */
-            int remaining = runtime_params.timeout_seconds - (int)time_elapsed();
-            if (remaining < 0) remaining = 0;
-
-            tui_update(runtime_params.num_producers, runtime_params.num_consumers,
-                       producer_args, consumer_args, &shared_queue, remaining, &analytics);
-
-            struct timespec ts;
-            ts.tv_sec = 0;
-            ts.tv_nsec = 100000000L;
-            nanosleep(&ts, NULL);
-
-            /* Sync elapsed time from wall clock */
-            if ((int)time_elapsed() > elapsed) elapsed = (int)time_elapsed();
-
-        } else {
-            /* LOG MODE — update once per second */
-            sleep(1);
-            elapsed++;
-            if (elapsed % 10 == 0 && running) {
-                printf("[%06.2f] --- %d seconds remaining ---\n",
-                       time_elapsed(), runtime_params.timeout_seconds - elapsed);
-            }
-        }
+    /* Sleeps in epoll_wait: wakes for a signal, the deadline, and the
+     * tick (a dashboard frame, or a progress line every few seconds) */
+    if (runtime_params.tui_enabled) monitor_tick(0, NULL);
+    monitor_run(&monitor, (long long)runtime_params.timeout_seconds * 1000,
+                runtime_params.tui_enabled ? MONITOR_TUI_FRAME_MS : MONITOR_LOG_INTERVAL_S * 1000LL,
+                monitor_tick, NULL, &running);
+    if (monitor.reason == MONITOR_STOP_SIGNAL && !runtime_params.tui_enabled) {
+        printf("\n[SIGNAL] Shutting down...\n");
+    }
+    if (monitor.reason == MONITOR_STOP_HANDLER && ingest_initialized) {
+        drain_after_source();
     }
 
     if (runtime_params.tui_enabled) {
@@ -214,6 +549,12 @@ int main(int argc, char *argv[])
         print_separator();
     }
 
+    if (!runtime_params.tui_enabled) {
+        printf("  Monitor: stopped by %s after %.2f s, %lld wake-up%s (%lld tick%s)\n",
+               monitor_stop_name(&monitor), monitor.run_us / 1e6, monitor.wakeups,
+               monitor.wakeups == 1 ? "" : "s", monitor.ticks, monitor.ticks == 1 ? "" : "s");
+    }
+
     if (!shutdown_in_progress) {
         initiate_shutdown();
         DBG(DBG_INFO, "%s", "Shutdown initiated: Timeout");
@@ -226,6 +567,10 @@ int main(int argc, char *argv[])
 
     if (!runtime_params.tui_enabled) printf("  Waiting for threads to finish...\n");
     wait_for_threads();
+    /* The queue is shut down: a blocked listener has returned */
+    if (listener_initialized) listener_stop(&socket_listener);
+    /* Consumers are joined: nothing more can be appended */
+    if (sink_initialized) sink_stop(&file_sink);
     if (!runtime_params.tui_enabled) {
         printf("  All threads joined.\n");
         printf("  All thread resources destroyed.\n");
@@ -238,8 +583,21 @@ int main(int argc, char *argv[])
     printf("THREAD SUMMARY\n");
     print_separator();
 
-    print_thread_summary(num_producers_created, num_consumers_created,
-                         producer_args, consumer_args, &shared_queue);
+    {
+        BalanceExtras extras;
+        extras.delayed = timewheel_initialized ? timewheel_pending(&timer_wheel) : 0;
+        extras.in_flight = lease_initialized ? lease_in_flight(&lease_table) : 0;
+        extras.dead_lettered = lease_initialized ? lease_dead_total(&lease_table) : 0;
+        extras.spilled = queue_spill_pending(&shared_queue);
+        extras.listened = listener_initialized ? listener_enqueued(&socket_listener) : 0;
+        extras.groups = topic_initialized ? fanout_topic.num_groups : 0;
+        extras.group_lag = 0;
+        for (i = 0; topic_initialized && i < fanout_topic.num_groups; i++) {
+            extras.group_lag += topic_lag(&fanout_topic, i);
+        }
+        print_thread_summary(num_producers_created, num_consumers_created,
+                             producer_args, consumer_args, &shared_queue, &extras);
+    }
 
     print_separator();
     printf("ANALYTICS REPORT\n");
@@ -281,7 +639,21 @@ static int create_producers(int num_producers)
         producer_args[i].quiet_mode = runtime_params.tui_enabled;
         producer_args[i].max_wait = runtime_params.max_producer_wait;
         producer_args[i].analytics = &analytics;
+        producer_args[i].perf_enabled = runtime_params.perf_enabled;
+        producer_args[i].start_gate = &start_gate;
+        producer_args[i].open_loop_rate = runtime_params.open_loop_rate;
+        producer_args[i].credit_batch = runtime_params.credit_batch;
+        if (timewheel_initialized) {
+            producer_args[i].timewheel = &timer_wheel;
+            producer_args[i].max_delay_ms = runtime_params.max_delay_ms;
+        }
+        producer_args[i].ttl_ms = runtime_params.ttl_ms;
+        producer_args[i].coalesce_keys = runtime_params.coalesce_keys;
+        if (ingest_initialized) producer_args[i].ingest = &source_input;
+        if (rpc_initialized) producer_args[i].rpc = &rpc_table;
+        if (topic_initialized) producer_args[i].topic = &fanout_topic;
 
+        producer_args[i].spawn_us = time_now_us();
         if (pthread_create(&producer_threads[i], NULL, producer_thread, &producer_args[i]) != 0) {
             fprintf(stderr, "[ERROR] Producer %d: pthread_create failed\n", i + 1);
             return -1;
@@ -307,7 +679,27 @@ static int create_consumers(int num_consumers)
         consumer_args[i].quiet_mode = runtime_params.tui_enabled;
         consumer_args[i].max_wait = runtime_params.max_consumer_wait;
         consumer_args[i].analytics = &analytics;
+        consumer_args[i].perf_enabled = runtime_params.perf_enabled;
+        consumer_args[i].start_gate = &start_gate;
+        consumer_args[i].batch_size = runtime_params.batch_size;
+        consumer_args[i].partitioned = (runtime_params.partitions > 0);
+        consumer_args[i].use_epoll = (runtime_params.epoll_mode > 0);
+        if (sink_initialized) consumer_args[i].sink = &file_sink;
+        if (rpc_initialized) consumer_args[i].rpc = &rpc_table;
+        if (topic_initialized) {
+            consumer_args[i].topic = &fanout_topic;
+            consumer_args[i].group = i % fanout_topic.num_groups;
+            topic_subscribe(&fanout_topic, consumer_args[i].group);
+        }
+        if (runtime_params.has_filter[i]) {
+            consumer_args[i].filter = &runtime_params.consumer_filter[i];
+        }
+        if (lease_initialized) {
+            consumer_args[i].leases = &lease_table;
+            consumer_args[i].fail_pct = runtime_params.fail_pct;
+        }
 
+        consumer_args[i].spawn_us = time_now_us();
         if (pthread_create(&consumer_threads[i], NULL, consumer_thread, &consumer_args[i]) != 0) {
             fprintf(stderr, "[ERROR] Consumer %d: pthread_create failed\n", i + 1);
             return -1;
@@ -385,6 +777,8 @@ static void setup_signal_handlers(void)
  * The handler only sets flags and wakes blocked threads via sem_post.
  * The main thread detects the flags and performs the actual cleanup
  * (thread joining, analytics stop) after the main loop exits.
+ * It only runs in benchmark mode and before monitor_init: after that
+ * both signals are blocked and arrive through the monitor's signalfd.
  *
  * Error handling: write() can fail (broken pipe, etc). We cast the
  * return to void since there's nothing we can do about it in a
@@ -398,8 +792,9 @@ static void signal_handler(int signum)
         running = 0;
 
         /* Wake all blocked threads so they can see the stop flag.
-         * queue_shutdown only sets a flag and calls sem_post,
-         * both of which are async-signal-safe. */
+         * queue_shutdown only sets a flag, calls sem_post and writes
+         * the eventfd, all async-signal-safe; it takes no mutex (the
+         * condition-variable waiters poll the flag instead). */
         if (queue_initialized) queue_shutdown(&shared_queue);
 
         if (!runtime_params.tui_enabled) {
@@ -412,6 +807,65 @@ static void signal_handler(int signum)
     }
 }
 
+/*
+ * Monitor tick: one dashboard frame in TUI mode, otherwise a progress
+ * line every MONITOR_LOG_INTERVAL_S seconds (none at the deadline).
+ */
+static void monitor_tick(long long tick, void *arg)
+{
+    int remaining;
+
+    (void)arg;
+    if (runtime_params.tui_enabled) {
+        remaining = runtime_params.timeout_seconds - (int)time_elapsed();
+        if (remaining < 0) remaining = 0;
+        tui_update(runtime_params.num_producers, runtime_params.num_consumers,
+                   producer_args, consumer_args, &shared_queue, remaining, &analytics);
+        return;
+    }
+
+    remaining = runtime_params.timeout_seconds - (int)(tick * MONITOR_LOG_INTERVAL_S);
+    if (remaining > 0 && running) {
+        printf("[%06.2f] --- %d seconds remaining ---\n", time_elapsed(), remaining);
+    }
+}
+
+/*
+ * Monitor handler for the source's eventfd: every producer reached the
+ * end of its input. Returns: 1 (stop the loop).
+ */
+static int on_source_drained(int fd, unsigned int events, void *arg)
+{
+    uint64_t count;
+
+    (void)events;
+    (void)arg;
+    if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) {
+        fprintf(stderr, "[WARN] Source eventfd read failed\n");
+    }
+    return 1;
+}
+
+/*
+ * After the end of input: lets the consumers empty the queue before
+ * the shutdown, so the run ends when the last message is processed.
+ * Bounded by what is left of the run timeout.
+ */
+static void drain_after_source(void)
+{
+    long long left_us = (long long)runtime_params.timeout_seconds * 1000000LL - monitor.run_us;
+
+    if (!runtime_params.tui_enabled) {
+        printf("[%06.2f] [SOURCE] End of input: draining %d queued message%s...\n",
+               time_elapsed(), queue_get_count(&shared_queue),
+               queue_get_count(&shared_queue) == 1 ? "" : "s");
+    }
+    while (queue_get_count(&shared_queue) > 0 && left_us > 0 && running) {
+        sleep_us(INGEST_DRAIN_POLL_US);
+        left_us -= INGEST_DRAIN_POLL_US;
+    }
+}
+
 /*
  * Initiates system shutdown from the main thread.
  *
@@ -445,10 +899,40 @@ static void initiate_shutdown(void)
  */
 static void finalize_shutdown(void)
 {
+    /* Wake producers parked on a full timer pool, then join the timer.
+     * Messages it had not promoted stay counted as delayed. */
+    if (timewheel_initialized) {
+        timewheel_shutdown(&timer_wheel);
+        timewheel_stop(&timer_wheel);
+    }
+
+    /* Clients waiting for a reply that will not come */
+    if (rpc_initialized) rpc_shutdown(&rpc_table);
+
+    /* Publishers held up by the slowest group, and groups with nothing to read */
+    if (topic_initialized) topic_shutdown(&fanout_topic);
+
+    /* No-op unless --ttl started it */
+    sweeper_stop(&expiry_sweeper);
+
+    /* Consumers settle their own leases on the way out; anything the
+     * reaper has not expired by now stays counted as in flight */
+    if (lease_initialized) lease_stop(&lease_table);
+
     /* Stop the background sampling thread (calls pthread_join internally) */
     if (analytics_initialized) analytics_stop_sampling(&analytics);
 }
 
+/*
+ * Listener batch hook: socket messages count as produced, like a
+ * producer thread's batch enqueue. Runs in the listener thread.
+ */
+static void on_listener_batch(const Message *msgs, int n, int was_blocked,
+                              long wait_ms, void *arg)
+{
+    analytics_record_produce_batch((Analytics *)arg, msgs, n, was_blocked, wait_ms);
+}
+
 /*
  * Releases all allocated resources.
  *
@@ -469,6 +953,58 @@ static void cleanup_resources(void)
         }
     }
 
+    if (start_gate_initialized) start_gate_destroy(&start_gate);
+
+    if (timewheel_initialized) {
+        /* Joins the timer thread if an init failure skipped finalize */
+        timewheel_shutdown(&timer_wheel);
+        timewheel_stop(&timer_wheel);
+        timewheel_destroy(&timer_wheel);
+    }
+
+    if (lease_initialized) {
+        lease_stop(&lease_table);
+        lease_destroy(&lease_table);
+    }
+
+    if (spill_initialized) {
+        spill_destroy(&spill_store);
+        spill_initialized = 0;
+    }
+
+    if (sink_initialized) {
+        /* Joins the writer if an init failure skipped the shutdown path */
+        sink_stop(&file_sink);
+        sink_destroy(&file_sink);
+        sink_initialized = 0;
+    }
+
+    if (ingest_initialized) {
+        ingest_close(&source_input);
+        ingest_initialized = 0;
+    }
+
+    if (listener_initialized) {
+        /* Joins the thread if an init failure skipped the shutdown path */
+        listener_destroy(&socket_listener);
+        listener_initialized = 0;
+    }
+
+    if (rpc_initialized) {
+        rpc_destroy(&rpc_table);
+        rpc_initialized = 0;
+    }
+
+    if (topic_initialized) {
+        topic_destroy(&fanout_topic);
+        topic_initialized = 0;
+    }
+
+    if (monitor_initialized) {
+        monitor_destroy(&monitor);
+        monitor_initialized = 0;
+    }
+
     if (queue_initialized) {
         if (queue_destroy(&shared_queue) != 0) {
             fprintf(stderr, "[WARN] queue_destroy reported errors\n");
@@ -0,0 +1,270 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * monitor.c: Main-Thread Event Loop Implementation
+ * * One epoll set holds the signalfd, the deadline and tick timerfds
+ * * and any watched sockets; the epoll data word tags which one is
+ * * ready. All events of one wake-up are handled before the loop
+ * * decides to stop, ticks first, so a frame or log line due at the
+ * * same moment as the deadline is not lost.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer arguments         — checked, return -1
+ *   2. epoll/signalfd/timerfd failure — reported with errno, descriptors
+ *                                       already opened are closed and the
+ *                                       signal mask is restored
+ *   3. EINTR from epoll_wait          — retried (stray signals such as
+ *                                       SIGWINCH from the terminal)
+ *   4. Short or failed fd reads       — treated as "nothing ready"; a
+ *                                       hard epoll failure stops the loop
+ *                                       with MONITOR_STOP_ERROR
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "monitor.h"
+#include "utils.h"
+
+/* epoll data tags; watched sources use MON_TAG_SOURCE + index */
+#define MON_TAG_SIGNAL      0u
+#define MON_TAG_DEADLINE    1u
+#define MON_TAG_TICK        2u
+#define MON_TAG_SOURCE      3u
+
+#define MON_MAX_EVENTS      (MONITOR_MAX_SOURCES + 3)
+
+/* --- Internal Helpers --- */
+
+static void stop_signals(sigset_t *set)
+{
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+}
+
+static int add_fd(Monitor *m, int fd, unsigned int events, unsigned int tag)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u32 = tag;
+    if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        fprintf(stderr, "[ERROR] monitor: epoll_ctl(ADD fd %d) failed (errno=%d: %s)\n",
+                fd, errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Creates a timerfd firing after 'first_ms', then every 'period_ms' (0 = once) */
+static int arm_timer(Monitor *m, long long first_ms, long long period_ms, unsigned int tag)
+{
+    struct itimerspec its;
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (fd < 0) {
+        fprintf(stderr, "[ERROR] monitor: timerfd_create failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        return -1;
+    }
+    /* A zero it_value disarms the timer: fire at the earliest instead */
+    if (first_ms <= 0) first_ms = 0;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = first_ms / 1000;
+    its.it_value.tv_nsec = (first_ms % 1000) * 1000000L;
+    if (first_ms == 0) its.it_value.tv_nsec = 1;
+    its.it_interval.tv_sec = period_ms / 1000;
+    its.it_interval.tv_nsec = (period_ms % 1000) * 1000000L;
+
+    if (timerfd_settime(fd, 0, &its, NULL) != 0) {
+        fprintf(stderr, "[ERROR] monitor: timerfd_settime failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (add_fd(m, fd, EPOLLIN, tag) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Expirations since the last read (0 if none / spurious) */
+static long long read_timer(int fd)
+{
+    uint64_t expirations;
+
+    if (read(fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) return 0;
+    return (long long)expirations;
+}
+
+/* --- Public API --- */
+
+int monitor_init(Monitor *m)
+{
+    sigset_t set;
+
+    if (m == NULL) return -1;
+
+    memset(m, 0, sizeof(*m));
+    m->epoll_fd = -1;
+    m->signal_fd = -1;
+    m->deadline_fd = -1;
+    m->tick_fd = -1;
+
+    stop_signals(&set);
+    if (pthread_sigmask(SIG_BLOCK, &set, NULL) != 0) {
+        fprintf(stderr, "[ERROR] monitor: pthread_sigmask failed\n");
+        return -1;
+    }
+
+    m->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m->epoll_fd < 0) {
+        fprintf(stderr, "[ERROR] monitor: epoll_create1 failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+        return -1;
+    }
+    m->signal_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (m->signal_fd < 0 || add_fd(m, m->signal_fd, EPOLLIN, MON_TAG_SIGNAL) != 0) {
+        fprintf(stderr, "[ERROR] monitor: signalfd setup failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        monitor_destroy(m);
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+        return -1;
+    }
+    return 0;
+}
+
+int monitor_watch(Monitor *m, int fd, unsigned int events, MonitorHandler handler, void *arg)
+{
+    if (m == NULL || fd < 0 || handler == NULL) return -1;
+    if (m->num_sources >= MONITOR_MAX_SOURCES) {
+        fprintf(stderr, "[ERROR] monitor: more than %d watched descriptors\n",
+                MONITOR_MAX_SOURCES);
+        return -1;
+    }
+    if (add_fd(m, fd, events, MON_TAG_SOURCE + (unsigned int)m->num_sources) != 0) return -1;
+
+    m->sources[m->num_sources].fd = fd;
+    m->sources[m->num_sources].handler = handler;
+    m->sources[m->num_sources].arg = arg;
+    m->num_sources++;
+    return 0;
+}
+
+MonitorStop monitor_run(Monitor *m, long long timeout_ms, long long tick_ms,
+                        MonitorTick on_tick, void *arg, volatile sig_atomic_t *running)
+{
+    struct epoll_event events[MON_MAX_EVENTS];
+    long long start_us;
+    int n, i;
+
+    if (m == NULL || m->epoll_fd < 0) return MONITOR_STOP_ERROR;
+
+    start_us = time_now_us();
+    m->reason = MONITOR_RUNNING;
+    m->deadline_fd = arm_timer(m, timeout_ms, 0, MON_TAG_DEADLINE);
+    if (m->deadline_fd < 0) return MONITOR_STOP_ERROR;
+    if (tick_ms > 0) {
+        m->tick_fd = arm_timer(m, tick_ms, tick_ms, MON_TAG_TICK);
+        if (m->tick_fd < 0) return MONITOR_STOP_ERROR;
+    }
+
+    while (m->reason == MONITOR_RUNNING) {
+        int deadline = 0, signo = 0, stop_source = 0;
+
+        if (running != NULL && !*running) {
+            m->reason = MONITOR_STOP_FLAG;
+            break;
+        }
+
+        n = epoll_wait(m->epoll_fd, events, MON_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "[ERROR] monitor: epoll_wait failed (errno=%d: %s)\n",
+                    errno, strerror(errno));
+            m->reason = MONITOR_STOP_ERROR;
+            break;
+        }
+        m->wakeups++;
+
+        for (i = 0; i < n; i++) {
+            unsigned int tag = events[i].data.u32;
+
+            if (tag == MON_TAG_TICK) {
+                long long fired = read_timer(m->tick_fd);
+                if (fired > 0) {
+                    m->ticks += fired;
+                    if (on_tick != NULL) on_tick(m->ticks, arg);
+                }
+            } else if (tag == MON_TAG_DEADLINE) {
+                deadline = (read_timer(m->deadline_fd) > 0);
+            } else if (tag == MON_TAG_SIGNAL) {
+                struct signalfd_siginfo si;
+                if (read(m->signal_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+                    signo = (int)si.ssi_signo;
+                }
+            } else if (tag - MON_TAG_SOURCE < (unsigned int)m->num_sources) {
+                MonitorSource *src = &m->sources[tag - MON_TAG_SOURCE];
+                m->source_events++;
+                if (src->handler(src->fd, events[i].events, src->arg) != 0) stop_source = 1;
+            }
+        }
+
+        if (signo != 0) {
+            m->stop_signal = signo;
+            m->reason = MONITOR_STOP_SIGNAL;
+        } else if (stop_source) {
+            m->reason = MONITOR_STOP_HANDLER;
+        } else if (deadline) {
+            m->reason = MONITOR_STOP_DEADLINE;
+        }
+    }
+
+    m->run_us = time_now_us() - start_us;
+    DBG(DBG_INFO, "Monitor: stopped (%s) after %lld wake-ups", monitor_stop_name(m),
+        m->wakeups);
+    return m->reason;
+}
+
+const char *monitor_stop_name(const Monitor *m)
+{
+    if (m == NULL) return "unknown";
+    switch (m->reason) {
+    case MONITOR_RUNNING:       return "running";
+    case MONITOR_STOP_DEADLINE: return "deadline";
+    case MONITOR_STOP_SIGNAL:
+        return (m->stop_signal == SIGINT) ? "SIGINT" :
+               (m->stop_signal == SIGTERM) ? "SIGTERM" : "signal";
+    case MONITOR_STOP_HANDLER:  return "watched descriptor";
+    case MONITOR_STOP_FLAG:     return "stop flag";
+    case MONITOR_STOP_ERROR:    return "error";
+    }
+    return "unknown";
+}
+
+void monitor_destroy(Monitor *m)
+{
+    if (m == NULL) return;
+    if (m->tick_fd >= 0) close(m->tick_fd);
+    if (m->deadline_fd >= 0) close(m->deadline_fd);
+    if (m->signal_fd >= 0) close(m->signal_fd);
+    if (m->epoll_fd >= 0) close(m->epoll_fd);
+    m->tick_fd = m->deadline_fd = m->signal_fd = m->epoll_fd = -1;
+}
@@ -0,0 +1,93 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * monitor.h: Main-Thread Event Loop (epoll + signalfd + timerfd)
+ * * SIGINT/SIGTERM are blocked in every thread and read from a
+ * * signalfd, the run deadline and the periodic tick (TUI frame or log
+ * * line) are timerfds, and further descriptors (control or metrics
+ * * sockets) can be watched with their own handler. The main thread
+ * * sleeps in epoll_wait until one of them is ready.
+ */
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <signal.h>
+#include "config.h"
+
+/* --- Data Structures --- */
+
+typedef enum {
+    MONITOR_RUNNING = 0,
+    MONITOR_STOP_DEADLINE,       // Run timeout reached
+    MONITOR_STOP_SIGNAL,         // SIGINT/SIGTERM read from the signalfd
+    MONITOR_STOP_HANDLER,        // A watched descriptor's handler asked to stop
+    MONITOR_STOP_FLAG,           // The running flag was cleared elsewhere
+    MONITOR_STOP_ERROR           // epoll_wait or a descriptor read failed
+} MonitorStop;
+
+/*
+ * Called when a watched descriptor is ready ('events' = EPOLL* mask).
+ * Returns: 0 to keep running, non-zero to stop the loop.
+ */
+typedef int (*MonitorHandler)(int fd, unsigned int events, void *arg);
+
+/* Called on every tick; 'tick' counts from 1. */
+typedef void (*MonitorTick)(long long tick, void *arg);
+
+typedef struct {
+    int fd;
+    MonitorHandler handler;
+    void *arg;
+} MonitorSource;
+
+typedef struct {
+    int epoll_fd;
+    int signal_fd;
+    int deadline_fd;            // One-shot timerfd (-1 until monitor_run)
+    int tick_fd;                // Periodic timerfd (-1 = no tick)
+    MonitorSource sources[MONITOR_MAX_SOURCES];
+    int num_sources;
+    MonitorStop reason;
+    int stop_signal;            // Signal that stopped the loop (0 = none)
+    long long wakeups;          // epoll_wait returns
+    long long ticks;            // Tick expirations handled
+    long long source_events;    // Watched descriptor events
+    long long run_us;           // Loop start to stop
+} Monitor;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Blocks SIGINT and SIGTERM in the calling thread and creates the
+ * epoll instance and signalfd. Threads created afterwards inherit the
+ * mask, so call it before starting any of them: a signal is then only
+ * ever seen by the loop, never by a handler in a random thread.
+ * Returns: 0 on success, -1 on failure (signals unblocked again).
+ */
+int monitor_init(Monitor *m);
+
+/*
+ * Watches 'fd' for 'events' (EPOLLIN etc.); 'handler' runs in the
+ * loop's thread. Returns: 0 on success, -1 if full or epoll_ctl fails.
+ */
+int monitor_watch(Monitor *m, int fd, unsigned int events, MonitorHandler handler, void *arg);
+
+/*
+ * Runs until the deadline ('timeout_ms' from now), a signal, a handler
+ * asking to stop, or '*running' going to 0 (checked on each wake-up).
+ * 'on_tick' (may be NULL) runs every 'tick_ms' (0 = no tick).
+ * Returns: the reason the loop stopped.
+ */
+MonitorStop monitor_run(Monitor *m, long long timeout_ms, long long tick_ms,
+                        MonitorTick on_tick, void *arg, volatile sig_atomic_t *running);
+
+/* Human-readable stop reason ("deadline", "SIGINT", ...) */
+const char *monitor_stop_name(const Monitor *m);
+
+/* Closes the descriptors (signals stay blocked: late ones are ignored). */
+void monitor_destroy(Monitor *m);
+
+#endif /* MONITOR_H */
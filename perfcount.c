@@ -0,0 +1,195 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * perfcount.c: Hardware Performance Counter Implementation
+ * * Opens one perf_event per counter for the calling thread (pid=0, cpu=-1).
+ * * Used by producer/consumer threads when the --perf flag is given.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer arguments         — all public functions check inputs
+ *   2. perf_event_open EACCES/EPERM   — retried with exclude_kernel=1,
+ *                                       then the counter is left disabled
+ *   3. Missing PMU (ENOENT/EOPNOTSUPP)— counter left disabled, others kept
+ *   4. Short/failed read()            — counter reported as invalid
+ *   5. Multiplexed counters           — scaled by enabled/running time
+ */
+
+#define _GNU_SOURCE /* Required for syscall() */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfcount.h"
+#include "utils.h"
+
+/* --- Internal Helpers --- */
+
+/* Event table, indexed by PerfCounterId */
+static const struct {
+    const char *name;
+    unsigned int type;
+    unsigned long long config;
+} perf_events[PERF_NUM_COUNTERS] = {
+    { "cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-misses",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch-misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }
+};
+
+/*
+ * glibc provides no wrapper for perf_event_open.
+ * pid=0/cpu=-1 counts the calling thread on whichever CPU it runs.
+ */
+static int open_event(PerfCounterId id, int exclude_kernel)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_events[id].type;
+    attr.config = perf_events[id].config;
+    attr.disabled = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_kernel = exclude_kernel ? 1 : 0;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                        PERF_FLAG_FD_CLOEXEC);
+}
+
+/* --- Public API --- */
+
+/*
+ * Opens every counter for the calling thread.
+ *
+ * Error handling: A failed counter does not fail the whole set —
+ * a VM without a PMU still gets the software context-switch count.
+ * The first errno is kept so the report can explain why.
+ */
+int perf_counters_open(PerfCounters *pc)
+{
+    int i, fd;
+
+    if (pc == NULL) return 0;
+
+    pc->num_open = 0;
+    pc->open_errno = 0;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        fd = open_event((PerfCounterId)i, 0);
+        if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+            /* perf_event_paranoid >= 2 only allows user-space counting */
+            fd = open_event((PerfCounterId)i, 1);
+        }
+
+        if (fd < 0) {
+            if (pc->open_errno == 0) pc->open_errno = errno;
+            DBG(DBG_INFO, "perf: %s unavailable (errno=%d: %s)",
+                perf_events[i].name, errno, strerror(errno));
+        } else {
+            pc->num_open++;
+        }
+        pc->fds[i] = fd;
+    }
+
+    return pc->num_open;
+}
+
+void perf_counters_start(PerfCounters *pc)
+{
+    int i;
+    if (pc == NULL) return;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] < 0) continue;
+        ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters_stop(PerfCounters *pc)
+{
+    int i;
+    if (pc == NULL) return;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] >= 0) ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+}
+
+/*
+ * Reads all counters.
+ *
+ * Error handling: A short read or a counter that never got scheduled
+ * (time_running == 0) is reported as invalid rather than as zero,
+ * so the report never shows a misleading 0 cycles/msg.
+ */
+void perf_counters_read(const PerfCounters *pc, PerfSample *out)
+{
+    unsigned long long buf[3]; /* value, time_enabled, time_running */
+    int i;
+
+    if (out == NULL) return;
+    memset(out, 0, sizeof(*out));
+    if (pc == NULL) return;
+
+    out->open_errno = pc->open_errno;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] < 0) continue;
+        if (read(pc->fds[i], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) continue;
+        if (buf[2] == 0) continue;
+
+        if (buf[2] < buf[1]) {
+            /* Multiplexed: extrapolate to the full enabled time */
+            out->values[i] = (unsigned long long)
+                ((double)buf[0] * (double)buf[1] / (double)buf[2]);
+        } else {
+            out->values[i] = buf[0];
+        }
+        out->valid[i] = 1;
+    }
+}
+
+void perf_counters_close(PerfCounters *pc)
+{
+    int i;
+    if (pc == NULL) return;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] >= 0) close(pc->fds[i]);
+        pc->fds[i] = -1;
+    }
+    pc->num_open = 0;
+}
+
+const char *perf_counter_name(PerfCounterId id)
+{
+    if ((int)id < 0 || (int)id >= PERF_NUM_COUNTERS) return "unknown";
+    return perf_events[id].name;
+}
+
+int perf_paranoid_level(void)
+{
+    FILE *fp;
+    int level;
+
+    fp = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+    if (fp == NULL) return -100;
+
+    if (fscanf(fp, "%d", &level) != 1) level = -100;
+    fclose(fp);
+
+    return level;
+}
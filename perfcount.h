@@ -0,0 +1,86 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * perfcount.h: Hardware Performance Counter Declarations
+ * * Thin wrapper around Linux perf_event_open for per-thread counting.
+ * * Counters are optional: every function degrades to a no-op when the
+ * * kernel refuses access (unprivileged user, VM without a PMU, etc).
+ */
+
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+/* --- Constants --- */
+
+/*
+ * Events counted around each producer/consumer loop.
+ * Context switches is a software event, so it usually survives even
+ * when the hardware events are unavailable.
+ */
+typedef enum {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_CONTEXT_SWITCHES,
+    PERF_NUM_COUNTERS
+} PerfCounterId;
+
+/* --- Data Structures --- */
+
+/*
+ * One set of counters bound to the calling thread.
+ * fds[i] is -1 when that event could not be opened.
+ */
+typedef struct {
+    int fds[PERF_NUM_COUNTERS];
+    int num_open;               // How many events were opened successfully
+    int open_errno;             // errno of the first failed open (0 = none)
+} PerfCounters;
+
+/*
+ * Counter values read at the end of a loop.
+ * Values are scaled by time_enabled/time_running to correct for
+ * kernel multiplexing when more events are requested than the PMU has.
+ */
+typedef struct {
+    unsigned long long values[PERF_NUM_COUNTERS];
+    int valid[PERF_NUM_COUNTERS];
+    int open_errno;
+} PerfSample;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Opens all counters for the calling thread (disabled until start).
+ * Retries with exclude_kernel=1 when the kernel denies kernel-mode
+ * counting, which is the common perf_event_paranoid=2 case.
+ * Returns: number of counters opened (0 = perf unavailable).
+ */
+int perf_counters_open(PerfCounters *pc);
+
+/* Resets and enables / disables all open counters. */
+void perf_counters_start(PerfCounters *pc);
+void perf_counters_stop(PerfCounters *pc);
+
+/*
+ * Reads the current counter values into 'out'.
+ * Counters that were not opened are marked invalid.
+ */
+void perf_counters_read(const PerfCounters *pc, PerfSample *out);
+
+/* Closes all file descriptors. Safe to call on a failed open. */
+void perf_counters_close(PerfCounters *pc);
+
+/* Short display name of a counter (e.g. "cycles"). */
+const char *perf_counter_name(PerfCounterId id);
+
+/*
+ * Reads /proc/sys/kernel/perf_event_paranoid.
+ * Returns: the level, or -100 if the file is missing/unreadable.
+ */
+int perf_paranoid_level(void);
+
+#endif /* PERFCOUNT_H */
@@ -28,6 +28,139 @@
 #include "producer.h"
 #include "config.h"
 #include "utils.h"
+#include "perfcount.h"
+
+/* --- Internal Helpers --- */
+
+/*
+ * --source: parses messages from the input and stores them with batch
+ * enqueues until the input ends or the run stops. One parser call
+ * yields up to INGEST_PARSE_BATCH messages; they go in with as many
+ * batches as it takes (each one is limited by the free slots).
+ *
+ * Error handling: a read failure ends this producer's input (reported
+ * by the parser); a failed enqueue is treated like shutdown.
+ */
+static void ingest_loop(ProducerArgs *args, long long release_us)
+{
+    Message msgs[INGEST_PARSE_BATCH];
+    int reader = args->id - 1;
+    int n = 1, i, done, stored = 0;   /* n = 0 only at end of input */
+    int was_blocked;
+    long wait_time_ms;
+    long long t0;
+
+    while (*(args->running)) {
+        n = ingest_next_batch(args->ingest, reader, msgs, INGEST_PARSE_BATCH, args->id);
+        if (n <= 0) break;
+        if (args->ttl_ms > 0) {
+            for (i = 0; i < n; i++) msgs[i].expires_us = msgs[i].intended_us + args->ttl_ms * 1000LL;
+        }
+
+        for (done = 0; done < n && *(args->running); done += stored) {
+            t0 = time_now_us();
+            stored = queue_enqueue_batch_safe(args->queue, msgs + done, n - done,
+                                              &was_blocked, &wait_time_ms);
+            if (stored < 0) break;
+            ingest_note_enqueue(args->ingest, reader, time_now_us() - t0, was_blocked);
+
+            args->stats.messages_produced += stored;
+            if (was_blocked) {
+                args->stats.times_blocked++;
+                if (args->analytics) {
+                    analytics_record_producer_block(args->analytics);
+                    analytics_record_producer_wait(args->analytics, wait_time_ms);
+                }
+            }
+            if (args->analytics) {
+                if (release_us > 0 && args->stats.messages_produced == stored) {
+                    analytics_record_first_op(args->analytics, time_now_us() - release_us);
+                }
+                analytics_record_produce_batch(args->analytics, msgs + done, stored,
+                                               was_blocked, wait_time_ms);
+            }
+            if (!args->quiet_mode) {
+                printf("[%06.2f] Producer %d: Ingested %d message%s%s | Queue: %d/%d\n",
+                       time_elapsed(), args->id, stored, stored == 1 ? "" : "s",
+                       was_blocked ? " (blocked)" : "",
+                       queue_get_count(args->queue), queue_get_capacity(args->queue));
+            }
+        }
+        if (stored < 0) break;
+    }
+
+    if (n == 0 && !args->quiet_mode) {
+        printf("[%06.2f] Producer %d: End of input\n", time_elapsed(), args->id);
+    }
+    ingest_reader_done(args->ingest, reader);
+}
+
+/*
+ * --rpc: a closed-loop client. Sends requests until every completion
+ * slot is in use, then sleeps until a consumer's reply frees one; there
+ * is no think time, so the reply rate is the most this many
+ * outstanding requests can sustain.
+ *
+ * Error handling: a failed enqueue hands its slot back and is treated
+ * like shutdown; a failed wait means the run is over.
+ */
+static void rpc_loop(ProducerArgs *args, long long release_us)
+{
+    Message msg;
+    int slot, result, was_blocked;
+    long wait_time_ms;
+    long long rtt_us;
+
+    while (*(args->running)) {
+        /* Only this thread takes slots: a free one stays free until used */
+        while (*(args->running) &&
+               rpc_outstanding(args->rpc, args->id) < args->rpc->max_outstanding) {
+            msg = message_create(random_range(DATA_RANGE_MIN, DATA_RANGE_MAX),
+                                 random_range(PRIORITY_MIN, PRIORITY_MAX), args->id);
+            slot = rpc_begin(args->rpc, args->id, &msg);
+            if (slot < 0) break;
+
+            was_blocked = 0;
+            wait_time_ms = 0;
+            result = queue_enqueue_safe(args->queue, msg, &was_blocked, &wait_time_ms);
+            if (was_blocked) {
+                args->stats.times_blocked++;
+                if (args->analytics) {
+                    analytics_record_producer_block(args->analytics);
+                    analytics_record_producer_wait(args->analytics, wait_time_ms);
+                }
+            }
+            if (result != 0) {
+                rpc_cancel(args->rpc, args->id, slot);
+                return;
+            }
+
+            args->stats.messages_produced++;
+            if (args->analytics) {
+                if (release_us > 0 && args->stats.messages_produced == 1) {
+                    analytics_record_first_op(args->analytics, time_now_us() - release_us);
+                }
+                analytics_record_produce(args->analytics);
+                analytics_record_class_enqueue(args->analytics, msg.priority,
+                                               was_blocked, wait_time_ms);
+            }
+            if (!args->quiet_mode) {
+                printf("[%06.2f] Producer %d: Request %d (pri=%d, data=%d)%s | Queue: %d/%d\n",
+                       time_elapsed(), args->id, slot + 1, msg.priority, msg.data,
+                       was_blocked ? " (blocked)" : "",
+                       queue_get_count(args->queue), queue_get_capacity(args->queue));
+            }
+        }
+
+        if (rpc_wait(args->rpc, args->id, &rtt_us) != 0) break;
+        if (args->analytics) analytics_record_rpc(args->analytics, rtt_us);
+        if (!args->quiet_mode) {
+            printf("[%06.2f] Producer %d: Reply after %.3f ms | Outstanding: %d\n",
+                   time_elapsed(), args->id, rtt_us / 1000.0,
+                   rpc_outstanding(args->rpc, args->id));
+        }
+    }
+}
 
 /* --- Public API --- */
 
@@ -63,9 +196,22 @@ int producer_init_args(ProducerArgs *args, int id, Queue *queue, volatile sig_at
     args->quiet_mode = 0;
     args->max_wait = MAX_PRODUCER_WAIT;
     args->analytics = NULL;
+    args->perf_enabled = 0;
+    args->start_gate = NULL;
+    args->spawn_us = 0;
+    args->credit_batch = 0;
+    args->timewheel = NULL;
+    args->max_delay_ms = 0;
+    args->ttl_ms = 0;
+    args->coalesce_keys = 0;
+    args->ingest = NULL;
+    args->rpc = NULL;
+    args->topic = NULL;
+    args->open_loop_rate = 0;
 
     args->stats.messages_produced = 0;
     args->stats.times_blocked = 0;
+    args->stats.missed_slots = 0;
 
     return 0;
 }
@@ -92,6 +238,13 @@ void *producer_thread(void *arg)
     int result;
     int sleep_time;
     int was_blocked;
+    PerfCounters perf;
+    long long release_us = 0;
+    int first_op_done = 0;
+    long long schedule_start_us = 0;
+    long long arrivals = 0;
+    long long intended_us = 0;
+    int credits = 0;            /* Banked slot credits (--credits) */
 
     args = (ProducerArgs *)arg;
 
@@ -102,29 +255,124 @@ void *producer_thread(void *arg)
         return NULL;
     }
 
+    /* Park at the start gate until every worker exists, so threads
+     * created first do not get a head start on an idle system.
+     * Spawn latency = pthread_create call -> this thread running. */
+    if (args->start_gate != NULL) {
+        if (args->analytics) {
+            analytics_record_spawn(args->analytics, time_now_us() - args->spawn_us);
+        }
+        release_us = start_gate_arrive_and_wait(args->start_gate);
+    }
+
     if (!args->quiet_mode) {
         printf("[%06.2f] Producer %d: Started\n", time_elapsed(), args->id);
     }
 
     DBG(DBG_INFO, "Producer %d: Context Loaded", args->id);
 
+    /* Optional hardware counters around the whole loop (--perf).
+     * A failed open is not an error: the report explains it. */
+    if (args->perf_enabled) {
+        perf_counters_open(&perf);
+        perf_counters_start(&perf);
+    }
+
+    /* Open-loop schedule: arrival k is due at start + k/rate seconds.
+     * A random phase keeps producers from arriving in lock-step. */
+    if (args->open_loop_rate > 0) {
+        long long interval_us = 1000000LL / args->open_loop_rate;
+        schedule_start_us = time_now_us() +
+                            random_range(0, interval_us > 0 ? (int)interval_us : 0);
+    }
+
+    if (args->ingest != NULL) {
+        ingest_loop(args, release_us);
+    } else if (args->rpc != NULL) {
+        rpc_loop(args, release_us);
+    }
+
     /* Main Lifecycle Loop
-     * Continues until the main thread sets the global 'running' flag to 0. */
-    while (*(args->running)) {
+     * Continues until the main thread sets the global 'running' flag to 0
+     * (an ingesting or RPC producer has already done its work above). */
+    while (args->ingest == NULL && args->rpc == NULL && *(args->running)) {
+
+        /* Step 0 (open loop): wait for the next scheduled arrival.
+         * If we are already behind, send at once — the schedule does not
+         * slip when the queue blocks, which is what exposes backlog latency. */
+        if (args->open_loop_rate > 0) {
+            intended_us = schedule_start_us +
+                          (long long)((double)arrivals * 1000000.0 / args->open_loop_rate);
+            while (*(args->running)) {
+                long long remaining_us = intended_us - time_now_us();
+                if (remaining_us <= 0) break;
+                if (credits > 0 && remaining_us >= CREDIT_IDLE_RETURN_MS * 1000LL) {
+                    queue_credit_return(args->queue, credits);
+                    credits = 0;
+                }
+                sleep_us(remaining_us < 200000 ? remaining_us : 200000);
+            }
+            if (!*(args->running)) break;
+            arrivals++;
+
+            /* Started after the following arrival was already due */
+            if (time_now_us() - intended_us > 1000000LL / args->open_loop_rate) {
+                args->stats.missed_slots++;
+            }
+        }
 
         /* Step 1: Data Generation */
         data = random_range(DATA_RANGE_MIN, DATA_RANGE_MAX);
         priority = random_range(PRIORITY_MIN, PRIORITY_MAX);
         msg = message_create(data, priority, args->id);
+        if (args->open_loop_rate > 0) msg.intended_us = intended_us;
+        if (args->timewheel != NULL) {
+            /* Corrected latency counts from the scheduled delivery time */
+            msg.not_before_us = msg.intended_us +
+                                random_range(0, args->max_delay_ms) * 1000LL;
+            msg.intended_us = msg.not_before_us;
+        }
+        if (args->ttl_ms > 0) msg.expires_us = msg.intended_us + args->ttl_ms * 1000LL;
+        if (args->coalesce_keys > 0) msg.key = random_range(1, args->coalesce_keys);
 
         DBG(DBG_TRACE, "Producer %d: Generated data=%d, pri=%d", args->id, data, priority);
 
         /* Step 2: Enqueue (Blocking Operation)
          * was_blocked is set by queue_enqueue_safe using sem_trywait.
-         * This gives us accurate block detection without race conditions. */
+         * This gives us accurate block detection without race conditions.
+         * With --credits, the slot comes from the local bank, refilled
+         * with up to credit_batch credits in one atomic grab.
+         * With --delay, the message goes to the timing wheel and only
+         * takes a queue slot when the timer thread promotes it.
+         * With --groups, it is published once for all groups. */
         was_blocked = 0;
         long wait_time_ms = 0;
-        result = queue_enqueue_safe(args->queue, msg, &was_blocked, &wait_time_ms);
+        if (args->timewheel != NULL) {
+            result = timewheel_schedule(args->timewheel, msg, &was_blocked, &wait_time_ms);
+        } else if (args->topic != NULL) {
+            result = topic_publish(args->topic, msg, &was_blocked, &wait_time_ms);
+        } else if (args->credit_batch > 0) {
+            result = 0;
+            if (credits == 0) {
+                result = queue_credit_acquire(args->queue, args->credit_batch,
+                                              &was_blocked, &wait_time_ms);
+                credits = (result > 0) ? result : 0;
+                result = (result > 0) ? 0 : -1;
+            }
+            if (result == 0) {
+                int shared_blocked = 0;
+                long shared_wait_ms = 0;
+                credits--;
+                result = queue_enqueue_credit(args->queue, msg,
+                                              &shared_blocked, &shared_wait_ms);
+                if (shared_blocked) {
+                    was_blocked = 1;
+                    wait_time_ms += shared_wait_ms;
+                }
+            }
+        } else {
+            result = queue_enqueue_safe(args->queue, msg, &was_blocked, &wait_time_ms);
+        }
 
         /* Step 3: Record blocking if it occurred */
         if (was_blocked) {
@@ -136,8 +384,10 @@ void *producer_thread(void *arg)
                 analytics_record_producer_wait(args->analytics, wait_time_ms);
             }
             if (!args->quiet_mode) {
-                printf("[%06.2f] Producer %d: BLOCKED (queue was full)\n",
-                       time_elapsed(), args->id);
+                printf("[%06.2f] Producer %d: BLOCKED (%s was full)\n",
+                       time_elapsed(), args->id,
+                       args->timewheel != NULL ? "timer pool" :
+                       args->topic != NULL ? "topic log" : "queue");
             }
         }
 
@@ -158,23 +408,54 @@ void *producer_thread(void *arg)
 
         /* Step 4: Success Logging */
         args->stats.messages_produced++;
-        if (args->analytics) analytics_record_produce(args->analytics);
 
-        if (!args->quiet_mode) {
-            printf("[%06.2f] Producer %d: Wrote (pri=%d, data=%d) | Queue: %d/%d\n",
+        /* Warm-up latency: gate release -> first completed operation */
+        if (!first_op_done) {
+            first_op_done = 1;
+            if (args->analytics && release_us > 0) {
+                analytics_record_first_op(args->analytics, time_now_us() - release_us);
+            }
+        }
+        if (args->analytics) {
+            analytics_record_produce(args->analytics);
+            analytics_record_class_enqueue(args->analytics, msg.priority,
+                                           was_blocked, wait_time_ms);
+        }
+
+        if (!args->quiet_mode && args->timewheel != NULL) {
+            printf("[%06.2f] Producer %d: Scheduled (pri=%d, data=%d, +%lld ms) | Delayed: %d\n",
+                   time_elapsed(), args->id, priority, data,
+                   (msg.not_before_us - time_now_us()) / 1000,
+                   timewheel_pending(args->timewheel));
+        } else if (!args->quiet_mode && args->topic != NULL) {
+            printf("[%06.2f] Producer %d: Published (pri=%d, data=%d) | Retained: %d/%d\n",
+                   time_elapsed(), args->id, priority, data,
+                   topic_retained(args->topic), args->topic->capacity);
+        } else if (!args->quiet_mode) {
+            printf("[%06.2f] Producer %d: Wrote (pri=%d, data=%d) | Queue: %d/%d",
                    time_elapsed(), args->id,
                    priority, data,
                    queue_get_count(args->queue), queue_get_capacity(args->queue));
+            if (msg.key != 0) printf(" | Key %d", msg.key);
+            if (args->queue->spill != NULL) printf(" | Spilled: %d", queue_spill_pending(args->queue));
+            printf("\n");
         }
 
         /* Step 5: Simulated Processing Time
          * Responsive sleep: wake every second to check shutdown flag.
-         * This ensures threads exit promptly (within 1s) when stopped. */
-        if (*(args->running)) {
+         * This ensures threads exit promptly (within 1s) when stopped.
+         * Open-loop producers pace themselves in Step 0 instead. */
+        if (*(args->running) && args->open_loop_rate == 0) {
             sleep_time = random_range(0, args->max_wait);
 
             DBG(DBG_TRACE, "Producer %d: Sleeping for %d s", args->id, sleep_time);
 
+            /* Going idle: banked credits would only block other producers */
+            if (credits > 0 && sleep_time * 1000 >= CREDIT_IDLE_RETURN_MS) {
+                queue_credit_return(args->queue, credits);
+                credits = 0;
+            }
+
             {
                 int remaining_ms = sleep_time * 1000;
                 struct timespec ts;
@@ -188,6 +469,22 @@ void *producer_thread(void *arg)
         }
     }
 
+    /* Unused credits go back so the pool balances at shutdown */
+    if (credits > 0) queue_credit_return(args->queue, credits);
+
+    if (args->open_loop_rate > 0 && args->analytics) {
+        analytics_record_open_loop(args->analytics, arrivals,
+                                   args->stats.missed_slots);
+    }
+
+    if (args->perf_enabled) {
+        PerfSample sample;
+        perf_counters_stop(&perf);
+        perf_counters_read(&perf, &sample);
+        perf_counters_close(&perf);
+        if (args->analytics) analytics_record_perf(args->analytics, 0, &sample);
+    }
+
     /* Cleanup & Exit */
     if (!args->quiet_mode) {
         printf("[%06.2f] Producer %d: Stopped (produced %d, blocked %d)\n",
@@ -203,6 +500,10 @@ void producer_print_stats(const ProducerArgs *args)
 {
     if (args == NULL) return;
 
-    printf("    Producer %d: %d messages produced, %d times blocked\n",
+    printf("    Producer %d: %d messages produced, %d times blocked",
            args->id, args->stats.messages_produced, args->stats.times_blocked);
+    if (args->open_loop_rate > 0) {
+        printf(", %d missed slots", args->stats.missed_slots);
+    }
+    printf("\n");
 }
@@ -15,6 +15,11 @@
 #include <signal.h>
 #include "queue.h"
 #include "analytics.h"
+#include "timewheel.h"
+#include "ingest.h"
+#include "rpc.h"
+#include "topic.h"
+#include "utils.h"
 
 /* --- Data Structures --- */
 
@@ -25,6 +30,7 @@
 typedef struct {
     int messages_produced;      // Successful writes to queue
     int times_blocked;          // Count of times the thread had to wait for space
+    int missed_slots;           // Open loop: sends that started > 1 interval late
 } ProducerStats;
 
 /*
@@ -39,6 +45,18 @@ typedef struct {
     int quiet_mode;            // Flag for quiet mode (TUI integration)
     int max_wait;              // Max sleep between writes (seconds)
     Analytics *analytics;      // Pointer to shared analytics (may be NULL)
+    int perf_enabled;          // Count hardware events around the loop (--perf)
+    int open_loop_rate;        // Arrivals/sec on a fixed schedule (0 = closed loop)
+    StartGate *start_gate;     // Park here until all workers exist (may be NULL)
+    long long spawn_us;        // time_now_us() just before pthread_create
+    int credit_batch;          // Slot credits per grab (--credits, 0 = semaphore)
+    TimingWheel *timewheel;    // Delayed delivery (--delay, NULL = enqueue directly)
+    int max_delay_ms;          // Each message is due 0..max_delay_ms after creation
+    int ttl_ms;                // Dropped if not consumed this long after it is due (0 = never)
+    int coalesce_keys;         // Each message updates key 1..coalesce_keys (0 = unkeyed)
+    Ingest *ingest;            // --source: parse messages from input (NULL = generate)
+    RpcTable *rpc;             // --rpc: closed-loop client awaiting replies (NULL = fire-and-forget)
+    Topic *topic;              // --groups: publish to every subscriber group (NULL = queue)
 } ProducerArgs;
 
 /* --- Function Prototypes --- */
@@ -50,6 +68,18 @@ typedef struct {
  * 2. Write to Queue (Blocks if full).
  * 3. Log activity.
  * 4. Sleep random interval (0..MAX_PRODUCER_WAIT).
+ * In open-loop mode step 4 is replaced by waiting for the next scheduled
+ * arrival; arrivals that fell behind are sent immediately, never skipped.
+ * With --delay, step 2 hands the message to the timing wheel instead; the
+ * timer thread moves it into the queue once its not_before time passes.
+ * With --coalesce, step 2 may fold the message into a queued one with
+ * the same key instead of storing it.
+ * With --source, steps 1-4 become: parse a block of input lines, store
+ * them with batch enqueues; the thread ends at the end of its input.
+ * With --rpc, each message is a request: the producer keeps its quota
+ * of requests outstanding and, instead of step 4, waits for a reply.
+ * With --groups, step 2 publishes to the shared topic log instead of
+ * the queue (blocks while the slowest group is a whole log behind).
  * Returns: NULL on exit.
  */
 void *producer_thread(void *arg);
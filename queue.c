@@ -29,10 +29,33 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include "queue.h"
 #include "config.h"
 #include "utils.h"
+#include "spill.h"
+
+#if MAX_QUEUE_SIZE > 32
+#error "Selective receive bitmaps hold one bit per slot: MAX_QUEUE_SIZE must be <= 32"
+#endif
+#if MAX_PRODUCERS > 31
+#error "MessageFilter.producer_mask holds one bit per producer id: MAX_PRODUCERS must be <= 31"
+#endif
+#if COALESCE_HASH_SIZE < 2 * MAX_QUEUE_SIZE || (COALESCE_HASH_SIZE & (COALESCE_HASH_SIZE - 1)) != 0
+#error "COALESCE_HASH_SIZE must be a power of two >= 2 * MAX_QUEUE_SIZE"
+#endif
+
+#define KEY_MASK (COALESCE_HASH_SIZE - 1)
+
+/* Parked filtered consumer; lives on the waiter's stack */
+struct FilterWaiter {
+    const MessageFilter *filter;
+    pthread_cond_t cond;        // Waits on q->mutex
+    int signalled;              // Set by the arrival that woke it
+};
 
 /* --- Internal Helpers (Private) --- */
 
@@ -58,22 +81,36 @@ static long get_current_time_ms(void)
 }
 
 /*
- * Calculates effective priority with aging.
- * For every AGING_INTERVAL_MS the item has waited, its effective
- * priority increases by 1, capped at PRIORITY_MAX.
+ * Calculates effective priority: the dequeue policy's rank for a
+ * message (higher is served first). Every ring selection path ranks
+ * through here, so a policy only has to be added in this switch. The
+ * spill tier is the exception: it evicts and refills by static
+ * priority, so --spill is rejected with any other policy.
+ *
+ * MLFQ: the rank is the class level turned upside down (level 0 ranks
+ * highest); the static priority only names the class, and there is no
+ * aging, because the periodic reset already prevents starvation.
+ *
+ * Priority: for every aging_interval_ms the item has waited, its
+ * effective priority increases by 1, capped at PRIORITY_MAX.
  * This prevents low-priority items from starving indefinitely.
  *
  * Error handling: If now_ms is 0 (clock failure) or less than
  * the message timestamp, wait will be <= 0 and no boost is applied.
  * This is a safe degradation — priorities work normally without aging.
  */
-static int effective_priority(const Message *msg, long now_ms, int aging_interval_ms)
+static int effective_priority(const Queue *q, const Message *msg, long now_ms)
 {
-    long wait = now_ms - msg->timestamp;
+    long wait;
     int boost = 0;
 
-    if (wait > 0 && aging_interval_ms > 0)
-        boost = (int)(wait / aging_interval_ms);
+    if (q->policy == QUEUE_POLICY_MLFQ) {
+        return MLFQ_LEVELS - 1 - q->mlfq.level[msg->priority];
+    }
+
+    wait = now_ms - msg->timestamp;
+    if (wait > 0 && q->aging_interval_ms > 0)
+        boost = (int)(wait / q->aging_interval_ms);
 
     int eff = msg->priority + boost;
     if (eff > PRIORITY_MAX) eff = PRIORITY_MAX;
@@ -107,12 +144,12 @@ static int find_highest_priority_index(const Queue *q)
     now_ms = get_current_time_ms();
 
     highest_index = q->front;
-    highest_priority = effective_priority(&q->buffer[q->front], now_ms, q->aging_interval_ms);
+    highest_priority = effective_priority(q, &q->buffer[q->front], now_ms);
     oldest_timestamp = q->buffer[q->front].timestamp;
 
     for (i = 0; i < q->count; i++) {
         current_index = (q->front + i) % q->capacity;
-        int eff = effective_priority(&q->buffer[current_index], now_ms, q->aging_interval_ms);
+        int eff = effective_priority(q, &q->buffer[current_index], now_ms);
 
         if (eff > highest_priority) {
             highest_priority = eff;
@@ -131,6 +168,331 @@ static int find_highest_priority_index(const Queue *q)
     return highest_index;
 }
 
+/*
+ * Returns the full/empty state used for episode tracking.
+ * With capacity 1 the queue alternates between the two directly.
+ */
+static int occupancy_state(const Queue *q)
+{
+    if (q->count >= q->capacity) return 1;
+    if (q->count == 0) return -1;
+    return 0;
+}
+
+/*
+ * Closes the time spent at the current depth.
+ * Called before every count change. NOTE: Caller must hold the mutex!
+ */
+static void occupancy_advance(Queue *q, long long now_us)
+{
+    QueueOccupancy *occ = &q->occupancy;
+    long long dt = now_us - occ->last_change_us;
+
+    if (dt > 0) occ->depth_us[q->count] += dt;
+    occ->last_change_us = now_us;
+}
+
+/*
+ * Ends a full/empty episode when the state changes.
+ * Called after every count change. NOTE: Caller must hold the mutex!
+ */
+static void occupancy_episode(Queue *q, long long now_us)
+{
+    QueueOccupancy *occ = &q->occupancy;
+    int state = occupancy_state(q);
+
+    if (state == occ->episode_state) return;
+
+    if (occ->episode_state == 1) {
+        histogram_record(&occ->full_episodes, now_us - occ->episode_start_us);
+    } else if (occ->episode_state == -1) {
+        histogram_record(&occ->empty_episodes, now_us - occ->episode_start_us);
+    }
+    occ->episode_state = state;
+    occ->episode_start_us = now_us;
+}
+
+/* --- Selective Receive Indexes ---
+ * One bitmap per priority and per producer; bit i stands for the item
+ * at logical position i (0 = front). Removing position i shifts every
+ * later item down by one, which is one shift-and-mask per bitmap.
+ */
+
+/* Adds the item now at logical position 'pos'. Caller holds the mutex. */
+static void index_insert(Queue *q, const Message *m, int pos)
+{
+    unsigned int bit = 1u << pos;
+
+    if (m->priority >= PRIORITY_MIN && m->priority <= PRIORITY_MAX) {
+        q->prio_index[m->priority] |= bit;
+    }
+    if (m->producer_id >= 1 && m->producer_id <= MAX_PRODUCERS) {
+        q->producer_index[m->producer_id] |= bit;
+    }
+    if (q->partitions > 0) q->partition_index[queue_partition_of(q, m)] |= bit;
+}
+
+/* Drops logical position 'pos' and closes the gap. Caller holds the mutex. */
+static void index_remove(Queue *q, int pos)
+{
+    unsigned int low = (1u << pos) - 1;
+    int i;
+
+    for (i = 0; i <= PRIORITY_MAX; i++) {
+        q->prio_index[i] = (q->prio_index[i] & low) | ((q->prio_index[i] >> 1) & ~low);
+    }
+    for (i = 0; i <= MAX_PRODUCERS; i++) {
+        q->producer_index[i] = (q->producer_index[i] & low) |
+                               ((q->producer_index[i] >> 1) & ~low);
+    }
+    for (i = 0; i < q->partitions; i++) {
+        q->partition_index[i] = (q->partition_index[i] & low) |
+                                ((q->partition_index[i] >> 1) & ~low);
+    }
+}
+
+/* Recomputes every bitmap (after a multi-item compaction). Caller holds the mutex. */
+static void index_rebuild(Queue *q)
+{
+    int i;
+
+    memset(q->prio_index, 0, sizeof(q->prio_index));
+    memset(q->producer_index, 0, sizeof(q->producer_index));
+    memset(q->partition_index, 0, sizeof(q->partition_index));
+    for (i = 0; i < q->count; i++) {
+        index_insert(q, &q->buffer[(q->front + i) % q->capacity], i);
+    }
+}
+
+/* Clears logical position 'pos' of message 'm' (fields about to change). Caller holds the mutex. */
+static void index_clear(Queue *q, const Message *m, int pos)
+{
+    unsigned int bit = 1u << pos;
+
+    if (m->priority >= PRIORITY_MIN && m->priority <= PRIORITY_MAX) {
+        q->prio_index[m->priority] &= ~bit;
+    }
+    if (m->producer_id >= 1 && m->producer_id <= MAX_PRODUCERS) {
+        q->producer_index[m->producer_id] &= ~bit;
+    }
+}
+
+/*
+ * Wakes one parked filtered consumer whose filter accepts 'msg'.
+ * Consumers filtering on something else stay asleep.
+ * NOTE: Caller must hold the mutex!
+ */
+static void notify_filter_waiter(Queue *q, const Message *msg)
+{
+    int i;
+
+    for (i = 0; i < q->num_filter_waiters; i++) {
+        FilterWaiter *w = q->filter_waiters[i];
+        if (w->signalled || !queue_filter_matches(w->filter, msg)) continue;
+        w->signalled = 1;
+        q->filter.targeted_wakeups++;
+        pthread_cond_signal(&w->cond);
+        return;
+    }
+}
+
+/* --- Readiness Notification ---
+ * The eventfd mirrors "items queued" for epoll users. Level mode is
+ * kept under the mutex, right after the count changes, so the fd and
+ * the count never disagree for long enough to lose a wake-up. Edge
+ * mode writes after the items token is posted: a consumer woken by the
+ * write must find the token, as it gets no second edge.
+ */
+
+/* An item was stored. NOTE: Caller must hold the mutex! */
+static void ready_raise(Queue *q)
+{
+    uint64_t one = 1;
+
+    if (q->ready_fd < 0 || q->ready_mode != QUEUE_READY_LEVEL) return;
+    /* Level: only the empty -> non-empty transition changes anything */
+    if (q->count != 1) return;
+    if (write(q->ready_fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) {
+        q->ready.write_failures++;
+        return;
+    }
+    q->ready.signals++;
+}
+
+/* 'n' items_available tokens were just posted (edge mode; no lock held) */
+static void ready_notify(Queue *q, int n)
+{
+    uint64_t value = (uint64_t)n;
+
+    if (q->ready_fd < 0 || q->ready_mode != QUEUE_READY_EDGE || n <= 0) return;
+    if (write(q->ready_fd, &value, sizeof(value)) != (ssize_t)sizeof(value)) {
+        __atomic_fetch_add(&q->ready.write_failures, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_fetch_add(&q->ready.signals, 1, __ATOMIC_RELAXED);
+}
+
+/* Items were removed. NOTE: Caller must hold the mutex! */
+static void ready_lower(Queue *q)
+{
+    uint64_t value;
+
+    if (q->ready_fd < 0 || q->ready_mode != QUEUE_READY_LEVEL || q->count != 0) return;
+    /* Non-blocking: EAGAIN just means nobody had raised it */
+    if (read(q->ready_fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) q->ready.clears++;
+    /* queue_shutdown sets the flag before its write and takes no lock:
+     * if that write was just drained, put it back */
+    if (__atomic_load_n(&q->shutdown, __ATOMIC_SEQ_CST)) {
+        value = 1;
+        if (write(q->ready_fd, &value, sizeof(value)) != (ssize_t)sizeof(value)) {
+            q->ready.write_failures++;
+        }
+    }
+}
+
+/* --- Key Coalescing Index ---
+ * Open-addressed hash from key to the ring index of the queued message
+ * holding it. Buckets store only the ring index (the key is read back
+ * from the buffer); -1 = empty. Deletion shifts later entries of the
+ * probe run back, so no tombstones build up. At most one queued
+ * message per key is indexed: a redelivered duplicate is not.
+ */
+
+/* Home bucket of 'key' (Fibonacci hashing) */
+static int key_home(int key)
+{
+    return (int)((((unsigned int)key * 2654435761u) >> 16) & KEY_MASK);
+}
+
+/* Bucket holding 'key', or -1. Caller holds the mutex. */
+static int key_find(Queue *q, int key)
+{
+    int b = key_home(key), n;
+
+    q->coalesce.lookups++;
+    for (n = 0; n < COALESCE_HASH_SIZE && q->key_slot[b] >= 0; n++) {
+        q->coalesce.probes++;
+        if (q->buffer[q->key_slot[b]].key == key) return b;
+        b = (b + 1) & KEY_MASK;
+    }
+    return -1;
+}
+
+/* Bucket pointing at ring index 'slot' (holding 'key'), or -1. Caller holds the mutex. */
+static int key_bucket_of(const Queue *q, int key, int slot)
+{
+    int b = key_home(key), n;
+
+    for (n = 0; n < COALESCE_HASH_SIZE && q->key_slot[b] >= 0; n++) {
+        if (q->key_slot[b] == slot) return b;
+        b = (b + 1) & KEY_MASK;
+    }
+    return -1;
+}
+
+/* Indexes the message at ring index 'slot' unless its key already is. Caller holds the mutex. */
+static void key_insert(Queue *q, int slot)
+{
+    int key = q->buffer[slot].key;
+    int b;
+
+    if (key == 0) return;
+    for (b = key_home(key); q->key_slot[b] >= 0; b = (b + 1) & KEY_MASK) {
+        if (q->buffer[q->key_slot[b]].key == key) return;
+    }
+    q->key_slot[b] = slot;
+}
+
+/* Unindexes ring index 'slot' before it is overwritten. Caller holds the mutex. */
+static void key_delete(Queue *q, int slot)
+{
+    int key = q->buffer[slot].key;
+    int hole, b, home;
+
+    if (key == 0) return;
+    hole = key_bucket_of(q, key, slot);
+    if (hole < 0) return;   /* unindexed duplicate */
+
+    /* Backward shift: an entry may fill the hole if its home bucket
+     * does not lie between the hole and its current bucket */
+    for (b = (hole + 1) & KEY_MASK; q->key_slot[b] >= 0; b = (b + 1) & KEY_MASK) {
+        home = key_home(q->buffer[q->key_slot[b]].key);
+        if (((b - home) & KEY_MASK) >= ((b - hole) & KEY_MASK)) {
+            q->key_slot[hole] = q->key_slot[b];
+            hole = b;
+        }
+    }
+    q->key_slot[hole] = -1;
+}
+
+/* The message holding 'key' moved from ring index 'from' to 'to'. Caller holds the mutex. */
+static void key_move(Queue *q, int key, int from, int to)
+{
+    int b;
+
+    if (key == 0) return;
+    b = key_bucket_of(q, key, from);
+    if (b >= 0) q->key_slot[b] = to;
+}
+
+/* Re-indexes every queued message (after a multi-item compaction). Caller holds the mutex. */
+static void key_rebuild(Queue *q)
+{
+    int i;
+
+    for (i = 0; i < COALESCE_HASH_SIZE; i++) q->key_slot[i] = -1;
+    for (i = 0; i < q->count; i++) {
+        key_insert(q, (q->front + i) % q->capacity);
+    }
+}
+
+/*
+ * Folds 'msg' into the queued message with the same key, if there is
+ * one: payload, producer and expiry are replaced, the priority becomes
+ * the higher of the two, and the message keeps its place in line and
+ * its timestamp (so aging and FIFO tie-breaks are unchanged).
+ * Returns: 1 if folded, 0 if the key is not queued.
+ * NOTE: Caller must hold the mutex!
+ */
+static int coalesce_locked(Queue *q, const Message *msg)
+{
+    Message *m;
+    int b, pos, prio;
+
+    b = key_find(q, msg->key);
+    if (b < 0) return 0;
+
+    m = &q->buffer[q->key_slot[b]];
+    pos = (q->key_slot[b] - q->front + q->capacity) % q->capacity;
+    prio = (msg->priority > m->priority) ? msg->priority : m->priority;
+
+    /* A NORMAL message raised into the HIGH class no longer needs its
+     * shared token; the dequeue will not return one for it */
+    if (q->reserved_slots > 0 && queue_priority_class(m->priority) == PRIO_CLASS_NORMAL &&
+        queue_priority_class(prio) == PRIO_CLASS_HIGH) {
+        sem_post(&q->shared_slots);
+    }
+    if (prio > m->priority) q->coalesce.priority_raised++;
+
+    if (q->index_enabled) index_clear(q, m, pos);
+    m->data = msg->data;
+    m->producer_id = msg->producer_id;
+    m->expires_us = msg->expires_us;
+    m->priority = prio;
+    m->merged++;
+    if (m->merged > q->coalesce.max_merged) q->coalesce.max_merged = m->merged;
+    q->coalesce.coalesced++;
+    if (q->index_enabled) {
+        index_insert(q, m, pos);
+        /* It may now match a filter it did not match before */
+        if (q->num_filter_waiters > 0) notify_filter_waiter(q, m);
+    }
+
+    DBG(DBG_TRACE, "Coalesce: key=%d folded into slot %d (pri=%d, merged=%d)",
+        msg->key, q->key_slot[b], m->priority, m->merged);
+    return 1;
+}
+
 /*
  * Low-level write to buffer.
  * NOTE: Caller must hold the mutex!
@@ -141,6 +503,8 @@ static int find_highest_priority_index(const Queue *q)
  */
 static int internal_enqueue(Queue *q, Message msg)
 {
+    long long now_us;
+
     if (q->count >= q->capacity) {
         /* Error handling: This indicates a semaphore count mismatch.
          * Should never occur in normal operation. */
@@ -149,13 +513,74 @@ static int internal_enqueue(Queue *q, Message msg)
         return -1;
     }
 
+    now_us = time_now_us();
+    occupancy_advance(q, now_us);
+
+    /* Stamp the actual enqueue time (after any blocking, inside the lock),
+     * so consumers can tell queueing delay apart from the producer's own
+     * backlog, and the same clock read drives the occupancy integral */
+    msg.enqueue_us = now_us;
     q->buffer[q->rear] = msg;
+    if (q->coalesce_enabled) key_insert(q, q->rear);
     q->rear = (q->rear + 1) % q->capacity;
+    if (q->index_enabled) {
+        index_insert(q, &msg, q->count);
+        if (q->num_filter_waiters > 0) notify_filter_waiter(q, &msg);
+    }
+    if (q->partitions > 0) {
+        int p = queue_partition_of(q, &msg);
+        q->partition.arrivals[p]++;
+        /* Only a consumer that could lease it is worth waking */
+        if (q->partition_waiters > 0 && q->partition_owner[p] == 0) {
+            pthread_cond_signal(&q->partition_cond);
+        }
+    }
     q->count++;
+    ready_raise(q);
 
+    occupancy_episode(q, now_us);
     return 0;
 }
 
+/*
+ * Takes the item at ring index 'index' and shifts the items in front
+ * of it back by one to fill the gap (FIFO order is kept).
+ * NOTE: Caller must hold the mutex!
+ */
+static void remove_at(Queue *q, int index, Message *msg)
+{
+    int current_index, next_index;
+    long long now_us;
+
+    *msg = q->buffer[index];
+    if (q->index_enabled) {
+        index_remove(q, (index - q->front + q->capacity) % q->capacity);
+    }
+    if (q->coalesce_enabled) key_delete(q, index);
+
+    /* Shift elements toward front to fill the gap left by removal */
+    if (index == q->front) {
+        q->front = (q->front + 1) % q->capacity;
+    } else {
+        current_index = index;
+        while (current_index != q->front) {
+            next_index = (current_index - 1 + q->capacity) % q->capacity;
+            if (q->coalesce_enabled) {
+                key_move(q, q->buffer[next_index].key, next_index, current_index);
+            }
+            q->buffer[current_index] = q->buffer[next_index];
+            current_index = next_index;
+        }
+        q->front = (q->front + 1) % q->capacity;
+    }
+
+    now_us = time_now_us();
+    occupancy_advance(q, now_us);
+    q->count--;
+    ready_lower(q);
+    occupancy_episode(q, now_us);
+}
+
 /*
  * Low-level read from buffer with gap-filling shift.
  * NOTE: Caller must hold the mutex!
@@ -165,7 +590,7 @@ static int internal_enqueue(Queue *q, Message msg)
  */
 static int internal_dequeue(Queue *q, Message *msg)
 {
-    int highest_index, current_index, next_index;
+    int highest_index;
 
     if (q->count == 0) {
         /* Error handling: Dequeue from empty buffer.
@@ -183,368 +608,2094 @@ static int internal_dequeue(Queue *q, Message *msg)
         return -1;
     }
 
-    *msg = q->buffer[highest_index];
+    remove_at(q, highest_index, msg);
+    return 0;
+}
 
-    /* Shift elements toward front to fill the gap left by removal */
-    if (highest_index == q->front) {
-        q->front = (q->front + 1) % q->capacity;
-    } else {
-        current_index = highest_index;
-        while (current_index != q->front) {
-            next_index = (current_index - 1 + q->capacity) % q->capacity;
-            q->buffer[current_index] = q->buffer[next_index];
-            current_index = next_index;
+/*
+ * Removes the 'n' items flagged in 'taken' (logical positions, 0 = front).
+ * Walks back from the rear, sliding survivors over the taken slots;
+ * write >= read throughout, so it is in place and keeps FIFO order.
+ * NOTE: Caller must hold the mutex!
+ */
+static void remove_marked(Queue *q, const char *taken, int n, long long now_us)
+{
+    int read, write = q->count - 1;
+
+    for (read = q->count - 1; read >= 0; read--) {
+        if (taken[read]) continue;
+        if (write != read) {
+            q->buffer[(q->front + write) % q->capacity] =
+                q->buffer[(q->front + read) % q->capacity];
         }
-        q->front = (q->front + 1) % q->capacity;
+        write--;
     }
+    q->front = (q->front + n) % q->capacity;
 
-    q->count--;
-    return 0;
-}
+    occupancy_advance(q, now_us);
+    q->count -= n;
+    ready_lower(q);
+    occupancy_episode(q, now_us);
 
-/* --- Public API: Lifecycle --- */
+    if (q->index_enabled) index_rebuild(q);
+    if (q->coalesce_enabled) key_rebuild(q);
+}
 
 /*
- * Initialises the queue and all OS synchronisation resources.
- *
- * Error handling: Uses cascading cleanup — if any init step fails,
- * all previously initialised resources are destroyed before returning.
- * This prevents resource leaks on partial initialisation.
+ * Ranking used by the top-k selection: higher effective priority,
+ * then older timestamp, then earlier ring position — the same order
+ * find_highest_priority_index would pick items in.
  */
-int queue_init(Queue *q, int capacity, int aging_interval_ms)
+static int topk_better(const int *eff, const long *stamp, int a, int b)
 {
-    if (q == NULL) return -1;
-    if (capacity < MIN_QUEUE_SIZE || capacity > MAX_QUEUE_SIZE) {
-        fprintf(stderr, "[ERROR] queue_init: capacity %d out of range [%d, %d]\n",
-                capacity, MIN_QUEUE_SIZE, MAX_QUEUE_SIZE);
-        return -1;
+    if (eff[a] != eff[b]) return eff[a] > eff[b];
+    if (stamp[a] != stamp[b]) return stamp[a] < stamp[b];
+    return a < b;
+}
+
+/* Restores the min-heap (worst selected item at the root) below 'i' */
+static void topk_sift_down(int *heap, int size, int i, const int *eff, const long *stamp)
+{
+    int child, tmp;
+
+    while ((child = 2 * i + 1) < size) {
+        if (child + 1 < size && topk_better(eff, stamp, heap[child], heap[child + 1])) child++;
+        if (!topk_better(eff, stamp, heap[i], heap[child])) break;
+        tmp = heap[i];
+        heap[i] = heap[child];
+        heap[child] = tmp;
+        i = child;
     }
+}
 
-    /* Data setup */
-    q->front = 0;
-    q->rear = 0;
-    q->count = 0;
-    q->capacity = capacity;
-    q->shutdown = 0;
-    q->aging_interval_ms = aging_interval_ms;
-    memset(q->buffer, 0, sizeof(q->buffer));
+/*
+ * Low-level top-k read with a single compaction.
+ * One scan computes each item's effective priority once and keeps the
+ * best k in a bounded min-heap (O(n log k)). The survivors are then
+ * packed toward the rear in their original order, so FIFO tie-breaks
+ * stay intact, and front advances by k.
+ * NOTE: Caller must hold the mutex!
+ *
+ * Error handling: Returns -1 if k is out of range for the current
+ * count. This should never happen if semaphores are working correctly.
+ */
+static int internal_dequeue_topk(Queue *q, Message *msgs, int k)
+{
+    int eff[MAX_QUEUE_SIZE];
+    long stamp[MAX_QUEUE_SIZE];
+    int heap[MAX_QUEUE_SIZE];
+    char taken[MAX_QUEUE_SIZE];
+    int size = 0, i, n;
+    long now_ms;
 
-    /* 1. Initialise Mutex — protects buffer/indices in critical sections */
-    if (pthread_mutex_init(&q->mutex, NULL) != 0) {
-        fprintf(stderr, "[ERROR] queue_init: pthread_mutex_init failed\n");
+    if (k < 1 || k > q->count) {
+        fprintf(stderr, "[ERROR] internal_dequeue_topk: underflow prevented "
+                "(k=%d, count=%d)\n", k, q->count);
         return -1;
     }
 
-    /* 2. Init 'Slots' Semaphore (starts at capacity — all slots free)
-     * Error handling: destroy mutex if sem_init fails */
-    if (sem_init(&q->slots_available, 0, capacity) != 0) {
-        fprintf(stderr, "[ERROR] queue_init: sem_init(slots) failed\n");
-        pthread_mutex_destroy(&q->mutex);
-        return -1;
+    /* 1. Selection: positions are logical (0 = front) */
+    now_ms = get_current_time_ms();
+    for (i = 0; i < q->count; i++) {
+        const Message *m = &q->buffer[(q->front + i) % q->capacity];
+        eff[i] = effective_priority(q, m, now_ms);
+        stamp[i] = m->timestamp;
+
+        if (size < k) {
+            int c = size++;
+            heap[c] = i;
+            /* Sift up */
+            while (c > 0 && topk_better(eff, stamp, heap[(c - 1) / 2], heap[c])) {
+                int p = (c - 1) / 2, tmp = heap[p];
+                heap[p] = heap[c];
+                heap[c] = tmp;
+                c = p;
+            }
+        } else if (topk_better(eff, stamp, i, heap[0])) {
+            heap[0] = i;
+            topk_sift_down(heap, size, 0, eff, stamp);
+        }
     }
 
-    /* 3. Init 'Items' Semaphore (starts at 0 — no items yet)
-     * Error handling: destroy mutex + slots semaphore if this fails */
-    if (sem_init(&q->items_available, 0, 0) != 0) {
-        fprintf(stderr, "[ERROR] queue_init: sem_init(items) failed\n");
-        pthread_mutex_destroy(&q->mutex);
-        sem_destroy(&q->slots_available);
-        return -1;
+    /* 2. Output best-first: popping the min-heap yields worst-first */
+    memset(taken, 0, sizeof(taken));
+    for (n = k - 1; n >= 0; n--) {
+        msgs[n] = q->buffer[(q->front + heap[0]) % q->capacity];
+        taken[heap[0]] = 1;
+        heap[0] = heap[--size];
+        topk_sift_down(heap, size, 0, eff, stamp);
     }
 
+    /* 3. One compaction pass for all k gaps */
+    remove_marked(q, taken, k, time_now_us());
+
     return 0;
 }
 
+/* --- Disk Spill-Over Tier ---
+ * The ring is the fast tier, the spill file the slow one. A message
+ * only enters the ring ahead of spilled messages if it has a strictly
+ * higher priority than all of them, so consumers still see priority
+ * order (then creation order) across both tiers. Aging only applies
+ * once a message is back in the ring.
+ */
+
 /*
- * Destroys the queue and releases OS resources.
- *
- * Error handling: Checks each destroy call. Failures here typically
- * mean the resource was already destroyed or never initialised.
- * We log but continue cleanup to release as much as possible.
+ * Ring index of the message a full ring gives up first: lowest base
+ * priority, newest on ties (the one a consumer would reach last).
+ * NOTE: Caller must hold the mutex!
  */
-int queue_destroy(Queue *q)
+static int find_worst_index(const Queue *q)
 {
-    int errors = 0;
-
-    if (q == NULL) return -1;
+    int i, index, worst = -1;
 
-    if (pthread_mutex_destroy(&q->mutex) != 0) {
-        fprintf(stderr, "[ERROR] queue_destroy: mutex destroy failed "
-                "(may still be locked)\n");
-        errors++;
-    }
-    if (sem_destroy(&q->slots_available) != 0) {
-        fprintf(stderr, "[ERROR] queue_destroy: slots semaphore destroy failed\n");
-        errors++;
-    }
-    if (sem_destroy(&q->items_available) != 0) {
-        fprintf(stderr, "[ERROR] queue_destroy: items semaphore destroy failed\n");
-        errors++;
+    for (i = 0; i < q->count; i++) {
+        index = (q->front + i) % q->capacity;
+        if (worst < 0 || q->buffer[index].priority < q->buffer[worst].priority ||
+            (q->buffer[index].priority == q->buffer[worst].priority &&
+             q->buffer[index].timestamp >= q->buffer[worst].timestamp)) {
+            worst = index;
+        }
     }
-
-    return (errors > 0) ? -1 : 0;
+    return worst;
 }
 
-/* --- Public API: Unsafe Diagnostics --- */
-
 /*
- * NOTE: These functions read queue state WITHOUT holding the mutex.
+ * Moves spilled messages into the ring while free slot tokens last.
+ * Returns: messages moved (the caller posts items_available for each
+ * once the mutex is released).
+ * NOTE: Caller must hold the mutex!
+ */
+static int spill_refill_locked(Queue *q)
+{
+    Message msg;
+    int moved = 0;
+
+    /* The count check matters at shutdown, when queue_shutdown has
+     * posted more slot tokens than there are free slots: a record
+     * taken off the disk must always fit in the ring */
+    while (spill_pending(q->spill) > 0 && q->count < q->capacity &&
+           sem_trywait(&q->slots_available) == 0) {
+        if (spill_take(q->spill, &msg, time_now_us()) != 0) {
+            sem_post(&q->slots_available);
+            break;
+        }
+        internal_enqueue(q, msg);
+        moved++;
+    }
+    return moved;
+}
+
+/* Posts one items_available token per refilled message */
+static void post_refilled(Queue *q, int moved)
+{
+    int i;
+
+    for (i = 0; i < moved; i++) {
+        if (sem_post(&q->items_available) != 0) {
+            fprintf(stderr, "[ERROR] queue: sem_post(items) failed after refill "
+                    "(errno=%d: %s)\n", errno, strerror(errno));
+        }
+    }
+    ready_notify(q, moved);
+}
+
+/*
+ * Release-side refill: called right after slots were posted, and only
+ * if something is on disk.
+ */
+static void spill_refill(Queue *q)
+{
+    int moved;
+
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue: mutex lock failed in spill refill\n");
+        return;
+    }
+    moved = spill_refill_locked(q);
+    pthread_mutex_unlock(&q->mutex);
+    post_refilled(q, moved);
+}
+
+/*
+ * Producer-side spill: the ring had no free slot, so 'msg' is stored
+ * without one. Either it displaces the worst queued message (which
+ * goes to disk in its place) or it is spilled itself; a slot that
+ * freed meanwhile is refilled before returning.
+ * Returns: 1 if stored, 0 if the spill file is full (block instead),
+ *          -1 on lock failure.
+ */
+static int spill_enqueue(Queue *q, const Message *msg)
+{
+    Message victim;
+    int worst, moved;
+    long long now_us;
+
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_enqueue: mutex lock failed\n");
+        return -1;
+    }
+    if (!spill_has_room(q->spill)) {
+        q->spill->stats.full_blocks++;
+        pthread_mutex_unlock(&q->mutex);
+        return 0;
+    }
+
+    now_us = time_now_us();
+    worst = find_worst_index(q);
+    if (worst >= 0 && msg->priority > q->buffer[worst].priority &&
+        msg->priority > spill_best_priority(q->spill)) {
+        remove_at(q, worst, &victim);
+        internal_enqueue(q, *msg);
+        spill_put(q->spill, &victim, now_us);
+        q->spill->stats.evictions++;
+        DBG(DBG_TRACE, "Spill: pri=%d evicts P%d#%d (pri=%d) to disk",
+            msg->priority, victim.producer_id, victim.data, victim.priority);
+    } else {
+        spill_put(q->spill, msg, now_us);
+        DBG(DBG_TRACE, "Spill: pri=%d to disk (%d spilled)",
+            msg->priority, spill_pending(q->spill));
+    }
+
+    /* Stored before this trywait; release_slots posts before it reads
+     * the pending count: one of the two always sees the other */
+    moved = spill_refill_locked(q);
+    pthread_mutex_unlock(&q->mutex);
+    post_refilled(q, moved);
+    return 1;
+}
+
+/* --- Public API: Lifecycle --- */
+
+/*
+ * Initialises the queue and all OS synchronisation resources.
+ *
+ * Error handling: Uses cascading cleanup — if any init step fails,
+ * all previously initialised resources are destroyed before returning.
+ * This prevents resource leaks on partial initialisation.
+ */
+int queue_init(Queue *q, int capacity, int aging_interval_ms)
+{
+    int i;
+
+    if (q == NULL) return -1;
+    if (capacity < MIN_QUEUE_SIZE || capacity > MAX_QUEUE_SIZE) {
+        fprintf(stderr, "[ERROR] queue_init: capacity %d out of range [%d, %d]\n",
+                capacity, MIN_QUEUE_SIZE, MAX_QUEUE_SIZE);
+        return -1;
+    }
+
+    /* Data setup */
+    q->front = 0;
+    q->rear = 0;
+    q->count = 0;
+    q->capacity = capacity;
+    q->shutdown = 0;
+    q->aging_interval_ms = aging_interval_ms;
+    q->policy = QUEUE_POLICY_PRIORITY;
+    memset(&q->mlfq, 0, sizeof(q->mlfq));
+    q->reserved_slots = 0;
+    q->credit_mode = 0;
+    q->slot_credits = 0;
+    q->credits_outstanding = 0;
+    q->credit_waiters = 0;
+    q->expiry_enabled = 0;
+    q->token_debt = 0;
+    q->hold_slots = 0;
+    q->index_enabled = 0;
+    q->num_filter_waiters = 0;
+    q->coalesce_enabled = 0;
+    for (i = 0; i < COALESCE_HASH_SIZE; i++) q->key_slot[i] = -1;
+    memset(&q->coalesce, 0, sizeof(q->coalesce));
+    q->partitions = 0;
+    q->partition_waiters = 0;
+    q->spill = NULL;
+    q->ready_fd = -1;
+    q->ready_mode = QUEUE_READY_LEVEL;
+    memset(&q->ready, 0, sizeof(q->ready));
+    memset(q->partition_index, 0, sizeof(q->partition_index));
+    memset(q->partition_owner, 0, sizeof(q->partition_owner));
+    memset(q->partition_last, 0, sizeof(q->partition_last));
+    memset(q->partition_free_us, 0, sizeof(q->partition_free_us));
+    memset(&q->partition, 0, sizeof(q->partition));
+    histogram_init(&q->partition.handoff_us);
+    memset(q->prio_index, 0, sizeof(q->prio_index));
+    memset(q->producer_index, 0, sizeof(q->producer_index));
+    memset(&q->filter, 0, sizeof(q->filter));
+    memset(&q->expiry, 0, sizeof(q->expiry));
+    memset(&q->flow, 0, sizeof(q->flow));
+    memset(q->buffer, 0, sizeof(q->buffer));
+    memset(&q->occupancy, 0, sizeof(q->occupancy));
+    q->occupancy.since_us = time_now_us();
+    q->occupancy.last_change_us = q->occupancy.since_us;
+    q->occupancy.episode_state = -1;  /* starts empty */
+    q->occupancy.episode_start_us = q->occupancy.since_us;
+
+    /* 1. Initialise Mutex — protects buffer/indices in critical sections */
+    if (pthread_mutex_init(&q->mutex, NULL) != 0) {
+        fprintf(stderr, "[ERROR] queue_init: pthread_mutex_init failed\n");
+        return -1;
+    }
+
+    /* 2. Init 'Slots' Semaphore (starts at capacity — all slots free)
+     * Error handling: destroy mutex if sem_init fails */
+    if (sem_init(&q->slots_available, 0, capacity) != 0) {
+        fprintf(stderr, "[ERROR] queue_init: sem_init(slots) failed\n");
+        pthread_mutex_destroy(&q->mutex);
+        return -1;
+    }
+
+    /* 3. Init 'Items' Semaphore (starts at 0 — no items yet)
+     * Error handling: destroy mutex + slots semaphore if this fails */
+    if (sem_init(&q->items_available, 0, 0) != 0) {
+        fprintf(stderr, "[ERROR] queue_init: sem_init(items) failed\n");
+        pthread_mutex_destroy(&q->mutex);
+        sem_destroy(&q->slots_available);
+        return -1;
+    }
+
+    /* 4. Init 'Shared' Semaphore (no reservation yet — every slot shared)
+     * Error handling: destroy everything above if this fails */
+    if (sem_init(&q->shared_slots, 0, capacity) != 0) {
+        fprintf(stderr, "[ERROR] queue_init: sem_init(shared) failed\n");
+        pthread_mutex_destroy(&q->mutex);
+        sem_destroy(&q->slots_available);
+        sem_destroy(&q->items_available);
+        return -1;
+    }
+
+    /* 5. Credit pool wait (only used in credit mode)
+     * Error handling: destroy everything above if this fails */
+    if (pthread_mutex_init(&q->credit_mutex, NULL) != 0) {
+        fprintf(stderr, "[ERROR] queue_init: pthread_mutex_init(credit) failed\n");
+        pthread_mutex_destroy(&q->mutex);
+        sem_destroy(&q->slots_available);
+        sem_destroy(&q->items_available);
+        sem_destroy(&q->shared_slots);
+        return -1;
+    }
+    if (pthread_cond_init(&q->credit_cond, NULL) != 0) {
+        fprintf(stderr, "[ERROR] queue_init: pthread_cond_init(credit) failed\n");
+        pthread_mutex_destroy(&q->credit_mutex);
+        pthread_mutex_destroy(&q->mutex);
+        sem_destroy(&q->slots_available);
+        sem_destroy(&q->items_available);
+        sem_destroy(&q->shared_slots);
+        return -1;
+    }
+
+    /* 6. Partition wait (only used in partitioned mode)
+     * Error handling: destroy everything above if this fails */
+    if (pthread_cond_init(&q->partition_cond, NULL) != 0) {
+        fprintf(stderr, "[ERROR] queue_init: pthread_cond_init(partition) failed\n");
+        pthread_cond_destroy(&q->credit_cond);
+        pthread_mutex_destroy(&q->credit_mutex);
+        pthread_mutex_destroy(&q->mutex);
+        sem_destroy(&q->slots_available);
+        sem_destroy(&q->items_available);
+        sem_destroy(&q->shared_slots);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Destroys the queue and releases OS resources.
+ *
+ * Error handling: Checks each destroy call. Failures here typically
+ * mean the resource was already destroyed or never initialised.
+ * We log but continue cleanup to release as much as possible.
+ */
+int queue_destroy(Queue *q)
+{
+    int errors = 0;
+
+    if (q == NULL) return -1;
+
+    if (pthread_mutex_destroy(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_destroy: mutex destroy failed "
+                "(may still be locked)\n");
+        errors++;
+    }
+    if (sem_destroy(&q->slots_available) != 0) {
+        fprintf(stderr, "[ERROR] queue_destroy: slots semaphore destroy failed\n");
+        errors++;
+    }
+    if (sem_destroy(&q->items_available) != 0) {
+        fprintf(stderr, "[ERROR] queue_destroy: items semaphore destroy failed\n");
+        errors++;
+    }
+    if (sem_destroy(&q->shared_slots) != 0) {
+        fprintf(stderr, "[ERROR] queue_destroy: shared semaphore destroy failed\n");
+        errors++;
+    }
+    if (pthread_cond_destroy(&q->credit_cond) != 0 ||
+        pthread_mutex_destroy(&q->credit_mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_destroy: credit wait destroy failed\n");
+        errors++;
+    }
+    if (pthread_cond_destroy(&q->partition_cond) != 0) {
+        fprintf(stderr, "[ERROR] queue_destroy: partition wait destroy failed\n");
+        errors++;
+    }
+    if (q->ready_fd >= 0) {
+        if (close(q->ready_fd) != 0) {
+            fprintf(stderr, "[ERROR] queue_destroy: readiness eventfd close failed\n");
+            errors++;
+        }
+        q->ready_fd = -1;
+    }
+
+    return (errors > 0) ? -1 : 0;
+}
+
+/*
+ * Error handling: Rejects a reservation that would leave the NORMAL
+ * class no slot at all (it could never enqueue), or a second call
+ * (tokens already handed out would be miscounted).
+ */
+int queue_set_reserve(Queue *q, int reserved_slots)
+{
+    int i;
+
+    if (q == NULL) return -1;
+    if (reserved_slots < 0 || reserved_slots >= q->capacity) {
+        fprintf(stderr, "[ERROR] queue_set_reserve: %d reserved slots out of range "
+                "[0, %d]\n", reserved_slots, q->capacity - 1);
+        return -1;
+    }
+    if (q->reserved_slots != 0) {
+        fprintf(stderr, "[ERROR] queue_set_reserve: reservation already set\n");
+        return -1;
+    }
+
+    /* Withdraw the reserved tokens from the shared pool */
+    for (i = 0; i < reserved_slots; i++) {
+        if (sem_trywait(&q->shared_slots) != 0) {
+            fprintf(stderr, "[ERROR] queue_set_reserve: queue already in use\n");
+            while (i-- > 0) sem_post(&q->shared_slots);
+            return -1;
+        }
+    }
+    q->reserved_slots = reserved_slots;
+    return 0;
+}
+
+void queue_enable_expiry(Queue *q)
+{
+    if (q == NULL) return;
+    q->expiry_enabled = 1;
+}
+
+void queue_enable_filters(Queue *q)
+{
+    if (q == NULL) return;
+    q->index_enabled = 1;
+}
+
+void queue_enable_coalescing(Queue *q)
+{
+    if (q == NULL) return;
+    q->coalesce_enabled = 1;
+}
+
+int queue_enable_partitions(Queue *q, int partitions)
+{
+    if (q == NULL) return -1;
+    if (partitions < 1 || partitions > MAX_PARTITIONS) {
+        fprintf(stderr, "[ERROR] queue_enable_partitions: %d partitions out of range "
+                "[1, %d]\n", partitions, MAX_PARTITIONS);
+        return -1;
+    }
+    q->partitions = partitions;
+    q->index_enabled = 1;   /* partition bitmaps are kept with the others */
+    return 0;
+}
+
+int queue_enable_ready_fd(Queue *q, QueueReadyMode mode)
+{
+    if (q == NULL) return -1;
+    if (q->ready_fd >= 0) return q->ready_fd;
+
+    q->ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (q->ready_fd < 0) {
+        fprintf(stderr, "[ERROR] queue_enable_ready_fd: eventfd failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        return -1;
+    }
+    q->ready_mode = mode;
+    return q->ready_fd;
+}
+
+int queue_ready_fd(const Queue *q)
+{
+    return (q == NULL) ? -1 : q->ready_fd;
+}
+
+void queue_ready_stats(Queue *q, QueueReadyStats *out)
+{
+    if (q == NULL || out == NULL) return;
+    if (pthread_mutex_lock(&q->mutex) != 0) return;
+    *out = q->ready;
+    pthread_mutex_unlock(&q->mutex);
+}
+
+void queue_attach_spill(Queue *q, SpillStore *s)
+{
+    if (q == NULL) return;
+    q->spill = s;
+}
+
+int queue_spill_pending(const Queue *q)
+{
+    if (q == NULL || q->spill == NULL) return 0;
+    return spill_pending(q->spill);
+}
+
+void queue_enable_leases(Queue *q)
+{
+    if (q == NULL) return;
+    q->hold_slots = 1;
+}
+
+PriorityClass queue_priority_class(int priority)
+{
+    return (priority >= RESERVED_PRIORITY_MIN) ? PRIO_CLASS_HIGH : PRIO_CLASS_NORMAL;
+}
+
+const char *queue_priority_class_name(PriorityClass c)
+{
+    switch (c) {
+        case PRIO_CLASS_NORMAL: return "normal";
+        case PRIO_CLASS_HIGH:   return "high";
+        default:                return "unknown";
+    }
+}
+
+/* --- Public API: Unsafe Diagnostics --- */
+
+/*
+ * NOTE: These functions read queue state WITHOUT holding the mutex.
  * They are safe for approximate reads (display, logging) but not
  * for decisions that affect queue operations. The values may be
  * stale by the time the caller uses them.
  */
 
-int queue_is_full(const Queue *q) {
-    if (!q) return 0;
-    return (q->count >= q->capacity);
-}
+int queue_is_full(const Queue *q) {
+    if (!q) return 0;
+    return (q->count >= q->capacity);
+}
+
+int queue_is_empty(const Queue *q) {
+    if (!q) return 1;
+    return (q->count == 0);
+}
+
+int queue_get_count(const Queue *q) {
+    if (!q) return 0;
+    return q->count;
+}
+
+int queue_get_capacity(const Queue *q) {
+    if (!q) return 0;
+    return q->capacity;
+}
+
+void queue_display(const Queue *q)
+{
+    int i, index;
+    if (!q) return;
+
+    printf("Queue Status: %d/%d items (Shutdown=%d)\n",
+           q->count, q->capacity, q->shutdown);
+
+    for (i = 0; i < q->count; i++) {
+        index = (q->front + i) % q->capacity;
+        printf("    [%d] Prod:%d Pri:%d Data:%d\n",
+               index, q->buffer[index].producer_id,
+               q->buffer[index].priority, q->buffer[index].data);
+    }
+}
+
+/* --- Public API: Thread-Safe Operations --- */
+
+/*
+ * Takes one token from 'sem', blocking if none is left.
+ * Sets *blocked (and the wait start, once per operation) when it has
+ * to wait, so a NORMAL enqueue that waits on both semaphores reports
+ * one block spanning both waits.
+ * 'ops' (may be NULL) counts the semaphore calls made.
+ *
+ * ERROR HANDLING:
+ *   - sem_trywait EAGAIN: Normal — means "would block", not an error
+ *   - sem_trywait other:  Unexpected failure — log and return error
+ *   - sem_wait EINTR:     Signal interrupted the wait — retry in loop
+ *   - sem_wait other:     Unexpected failure — log and return error
+ *   - shutdown on wake:   Token handed back so the count stays exact
+ */
+static int acquire_token(Queue *q, sem_t *sem, const char *name,
+                         int *blocked, long *wait_start, long long *ops)
+{
+    int result;
+
+    /* Try non-blocking acquire to detect if we would block */
+    if (ops) __atomic_fetch_add(ops, 1, __ATOMIC_RELAXED);
+    if (sem_trywait(sem) == 0) return 0;
+
+    if (errno != EAGAIN) {
+        /* Error handling: Unexpected sem_trywait failure.
+         * Could be EINVAL (invalid semaphore) or other system error. */
+        fprintf(stderr, "[ERROR] queue_enqueue: sem_trywait(%s) failed "
+                "(errno=%d: %s)\n", name, errno, strerror(errno));
+        return -1;
+    }
+
+    /* Normal: semaphore is 0, we will block */
+    if (!*blocked) {
+        *blocked = 1;
+        *wait_start = get_current_time_ms();
+    }
+
+    /* Fall back to blocking wait, retrying on signal interrupts */
+    if (ops) __atomic_fetch_add(ops, 1, __ATOMIC_RELAXED);
+    do {
+        result = sem_wait(sem);
+    } while (result != 0 && errno == EINTR && !q->shutdown);
+
+    if (result != 0) {
+        /* Error handling: sem_wait failed with non-EINTR error,
+         * or EINTR during shutdown. Either way we cannot proceed. */
+        if (errno != EINTR) {
+            fprintf(stderr, "[ERROR] queue_enqueue: sem_wait(%s) failed "
+                    "(errno=%d: %s)\n", name, errno, strerror(errno));
+        }
+        return -1;
+    }
+
+    if (q->shutdown) {
+        /* Error handling: Acquired semaphore but shutdown was signalled.
+         * Return the token to avoid leaking a semaphore count. */
+        sem_post(sem);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Hands the shared tokens of dequeued NORMAL messages back.
+ * Aging only affects selection, so the class at dequeue is normally
+ * the class a message was admitted under. The one exception is key
+ * coalescing: coalesce_locked can raise a queued NORMAL message into
+ * the HIGH class, and it posts that message's shared token at once.
+ * A class only ever moves up, so a message still NORMAL here always
+ * holds its token, and one now HIGH has none left to return.
+ */
+static void release_shared(Queue *q, const Message *msgs, int n)
+{
+    int i;
+
+    if (q->reserved_slots == 0) return;
+    for (i = 0; i < n; i++) {
+        if (queue_priority_class(msgs[i].priority) != PRIO_CLASS_NORMAL) continue;
+        if (sem_post(&q->shared_slots) != 0) {
+            fprintf(stderr, "[ERROR] queue_dequeue: sem_post(shared) failed "
+                    "(errno=%d: %s)\n", errno, strerror(errno));
+        }
+    }
+}
+
+/*
+ * Returns 'n' slots to producers: one sem_post each in semaphore mode,
+ * a single atomic add (plus a wake-up only if someone waits) in credit
+ * mode. With messages on the disk tier, the slots refill from it.
+ */
+static void release_slots(Queue *q, int n)
+{
+    int i;
+
+    if (q->credit_mode) {
+        __atomic_fetch_add(&q->flow.credit_returns, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&q->slot_credits, n, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&q->credit_waiters, __ATOMIC_SEQ_CST) > 0) {
+            pthread_mutex_lock(&q->credit_mutex);
+            pthread_cond_broadcast(&q->credit_cond);
+            pthread_mutex_unlock(&q->credit_mutex);
+        }
+        return;
+    }
+
+    __atomic_fetch_add(&q->flow.slot_sem_ops, n, __ATOMIC_RELAXED);
+    for (i = 0; i < n; i++) {
+        if (sem_post(&q->slots_available) != 0) {
+            /* Error handling: sem_post failed — semaphore count corruption */
+            fprintf(stderr, "[ERROR] queue: sem_post(slots) failed "
+                    "(errno=%d: %s)\n", errno, strerror(errno));
+        }
+    }
+
+    /* Freed slots go to spilled messages first */
+    if (q->spill != NULL && spill_pending(q->spill) > 0) spill_refill(q);
+}
+
+/*
+ * Takes up to 'want' slot credits in one compare-and-swap.
+ * Blocks on credit_cond only when the pool is empty, for at most
+ * CREDIT_WAIT_POLL_MS at a time so shutdown (which may run in a signal
+ * handler and cannot take credit_mutex) is noticed.
+ * Returns: credits taken (>= 1), or -1 on shutdown.
+ */
+static int credit_take(Queue *q, int want, int *blocked, long *wait_start)
+{
+    struct timespec deadline;
+    int avail, take;
+
+    __atomic_fetch_add(&q->flow.credit_grabs, 1, __ATOMIC_RELAXED);
+
+    for (;;) {
+        avail = __atomic_load_n(&q->slot_credits, __ATOMIC_SEQ_CST);
+        while (avail > 0) {
+            take = (avail < want) ? avail : want;
+            if (__atomic_compare_exchange_n(&q->slot_credits, &avail, avail - take, 0,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                __atomic_fetch_add(&q->credits_outstanding, take, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&q->flow.credits_granted, take, __ATOMIC_RELAXED);
+                return take;
+            }
+            /* CAS failure reloaded 'avail'; retry */
+        }
+
+        if (q->shutdown) return -1;
+
+        /* Pool empty. Anything still outstanding is sitting in other
+         * producers' local banks — the fairness cost of credits. */
+        if (!*blocked) {
+            int stranded = __atomic_load_n(&q->credits_outstanding, __ATOMIC_RELAXED);
+            *blocked = 1;
+            *wait_start = get_current_time_ms();
+            __atomic_fetch_add(&q->flow.grab_blocks, 1, __ATOMIC_RELAXED);
+            if (stranded > 0) {
+                __atomic_fetch_add(&q->flow.stranded_blocks, 1, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&q->flow.stranded_sum, stranded, __ATOMIC_RELAXED);
+            }
+        }
+
+        /* Waiter count goes up before the re-check, release_slots adds
+         * before it reads the count: one of the two always sees the other */
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += CREDIT_WAIT_POLL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+
+        pthread_mutex_lock(&q->credit_mutex);
+        __atomic_fetch_add(&q->credit_waiters, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&q->slot_credits, __ATOMIC_SEQ_CST) == 0 &&
+               !__atomic_load_n(&q->shutdown, __ATOMIC_SEQ_CST)) {
+            if (pthread_cond_timedwait(&q->credit_cond, &q->credit_mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        __atomic_fetch_sub(&q->credit_waiters, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&q->credit_mutex);
+    }
+}
+
+/*
+ * Stores one message for which the caller already holds a slot
+ * (semaphore token or credit), then signals consumers.
+ *
+ * Error handling: On mutex or buffer failure the slot and any shared
+ * token go back, so the counts stay exact.
+ */
+static int commit_enqueue(Queue *q, Message msg, int holds_shared, int blocked)
+{
+    int result, folded = 0;
+
+    /* 2. Critical Section — mutex protects buffer/indices */
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        /* Error handling: Mutex lock failure is critical.
+         * Could indicate deadlock or corrupted mutex.
+         * Return the semaphore token and abort this operation. */
+        fprintf(stderr, "[ERROR] queue_enqueue: mutex lock failed\n");
+        release_slots(q, 1);
+        if (holds_shared) sem_post(&q->shared_slots);
+        return -1;
+    }
+
+    /* The key may have been queued while we waited for the slot */
+    if (q->coalesce_enabled && msg.key != 0 && coalesce_locked(q, &msg)) {
+        q->coalesce.slot_returned++;
+        folded = 1;
+        result = 0;
+    } else {
+        result = internal_enqueue(q, msg);
+        if (result == 0 && msg.key != 0 && q->coalesce_enabled) q->coalesce.stored++;
+    }
+
+    if (result == 0 && !folded) {
+        DBG(DBG_TRACE, "Enqueue: pri=%d, slot=%d, count=%d/%d, was_blocked=%d",
+            msg.priority, (q->rear - 1 + q->capacity) % q->capacity,
+            q->count, q->capacity, blocked);
+    }
+
+    if (pthread_mutex_unlock(&q->mutex) != 0) {
+        /* Error handling: Mutex unlock failure.
+         * The data was already written, but other threads may deadlock.
+         * Log the error — there's no safe recovery from this. */
+        fprintf(stderr, "[ERROR] queue_enqueue: mutex unlock failed\n");
+    }
+
+    if (result != 0) {
+        /* Error handling: internal_enqueue failed (buffer overflow).
+         * Return the slots token since we didn't actually add an item. */
+        release_slots(q, 1);
+        if (holds_shared) sem_post(&q->shared_slots);
+        return -1;
+    }
+    if (folded) {
+        /* Nothing new was stored: the slot goes back, no consumer is woken */
+        release_slots(q, 1);
+        if (holds_shared) sem_post(&q->shared_slots);
+        return 0;
+    }
+    __atomic_fetch_add(&q->flow.enqueues, 1, __ATOMIC_RELAXED);
+
+    /* 3. Signal Consumers — one new item is available */
+    if (sem_post(&q->items_available) != 0) {
+        /* Error handling: sem_post failed — likely SEM_VALUE_MAX overflow.
+         * This would desynchronise the semaphore count. Log the error. */
+        fprintf(stderr, "[ERROR] queue_enqueue: sem_post(items) failed "
+                "(errno=%d: %s)\n", errno, strerror(errno));
+    }
+    ready_notify(q, 1);
+
+    return 0;
+}
+
+/*
+ * Takes the reservation's shared token for a NORMAL-class message.
+ * HIGH-class messages skip this, so they only ever compete for
+ * the slots themselves and the reserved share stays open to them.
+ * Returns: 1 if a token is now held, 0 if none needed, -1 on failure.
+ */
+static int acquire_shared(Queue *q, const Message *msg, int *blocked, long *wait_start)
+{
+    if (q->reserved_slots == 0 || queue_priority_class(msg->priority) != PRIO_CLASS_NORMAL) {
+        return 0;
+    }
+    if (acquire_token(q, &q->shared_slots, "shared", blocked, wait_start, NULL) != 0) return -1;
+    return 1;
+}
+
+/*
+ * Coalescing fast path: folds 'msg' into its queued key under the
+ * mutex, before any slot or shared token is taken.
+ * Returns: 1 if folded, 0 if the key is not queued, -1 on lock failure.
+ */
+static int coalesce_enqueue(Queue *q, const Message *msg)
+{
+    int folded;
+
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_enqueue: mutex lock failed\n");
+        return -1;
+    }
+    folded = coalesce_locked(q, msg);
+    if (folded) q->coalesce.without_slot++;
+    pthread_mutex_unlock(&q->mutex);
+    return folded;
+}
+
+/*
+ * Blocking Enqueue with accurate block detection.
+ *
+ * Uses sem_trywait first to detect if the thread would block.
+ * If trywait fails with EAGAIN (semaphore at 0), we fall back
+ * to blocking sem_wait and set was_blocked = 1.
+ * In credit mode the slot is a single credit from the shared pool.
+ *
+ * ERROR HANDLING:
+ *   - sem_trywait EAGAIN: Normal — means "would block", not an error
+ *   - sem_trywait other:  Unexpected failure — log and return error
+ *   - sem_wait EINTR:     Signal interrupted the wait — retry in loop
+ *   - sem_wait other:     Unexpected failure — log and return error
+ *   - mutex lock fail:    Fatal for data integrity — log and return error
+ *   - sem_post fail:      Semaphore overflow — log (should never happen)
+ */
+int queue_enqueue_safe(Queue *q, Message msg, int *was_blocked, long *wait_time_ms)
+{
+    int blocked = 0;
+    int holds_shared;
+    long wait_start = 0;
+
+    if (q == NULL) return -1;
+    if (q->shutdown) return -1;
+
+    if (was_blocked) *was_blocked = 0;
+    if (wait_time_ms) *wait_time_ms = 0;
+
+    /* Key already queued: fold into it without touching a slot */
+    if (q->coalesce_enabled && msg.key != 0) {
+        int folded = coalesce_enqueue(q, &msg);
+        if (folded != 0) return (folded > 0) ? 0 : -1;
+    }
+
+    /* 0. NORMAL class under a reservation: shared token first */
+    holds_shared = acquire_shared(q, &msg, &blocked, &wait_start);
+    if (holds_shared < 0) return -1;
+
+    /* Full ring with a disk tier: spill instead of blocking (a slot
+     * taken by another producer after this check only means a short
+     * block on it below) */
+    if (q->spill != NULL) {
+        int sval = 1;
+        sem_getvalue(&q->slots_available, &sval);
+        if (sval <= 0) {
+            int stored = spill_enqueue(q, &msg);
+            if (stored != 0) {
+                if (holds_shared) sem_post(&q->shared_slots);
+                return (stored > 0) ? 0 : -1;
+            }
+        }
+    }
+
+    /* 1. Slot token (blocks if the queue is full) */
+    if (q->credit_mode) {
+        if (credit_take(q, 1, &blocked, &wait_start) < 0) {
+            if (holds_shared) sem_post(&q->shared_slots);
+            return -1;
+        }
+        __atomic_fetch_sub(&q->credits_outstanding, 1, __ATOMIC_RELAXED);
+    } else if (acquire_token(q, &q->slots_available, "slots", &blocked, &wait_start,
+                             &q->flow.slot_sem_ops) != 0) {
+        if (holds_shared) sem_post(&q->shared_slots);
+        return -1;
+    }
+
+    /* Re-check shutdown after acquiring semaphore (could have changed) */
+    if (q->shutdown) {
+        release_slots(q, 1);
+        if (holds_shared) sem_post(&q->shared_slots);
+        return -1;
+    }
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms) {
+        *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
+    }
+
+    return commit_enqueue(q, msg, holds_shared, blocked);
+}
+
+/*
+ * Error handling: Tokens taken but not used (shutdown after the wait,
+ * mutex or buffer failure) are handed back, so the counts stay exact.
+ */
+int queue_enqueue_batch_safe(Queue *q, const Message *msgs, int n,
+                             int *was_blocked, long *wait_time_ms)
+{
+    int k, i, stored = 0;
+    int blocked = 0;
+    long wait_start = 0;
+
+    if (q == NULL || msgs == NULL || n < 1) return -1;
+    if (q->credit_mode || q->reserved_slots > 0 || q->spill != NULL || q->coalesce_enabled) {
+        fprintf(stderr, "[ERROR] queue_enqueue_batch: needs plain semaphore admission\n");
+        return -1;
+    }
+    if (q->shutdown) return -1;
+
+    if (was_blocked) *was_blocked = 0;
+    if (wait_time_ms) *wait_time_ms = 0;
+
+    /* 1. First token: identical to the single enqueue, may block */
+    if (acquire_token(q, &q->slots_available, "slots", &blocked, &wait_start,
+                      &q->flow.slot_sem_ops) != 0) {
+        return -1;
+    }
+
+    /* Extra tokens: only slots that are already free */
+    k = 1;
+    while (k < n && sem_trywait(&q->slots_available) == 0) k++;
+    __atomic_fetch_add(&q->flow.slot_sem_ops, (k - 1) + (k < n), __ATOMIC_RELAXED);
+
+    if (q->shutdown) {
+        release_slots(q, k);
+        return -1;
+    }
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms) {
+        *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
+    }
+
+    /* 2. Critical Section — one lock for all k items */
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_enqueue_batch: mutex lock failed\n");
+        release_slots(q, k);
+        return -1;
+    }
+    for (i = 0; i < k; i++) {
+        if (internal_enqueue(q, msgs[i]) != 0) break;
+        stored++;
+    }
+    DBG(DBG_TRACE, "Enqueue batch: k=%d, stored=%d, count=%d/%d, was_blocked=%d",
+        k, stored, q->count, q->capacity, blocked);
+    if (pthread_mutex_unlock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_enqueue_batch: mutex unlock failed\n");
+    }
+
+    /* Error handling: internal_enqueue failed (buffer overflow) —
+     * the unused tokens go back */
+    if (stored < k) release_slots(q, k - stored);
+    if (stored == 0) return -1;
+    __atomic_fetch_add(&q->flow.enqueues, stored, __ATOMIC_RELAXED);
+
+    /* 3. Signal Consumers — k new items are available */
+    for (i = 0; i < stored; i++) {
+        if (sem_post(&q->items_available) != 0) {
+            fprintf(stderr, "[ERROR] queue_enqueue_batch: sem_post(items) failed "
+                    "(errno=%d: %s)\n", errno, strerror(errno));
+        }
+    }
+    ready_notify(q, stored);
+
+    return stored;
+}
+
+/*
+ * Error handling: The caller's credit is spent whether or not the
+ * store succeeds — on failure commit_enqueue has already put the slot
+ * back in the pool, so the caller just drops it from its bank.
+ */
+int queue_enqueue_credit(Queue *q, Message msg, int *was_blocked, long *wait_time_ms)
+{
+    int blocked = 0;
+    int holds_shared;
+    long wait_start = 0;
+
+    if (q == NULL || !q->credit_mode) return -1;
+
+    /* The credit leaves the caller's bank now, used or not */
+    __atomic_fetch_sub(&q->credits_outstanding, 1, __ATOMIC_RELAXED);
+
+    if (q->shutdown) {
+        release_slots(q, 1);
+        return -1;
+    }
+
+    holds_shared = acquire_shared(q, &msg, &blocked, &wait_start);
+    if (holds_shared < 0) {
+        release_slots(q, 1);
+        return -1;
+    }
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms) {
+        *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
+    }
+
+    return commit_enqueue(q, msg, holds_shared, blocked);
+}
+
+int queue_credit_acquire(Queue *q, int want, int *was_blocked, long *wait_time_ms)
+{
+    int blocked = 0, taken;
+    long wait_start = 0;
+
+    if (q == NULL || !q->credit_mode || want < 1) return -1;
+    if (q->shutdown) return -1;
+
+    taken = credit_take(q, want, &blocked, &wait_start);
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms) {
+        *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
+    }
+    return taken;
+}
+
+void queue_credit_return(Queue *q, int credits)
+{
+    if (q == NULL || !q->credit_mode || credits < 1) return;
+
+    __atomic_fetch_sub(&q->credits_outstanding, credits, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&q->flow.credits_returned_unused, credits, __ATOMIC_RELAXED);
+    release_slots(q, credits);
+}
+
+int queue_enable_credits(Queue *q)
+{
+    if (q == NULL) return -1;
+    if (q->count != 0 || q->credit_mode) {
+        fprintf(stderr, "[ERROR] queue_enable_credits: queue already in use\n");
+        return -1;
+    }
+    q->slot_credits = q->capacity;
+    q->credits_outstanding = 0;
+    q->credit_mode = 1;
+    return 0;
+}
+
+void queue_flow_stats(const Queue *q, QueueFlowStats *out)
+{
+    if (out == NULL) return;
+    memset(out, 0, sizeof(*out));
+    if (q == NULL) return;
+
+    out->enqueues = __atomic_load_n(&q->flow.enqueues, __ATOMIC_RELAXED);
+    out->slot_sem_ops = __atomic_load_n(&q->flow.slot_sem_ops, __ATOMIC_RELAXED);
+    out->credit_grabs = __atomic_load_n(&q->flow.credit_grabs, __ATOMIC_RELAXED);
+    out->credits_granted = __atomic_load_n(&q->flow.credits_granted, __ATOMIC_RELAXED);
+    out->credit_returns = __atomic_load_n(&q->flow.credit_returns, __ATOMIC_RELAXED);
+    out->credits_returned_unused = __atomic_load_n(&q->flow.credits_returned_unused,
+                                                   __ATOMIC_RELAXED);
+    out->grab_blocks = __atomic_load_n(&q->flow.grab_blocks, __ATOMIC_RELAXED);
+    out->stranded_blocks = __atomic_load_n(&q->flow.stranded_blocks, __ATOMIC_RELAXED);
+    out->stranded_sum = __atomic_load_n(&q->flow.stranded_sum, __ATOMIC_RELAXED);
+}
+
+/*
+ * Takes one items_available token, blocking if none is left
+ * (returns 1 instead if 'wait' is 0).
+ * Same trywait-then-wait pattern as acquire_token; 'who' names the
+ * caller in error messages.
+ *
+ * ERROR HANDLING:
+ *   - sem_trywait EAGAIN: Normal — queue is empty, we will block
+ *   - sem_wait EINTR:     Signal interrupted the wait — retry in loop
+ *   - shutdown on wake:   Token handed back so the count stays exact
+ */
+static int acquire_item(Queue *q, int wait, int *blocked, long *wait_start, const char *who)
+{
+    int result;
+
+    /* 1. Try non-blocking acquire to detect if we would block */
+    if (sem_trywait(&q->items_available) == 0) return 0;
+
+    if (errno != EAGAIN) {
+        /* Error handling: Unexpected sem_trywait failure */
+        fprintf(stderr, "[ERROR] %s: sem_trywait failed "
+                "(errno=%d: %s)\n", who, errno, strerror(errno));
+        return -1;
+    }
+    if (!wait) return 1;
+
+    /* Normal: semaphore is 0, queue is empty, we will block */
+    if (!*blocked) {
+        *blocked = 1;
+        *wait_start = get_current_time_ms();
+    }
+
+    /* Fall back to blocking wait, retrying on signal interrupts */
+    do {
+        result = sem_wait(&q->items_available);
+    } while (result != 0 && errno == EINTR && !q->shutdown);
+
+    if (result != 0) {
+        if (errno != EINTR) {
+            fprintf(stderr, "[ERROR] %s: sem_wait failed "
+                    "(errno=%d: %s)\n", who, errno, strerror(errno));
+        }
+        return -1;
+    }
+
+    if (q->shutdown) {
+        sem_post(&q->items_available);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Drops up to 'limit' expired items in one pass and copies them to
+ * 'out'. Each dropped item still has an items_available token: the
+ * free ones are taken back here, the rest are already held by
+ * consumers on their way in and are recorded as token_debt, which
+ * those consumers pay off when they find nothing left to take.
+ * NOTE: Caller must hold the mutex!
+ */
+static int purge_expired(Queue *q, Message *out, int limit, int swept)
+{
+    char taken[MAX_QUEUE_SIZE];
+    long long now_us;
+    int i, n = 0;
+
+    if (!q->expiry_enabled || q->count == 0) return 0;
+
+    now_us = time_now_us();
+    memset(taken, 0, sizeof(taken));
+    for (i = 0; i < q->count && n < limit; i++) {
+        const Message *m = &q->buffer[(q->front + i) % q->capacity];
+        if (m->expires_us == 0 || m->expires_us > now_us) continue;
+        if (m->priority >= PRIORITY_MIN && m->priority <= PRIORITY_MAX) {
+            if (swept) q->expiry.swept[m->priority]++;
+            else q->expiry.at_dequeue[m->priority]++;
+        }
+        taken[i] = 1;
+        out[n++] = *m;
+    }
+    if (n == 0) return 0;
+
+    remove_marked(q, taken, n, now_us);
+    for (i = 0; i < n; i++) {
+        if (sem_trywait(&q->items_available) != 0) q->token_debt++;
+    }
+
+    DBG(DBG_TRACE, "Expiry: dropped %d item(s) (%s), count=%d, debt=%d",
+        n, swept ? "sweeper" : "dequeue", q->count, q->token_debt);
+    return n;
+}
+
+/* Returns the slots (and shared tokens) of dropped items to producers */
+static void release_dropped(Queue *q, const Message *msgs, int n)
+{
+    if (n <= 0) return;
+    release_slots(q, n);
+    release_shared(q, msgs, n);
+}
+
+/*
+ * Blocking Dequeue with accurate block detection.
+ *
+ * Same pattern as enqueue: sem_trywait to detect blocking,
+ * then blocking sem_wait if needed (with wait = 0 it returns 1
+ * instead, for queue_try_dequeue). With TTL enabled, expired items
+ * are dropped first; if that leaves nothing for this token, the token
+ * pays one unit of token_debt and the consumer waits again.
+ *
+ * ERROR HANDLING: Same strategy as queue_enqueue_safe (see above).
+ */
+static int dequeue_one(Queue *q, Message *msg, int wait, int *was_blocked, long *wait_time_ms)
+{
+    Message dropped[MAX_QUEUE_SIZE];
+    int result, n_dropped;
+    int blocked = 0;
+    long wait_start = 0;
+
+    if (q == NULL || msg == NULL) return -1;
+    if (q->shutdown) return -1;
+
+    for (;;) {
+        result = acquire_item(q, wait, &blocked, &wait_start, "queue_dequeue");
+        if (result != 0) return result;
+
+        /* Re-check shutdown after acquiring semaphore */
+        if (q->shutdown) {
+            sem_post(&q->items_available);
+            return -1;
+        }
+
+        /* 2. Critical Section — mutex protects buffer/indices */
+        if (pthread_mutex_lock(&q->mutex) != 0) {
+            /* Error handling: Mutex lock failure — return semaphore token */
+            fprintf(stderr, "[ERROR] queue_dequeue: mutex lock failed\n");
+            sem_post(&q->items_available);
+            return -1;
+        }
+
+        n_dropped = purge_expired(q, dropped, MAX_QUEUE_SIZE, 0);
+        if (q->count > 0 || q->token_debt == 0) break;
+
+        /* Our token belonged to an item that was dropped */
+        q->token_debt--;
+        q->expiry.phantom_wakeups++;
+        pthread_mutex_unlock(&q->mutex);
+        release_dropped(q, dropped, n_dropped);
+    }
+
+    result = internal_dequeue(q, msg);
+
+    if (result == 0) {
+        DBG(DBG_TRACE, "Dequeue: pri=%d, data=%d, from P%d, count=%d/%d",
+            msg->priority, msg->data, msg->producer_id,
+            q->count, q->capacity);
+    }
+
+    if (pthread_mutex_unlock(&q->mutex) != 0) {
+        /* Error handling: Mutex unlock failure — no safe recovery */
+        fprintf(stderr, "[ERROR] queue_dequeue: mutex unlock failed\n");
+    }
+    release_dropped(q, dropped, n_dropped);
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms) {
+        *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
+    }
+
+    if (result != 0) {
+        /* Error handling: internal_dequeue failed (underflow).
+         * Return the items token since we didn't actually remove an item. */
+        sem_post(&q->items_available);
+        return -1;
+    }
+
+    /* 3. Signal Producers — one slot is now free (a leased item
+     * keeps it until queue_release) */
+    if (!q->hold_slots) {
+        release_slots(q, 1);
+        release_shared(q, msg, 1);
+    }
+
+    return 0;
+}
+
+int queue_dequeue_safe(Queue *q, Message *msg, int *was_blocked, long *wait_time_ms)
+{
+    return dequeue_one(q, msg, 1, was_blocked, wait_time_ms);
+}
+
+int queue_try_dequeue(Queue *q, Message *msg)
+{
+    return dequeue_one(q, msg, 0, NULL, NULL);
+}
+
+/*
+ * Error handling: Same token discipline as queue_dequeue_safe. Extra
+ * tokens come from sem_trywait only, so the call never blocks for more
+ * than the first item; on any failure every token taken is returned.
+ * Tokens left over after expired items are dropped pay token_debt.
+ */
+int queue_dequeue_batch_safe(Queue *q, Message *msgs, int max_items,
+                             int *was_blocked, long *wait_time_ms)
+{
+    Message dropped[MAX_QUEUE_SIZE];
+    int k, i, result, n_dropped;
+    int blocked = 0;
+    long wait_start = 0;
+
+    if (q == NULL || msgs == NULL || max_items < 1) return -1;
+    if (q->shutdown) return -1;
+
+    for (;;) {
+        /* 1. First token: identical to the single dequeue, may block */
+        if (acquire_item(q, 1, &blocked, &wait_start, "queue_dequeue_batch") != 0) return -1;
+
+        if (q->shutdown) {
+            sem_post(&q->items_available);
+            return -1;
+        }
+
+        /* Extra tokens: only what is already there */
+        k = 1;
+        while (k < max_items && sem_trywait(&q->items_available) == 0) k++;
+
+        /* 2. Critical Section — one lock for all k items */
+        if (pthread_mutex_lock(&q->mutex) != 0) {
+            fprintf(stderr, "[ERROR] queue_dequeue_batch: mutex lock failed\n");
+            for (i = 0; i < k; i++) sem_post(&q->items_available);
+            return -1;
+        }
+
+        n_dropped = purge_expired(q, dropped, MAX_QUEUE_SIZE, 0);
+        if (q->count < k && q->token_debt > 0) {
+            /* Tokens of dropped items: pay the debt with the surplus */
+            int surplus = k - q->count;
+            if (surplus > q->token_debt) surplus = q->token_debt;
+            q->token_debt -= surplus;
+            k -= surplus;
+            if (k == 0) q->expiry.phantom_wakeups++;
+        }
+        if (k > 0) break;
+
+        pthread_mutex_unlock(&q->mutex);
+        release_dropped(q, dropped, n_dropped);
+    }
+
+    result = internal_dequeue_topk(q, msgs, k);
+
+    if (result == 0) {
+        DBG(DBG_TRACE, "Dequeue batch: k=%d, top pri=%d, count=%d/%d",
+            k, msgs[0].priority, q->count, q->capacity);
+    }
+
+    if (pthread_mutex_unlock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_dequeue_batch: mutex unlock failed\n");
+    }
+    release_dropped(q, dropped, n_dropped);
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms) {
+        *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
+    }
+
+    if (result != 0) {
+        for (i = 0; i < k; i++) sem_post(&q->items_available);
+        return -1;
+    }
+
+    /* 3. Signal Producers — k slots are now free (one atomic step
+     * in credit mode) */
+    if (!q->hold_slots) {
+        release_slots(q, k);
+        release_shared(q, msgs, k);
+    }
+
+    return k;
+}
+
+/* --- Public API: Selective Receive --- */
+
+int queue_filter_matches(const MessageFilter *filter, const Message *msg)
+{
+    if (filter == NULL || msg == NULL) return 0;
+    if (msg->priority < filter->min_priority || msg->priority > filter->max_priority) return 0;
+    if (filter->producer_mask == 0) return 1;
+    if (msg->producer_id < 1 || msg->producer_id > MAX_PRODUCERS) return 0;
+    return (filter->producer_mask >> msg->producer_id) & 1u;
+}
+
+void queue_filter_describe(const MessageFilter *filter, char *buf, size_t size)
+{
+    size_t len;
+    int p, first = 1;
+
+    if (buf == NULL || size == 0) return;
+    buf[0] = '\0';
+    if (filter == NULL) return;
+
+    snprintf(buf, size, "priority %d-%d", filter->min_priority, filter->max_priority);
+    if (filter->producer_mask == 0) return;
+
+    len = strlen(buf);
+    snprintf(buf + len, size - len, ", producers ");
+    for (p = 1; p <= MAX_PRODUCERS; p++) {
+        if (!((filter->producer_mask >> p) & 1u)) continue;
+        len = strlen(buf);
+        snprintf(buf + len, size - len, "%s%d", first ? "" : ",", p);
+        first = 0;
+    }
+}
+
+/*
+ * Best matching item by ring index, or -1. Only positions set in the
+ * combined bitmap are visited; 'examined' counts them.
+ * NOTE: Caller must hold the mutex!
+ */
+static int find_filtered_index(const Queue *q, const MessageFilter *f, int *examined)
+{
+    unsigned int match = 0, producers = 0;
+    int p, pos, index, eff, best = -1, best_eff = -1;
+    long best_stamp = 0, now_ms;
+
+    for (p = f->min_priority; p <= f->max_priority; p++) match |= q->prio_index[p];
+    if (f->producer_mask != 0) {
+        for (p = 1; p <= MAX_PRODUCERS; p++) {
+            if ((f->producer_mask >> p) & 1u) producers |= q->producer_index[p];
+        }
+        match &= producers;
+    }
+    if (match == 0) return -1;
+
+    /* Same order as find_highest_priority_index: effective priority,
+     * then oldest timestamp, then ring position (lowest bit first) */
+    now_ms = get_current_time_ms();
+    while (match != 0) {
+        pos = __builtin_ctz(match);
+        match &= match - 1;
+        (*examined)++;
+
+        index = (q->front + pos) % q->capacity;
+        eff = effective_priority(q, &q->buffer[index], now_ms);
+        if (best < 0 || eff > best_eff ||
+            (eff == best_eff && q->buffer[index].timestamp < best_stamp)) {
+            best = index;
+            best_eff = eff;
+            best_stamp = q->buffer[index].timestamp;
+        }
+    }
+    return best;
+}
+
+/*
+ * Parks a filtered consumer until a matching arrival signals it.
+ * The wait is bounded by FILTER_WAIT_POLL_MS so shutdown (which may run
+ * in a signal handler and cannot take the queue mutex) is noticed.
+ * NOTE: Caller must hold the mutex!
+ */
+static void filter_wait(Queue *q, FilterWaiter *w)
+{
+    struct timespec deadline;
+    int i, registered = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += FILTER_WAIT_POLL_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    w->signalled = 0;
+    if (q->num_filter_waiters < MAX_CONSUMERS) {
+        q->filter_waiters[q->num_filter_waiters++] = w;
+        registered = 1;
+    }
+
+    pthread_cond_timedwait(&w->cond, &q->mutex, &deadline);
+
+    if (!registered) return;
+    for (i = 0; i < q->num_filter_waiters; i++) {
+        if (q->filter_waiters[i] != w) continue;
+        q->filter_waiters[i] = q->filter_waiters[--q->num_filter_waiters];
+        break;
+    }
+}
+
+/*
+ * Error handling: Same slot discipline as queue_dequeue_safe. The items
+ * token is taken with sem_trywait only; if an unfiltered consumer holds
+ * it already, token_debt records it and that consumer pays it off when
+ * it finds nothing left (the TTL path uses the same mechanism).
+ */
+int queue_dequeue_filtered(Queue *q, const MessageFilter *filter, Message *msg,
+                           int *was_blocked, long *wait_time_ms)
+{
+    Message dropped[MAX_QUEUE_SIZE];
+    FilterWaiter waiter;
+    int index = -1, n_dropped = 0, examined = 0, woken = 0, depth;
+    int blocked = 0;
+    long wait_start = 0;
+
+    if (q == NULL || filter == NULL || msg == NULL || !q->index_enabled) return -1;
+    if (q->shutdown) return -1;
+
+    waiter.filter = filter;
+    waiter.signalled = 0;
+    if (pthread_cond_init(&waiter.cond, NULL) != 0) {
+        fprintf(stderr, "[ERROR] queue_dequeue_filtered: cond init failed\n");
+        return -1;
+    }
+
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_dequeue_filtered: mutex lock failed\n");
+        pthread_cond_destroy(&waiter.cond);
+        return -1;
+    }
+
+    for (;;) {
+        n_dropped = purge_expired(q, dropped, MAX_QUEUE_SIZE, 0);
+        index = find_filtered_index(q, filter, &examined);
+        if (index >= 0 || q->shutdown) break;
+        if (woken) q->filter.stale_wakeups++;
+
+        /* Slots of dropped items go back before we sleep */
+        release_dropped(q, dropped, n_dropped);
+        n_dropped = 0;
+
+        if (!blocked) {
+            blocked = 1;
+            wait_start = get_current_time_ms();
+            q->filter.waits++;
+        }
+        filter_wait(q, &waiter);
+        woken = waiter.signalled;
+    }
+
+    if (index < 0) {
+        pthread_mutex_unlock(&q->mutex);
+        pthread_cond_destroy(&waiter.cond);
+        release_dropped(q, dropped, n_dropped);
+        return -1;
+    }
+
+    depth = q->count;
+    remove_at(q, index, msg);
+    if (sem_trywait(&q->items_available) != 0) q->token_debt++;
+
+    q->filter.dequeues++;
+    q->filter.candidates += examined;
+    q->filter.depth_sum += depth;
+
+    DBG(DBG_TRACE, "Dequeue filtered: pri=%d, from P%d, %d candidate(s) of %d, debt=%d",
+        msg->priority, msg->producer_id, examined, depth, q->token_debt);
+
+    if (pthread_mutex_unlock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_dequeue_filtered: mutex unlock failed\n");
+    }
+    pthread_cond_destroy(&waiter.cond);
+    release_dropped(q, dropped, n_dropped);
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms) {
+        *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
+    }
+
+    if (!q->hold_slots) {
+        release_slots(q, 1);
+        release_shared(q, msg, 1);
+    }
+    return 0;
+}
+
+void queue_filter_stats(Queue *q, QueueFilterStats *out)
+{
+    if (out == NULL) return;
+    memset(out, 0, sizeof(*out));
+    if (q == NULL) return;
+
+    if (pthread_mutex_lock(&q->mutex) != 0) return;
+    *out = q->filter;
+    pthread_mutex_unlock(&q->mutex);
+}
+
+/* --- Public API: At-Least-Once Delivery --- */
+
+/*
+ * Error handling: The slot is still held by the lease, so the buffer
+ * cannot be full; an overflow here means the slot accounting is broken
+ * and is reported by internal_enqueue.
+ */
+int queue_requeue(Queue *q, Message msg)
+{
+    int result;
+
+    if (q == NULL || !q->hold_slots) return -1;
 
-int queue_is_empty(const Queue *q) {
-    if (!q) return 1;
-    return (q->count == 0);
-}
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_requeue: mutex lock failed\n");
+        return -1;
+    }
+    result = internal_enqueue(q, msg);
+    pthread_mutex_unlock(&q->mutex);
+    if (result != 0) return -1;
 
-int queue_get_count(const Queue *q) {
-    if (!q) return 0;
-    return q->count;
+    if (sem_post(&q->items_available) != 0) {
+        fprintf(stderr, "[ERROR] queue_requeue: sem_post(items) failed "
+                "(errno=%d: %s)\n", errno, strerror(errno));
+    }
+    ready_notify(q, 1);
+    return 0;
 }
 
-int queue_get_capacity(const Queue *q) {
-    if (!q) return 0;
-    return q->capacity;
+void queue_release(Queue *q, const Message *msgs, int n)
+{
+    if (q == NULL || msgs == NULL || n <= 0) return;
+    release_slots(q, n);
+    release_shared(q, msgs, n);
 }
 
-void queue_display(const Queue *q)
+/* --- Public API: Partitioned Delivery --- */
+
+/*
+ * Small consecutive ids (producers 1..N) must still spread evenly, so
+ * every input bit is mixed into the low bits (murmur3 finaliser).
+ */
+int queue_partition_of(const Queue *q, const Message *msg)
 {
-    int i, index;
-    if (!q) return;
+    unsigned int h;
+
+    if (q == NULL || msg == NULL || q->partitions < 1) return 0;
+    h = (unsigned int)((msg->key != 0) ? msg->key : msg->producer_id);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return (int)(h % (unsigned int)q->partitions);
+}
 
-    printf("Queue Status: %d/%d items (Shutdown=%d)\n",
-           q->count, q->capacity, q->shutdown);
+/*
+ * Oldest item in a partition nobody holds: the lowest set bit of the
+ * free partitions' bitmaps is its logical position.
+ * Returns: ring index, or -1 if every queued item is in a leased partition.
+ * NOTE: Caller must hold the mutex!
+ */
+static int find_partition_index(const Queue *q)
+{
+    unsigned int avail = 0;
+    int p;
 
-    for (i = 0; i < q->count; i++) {
-        index = (q->front + i) % q->capacity;
-        printf("    [%d] Prod:%d Pri:%d Data:%d\n",
-               index, q->buffer[index].producer_id,
-               q->buffer[index].priority, q->buffer[index].data);
+    for (p = 0; p < q->partitions; p++) {
+        if (q->partition_owner[p] == 0) avail |= q->partition_index[p];
     }
+    if (avail == 0) return -1;
+    return (q->front + __builtin_ctz(avail)) % q->capacity;
 }
 
-/* --- Public API: Thread-Safe Operations --- */
+/*
+ * Sleeps on partition_cond for at most PARTITION_WAIT_POLL_MS.
+ * The bound lets shutdown (flag only, may run in a signal handler)
+ * be noticed. NOTE: Caller must hold the mutex!
+ */
+static void partition_wait(Queue *q)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += PARTITION_WAIT_POLL_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    q->partition_waiters++;
+    pthread_cond_timedwait(&q->partition_cond, &q->mutex, &deadline);
+    q->partition_waiters--;
+}
 
 /*
- * Blocking Enqueue with accurate block detection.
- *
- * Uses sem_trywait first to detect if the thread would block.
- * If trywait fails with EAGAIN (semaphore at 0), we fall back
- * to blocking sem_wait and set was_blocked = 1.
- *
- * ERROR HANDLING:
- *   - sem_trywait EAGAIN: Normal — means "would block", not an error
- *   - sem_trywait other:  Unexpected failure — log and return error
- *   - sem_wait EINTR:     Signal interrupted the wait — retry in loop
- *   - sem_wait other:     Unexpected failure — log and return error
- *   - mutex lock fail:    Fatal for data integrity — log and return error
- *   - sem_post fail:      Semaphore overflow — log (should never happen)
+ * Error handling: Same as queue_dequeue_filtered — the token is taken
+ * without blocking (token_debt if another path holds it), and dropped
+ * items' slots are returned before sleeping.
  */
-int queue_enqueue_safe(Queue *q, Message msg, int *was_blocked, long *wait_time_ms)
+int queue_dequeue_partitioned(Queue *q, int owner, Message *msg, int *partition,
+                              int *was_blocked, long *wait_time_ms)
 {
-    int result;
+    Message dropped[MAX_QUEUE_SIZE];
+    int index = -1, n_dropped = 0, p;
     int blocked = 0;
     long wait_start = 0;
+    long long now_us;
 
-    if (q == NULL) return -1;
+    if (q == NULL || msg == NULL || partition == NULL || q->partitions < 1) return -1;
+    if (owner < 1 || owner > MAX_CONSUMERS) return -1;
+    *partition = -1;
     if (q->shutdown) return -1;
 
-    /* 1. Try non-blocking acquire to detect if we would block */
-    result = sem_trywait(&q->slots_available);
-    if (result != 0) {
-        if (errno == EAGAIN) {
-            /* Normal: semaphore is 0, queue is full, we will block */
-            blocked = 1;
-            wait_start = get_current_time_ms();
-        } else {
-            /* Error handling: Unexpected sem_trywait failure.
-             * Could be EINVAL (invalid semaphore) or other system error. */
-            fprintf(stderr, "[ERROR] queue_enqueue: sem_trywait failed "
-                    "(errno=%d: %s)\n", errno, strerror(errno));
-            return -1;
-        }
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_dequeue_partitioned: mutex lock failed\n");
+        return -1;
+    }
 
-        /* Fall back to blocking wait, retrying on signal interrupts */
-        do {
-            result = sem_wait(&q->slots_available);
-        } while (result != 0 && errno == EINTR && !q->shutdown);
+    for (;;) {
+        n_dropped = purge_expired(q, dropped, MAX_QUEUE_SIZE, 0);
+        index = find_partition_index(q);
+        if (index >= 0 || q->shutdown) break;
 
-        if (result != 0) {
-            /* Error handling: sem_wait failed with non-EINTR error,
-             * or EINTR during shutdown. Either way we cannot proceed. */
-            if (errno != EINTR) {
-                fprintf(stderr, "[ERROR] queue_enqueue: sem_wait failed "
-                        "(errno=%d: %s)\n", errno, strerror(errno));
-            }
-            return -1;
-        }
+        release_dropped(q, dropped, n_dropped);
+        n_dropped = 0;
 
-        if (q->shutdown) {
-            /* Error handling: Acquired semaphore but shutdown was signalled.
-             * Return the token to avoid leaking a semaphore count. */
-            sem_post(&q->slots_available);
-            return -1;
+        if (!blocked) {
+            blocked = 1;
+            wait_start = get_current_time_ms();
+            /* Work exists, but only in partitions other consumers hold */
+            if (q->count > 0) q->partition.lease_waits++;
         }
+        partition_wait(q);
     }
 
-    /* Re-check shutdown after acquiring semaphore (could have changed) */
-    if (q->shutdown) {
-        sem_post(&q->slots_available);
+    if (index < 0) {
+        pthread_mutex_unlock(&q->mutex);
+        release_dropped(q, dropped, n_dropped);
         return -1;
     }
 
+    remove_at(q, index, msg);
+    if (sem_trywait(&q->items_available) != 0) q->token_debt++;
+
+    /* Lease the partition */
+    p = queue_partition_of(q, msg);
+    now_us = time_now_us();
+    q->partition_owner[p] = owner;
+    q->partition.acquisitions++;
+    q->partition.delivered[p]++;
+    q->partition.owners[p] |= 1u << owner;
+    if (q->partition_last[p] != 0 && q->partition_last[p] != owner) q->partition.handoffs++;
+    if (q->partition_free_us[p] > 0) {
+        histogram_record(&q->partition.handoff_us, now_us - q->partition_free_us[p]);
+        q->partition_free_us[p] = 0;
+    }
+    *partition = p;
+
+    DBG(DBG_TRACE, "Dequeue partitioned: partition %d leased to C%d, from P%d, debt=%d",
+        p, owner, msg->producer_id, q->token_debt);
+
+    if (pthread_mutex_unlock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_dequeue_partitioned: mutex unlock failed\n");
+    }
+    release_dropped(q, dropped, n_dropped);
+
     if (was_blocked) *was_blocked = blocked;
     if (wait_time_ms) {
         *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
     }
 
-    /* 2. Critical Section — mutex protects buffer/indices */
+    release_slots(q, 1);
+    release_shared(q, msg, 1);
+    return 0;
+}
+
+void queue_partition_release(Queue *q, int partition, int owner)
+{
+    if (q == NULL || partition < 0 || partition >= q->partitions) return;
+
     if (pthread_mutex_lock(&q->mutex) != 0) {
-        /* Error handling: Mutex lock failure is critical.
-         * Could indicate deadlock or corrupted mutex.
-         * Return the semaphore token and abort this operation. */
-        fprintf(stderr, "[ERROR] queue_enqueue: mutex lock failed\n");
-        sem_post(&q->slots_available);
-        return -1;
+        fprintf(stderr, "[ERROR] queue_partition_release: mutex lock failed\n");
+        return;
+    }
+    if (q->partition_owner[partition] == owner) {
+        q->partition_owner[partition] = 0;
+        q->partition_last[partition] = owner;
+        /* Backlog: the hand-off clock runs until someone leases it */
+        if (q->partition_index[partition] != 0) {
+            q->partition_free_us[partition] = time_now_us();
+            if (q->partition_waiters > 0) pthread_cond_broadcast(&q->partition_cond);
+        }
     }
+    pthread_mutex_unlock(&q->mutex);
+}
 
-    result = internal_enqueue(q, msg);
+void queue_partition_stats(Queue *q, QueuePartitionStats *out)
+{
+    if (out == NULL) return;
+    memset(out, 0, sizeof(*out));
+    histogram_init(&out->handoff_us);
+    if (q == NULL) return;
 
-    if (result == 0) {
-        DBG(DBG_TRACE, "Enqueue: pri=%d, slot=%d, count=%d/%d, was_blocked=%d",
-            msg.priority, (q->rear - 1 + q->capacity) % q->capacity,
-            q->count, q->capacity, blocked);
+    if (pthread_mutex_lock(&q->mutex) != 0) return;
+    *out = q->partition;
+    pthread_mutex_unlock(&q->mutex);
+}
+
+/* --- Public API: Key Coalescing --- */
+
+void queue_coalesce_stats(Queue *q, QueueCoalesceStats *out)
+{
+    if (out == NULL) return;
+    memset(out, 0, sizeof(*out));
+    if (q == NULL) return;
+
+    if (pthread_mutex_lock(&q->mutex) != 0) return;
+    *out = q->coalesce;
+    pthread_mutex_unlock(&q->mutex);
+}
+
+int queue_coalesced_total(const Queue *q)
+{
+    if (q == NULL) return 0;
+    return (int)q->coalesce.coalesced;
+}
+
+/* --- Public API: Message TTL --- */
+
+/*
+ * Error handling: Mutex failure returns -1 and removes nothing; the
+ * sweeper just tries again on its next pass.
+ */
+int queue_sweep_expired(Queue *q, int max_items)
+{
+    Message dropped[MAX_QUEUE_SIZE];
+    long long start_us, held_us;
+    int n;
+
+    if (q == NULL || max_items < 1) return -1;
+    if (max_items > MAX_QUEUE_SIZE) max_items = MAX_QUEUE_SIZE;
+
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_sweep_expired: mutex lock failed\n");
+        return -1;
     }
+    start_us = time_now_us();
 
-    if (pthread_mutex_unlock(&q->mutex) != 0) {
-        /* Error handling: Mutex unlock failure.
-         * The data was already written, but other threads may deadlock.
-         * Log the error — there's no safe recovery from this. */
-        fprintf(stderr, "[ERROR] queue_enqueue: mutex unlock failed\n");
+    n = purge_expired(q, dropped, max_items, 1);
+
+    q->expiry.sweeps++;
+    held_us = time_now_us() - start_us;
+    if (held_us > q->expiry.sweep_hold_max_us) q->expiry.sweep_hold_max_us = held_us;
+    pthread_mutex_unlock(&q->mutex);
+
+    release_dropped(q, dropped, n);
+    return n;
+}
+
+void queue_expiry_stats(Queue *q, QueueExpiryStats *out)
+{
+    if (out == NULL) return;
+    memset(out, 0, sizeof(*out));
+    if (q == NULL) return;
+
+    if (pthread_mutex_lock(&q->mutex) != 0) return;
+    *out = q->expiry;
+    pthread_mutex_unlock(&q->mutex);
+}
+
+int queue_expired_total(const Queue *q)
+{
+    long long total = 0;
+    int p;
+
+    if (q == NULL) return 0;
+    for (p = 0; p <= PRIORITY_MAX; p++) {
+        total += q->expiry.at_dequeue[p] + q->expiry.swept[p];
     }
+    return (int)total;
+}
 
-    if (result != 0) {
-        /* Error handling: internal_enqueue failed (buffer overflow).
-         * Return the slots token since we didn't actually add an item. */
-        sem_post(&q->slots_available);
+/* --- Public API: Dequeue Policy --- */
+
+/* Quantum of MLFQ level 'level' (level 0 = the configured quantum) */
+static long long mlfq_quantum_us(const QueueMlfq *m, int level)
+{
+    long long quantum = m->quantum_us;
+
+    while (level-- > 0) quantum *= MLFQ_QUANTUM_FACTOR;
+    return quantum;
+}
+
+int queue_set_policy(Queue *q, QueuePolicy policy, int quantum_us)
+{
+    if (q == NULL) return -1;
+    if (policy != QUEUE_POLICY_PRIORITY && policy != QUEUE_POLICY_MLFQ) {
+        fprintf(stderr, "[ERROR] queue_set_policy: unknown policy %d\n", (int)policy);
         return -1;
     }
-
-    /* 3. Signal Consumers — one new item is available */
-    if (sem_post(&q->items_available) != 0) {
-        /* Error handling: sem_post failed — likely SEM_VALUE_MAX overflow.
-         * This would desynchronise the semaphore count. Log the error. */
-        fprintf(stderr, "[ERROR] queue_enqueue: sem_post(items) failed "
-                "(errno=%d: %s)\n", errno, strerror(errno));
+    if (policy == QUEUE_POLICY_MLFQ && (quantum_us < 1 || quantum_us > MAX_MLFQ_QUANTUM_US)) {
+        fprintf(stderr, "[ERROR] queue_set_policy: quantum %d us out of range [1, %d]\n",
+                quantum_us, MAX_MLFQ_QUANTUM_US);
+        return -1;
     }
 
+    q->policy = policy;
+    memset(&q->mlfq, 0, sizeof(q->mlfq));
+    q->mlfq.quantum_us = quantum_us;
+    q->mlfq.last_reset_us = time_now_us();
     return 0;
 }
 
 /*
- * Blocking Dequeue with accurate block detection.
- *
- * Same pattern as enqueue: sem_trywait to detect blocking,
- * then blocking sem_wait if needed.
+ * One step per report: a class moves at most one level per message,
+ * so a single odd job cannot throw it from the top to the bottom.
  *
- * ERROR HANDLING: Same strategy as queue_enqueue_safe (see above).
+ * Error handling: Out-of-range priorities (no class) and a failed lock
+ * are ignored; the class simply keeps its level.
  */
-int queue_dequeue_safe(Queue *q, Message *msg, int *was_blocked, long *wait_time_ms)
+void queue_policy_charge(Queue *q, const Message *msg, long long service_us)
 {
-    int result;
-    int blocked = 0;
-    long wait_start = 0;
-
-    if (q == NULL || msg == NULL) return -1;
-    if (q->shutdown) return -1;
-
-    /* 1. Try non-blocking acquire to detect if we would block */
-    result = sem_trywait(&q->items_available);
-    if (result != 0) {
-        if (errno == EAGAIN) {
-            /* Normal: semaphore is 0, queue is empty, we will block */
-            blocked = 1;
-            wait_start = get_current_time_ms();
-        } else {
-            /* Error handling: Unexpected sem_trywait failure */
-            fprintf(stderr, "[ERROR] queue_dequeue: sem_trywait failed "
-                    "(errno=%d: %s)\n", errno, strerror(errno));
-            return -1;
-        }
+    QueueMlfq *m;
+    long long now_us;
+    int c, level;
+
+    if (q == NULL || msg == NULL || q->policy != QUEUE_POLICY_MLFQ) return;
+    if (msg->priority < PRIORITY_MIN || msg->priority > PRIORITY_MAX) return;
+    if (service_us < 0) service_us = 0;
+
+    now_us = time_now_us();
+    if (pthread_mutex_lock(&q->mutex) != 0) return;
+    m = &q->mlfq;
+
+    /* Periodic reset: every class back on the top level */
+    if (now_us - m->last_reset_us >= MLFQ_RESET_MS * 1000LL) {
+        for (c = PRIORITY_MIN; c <= PRIORITY_MAX; c++) m->level[c] = 0;
+        m->resets++;
+        m->last_reset_us = now_us;
+    }
 
-        /* Fall back to blocking wait, retrying on signal interrupts */
-        do {
-            result = sem_wait(&q->items_available);
-        } while (result != 0 && errno == EINTR && !q->shutdown);
+    c = msg->priority;
+    level = m->level[c];
+    m->charged[c]++;
+    m->service_us[c] += service_us;
+    if (service_us > mlfq_quantum_us(m, level) && level < MLFQ_LEVELS - 1) {
+        m->level[c] = level + 1;
+        m->demotions++;
+    } else if (level > 0 && service_us <= mlfq_quantum_us(m, level - 1)) {
+        m->level[c] = level - 1;
+        m->promotions++;
+    }
+    pthread_mutex_unlock(&q->mutex);
+}
 
-        if (result != 0) {
-            if (errno != EINTR) {
-                fprintf(stderr, "[ERROR] queue_dequeue: sem_wait failed "
-                        "(errno=%d: %s)\n", errno, strerror(errno));
-            }
-            return -1;
-        }
+void queue_policy_stats(Queue *q, QueueMlfq *out)
+{
+    if (q == NULL || out == NULL) return;
+    if (pthread_mutex_lock(&q->mutex) != 0) return;
+    *out = q->mlfq;
+    pthread_mutex_unlock(&q->mutex);
+}
 
-        if (q->shutdown) {
-            sem_post(&q->items_available);
-            return -1;
-        }
+const char *queue_policy_name(QueuePolicy policy)
+{
+    switch (policy) {
+        case QUEUE_POLICY_PRIORITY: return "priority";
+        case QUEUE_POLICY_MLFQ:     return "mlfq";
+        default:                    return "unknown";
     }
+}
 
-    /* Re-check shutdown after acquiring semaphore */
-    if (q->shutdown) {
-        sem_post(&q->items_available);
-        return -1;
-    }
+/* --- Public API: Occupancy Tracking --- */
 
-    if (was_blocked) *was_blocked = blocked;
-    if (wait_time_ms) {
-        *wait_time_ms = blocked ? (get_current_time_ms() - wait_start) : 0;
-    }
+/*
+ * Error handling: Mutex failure returns -1 and leaves 'out' untouched;
+ * the caller simply omits the exact occupancy section.
+ */
+int queue_occupancy_snapshot(Queue *q, QueueOccupancy *out)
+{
+    long long now_us;
+    int i;
+
+    if (q == NULL || out == NULL) return -1;
 
-    /* 2. Critical Section — mutex protects buffer/indices */
     if (pthread_mutex_lock(&q->mutex) != 0) {
-        /* Error handling: Mutex lock failure — return semaphore token */
-        fprintf(stderr, "[ERROR] queue_dequeue: mutex lock failed\n");
-        sem_post(&q->items_available);
+        fprintf(stderr, "[ERROR] queue_occupancy_snapshot: mutex lock failed\n");
         return -1;
     }
 
-    result = internal_dequeue(q, msg);
+    now_us = time_now_us();
+    *out = q->occupancy;
 
-    if (result == 0) {
-        DBG(DBG_TRACE, "Dequeue: pri=%d, data=%d, from P%d, count=%d/%d",
-            msg->priority, msg->data, msg->producer_id,
-            q->count, q->capacity);
+    /* Close the copy at 'now' without disturbing the live tracker */
+    if (now_us > out->last_change_us) {
+        out->depth_us[q->count] += now_us - out->last_change_us;
     }
-
-    if (pthread_mutex_unlock(&q->mutex) != 0) {
-        /* Error handling: Mutex unlock failure — no safe recovery */
-        fprintf(stderr, "[ERROR] queue_dequeue: mutex unlock failed\n");
+    out->last_change_us = now_us;
+    if (out->episode_state == 1) {
+        histogram_record(&out->full_episodes, now_us - out->episode_start_us);
+    } else if (out->episode_state == -1) {
+        histogram_record(&out->empty_episodes, now_us - out->episode_start_us);
     }
 
-    if (result != 0) {
-        /* Error handling: internal_dequeue failed (underflow).
-         * Return the items token since we didn't actually remove an item. */
-        sem_post(&q->items_available);
-        return -1;
+    /* Items still queued have been in the integral but were never
+     * dequeued; their time so far (within the window) completes L = lambda*W */
+    out->residual_items = q->count;
+    out->residual_us = 0;
+    for (i = 0; i < q->count; i++) {
+        long long entered = q->buffer[(q->front + i) % q->capacity].enqueue_us;
+        if (entered < out->since_us) entered = out->since_us;
+        out->residual_us += now_us - entered;
     }
 
-    /* 3. Signal Producers — one slot is now free */
-    if (sem_post(&q->slots_available) != 0) {
-        /* Error handling: sem_post failed — semaphore count corruption */
-        fprintf(stderr, "[ERROR] queue_dequeue: sem_post(slots) failed "
-                "(errno=%d: %s)\n", errno, strerror(errno));
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+void queue_occupancy_reset(Queue *q)
+{
+    QueueOccupancy *occ;
+    long long now_us;
+
+    if (q == NULL) return;
+    if (pthread_mutex_lock(&q->mutex) != 0) {
+        fprintf(stderr, "[ERROR] queue_occupancy_reset: mutex lock failed\n");
+        return;
     }
 
-    return 0;
+    occ = &q->occupancy;
+    now_us = time_now_us();
+    memset(occ->depth_us, 0, sizeof(occ->depth_us));
+    histogram_init(&occ->full_episodes);
+    histogram_init(&occ->empty_episodes);
+    occ->since_us = now_us;
+    occ->last_change_us = now_us;
+    occ->episode_state = occupancy_state(q);
+    occ->episode_start_us = now_us;
+
+    pthread_mutex_unlock(&q->mutex);
+}
+
+long long queue_occupancy_window_us(const QueueOccupancy *occ)
+{
+    if (occ == NULL) return 0;
+    return occ->last_change_us - occ->since_us;
+}
+
+double queue_occupancy_mean(const QueueOccupancy *occ)
+{
+    double weighted = 0.0;
+    long long window;
+    int depth;
+
+    window = queue_occupancy_window_us(occ);
+    if (window <= 0) return 0.0;
+
+    for (depth = 0; depth <= MAX_QUEUE_SIZE; depth++) {
+        weighted += (double)depth * (double)occ->depth_us[depth];
+    }
+    return weighted / (double)window;
 }
 
 /*
@@ -552,6 +2703,9 @@ int queue_dequeue_safe(Queue *q, Message *msg, int *was_blocked, long *wait_time
  * Sets the shutdown flag and wakes all blocked threads by posting
  * to both semaphores enough times to cover worst-case (all threads waiting).
  *
+ * Takes no lock, so it stays callable from a signal handler: only the
+ * flag store, sem_post and the eventfd write() are used.
+ *
  * Error handling: sem_post failures during shutdown are non-fatal.
  * We continue posting to wake as many threads as possible.
  * The shutdown flag itself is what ultimately stops the threads.
@@ -562,7 +2716,7 @@ void queue_shutdown(Queue *q)
     if (q == NULL) return;
 
     /* Set flag first — threads check this after waking from sem_wait */
-    q->shutdown = 1;
+    __atomic_store_n(&q->shutdown, 1, __ATOMIC_SEQ_CST);
 
     /* Wake up all potentially sleeping threads.
      * We post enough times to cover worst-case: all threads waiting.
@@ -575,7 +2729,23 @@ void queue_shutdown(Queue *q)
         if (sem_post(&q->items_available) != 0 && errno != EOVERFLOW) {
             fprintf(stderr, "[WARN] queue_shutdown: sem_post(items) failed\n");
         }
+        if (sem_post(&q->shared_slots) != 0 && errno != EOVERFLOW) {
+            fprintf(stderr, "[WARN] queue_shutdown: sem_post(shared) failed\n");
+        }
     }
+
+    /* Epoll consumers sleep on the readiness eventfd (write() is
+     * async-signal-safe, like sem_post) */
+    if (q->ready_fd >= 0) {
+        uint64_t one = 1;
+        if (write(q->ready_fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) {
+            fprintf(stderr, "[WARN] queue_shutdown: eventfd write failed\n");
+        }
+    }
+
+    /* No mutex here (pthread_mutex_lock is not async-signal-safe): credit,
+     * filter and partition waiters use timed waits and see the flag
+     * within their poll interval */
 }
 
 /*
@@ -596,5 +2766,13 @@ Message message_create(int data, int priority, int producer_id)
     msg.priority = priority;
     msg.producer_id = producer_id;
     msg.timestamp = get_current_time_ms();
+    msg.intended_us = time_now_us();  /* closed loop: intended == created */
+    msg.enqueue_us = 0;
+    msg.not_before_us = 0;
+    msg.expires_us = 0;
+    msg.attempts = 0;
+    msg.key = 0;
+    msg.merged = 0;
+    msg.request = 0;
     return msg;
 }
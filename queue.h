@@ -13,11 +13,23 @@
 
 #include <pthread.h>
 #include <semaphore.h>
+#include <stddef.h>
 
 #include "config.h"
+#include "histogram.h"
 
 /* --- Data Structures --- */
 
+/*
+ * Admission classes for reserved capacity (--reserve).
+ * HIGH = priority >= RESERVED_PRIORITY_MIN.
+ */
+typedef enum {
+    PRIO_CLASS_NORMAL = 0,
+    PRIO_CLASS_HIGH,
+    PRIO_NUM_CLASSES
+} PriorityClass;
+
 /*
  * Represents a single work item passed between threads.
  * Includes metadata (producer_id, timestamp) for the required analysis report.
@@ -27,8 +39,163 @@ typedef struct {
     int priority;       // 0-9 (Higher values retrieved first)
     int producer_id;    // Traceability for logs
     long timestamp;     // Creation time (used to calculate latency)
+    long long intended_us; // Scheduled send time (monotonic us, open-loop correction)
+    long long enqueue_us;  // Actual enqueue time (monotonic us, set by the queue)
+    long long not_before_us; // Earliest delivery (monotonic us, 0 = immediate)
+    long long expires_us;  // Dropped unconsumed after this (monotonic us, 0 = never)
+    int attempts;          // Deliveries so far (--ack-timeout leases)
+    int key;               // Coalescing key (--coalesce, 0 = none)
+    int merged;            // Later updates folded into it while queued
+    int request;           // RPC completion slot + 1 (--rpc, 0 = no reply wanted)
 } Message;
 
+/*
+ * Selective receive filter (queue_dequeue_filtered).
+ * A message matches if its priority is in [min_priority, max_priority]
+ * and, when producer_mask is non-zero, bit producer_id is set.
+ */
+typedef struct {
+    unsigned int producer_mask; // Bit p = accept producer p (0 = any producer)
+    int min_priority;
+    int max_priority;
+} MessageFilter;
+
+/* A filtered consumer asleep until a matching arrival (defined in queue.c) */
+typedef struct FilterWaiter FilterWaiter;
+
+/* Disk tier for a full ring (--spill, defined in spill.h) */
+typedef struct SpillStore SpillStore;
+
+/*
+ * Filtered dequeue counters (protected by mutex).
+ * candidates / dequeues vs depth_sum / dequeues shows how much of the
+ * ring the indexes let a filtered consumer skip.
+ */
+typedef struct {
+    long long dequeues;              // Filtered dequeues completed
+    long long candidates;            // Matching items examined (index hits)
+    long long depth_sum;             // Queue depth at each filtered dequeue
+    long long waits;                 // Dequeues that slept because nothing matched
+    long long targeted_wakeups;      // Arrivals that woke a matching waiter
+    long long stale_wakeups;         // ...whose item was taken by someone else
+} QueueFilterStats;
+
+/*
+ * Key coalescing counters (protected by mutex).
+ * Every coalesced message is one slot and one dequeue that never happened.
+ */
+typedef struct {
+    long long stored;                // Keyed messages that took a new slot
+    long long coalesced;             // Keyed messages folded into a queued one
+    long long without_slot;          // ...found before taking a slot
+    long long slot_returned;         // ...found after taking one (handed straight back)
+    long long priority_raised;       // Folds that raised the queued priority
+    long long lookups;               // Hash lookups
+    long long probes;                // Buckets examined by those lookups
+    int max_merged;                  // Most updates folded into one message
+} QueueCoalesceStats;
+
+/*
+ * Partitioned delivery counters (protected by mutex).
+ * Skew = busiest partition's arrivals vs the mean; the hand-off cost
+ * is how long a partition with backlog sat unleased after a release.
+ */
+typedef struct {
+    long long arrivals[MAX_PARTITIONS];  // Messages stored per partition
+    long long delivered[MAX_PARTITIONS]; // Messages dequeued per partition
+    unsigned int owners[MAX_PARTITIONS]; // Bit c = consumer c ever leased it
+    long long acquisitions;          // Partition leases taken (one per message)
+    long long handoffs;              // ...by a different consumer than the last
+    long long lease_waits;           // Dequeues that slept although items were
+                                     // queued (all in leased partitions)
+    Histogram handoff_us;            // Release (backlog left) -> next lease
+} QueuePartitionStats;
+
+/*
+ * Readiness eventfd semantics (queue_enable_ready_fd).
+ * LEVEL: readable exactly while items are queued.
+ * EDGE:  written once per arrival and never reset (a reset by one
+ *        reader would cancel the wake-up pending in another's epoll
+ *        set); EPOLLET waiters wake once per write and drain with
+ *        queue_try_dequeue until the queue reports empty.
+ */
+typedef enum {
+    QUEUE_READY_LEVEL = 0,
+    QUEUE_READY_EDGE
+} QueueReadyMode;
+
+/*
+ * Dequeue policies (queue_set_policy): how waiting messages are ranked.
+ * Both break ties by FIFO order (oldest timestamp first).
+ */
+typedef enum {
+    QUEUE_POLICY_PRIORITY = 0,       // Static priority plus linear aging
+    QUEUE_POLICY_MLFQ                // Class level from observed service time
+} QueuePolicy;
+
+/* MLFQ state, one level per message class (protected by mutex) */
+typedef struct {
+    int quantum_us;                  // Level-0 quantum (x MLFQ_QUANTUM_FACTOR per level)
+    int level[PRIORITY_MAX + 1];     // Class -> level (0 = served first)
+    long long charged[PRIORITY_MAX + 1];    // Messages whose service was reported
+    long long service_us[PRIORITY_MAX + 1]; // Sum of their service times
+    long long demotions;
+    long long promotions;
+    long long resets;                // Periodic resets to level 0
+    long long last_reset_us;
+} QueueMlfq;
+
+/* Readiness notification counters (protected by mutex) */
+typedef struct {
+    long long signals;               // eventfd writes
+    long long clears;                // Level mode: reset when the queue emptied
+    long long write_failures;
+} QueueReadyStats;
+
+/*
+ * Exact time-weighted occupancy.
+ * Updated inside the critical section on every count change, so the
+ * integral sees every burst (the 1 Hz sampler only sees snapshots).
+ */
+typedef struct {
+    long long since_us;              // Start of the tracked window
+    long long last_change_us;        // When count last changed
+    long long depth_us[MAX_QUEUE_SIZE + 1]; // Time spent at each depth
+    int episode_state;               // 1 = full, -1 = empty, 0 = neither
+    long long episode_start_us;      // When the current state began
+    Histogram full_episodes;         // Durations of full periods (us)
+    Histogram empty_episodes;        // Durations of empty periods (us)
+    int residual_items;              // Snapshot only: items still queued
+    long long residual_us;           // Snapshot only: their time in queue so far
+} QueueOccupancy;
+
+/*
+ * Slot-admission counters, for comparing semaphore and credit modes.
+ * Updated with relaxed atomics outside the queue mutex.
+ */
+typedef struct {
+    long long enqueues;               // Completed enqueues
+    long long slot_sem_ops;           // sem_* calls on slots_available (semaphore mode)
+    long long credit_grabs;           // Multi-credit acquisitions (credit mode)
+    long long credits_granted;        // Credits handed out by those grabs
+    long long credit_returns;         // Atomic adds back to the pool
+    long long credits_returned_unused; // Credits given back idle / at shutdown
+    long long grab_blocks;            // Grabs that found the pool empty
+    long long stranded_blocks;        // ...while other producers held unused credits
+    long long stranded_sum;           // Credits held elsewhere at those moments
+} QueueFlowStats;
+
+/*
+ * Messages dropped after their TTL, by priority (protected by mutex).
+ */
+typedef struct {
+    long long at_dequeue[PRIORITY_MAX + 1]; // Skipped by a consumer's dequeue
+    long long swept[PRIORITY_MAX + 1];      // Reclaimed by the sweeper
+    long long sweeps;                // Sweeper passes that took the mutex
+    long long sweep_hold_max_us;     // Longest mutex hold of one pass
+    long long phantom_wakeups;       // Consumers woken for an item already dropped
+} QueueExpiryStats;
+
 /*
  * The Thread-Safe Circular Buffer.
  * combines the storage array with the synchronization primitives 
@@ -46,12 +213,72 @@ typedef struct {
     pthread_mutex_t mutex;           // Critical Section Lock (Protects buffer/indices)
     sem_t slots_available;           // Counting Sem: How many empty spots left? (Producers wait)
     sem_t items_available;           // Counting Sem: How many items ready? (Consumers wait)
+    sem_t shared_slots;              // Counting Sem: Slots the NORMAL class may still take
+    int reserved_slots;              // Slots only the HIGH class may use (0 = no reservation)
+
+    /* Credit-Based Flow Control (replaces slots_available when enabled) */
+    int credit_mode;                 // 1 = producers take slots from slot_credits
+    int slot_credits;                // Free slots not yet granted (atomic)
+    int credits_outstanding;         // Granted to producers, not yet spent (atomic)
+    int credit_waiters;              // Producers sleeping on credit_cond (atomic)
+    pthread_mutex_t credit_mutex;    // Only for the empty-pool wait
+    pthread_cond_t credit_cond;      // Signalled when credits come back
+    QueueFlowStats flow;
+
+    /* Message TTL (protected by mutex) */
+    int expiry_enabled;              // 1 = scan for expired items at dequeue
+    int token_debt;                  // items_available tokens for dropped items,
+                                     // still held by consumers in flight
+    QueueExpiryStats expiry;
+
+    /* Selective Receive (secondary indexes, protected by mutex) */
+    int index_enabled;               // 1 = maintain the position bitmaps
+    unsigned int prio_index[PRIORITY_MAX + 1];      // Bit i: logical position i
+    unsigned int producer_index[MAX_PRODUCERS + 1]; //   has this priority / producer
+    FilterWaiter *filter_waiters[MAX_CONSUMERS];    // Filtered consumers asleep
+    int num_filter_waiters;
+    QueueFilterStats filter;
+
+    /* Key Coalescing (protected by mutex) */
+    int coalesce_enabled;            // 1 = keyed enqueues fold into a queued message
+    int key_slot[COALESCE_HASH_SIZE]; // Ring index of the queued message per key (-1 = empty)
+    QueueCoalesceStats coalesce;
+
+    /* Partitioned Delivery (protected by mutex; bitmaps ride on the
+     * selective receive indexes, so index_enabled is set too) */
+    int partitions;                  // Number of partitions (0 = off)
+    unsigned int partition_index[MAX_PARTITIONS];   // Bit i: position i is in partition p
+    int partition_owner[MAX_PARTITIONS];  // Consumer holding the lease (0 = free)
+    int partition_last[MAX_PARTITIONS];   // Previous lease holder (0 = none)
+    long long partition_free_us[MAX_PARTITIONS]; // Released with backlog at (0 = no backlog)
+    pthread_cond_t partition_cond;   // A free partition got an item / a lease ended
+    int partition_waiters;
+    QueuePartitionStats partition;
+
+    /* Readiness Notification (protected by mutex; edge-mode counters atomic) */
+    int ready_fd;                    // eventfd readable when items are queued (-1 = off)
+    QueueReadyMode ready_mode;
+    QueueReadyStats ready;
+
+    /* Disk Spill-Over (store protected by mutex) */
+    SpillStore *spill;               // Overflow tier (NULL = producers block when full)
+
+    /* At-Least-Once Delivery */
+    int hold_slots;                  // 1 = dequeued items keep their slot until
+                                     // queue_release (leased, may come back)
     
     /* Control Flags */
     int shutdown;                    // Set to 1 to signal all threads to exit
 
     /* Priority Aging */
     int aging_interval_ms;           // Aging interval in ms (0 = disabled)
+
+    /* Dequeue Policy (set before the threads start; MLFQ state protected by mutex) */
+    QueuePolicy policy;
+    QueueMlfq mlfq;
+
+    /* Occupancy Tracking (protected by mutex) */
+    QueueOccupancy occupancy;
 } Queue;
 
 /* --- Lifecycle & Management --- */
@@ -68,6 +295,63 @@ int queue_init(Queue *q, int capacity, int aging_interval_ms);
  */
 int queue_destroy(Queue *q);
 
+/*
+ * Reserves 'reserved_slots' of the capacity for the HIGH class.
+ * NORMAL messages then need a 'shared_slots' token as well as a slot,
+ * so at most (capacity - reserved_slots) of them are ever queued.
+ * Must be called before any thread uses the queue.
+ * Returns: 0 on success, -1 if out of range [0, capacity - 1].
+ */
+int queue_set_reserve(Queue *q, int reserved_slots);
+
+/*
+ * Switches slot admission from the slots_available semaphore to an
+ * atomic credit pool. Must be called before any thread uses the queue.
+ * Returns: 0 on success, -1 if the queue is already in use.
+ */
+int queue_enable_credits(Queue *q);
+
+/*
+ * Turns on TTL handling: every dequeue first drops items whose
+ * expires_us has passed. Must be called before any thread uses the queue.
+ */
+void queue_enable_expiry(Queue *q);
+
+/*
+ * Turns on the secondary indexes used by queue_dequeue_filtered.
+ * Must be called before any thread uses the queue.
+ */
+void queue_enable_filters(Queue *q);
+
+/*
+ * Turns on key coalescing: an enqueue whose key is already queued
+ * replaces that message instead of taking a slot.
+ * Must be called before any thread uses the queue.
+ */
+void queue_enable_coalescing(Queue *q);
+
+/*
+ * Partitioned delivery with 'partitions' partitions (1..MAX_PARTITIONS):
+ * consumers must use queue_dequeue_partitioned / queue_partition_release.
+ * Must be called before any thread uses the queue.
+ * Returns: 0 on success, -1 if out of range.
+ */
+int queue_enable_partitions(Queue *q, int partitions);
+
+/*
+ * Lease mode (--ack-timeout): a dequeued item keeps its slot (and
+ * shared token) until queue_release, so a redelivery can always be
+ * put back without waiting for space. Must be called before any
+ * thread uses the queue.
+ */
+void queue_enable_leases(Queue *q);
+
+/* Admission class of a message priority. */
+PriorityClass queue_priority_class(int priority);
+
+/* Display name of a class ("normal", "high"). */
+const char *queue_priority_class_name(PriorityClass c);
+
 /* --- Unsafe Operations (Internal/Debug) ---
  * WARNING: These do not lock the mutex. 
  * Use only for debugging/logging or inside safe wrappers.
@@ -89,15 +373,36 @@ void queue_display(const Queue *q);
 /*
  * Blocking Enqueue.
  * Logic:
+ * 0. NORMAL class with a reservation: decrement 'shared_slots' first
+ *    (Blocks once the unreserved share is used up).
  * 1. Decrement 'slots_available' (Blocks if queue is full).
  * 2. Acquire 'mutex'.
  * 3. Add item.
  * 4. Release 'mutex'.
  * 5. Increment 'items_available' (Signals a consumer).
- * Returns: 0 on success, -1 if shutdown.
+ * With coalescing enabled, a message whose key is already queued is
+ * folded into that message (new payload, producer and expiry, higher
+ * of the two priorities, original place in line) under the mutex
+ * before step 0, so it takes no slot and signals no consumer.
+ * Returns: 0 on success (stored or folded), -1 if shutdown.
  */
 int queue_enqueue_safe(Queue *q, Message msg, int *was_blocked, long *wait_time_ms);
 
+/*
+ * Blocking Batch Enqueue (--source).
+ * Logic:
+ * 1. Decrement 'slots_available' once (Blocks if the queue is full),
+ *    then take up to n-1 more tokens without blocking.
+ * 2. Acquire 'mutex' once and store the first k messages in order.
+ * 3. Release 'mutex'.
+ * 4. Increment 'items_available' k times.
+ * Plain semaphore mode only: not with credits, a reservation, a spill
+ * tier or coalescing (each needs a per-message admission decision).
+ * Returns: number stored (1..n), -1 if shutdown or unsupported mode.
+ */
+int queue_enqueue_batch_safe(Queue *q, const Message *msgs, int n,
+                             int *was_blocked, long *wait_time_ms);
+
 /*
  * Blocking Dequeue (Priority Aware).
  * Logic:
@@ -106,13 +411,235 @@ int queue_enqueue_safe(Queue *q, Message msg, int *was_blocked, long *wait_time_
  * 3. Remove highest priority item.
  * 4. Release 'mutex'.
  * 5. Increment 'slots_available' (Signals a producer).
+ * With expiry enabled, step 3 first drops expired items (their slots
+ * are released too) and waits again if none is left for this token.
  * Returns: 0 on success, -1 if shutdown.
  */
 int queue_dequeue_safe(Queue *q, Message *msg, int *was_blocked, long *wait_time_ms);
 
+/*
+ * Non-blocking dequeue: same as queue_dequeue_safe, but returns at
+ * once if no item token is free. Used with the readiness eventfd.
+ * Returns: 0 on success, 1 if the queue is empty, -1 if shutdown.
+ */
+int queue_try_dequeue(Queue *q, Message *msg);
+
+/*
+ * Blocking Top-k Dequeue.
+ * Logic:
+ * 1. Decrement 'items_available' once (Blocks if queue is empty),
+ *    then take up to max_items-1 more tokens without blocking.
+ * 2. Acquire 'mutex' once.
+ * 3. Select the k highest effective-priority items in one scan and
+ *    close the gaps with one compaction pass.
+ * 4. Release 'mutex'.
+ * 5. Increment 'slots_available' k times.
+ * 'msgs' receives the items in dequeue order (same order k single
+ * dequeues would have returned at this instant).
+ * Returns: number of items (1..max_items), -1 if shutdown.
+ */
+int queue_dequeue_batch_safe(Queue *q, Message *msgs, int max_items,
+                             int *was_blocked, long *wait_time_ms);
+
+/*
+ * Selective Receive (needs queue_enable_filters).
+ * Logic:
+ * 1. Acquire 'mutex'.
+ * 2. OR the priority bitmaps of the filter's band, AND with the OR of
+ *    its producers' bitmaps: only matching positions are visited.
+ * 3. Take the best match (effective priority, then oldest), or sleep
+ *    until an arrival that matches this filter (other arrivals do not
+ *    wake it) and retry.
+ * 4. Consume one 'items_available' token without blocking (token_debt
+ *    if an unfiltered consumer holds it), release 'mutex', free the slot.
+ * Returns: 0 on success, -1 if shutdown or indexes are off.
+ */
+int queue_dequeue_filtered(Queue *q, const MessageFilter *filter, Message *msg,
+                           int *was_blocked, long *wait_time_ms);
+
+/*
+ * Partitioned Dequeue (needs queue_enable_partitions).
+ * Logic:
+ * 1. Acquire 'mutex'.
+ * 2. OR the position bitmaps of the partitions nobody holds and take
+ *    the oldest item in them (lowest set bit). Priority is ignored:
+ *    within a partition delivery is strictly FIFO.
+ * 3. Lease its partition to 'owner' (other consumers skip it until
+ *    queue_partition_release), or sleep until a free partition gets
+ *    an item or a lease ends, and retry.
+ * 4. Consume one 'items_available' token without blocking (token_debt
+ *    otherwise), release 'mutex', free the slot.
+ * Returns: 0 on success (*partition = leased partition), -1 if shutdown.
+ */
+int queue_dequeue_partitioned(Queue *q, int owner, Message *msg, int *partition,
+                              int *was_blocked, long *wait_time_ms);
+
+/*
+ * Ends 'owner's lease on 'partition' once its message is processed,
+ * and wakes waiters if the partition still has items.
+ */
+void queue_partition_release(Queue *q, int partition, int owner);
+
+/* Partition a message maps to: by key if it has one, else by producer. */
+int queue_partition_of(const Queue *q, const Message *msg);
+
+/* Copies the partition counters (under the mutex). */
+void queue_partition_stats(Queue *q, QueuePartitionStats *out);
+
+/* 1 if 'msg' passes 'filter'. */
+int queue_filter_matches(const MessageFilter *filter, const Message *msg);
+
+/* Human-readable filter ("priority 7-9, producers 1,3") into buf. */
+void queue_filter_describe(const MessageFilter *filter, char *buf, size_t size);
+
+/* Copies the filtered dequeue counters (under the mutex). */
+void queue_filter_stats(Queue *q, QueueFilterStats *out);
+
+/* --- Credit-Based Flow Control --- */
+
+/*
+ * Takes up to 'want' slot credits in one atomic step (blocks only if
+ * the pool is empty). The caller banks them and spends one per
+ * queue_enqueue_credit call.
+ * Returns: credits taken (1..want), -1 if shutdown or not in credit mode.
+ */
+int queue_credit_acquire(Queue *q, int want, int *was_blocked, long *wait_time_ms);
+
+/*
+ * Enqueue using one banked credit (no slot semaphore involved).
+ * The credit is spent even on failure.
+ * Returns: 0 on success, -1 if shutdown.
+ */
+int queue_enqueue_credit(Queue *q, Message msg, int *was_blocked, long *wait_time_ms);
+
+/* Gives unused banked credits back to the pool (idle or shutdown). */
+void queue_credit_return(Queue *q, int credits);
+
+/* Copies the slot-admission counters. */
+void queue_flow_stats(const Queue *q, QueueFlowStats *out);
+
+/* --- Message TTL --- */
+
+/*
+ * Sweeper step: removes up to 'max_items' expired items in one mutex
+ * hold and returns their slots to producers.
+ * Returns: items removed (0..max_items), -1 on NULL input or lock failure.
+ */
+int queue_sweep_expired(Queue *q, int max_items);
+
+/* Copies the expiry counters (under the mutex). */
+void queue_expiry_stats(Queue *q, QueueExpiryStats *out);
+
+/* Total messages dropped after their TTL (unlocked, approximate). */
+int queue_expired_total(const Queue *q);
+
+/* --- Key Coalescing --- */
+
+/* Copies the coalescing counters (under the mutex). */
+void queue_coalesce_stats(Queue *q, QueueCoalesceStats *out);
+
+/* Messages folded into a queued message (unlocked, approximate). */
+int queue_coalesced_total(const Queue *q);
+
+/* --- Readiness Notification --- */
+
+/*
+ * Creates the queue's readiness eventfd, so an external event loop can
+ * wait for items in epoll_wait alongside its sockets and timers. Call
+ * before any thread uses the queue; queue_destroy closes it.
+ * Returns: the eventfd, or -1 on failure.
+ */
+int queue_enable_ready_fd(Queue *q, QueueReadyMode mode);
+
+/* The readiness eventfd (-1 if not enabled). */
+int queue_ready_fd(const Queue *q);
+
+/* Copies the readiness counters (under the mutex). */
+void queue_ready_stats(Queue *q, QueueReadyStats *out);
+
+/* --- Dequeue Policy --- */
+
+/*
+ * Selects how consumers pick the next message. QUEUE_POLICY_MLFQ ranks
+ * by class level, starting every class on level 0 with a level-0
+ * quantum of quantum_us. Call before any thread uses the queue.
+ * Returns: 0 on success, -1 on an unknown policy or bad quantum.
+ */
+int queue_set_policy(Queue *q, QueuePolicy policy, int quantum_us);
+
+/*
+ * Feedback from a consumer: processing 'msg' took service_us. Under
+ * MLFQ this may move the message's class a level; it also runs the
+ * periodic reset. No-op under the priority policy.
+ */
+void queue_policy_charge(Queue *q, const Message *msg, long long service_us);
+
+/* Copies the MLFQ state (under the mutex). */
+void queue_policy_stats(Queue *q, QueueMlfq *out);
+
+/* "priority" or "mlfq". */
+const char *queue_policy_name(QueuePolicy policy);
+
+/* --- Disk Spill-Over --- */
+
+/*
+ * Gives the queue a disk tier (called by spill_init). A producer that
+ * finds the ring full stores its message there instead of blocking:
+ * it takes the place of the worst queued message if it beats it and
+ * everything already on disk, otherwise it is spilled itself. Each
+ * freed slot pulls the best spilled message back into the ring.
+ * A refill takes the mutex, and the filtered and partitioned dequeues
+ * free slots while holding it, so neither is combined with a spill
+ * tier (validated by the CLI).
+ */
+void queue_attach_spill(Queue *q, SpillStore *s);
+
+/* Messages on the disk tier (unlocked, 0 without one). */
+int queue_spill_pending(const Queue *q);
+
+/* --- At-Least-Once Delivery --- */
+
+/*
+ * Puts a leased message back for redelivery. Its slot is still held,
+ * so this never blocks; it also works after shutdown (the message is
+ * then counted as queued). A redelivery is never coalesced; if its key
+ * was queued again meanwhile, both copies are delivered.
+ * Returns: 0 on success, -1 on NULL input, lock failure or not in lease mode.
+ */
+int queue_requeue(Queue *q, Message msg);
+
+/*
+ * Frees the slots (and shared tokens) held by 'n' leased messages
+ * that are done with: acked or dead-lettered.
+ */
+void queue_release(Queue *q, const Message *msgs, int n);
+
+/* --- Occupancy Tracking --- */
+
+/*
+ * Copies the occupancy integral, closed off at the current time
+ * (the current depth and any open full/empty episode are included).
+ * Returns: 0 on success, -1 on NULL input or mutex failure.
+ */
+int queue_occupancy_snapshot(Queue *q, QueueOccupancy *out);
+
+/*
+ * Restarts the occupancy window now (e.g. at the end of a warm-up).
+ * An episode already in progress restarts from this moment.
+ */
+void queue_occupancy_reset(Queue *q);
+
+/* Length of the snapshot's window in microseconds. */
+long long queue_occupancy_window_us(const QueueOccupancy *occ);
+
+/* Time-weighted mean depth over the window (0.0 if empty window). */
+double queue_occupancy_mean(const QueueOccupancy *occ);
+
 /*
  * Signal for Shutdown.
  * Sets the shutdown flag and posts to all semaphores to wake sleeping threads.
+ * Takes no mutex, so it may be called from a signal handler; threads
+ * waiting on a condition variable notice the flag at their next poll.
  */
 void queue_shutdown(Queue *q);
 
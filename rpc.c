@@ -0,0 +1,224 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * rpc.c: Request/Response Implementation
+ * * A client's slots and reply queue share one mutex; the reply queue
+ * * is a ring of answered slot numbers with a semaphore counting its
+ * * entries, so a client with nothing to collect sleeps in sem_wait.
+ * * Consumers never hold the queue mutex while calling in here.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer / invalid args    — checked, return -1
+ *   2. Mutex / semaphore init         — reported, earlier clients
+ *                                       destroyed, return -1
+ *   3. Reply for a free slot          — counted as stale, ignored
+ *                                       (a slot is answered at most once)
+ *   4. Out-of-range request slot      — rejected with -1 before any
+ *                                       client array is touched
+ *   5. Shutdown while waiting         — rpc_shutdown posts every client,
+ *                                       the wait returns -1
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "rpc.h"
+#include "utils.h"
+
+/* --- Internal Helpers --- */
+
+static RpcClient *client_of(RpcTable *t, int producer_id)
+{
+    if (t == NULL || producer_id < 1 || producer_id > t->num_clients) return NULL;
+    return &t->clients[producer_id - 1];
+}
+
+/* --- Public API --- */
+
+int rpc_init(RpcTable *t, int clients, int outstanding)
+{
+    int i;
+
+    if (t == NULL || clients < 1 || clients > MAX_PRODUCERS ||
+        outstanding < 1 || outstanding > RPC_MAX_OUTSTANDING) {
+        fprintf(stderr, "[ERROR] rpc_init: invalid argument\n");
+        return -1;
+    }
+
+    memset(t, 0, sizeof(*t));
+    t->max_outstanding = outstanding;
+    for (i = 0; i < clients; i++) {
+        RpcClient *c = &t->clients[i];
+        if (pthread_mutex_init(&c->mutex, NULL) != 0) {
+            fprintf(stderr, "[ERROR] rpc_init: mutex init failed\n");
+            rpc_destroy(t);
+            return -1;
+        }
+        if (sem_init(&c->replies, 0, 0) != 0) {
+            fprintf(stderr, "[ERROR] rpc_init: sem_init failed\n");
+            pthread_mutex_destroy(&c->mutex);
+            rpc_destroy(t);
+            return -1;
+        }
+        t->num_clients = i + 1;
+    }
+    return 0;
+}
+
+int rpc_begin(RpcTable *t, int producer_id, Message *msg)
+{
+    RpcClient *c = client_of(t, producer_id);
+    int slot;
+
+    if (c == NULL || msg == NULL) return -1;
+
+    pthread_mutex_lock(&c->mutex);
+    for (slot = 0; slot < t->max_outstanding && c->sent_us[slot] != 0; slot++) {
+    }
+    if (slot == t->max_outstanding) {
+        pthread_mutex_unlock(&c->mutex);
+        return -1;
+    }
+    c->sent_us[slot] = time_now_us();
+    c->outstanding++;
+    c->stats.requests++;
+    pthread_mutex_unlock(&c->mutex);
+
+    msg->request = slot + 1;
+    return slot;
+}
+
+void rpc_cancel(RpcTable *t, int producer_id, int slot)
+{
+    RpcClient *c = client_of(t, producer_id);
+
+    if (c == NULL || slot < 0 || slot >= t->max_outstanding) return;
+
+    pthread_mutex_lock(&c->mutex);
+    if (c->sent_us[slot] != 0) {
+        c->sent_us[slot] = 0;
+        c->outstanding--;
+        c->stats.requests--;
+        c->stats.cancelled++;
+    }
+    pthread_mutex_unlock(&c->mutex);
+}
+
+int rpc_reply(RpcTable *t, const Message *msg)
+{
+    RpcClient *c;
+    int slot;
+
+    if (t == NULL || msg == NULL) return -1;
+    if (msg->request == 0) return 0;
+
+    c = client_of(t, msg->producer_id);
+    slot = msg->request - 1;
+    if (c == NULL || slot < 0 || slot >= t->max_outstanding) return -1;
+
+    pthread_mutex_lock(&c->mutex);
+    if (c->sent_us[slot] == 0 || c->ready_count == t->max_outstanding) {
+        c->stats.stale++;
+        pthread_mutex_unlock(&c->mutex);
+        return -1;
+    }
+    c->ready[(c->ready_head + c->ready_count) % RPC_MAX_OUTSTANDING] = slot;
+    c->ready_count++;
+    pthread_mutex_unlock(&c->mutex);
+
+    sem_post(&c->replies);
+    return 0;
+}
+
+int rpc_wait(RpcTable *t, int producer_id, long long *rtt_us)
+{
+    RpcClient *c = client_of(t, producer_id);
+    long long rtt;
+    int slot;
+
+    if (c == NULL) return -1;
+
+    while (sem_wait(&c->replies) != 0) {
+        if (errno != EINTR) return -1;
+    }
+    if (__atomic_load_n(&t->shutdown, __ATOMIC_ACQUIRE)) {
+        sem_post(&c->replies);      /* Later waits fail at once too */
+        return -1;
+    }
+
+    pthread_mutex_lock(&c->mutex);
+    slot = c->ready[c->ready_head];
+    c->ready_head = (c->ready_head + 1) % RPC_MAX_OUTSTANDING;
+    c->ready_count--;
+    rtt = time_now_us() - c->sent_us[slot];
+    c->sent_us[slot] = 0;
+    c->outstanding--;
+    c->stats.replies++;
+    c->stats.rtt_total_us += rtt;
+    pthread_mutex_unlock(&c->mutex);
+
+    if (rtt_us != NULL) *rtt_us = rtt;
+    return 0;
+}
+
+int rpc_outstanding(RpcTable *t, int producer_id)
+{
+    RpcClient *c = client_of(t, producer_id);
+    int n;
+
+    if (c == NULL) return 0;
+    pthread_mutex_lock(&c->mutex);
+    n = c->outstanding;
+    pthread_mutex_unlock(&c->mutex);
+    return n;
+}
+
+void rpc_shutdown(RpcTable *t)
+{
+    int i;
+
+    if (t == NULL) return;
+    __atomic_store_n(&t->shutdown, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < t->num_clients; i++) sem_post(&t->clients[i].replies);
+}
+
+void rpc_stats(RpcTable *t, RpcStats *out)
+{
+    int i;
+
+    if (t == NULL || out == NULL) return;
+
+    memset(out, 0, sizeof(*out));
+    for (i = 0; i < t->num_clients; i++) {
+        RpcClient *c = &t->clients[i];
+        pthread_mutex_lock(&c->mutex);
+        out->requests += c->stats.requests;
+        out->replies += c->stats.replies;
+        out->cancelled += c->stats.cancelled;
+        out->stale += c->stats.stale;
+        out->unanswered += c->outstanding;
+        out->client_replies[i] = c->stats.replies;
+        out->client_mean_rtt_us[i] = c->stats.replies > 0 ?
+                                     (double)c->stats.rtt_total_us / c->stats.replies : 0.0;
+        pthread_mutex_unlock(&c->mutex);
+    }
+}
+
+void rpc_destroy(RpcTable *t)
+{
+    int i;
+
+    if (t == NULL) return;
+    for (i = 0; i < t->num_clients; i++) {
+        sem_destroy(&t->clients[i].replies);
+        pthread_mutex_destroy(&t->clients[i].mutex);
+    }
+    t->num_clients = 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * rpc.h: Request/Response Round Trips (--rpc)
+ * * Each producer becomes a closed-loop client with a fixed set of
+ * * completion slots. A request takes a free slot (its number travels
+ * * in Message.request) and goes through the shared queue as usual;
+ * * the consumer that processed it pushes the slot onto the client's
+ * * reply queue, and the client takes the reply, measures the round
+ * * trip and reuses the slot for its next request.
+ */
+
+#ifndef RPC_H
+#define RPC_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include "config.h"
+#include "queue.h"
+
+/* --- Data Structures --- */
+
+/* Per-client counters (protected by the client's mutex) */
+typedef struct {
+    long long requests;         // Requests enqueued
+    long long replies;          // Replies taken by the client
+    long long cancelled;        // Slots handed back after a failed enqueue
+    long long stale;            // Replies for a slot that was not outstanding
+    long long rtt_total_us;     // Sum of round trips (whole run; the analytics
+                                // keep the distribution for the measured window)
+} RpcClientStats;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    sem_t replies;                          // One post per entry in 'ready'
+    int ready[RPC_MAX_OUTSTANDING];         // Reply queue: answered slots (ring)
+    int ready_head;
+    int ready_count;
+    long long sent_us[RPC_MAX_OUTSTANDING]; // Per slot: send time, 0 = free
+    int outstanding;                        // Slots in use
+    RpcClientStats stats;
+} RpcClient;
+
+typedef struct {
+    int num_clients;
+    int max_outstanding;        // Slots in use per client (1..RPC_MAX_OUTSTANDING)
+    int shutdown;               // Set by rpc_shutdown: waits return -1
+    RpcClient clients[MAX_PRODUCERS];
+} RpcTable;
+
+/* Totals over all clients (for the report) */
+typedef struct {
+    long long requests;
+    long long replies;
+    long long cancelled;
+    long long stale;
+    int unanswered;             // Still outstanding when the run stopped
+    long long client_replies[MAX_PRODUCERS];
+    double client_mean_rtt_us[MAX_PRODUCERS];
+} RpcStats;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Sets up 'clients' clients (producer ids 1..clients) with
+ * 'outstanding' completion slots each.
+ * Returns: 0 on success, -1 on invalid input or mutex/semaphore failure.
+ */
+int rpc_init(RpcTable *t, int clients, int outstanding);
+
+/*
+ * Claims a free slot of client 'producer_id' for 'msg' (sets
+ * msg->request) and stamps its send time.
+ * Returns: the slot, or -1 if all of them are outstanding.
+ */
+int rpc_begin(RpcTable *t, int producer_id, Message *msg);
+
+/* Frees a slot whose request never made it into the queue. */
+void rpc_cancel(RpcTable *t, int producer_id, int slot);
+
+/*
+ * Called by the consumer once 'msg' is processed: queues the reply
+ * for its client. Messages without a request are ignored.
+ * Returns: 0 on success (or nothing to answer), -1 for a bad request.
+ */
+int rpc_reply(RpcTable *t, const Message *msg);
+
+/*
+ * Blocks until client 'producer_id' has a reply, frees its slot and
+ * returns the round trip in *rtt_us.
+ * Returns: 0 on success, -1 once rpc_shutdown was called.
+ */
+int rpc_wait(RpcTable *t, int producer_id, long long *rtt_us);
+
+/* Requests the client has outstanding. */
+int rpc_outstanding(RpcTable *t, int producer_id);
+
+/* Wakes every waiting client; later waits fail at once. */
+void rpc_shutdown(RpcTable *t);
+
+/* Sums the clients' counters (call after the producers are joined). */
+void rpc_stats(RpcTable *t, RpcStats *out);
+
+void rpc_destroy(RpcTable *t);
+
+#endif /* RPC_H */
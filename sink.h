@@ -0,0 +1,120 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * sink.h: Consumer File Sink (io_uring / writev Group Commit)
+ * * Consumers append one text record per processed message to a shared
+ * * staging buffer. A writer thread commits every sealed buffer in one
+ * * group: one io_uring submission of fixed-buffer writes (buffers
+ * * registered once), or one writev where io_uring is unavailable.
+ * * With --sink-sync each group is followed by one fdatasync.
+ */
+
+#ifndef SINK_H
+#define SINK_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include "config.h"
+#include "queue.h"
+#include "histogram.h"
+
+/* --- Data Structures --- */
+
+typedef enum {
+    SINK_URING = 0,             // io_uring, registered buffers (writev if setup fails)
+    SINK_WRITEV                 // writev group commit only
+} SinkBackend;
+
+typedef struct {
+    long long records;
+    long long bytes;
+    long long commits;          // Groups written (one submission or writev each)
+    long long submissions;      // io_uring_enter / writev / fdatasync calls
+    long long stalls;           // Appends that waited for a free buffer
+    long long write_errors;
+    Histogram batch_buffers;    // Buffers per group
+    Histogram batch_records;    // Records per group
+    Histogram write_us;         // Write of one group (submit to last completion)
+    Histogram fsync_us;         // fdatasync after a group (--sink-sync)
+    Histogram commit_us;        // First append in a buffer to written (or durable)
+    long long busy_us;          // Writer time spent in write + fsync
+} SinkStats;
+
+/* Minimal io_uring state (raw syscalls; no liburing) */
+typedef struct {
+    int fd;                     // -1 = not set up
+    void *sq_ring;
+    void *cq_ring;
+    void *sqes;
+    size_t sq_ring_bytes;
+    size_t cq_ring_bytes;
+    size_t sqes_bytes;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    void *cqes;
+} SinkRing;
+
+typedef struct {
+    int fd;
+    char path[SINK_PATH_MAX];
+    SinkBackend backend;        // Requested; 'uring_active' says what runs
+    int uring_active;
+    int sync;                   // fdatasync after every group
+    SinkRing ring;
+    long long file_offset;      // Next write position (io_uring writes are positioned)
+    int last_error;             // errno of the last failed write or fsync (writer
+                                // thread; -cqe->res under io_uring), 0 = short write
+
+    /* Staging buffers: [head, head + pending) are sealed or being
+     * written, the one after them is open for appends */
+    char buffers[SINK_NUM_BUFFERS][SINK_BUFFER_BYTES];
+    size_t used[SINK_NUM_BUFFERS];
+    int records[SINK_NUM_BUFFERS];
+    long long first_us[SINK_NUM_BUFFERS];   // First append (commit latency start)
+    int head;
+    int pending;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;   // A buffer was sealed / stop requested
+    pthread_cond_t space_cond;  // A group was written: buffers are free again
+    pthread_t thread;
+    int thread_started;
+    int stop;                   // Flush what is left, then exit (protected by mutex)
+    SinkStats stats;            // Written by the writer thread; appends under mutex
+} Sink;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Creates (truncates) 'path', sets up the backend and starts the
+ * writer thread. SINK_URING falls back to writev with a warning if the
+ * kernel refuses io_uring or the buffer registration.
+ * Returns: 0 on success, -1 on invalid input, open or thread failure.
+ */
+int sink_init(Sink *s, const char *path, SinkBackend backend, int sync);
+
+/*
+ * Appends one record for 'msg' ("consumer,producer,priority,data,
+ * latency_us"). Blocks while every buffer is sealed or being written.
+ * Returns: 0 on success, -1 on NULL input or after sink_stop.
+ */
+int sink_append(Sink *s, int consumer_id, const Message *msg, long long now_us);
+
+/* Backend actually in use ("io_uring" or "writev"). */
+const char *sink_backend_name(const Sink *s);
+
+/* Copies the statistics (under the sink mutex). Returns: 0 on success, -1 on failure. */
+int sink_stats(Sink *s, SinkStats *out);
+
+/*
+ * Writes everything still staged and joins the writer thread. Call
+ * after the consumers have been joined.
+ */
+void sink_stop(Sink *s);
+
+/* Closes the file and tears down io_uring (after sink_stop). */
+void sink_destroy(Sink *s);
+
+#endif /* SINK_H */
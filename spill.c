@@ -0,0 +1,243 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * spill.c: Disk Spill-Over Implementation
+ * * Records live in a fixed-size file mapped MAP_SHARED; the kernel
+ * * writes dirty pages back on its own schedule, so a spill costs a
+ * * memcpy into the page cache, not a synchronous write. Record order
+ * * is kept in RAM as one doubly-linked list per priority, sorted by
+ * * creation timestamp (an evicted ring message can be older than
+ * * records already on disk), plus a free list.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer / invalid args    — checked, return -1
+ *   2. mkstemp / ftruncate / mmap     — reported with errno, file
+ *                                       closed and unlinked, return -1
+ *   3. Spill file full                — spill_put returns -1, the
+ *                                       caller falls back to blocking
+ *   4. Out-of-range priority          — clamped to the valid range so
+ *                                       the list heads are never overrun
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "spill.h"
+#include "utils.h"
+
+/* --- Internal Helpers --- */
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int clamp_priority(int priority)
+{
+    if (priority < PRIORITY_MIN) return PRIORITY_MIN;
+    if (priority > PRIORITY_MAX) return PRIORITY_MAX;
+    return priority;
+}
+
+/* Unlinks record 'r' from the list of priority 'p' */
+static void list_unlink(SpillStore *s, int p, int r)
+{
+    if (s->prev[r] >= 0) s->next[s->prev[r]] = s->next[r];
+    else s->head[p] = s->next[r];
+    if (s->next[r] >= 0) s->prev[s->next[r]] = s->prev[r];
+    else s->tail[p] = s->prev[r];
+}
+
+/*
+ * Links record 'r' into the list of priority 'p' after every record
+ * with a timestamp <= its own. Walks from the tail: new arrivals are
+ * the newest and stop at once; only evictions walk further.
+ */
+static void list_insert_sorted(SpillStore *s, int p, int r, long stamp)
+{
+    int after = s->tail[p];
+
+    while (after >= 0 && s->records[after].msg.timestamp > stamp) {
+        after = s->prev[after];
+    }
+    s->prev[r] = after;
+    if (after >= 0) {
+        s->next[r] = s->next[after];
+        s->next[after] = r;
+    } else {
+        s->next[r] = s->head[p];
+        s->head[p] = r;
+    }
+    if (s->next[r] >= 0) s->prev[s->next[r]] = r;
+    else s->tail[p] = r;
+}
+
+/* --- Public API --- */
+
+int spill_init(SpillStore *s, Queue *queue, int capacity)
+{
+    char path[64];
+    int i;
+
+    if (s == NULL || queue == NULL) {
+        fprintf(stderr, "[ERROR] spill_init: NULL argument\n");
+        return -1;
+    }
+    if (capacity < 1 || capacity > MAX_SPILL_MESSAGES) {
+        fprintf(stderr, "[ERROR] spill_init: capacity %d out of range [1 to %d]\n",
+                capacity, MAX_SPILL_MESSAGES);
+        return -1;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+    s->queue = queue;
+    s->capacity = capacity;
+    s->map_bytes = (size_t)capacity * sizeof(SpillRecord);
+
+    snprintf(path, sizeof(path), "%s/pc_spill_XXXXXX", SPILL_DIR);
+    s->fd = mkstemp(path);
+    if (s->fd < 0) {
+        fprintf(stderr, "[ERROR] spill_init: mkstemp(%s) failed (errno=%d: %s)\n",
+                path, errno, strerror(errno));
+        return -1;
+    }
+    /* Nothing else ever opens it: gone from the directory now, and
+     * from the disk once the descriptor and mapping are released */
+    unlink(path);
+
+    if (ftruncate(s->fd, (off_t)s->map_bytes) != 0) {
+        fprintf(stderr, "[ERROR] spill_init: ftruncate(%lu bytes) failed (errno=%d: %s)\n",
+                (unsigned long)s->map_bytes, errno, strerror(errno));
+        close(s->fd);
+        return -1;
+    }
+    s->records = mmap(NULL, s->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (s->records == MAP_FAILED) {
+        fprintf(stderr, "[ERROR] spill_init: mmap failed (errno=%d: %s)\n",
+                errno, strerror(errno));
+        s->records = NULL;
+        close(s->fd);
+        return -1;
+    }
+
+    for (i = 0; i < capacity; i++) s->next[i] = (i + 1 < capacity) ? i + 1 : -1;
+    s->free_head = 0;
+    for (i = PRIORITY_MIN; i <= PRIORITY_MAX; i++) {
+        s->head[i] = -1;
+        s->tail[i] = -1;
+    }
+    histogram_init(&s->stats.residence_us);
+
+    queue_attach_spill(queue, s);
+    DBG(DBG_INFO, "Spill: %d records (%lu bytes) mapped", capacity,
+        (unsigned long)s->map_bytes);
+    return 0;
+}
+
+int spill_put(SpillStore *s, const Message *msg, long long now_us)
+{
+    int r, p;
+    long long t0;
+
+    if (s == NULL || msg == NULL || s->free_head < 0) return -1;
+
+    r = s->free_head;
+    s->free_head = s->next[r];
+    p = clamp_priority(msg->priority);
+
+    t0 = now_ns();
+    s->records[r].msg = *msg;
+    s->records[r].spilled_us = now_us;
+    s->stats.write_ns += now_ns() - t0;
+    s->stats.bytes_written += (long long)sizeof(SpillRecord);
+
+    list_insert_sorted(s, p, r, msg->timestamp);
+    s->stats.spilled++;
+    s->stats.spilled_by_priority[p]++;
+    __atomic_store_n(&s->pending, s->pending + 1, __ATOMIC_SEQ_CST);
+    if (s->pending > s->stats.max_pending) s->stats.max_pending = s->pending;
+    return 0;
+}
+
+int spill_take(SpillStore *s, Message *out, long long now_us)
+{
+    int r, p = spill_best_priority(s);
+    long long t0, spilled_us;
+
+    if (p < 0 || out == NULL) return -1;
+
+    r = s->head[p];
+    list_unlink(s, p, r);
+
+    t0 = now_ns();
+    *out = s->records[r].msg;
+    spilled_us = s->records[r].spilled_us;
+    s->stats.read_ns += now_ns() - t0;
+    s->stats.bytes_read += (long long)sizeof(SpillRecord);
+
+    s->next[r] = s->free_head;
+    s->free_head = r;
+    s->stats.refilled++;
+    histogram_record(&s->stats.residence_us, now_us - spilled_us);
+    __atomic_store_n(&s->pending, s->pending - 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+int spill_best_priority(const SpillStore *s)
+{
+    int p;
+
+    if (s == NULL || s->pending == 0) return -1;
+    for (p = PRIORITY_MAX; p >= PRIORITY_MIN; p--) {
+        if (s->head[p] >= 0) return p;
+    }
+    return -1;
+}
+
+int spill_has_room(const SpillStore *s)
+{
+    return s != NULL && s->free_head >= 0;
+}
+
+int spill_pending(const SpillStore *s)
+{
+    if (s == NULL) return 0;
+    return __atomic_load_n(&s->pending, __ATOMIC_SEQ_CST);
+}
+
+int spill_stats(SpillStore *s, SpillStats *out)
+{
+    if (s == NULL || out == NULL) return -1;
+    if (pthread_mutex_lock(&s->queue->mutex) != 0) return -1;
+    *out = s->stats;
+    out->pending = s->pending;
+    pthread_mutex_unlock(&s->queue->mutex);
+    return 0;
+}
+
+void spill_destroy(SpillStore *s)
+{
+    if (s == NULL) return;
+    if (s->records != NULL) {
+        munmap(s->records, s->map_bytes);
+        s->records = NULL;
+    }
+    if (s->fd >= 0) {
+        close(s->fd);
+        s->fd = -1;
+    }
+}
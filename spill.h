@@ -0,0 +1,98 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * spill.h: Disk Spill-Over (Memory-Mapped Overflow Store)
+ * * When the ring is full, messages go to a spill file instead of
+ * * blocking the producer. The file is mmapped; the order of the
+ * * spilled records (per priority, oldest first) is kept in RAM, so a
+ * * freed ring slot always pulls back the best message on disk.
+ * * The store has no lock of its own: the queue mutex protects it.
+ */
+
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stddef.h>
+#include "config.h"
+#include "queue.h"
+#include "histogram.h"
+
+/* --- Data Structures --- */
+
+/* One record in the spill file */
+typedef struct {
+    Message msg;
+    long long spilled_us;       // When it went to disk (monotonic us)
+} SpillRecord;
+
+typedef struct {
+    long long spilled;          // Records written (arrivals and evictions)
+    long long evictions;        // Queued messages pushed to disk by a better arrival
+    long long refilled;         // Records read back into the ring
+    long long full_blocks;      // Spill file full: the producer blocked instead
+    long long spilled_by_priority[PRIORITY_MAX + 1];
+    long long bytes_written;
+    long long bytes_read;
+    long long write_ns;         // Time spent copying into the mapping
+    long long read_ns;          // Time spent copying out of it
+    int pending;                // On disk now
+    int max_pending;
+    Histogram residence_us;     // Spill to refill: latency added by the disk tier
+} SpillStats;
+
+struct SpillStore {
+    SpillRecord *records;       // The mapped spill file
+    size_t map_bytes;
+    int fd;
+    int capacity;               // Records the file holds
+    Queue *queue;
+    int next[MAX_SPILL_MESSAGES];   // Per-priority lists (and the free list)
+    int prev[MAX_SPILL_MESSAGES];
+    int head[PRIORITY_MAX + 1];     // Oldest record of each priority (-1 = none)
+    int tail[PRIORITY_MAX + 1];
+    int free_head;
+    int pending;                // Records on disk (read unlocked by release paths)
+    SpillStats stats;
+};
+
+/* --- Function Prototypes --- */
+
+/*
+ * Creates a spill file for 'capacity' records in SPILL_DIR, maps it,
+ * unlinks it (it vanishes with the process) and attaches the store to
+ * 'queue' (queue_attach_spill). Call before any thread uses the queue.
+ * Returns: 0 on success, -1 on invalid input or file/mmap failure.
+ */
+int spill_init(SpillStore *s, Queue *queue, int capacity);
+
+/*
+ * Writes 'msg' to the spill file, in timestamp order within its
+ * priority. Caller holds the queue mutex.
+ * Returns: 0 on success, -1 if the file is full.
+ */
+int spill_put(SpillStore *s, const Message *msg, long long now_us);
+
+/*
+ * Reads back the best spilled message: highest priority, then oldest.
+ * Caller holds the queue mutex.
+ * Returns: 0 on success, -1 if nothing is spilled.
+ */
+int spill_take(SpillStore *s, Message *out, long long now_us);
+
+/* Priority of the best spilled message (-1 = none). Caller holds the queue mutex. */
+int spill_best_priority(const SpillStore *s);
+
+/* 1 if another record fits. Caller holds the queue mutex. */
+int spill_has_room(const SpillStore *s);
+
+/* Records on disk (unlocked, exact once the workers have stopped). */
+int spill_pending(const SpillStore *s);
+
+/* Copies the statistics (under the queue mutex). Returns: 0 on success, -1 on failure. */
+int spill_stats(SpillStore *s, SpillStats *out);
+
+void spill_destroy(SpillStore *s);
+
+#endif /* SPILL_H */
@@ -0,0 +1,81 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * sweeper.c: Expired Message Sweeper Implementation
+ * * Each pass takes the queue mutex once and drops at most
+ * * TTL_SWEEP_BATCH expired items. A full batch means more may be
+ * * waiting, so the next pass follows at once (after the lock has been
+ * * released); otherwise the thread sleeps TTL_SWEEP_INTERVAL_MS.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer arguments         — checked before use
+ *   2. pthread_create failure         — reported, caller runs without it
+ *                                       (consumers still drop expired items)
+ *   3. Sweep failure (mutex)          — logged by the queue, retried next pass
+ *   4. Shutdown                       — stop flag checked every pass, the
+ *                                       sleep is short enough to exit promptly
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "sweeper.h"
+#include "config.h"
+#include "utils.h"
+
+/* --- Internal Helpers --- */
+
+static void *sweeper_thread(void *arg)
+{
+    Sweeper *sw = (Sweeper *)arg;
+    int n;
+
+    DBG(DBG_INFO, "%s", "Sweeper: thread started");
+
+    while (!sw->stop) {
+        n = queue_sweep_expired(sw->queue, TTL_SWEEP_BATCH);
+        if (n > 0) sw->reclaimed += n;
+        if (n < TTL_SWEEP_BATCH) sleep_us(TTL_SWEEP_INTERVAL_MS * 1000LL);
+    }
+
+    DBG(DBG_INFO, "Sweeper: thread exiting (%lld reclaimed)", sw->reclaimed);
+    return NULL;
+}
+
+/* --- Public API --- */
+
+int sweeper_start(Sweeper *sw, Queue *queue)
+{
+    if (sw == NULL || queue == NULL) {
+        fprintf(stderr, "[ERROR] sweeper_start: NULL argument\n");
+        return -1;
+    }
+
+    sw->queue = queue;
+    sw->stop = 0;
+    sw->reclaimed = 0;
+    sw->thread_started = 0;
+
+    if (pthread_create(&sw->thread, NULL, sweeper_thread, sw) != 0) {
+        fprintf(stderr, "[ERROR] sweeper_start: pthread_create failed\n");
+        return -1;
+    }
+    sw->thread_started = 1;
+    return 0;
+}
+
+void sweeper_stop(Sweeper *sw)
+{
+    if (sw == NULL || !sw->thread_started) return;
+
+    sw->stop = 1;
+    if (pthread_join(sw->thread, NULL) != 0) {
+        fprintf(stderr, "[ERROR] sweeper_stop: pthread_join failed\n");
+    }
+    sw->thread_started = 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * sweeper.h: Expired Message Sweeper Declarations
+ * * Background thread for --ttl. Reclaims expired messages in bounded
+ * * batches (TTL_SWEEP_BATCH per mutex hold), so their slots go back to
+ * * producers even when no consumer is dequeuing.
+ */
+
+#ifndef SWEEPER_H
+#define SWEEPER_H
+
+#include <pthread.h>
+#include <signal.h>
+#include "queue.h"
+
+/* --- Data Structures --- */
+
+typedef struct {
+    Queue *queue;
+    pthread_t thread;
+    int thread_started;
+    volatile sig_atomic_t stop; // Set by sweeper_stop
+    long long reclaimed;        // Items removed by this sweeper
+} Sweeper;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Starts the sweeper thread on 'queue' (which must have expiry enabled).
+ * Returns: 0 on success, -1 on NULL input or pthread_create failure.
+ */
+int sweeper_start(Sweeper *sw, Queue *queue);
+
+/* Stops and joins the sweeper thread (no-op if it never started). */
+void sweeper_stop(Sweeper *sw);
+
+#endif /* SWEEPER_H */
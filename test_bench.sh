@@ -19,6 +19,31 @@
 #  14. Input validation (strtol rejects non-numeric)
 #  15. Aging interval flag (-a)
 #  16. Producer/consumer wait flags (-p / -c)
+#  17. Hardware counters (--perf)
+#  18. Open-loop load generation (--open-loop)
+#  19. Start gate and warm-up window (--warmup)
+#  20. Live EWMA rates (1s/10s/60s windows)
+#  21. Exact time-weighted occupancy and Little's law
+#  22. Saturation-point finder (--saturate)
+#  23. Thread-count scaling sweep (--scale)
+#  24. Top-k batch dequeue (--batch)
+#  25. Reserved capacity per priority class (--reserve)
+#  26. Credit-based flow control (--credits)
+#  27. Delayed delivery via a timing wheel (--delay)
+#  28. Message TTL expiry and background sweeper (--ttl)
+#  29. At-least-once delivery with leases and a dead-letter queue (--ack-timeout)
+#  30. Selective receive with indexed, filtered dequeue (--filter)
+#  31. Key coalescing of queued messages (--coalesce)
+#  32. Partitioned delivery with per-key FIFO order (--partitions)
+#  33. Disk spill-over to an mmapped file when the ring is full (--spill)
+#  34. epoll monitor loop (signalfd, deadline and tick timerfds)
+#  35. eventfd readiness and epoll consumers (--epoll, --wakeup-bench)
+#  36. io_uring file sink with writev group-commit fallback (--sink)
+#  37. Ingestion from a mapped file or stdin with batch enqueue (--source)
+#  38. Unix-socket ingestion listener driven by ./loadgen (--listen)
+#  39. Request/response round trips with reply queues (--rpc)
+#  40. Pub/sub fan-out to consumer groups over a shared log (--groups)
+#  41. MLFQ dequeue policy and the policy comparison (--policy, --policy-bench)
 #
 # Usage:  ./test_bench.sh
 # Exit:   0 if all tests pass, 1 if any fail
@@ -810,10 +835,1150 @@ else
     fail "-p abc → should be rejected"
 fi
 
+# =============================================================================
+# 18. HARDWARE COUNTERS (--perf)
+# =============================================================================
+section "18. Hardware Counters (--perf)"
+
+# 18a. --perf runs successfully whether or not perf is permitted
+run 10 -s 42 -p 0 -c 0 --perf 2 2 5 2
+if [ "$EXIT_CODE" -eq 0 ]; then
+    pass "--perf → runs successfully"
+else
+    fail "--perf → should succeed" "exit=$EXIT_CODE"
+fi
+
+# 18b. Report contains the counter section (values or an explanation)
+if echo "$OUTPUT" | grep -q "HARDWARE COUNTERS (per message)" && \
+   echo "$OUTPUT" | grep -qE "context-switches|Unavailable:"; then
+    pass "--perf → counter section reported"
+else
+    fail "--perf → HARDWARE COUNTERS section missing"
+fi
+
+# 18c. Counting does not disturb the data path
+if echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--perf → balance check PASS"
+else
+    fail "--perf → balance check should PASS"
+fi
+
+# 18d. Section absent without the flag
+run 10 -s 42 1 1 5 1
+if ! echo "$OUTPUT" | grep -q "HARDWARE COUNTERS"; then
+    pass "No --perf → no counter section"
+else
+    fail "No --perf → counter section should be absent"
+fi
+
+# =============================================================================
+# 19. OPEN-LOOP LOAD (--open-loop)
+# =============================================================================
+section "19. Open-Loop Load (--open-loop)"
+
+# 19a. Open loop against slow consumers runs successfully
+run 10 -s 42 -c 1 --open-loop 50 2 1 5 2
+if [ "$EXIT_CODE" -eq 0 ]; then
+    pass "--open-loop 50 → runs successfully"
+else
+    fail "--open-loop 50 → should succeed" "exit=$EXIT_CODE"
+fi
+
+# 19b. Both corrected and uncorrected distributions reported
+if echo "$OUTPUT" | grep -q "Enqueue (uncorrected)" && \
+   echo "$OUTPUT" | grep -q "Intended send (corrected)"; then
+    pass "--open-loop → corrected and uncorrected latency reported"
+else
+    fail "--open-loop → both latency distributions expected"
+fi
+
+# 19c. Backlog shows up as missed send slots
+MISSED=$(echo "$OUTPUT" | grep "Missed Slots:" | awk '{print $3}')
+if [ -n "$MISSED" ] && [ "$MISSED" -gt 0 ]; then
+    pass "--open-loop → missed slots counted ($MISSED)"
+else
+    fail "--open-loop → expected missed slots against a slow consumer" "missed=${MISSED:-none}"
+fi
+
+# 19d. Balance check still holds
+if echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--open-loop → balance check PASS"
+else
+    fail "--open-loop → balance check should PASS"
+fi
+
+# 19e. Rate of zero rejected
+run 5 --open-loop 0 1 1 5 10
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--open-loop 0 → rejected"
+else
+    fail "--open-loop 0 → should be rejected"
+fi
+
+# 19f. Missing rate rejected
+run 5 --open-loop
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--open-loop without argument → non-zero exit"
+else
+    fail "--open-loop without argument → should exit with error"
+fi
+
+# =============================================================================
+# 20. START GATE & WARM-UP (--warmup)
+# =============================================================================
+section "20. Start Gate & Warm-up (--warmup)"
+
+# 20a. Every worker parks at the start gate before the run begins
+run 10 -s 42 -p 0 -c 0 3 2 5 2
+if echo "$OUTPUT" | grep -q "Spawn Phase:.*(5 threads parked at the start gate)"; then
+    pass "Start gate → all 5 threads parked before release"
+else
+    fail "Start gate → expected 5 threads at the gate"
+fi
+
+# 20b. Warm-up run reports the excluded window and a shorter runtime
+# (measured runtime ~2s; allow for the sampler's stop latency)
+run 10 -s 42 -p 0 -c 0 --warmup 1 2 2 5 3
+RUNTIME=$(echo "$OUTPUT" | grep -o "Runtime: *[0-9.]*" | awk '{print $2}')
+if [ "$EXIT_CODE" -eq 0 ] && \
+   echo "$OUTPUT" | grep -q "Warm-up Window:   1.0 sec excluded" && \
+   awk -v r="${RUNTIME:-99}" 'BEGIN { exit !(r < 3.5) }'; then
+    pass "--warmup 1 → window excluded, runtime measured after warm-up ($RUNTIME s)"
+else
+    fail "--warmup 1 → expected warm-up window and a runtime under 3.5 s" "runtime=${RUNTIME:-none}"
+fi
+
+# 20c. Balance check still covers the whole run
+if echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--warmup → balance check PASS"
+else
+    fail "--warmup → balance check should PASS"
+fi
+
+# 20d. Warm-up as long as the run rejected
+run 5 --warmup 2 1 1 5 2
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--warmup >= timeout → rejected"
+else
+    fail "--warmup >= timeout → should be rejected"
+fi
+
+# =============================================================================
+# 21. LIVE EWMA RATES
+# =============================================================================
+section "21. Live EWMA Rates"
+
+# 21a. Report shows every window for every metric
+run 10 -s 42 -p 0 -c 0 2 2 5 3
+if echo "$OUTPUT" | grep -q "LIVE RATES (EWMA at shutdown)" && \
+   echo "$OUTPUT" | grep -qE "Window +1s +10s +60s" && \
+   [ "$(echo "$OUTPUT" | grep -cE "^  (Produced \(msg|Consumed \(msg|Producer blocks|Consumer blocks|Occupancy \(items|Latency \(ms)")" -eq 6 ]; then
+    pass "EWMA → 6 metrics x 3 windows reported"
+else
+    fail "EWMA → LIVE RATES table incomplete"
+fi
+
+# 21b. A busy run has a non-zero 1s produce rate
+RATE=$(echo "$OUTPUT" | grep "Produced (msg/sec)" | awk '{print $3}')
+if awk -v r="${RATE:-0}" 'BEGIN { exit !(r > 0) }'; then
+    pass "EWMA → 1s produce rate is live ($RATE msg/sec)"
+else
+    fail "EWMA → 1s produce rate should be > 0" "rate=${RATE:-none}"
+fi
+
+# 21c. Live rates keep running through the warm-up window
+run 10 -s 42 -p 0 -c 0 --warmup 1 1 1 5 2
+if echo "$OUTPUT" | grep -q "LIVE RATES (EWMA at shutdown)" && \
+   echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "EWMA → reported alongside --warmup, balance PASS"
+else
+    fail "EWMA → expected rates and balance PASS with --warmup"
+fi
+
+# =============================================================================
+# 22. EXACT OCCUPANCY & LITTLE'S LAW
+# =============================================================================
+section "22. Exact Occupancy & Little's Law"
+
+# 22a. Exact section with depth distribution and episode table
+run 10 -s 42 -p 1 -c 1 3 2 5 4
+if echo "$OUTPUT" | grep -q "OCCUPANCY (exact, time-weighted" && \
+   echo "$OUTPUT" | grep -qE "^  Full +[0-9]+" && \
+   echo "$OUTPUT" | grep -qE "^  Empty +[0-9]+"; then
+    pass "Occupancy → exact mean, depth distribution and episodes reported"
+else
+    fail "Occupancy → exact occupancy section incomplete"
+fi
+
+# 22b. Time at each depth adds up to the whole window
+SUM=$(echo "$OUTPUT" | sed -n '/OCCUPANCY (exact/,/Episodes/p' | \
+      grep -E "^  [0-9]+ +[0-9.]+%" | awk '{gsub("%","",$2); s+=$2} END {print s}')
+if awk -v s="${SUM:-0}" 'BEGIN { exit !(s > 99.5 && s < 100.5) }'; then
+    pass "Occupancy → depth fractions sum to 100% ($SUM%)"
+else
+    fail "Occupancy → depth fractions should sum to 100%" "sum=${SUM:-none}"
+fi
+
+# 22c. Little's law holds within 10% for a lightly loaded queue
+ERR=$(echo "$OUTPUT" | grep "Little's Law:" | grep -oE "\([+-][0-9.]+%\)" | tr -d '()%+-')
+if [ -n "$ERR" ] && awk -v e="$ERR" 'BEGIN { exit !(e <= 10.0) }'; then
+    pass "Little's law → L matches lambda*W (error $ERR%)"
+else
+    fail "Little's law → L and lambda*W should agree within 10%" "error=${ERR:-none}"
+fi
+
+# 22d. With --warmup the exact window excludes the warm-up
+run 10 -s 42 -p 0 -c 0 --warmup 1 2 2 5 3
+WINDOW=$(echo "$OUTPUT" | grep -oE "time-weighted over [0-9.]+" | awk '{print $3}')
+if awk -v w="${WINDOW:-99}" 'BEGIN { exit !(w > 1.0 && w < 2.6) }'; then
+    pass "Occupancy → window starts after warm-up (${WINDOW} s)"
+else
+    fail "Occupancy → window should be ~2 s after a 1 s warm-up" "window=${WINDOW:-none}"
+fi
+
+# =============================================================================
+# 23. SATURATION FINDER (--saturate)
+# =============================================================================
+section "23. Saturation Finder (--saturate)"
+
+# 23a. Search completes and reports a knee point
+run 30 --saturate --service-us 1000 --trial-ms 200 2 1 10 20
+KNEE=$(echo "$OUTPUT" | grep "Knee:" | grep -oE "[0-9]+ msg/sec" | awk '{print $1}')
+if [ "$EXIT_CODE" -eq 0 ] && [ -n "$KNEE" ]; then
+    pass "--saturate → knee reported ($KNEE msg/sec)"
+else
+    fail "--saturate → expected a knee point" "exit=$EXIT_CODE"
+fi
+
+# 23b. One consumer at 1 ms/message saturates near 1000 msg/sec
+if [ -n "$KNEE" ] && [ "$KNEE" -ge 400 ] && [ "$KNEE" -le 1100 ]; then
+    pass "--saturate → knee within capacity bound (400-1100, got $KNEE)"
+else
+    fail "--saturate → knee should be near the 1000 msg/sec service limit" "knee=${KNEE:-none}"
+fi
+
+# 23c. Load-latency curve exported as CSV, sorted by offered rate
+CSV="saturation_p2_c1_q10.csv"
+if [ -f "$CSV" ] && head -1 "$CSV" | grep -q "^OfferedRate,AchievedRate,P50_ms" && \
+   tail -n +2 "$CSV" | cut -d, -f1 | sort -n -c 2>/dev/null && \
+   [ "$(tail -n +2 "$CSV" | wc -l)" -ge 3 ]; then
+    pass "--saturate → curve CSV written and sorted"
+else
+    fail "--saturate → curve CSV missing or unsorted"
+fi
+
+# 23d. Out-of-range trial length rejected
+run 5 --saturate --trial-ms 10 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--trial-ms 10 → rejected"
+else
+    fail "--trial-ms 10 → should be rejected"
+fi
+
+# 23e. Block limit above 100% rejected
+run 5 --saturate --block-limit 101 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--block-limit 101 → rejected"
+else
+    fail "--block-limit 101 → should be rejected"
+fi
+
+# =============================================================================
+# 24. SCALING SWEEP (--scale)
+# =============================================================================
+section "24. Scaling Sweep (--scale)"
+
+# 24a. Sweep completes with a SCALING table
+run 20 --scale --scale-max 2 --trial-ms 100 1 1 10 20
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "^SCALING" && \
+   echo "$OUTPUT" | grep -q "Enq p50"; then
+    pass "--scale → scaling table printed"
+else
+    fail "--scale → expected a SCALING table" "exit=$EXIT_CODE"
+fi
+
+# 24b. --scale-max 2 runs 1x1 and 2x2 only
+ROWS=$(echo "$OUTPUT" | grep -cE "^  mutex-ring +[0-9]+x[0-9]+")
+if [ "$ROWS" -eq 2 ] && echo "$OUTPUT" | grep -qE "mutex-ring +2x2"; then
+    pass "--scale-max 2 → 1x1 and 2x2 rows"
+else
+    fail "--scale-max 2 → expected 2 rows" "rows=$ROWS"
+fi
+
+# 24c. Results exported as CSV with per-op percentiles (2 rows x 3 backends)
+CSV="scaling_q10.csv"
+if [ -f "$CSV" ] && head -1 "$CSV" | grep -q "^Backend,Producers,Consumers,Throughput,EnqP50_ns" && \
+   [ "$(tail -n +2 "$CSV" | wc -l)" -eq 6 ] && grep -q "^lease-ring,1,1," "$CSV"; then
+    pass "--scale → scaling CSV written"
+else
+    fail "--scale → scaling CSV missing or incomplete"
+fi
+
+# 24d. --scale-max above MAX_CONSUMERS rejected
+run 5 --scale --scale-max 99 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--scale-max 99 → rejected"
+else
+    fail "--scale-max 99 → should be rejected"
+fi
+
+# =============================================================================
+# 25. TOP-K BATCH DEQUEUE (--batch)
+# =============================================================================
+section "25. Top-k Batch Dequeue (--batch)"
+
+# 25a. A backlogged queue hands out several items per lock
+run 15 -s 7 -p 0 -c 1 --batch 4 4 1 20 4
+RATIO=$(echo "$OUTPUT" | grep "Dequeue Locks:" | grep -oE "[0-9]+\.[0-9]+ items/lock" | awk '{print $1}')
+if [ "$EXIT_CODE" -eq 0 ] && [ -n "$RATIO" ] && awk "BEGIN{exit !($RATIO > 1.0)}"; then
+    pass "--batch 4 → more than one item per lock ($RATIO)"
+else
+    fail "--batch 4 → expected items/lock > 1" "ratio=${RATIO:-none}"
+fi
+
+# 25b. Batching keeps every message accounted for
+if echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--batch 4 → balance check PASS"
+else
+    fail "--batch 4 → balance check should PASS"
+fi
+
+# 25c. Without --batch every lock moves exactly one item
+run 15 -s 7 -p 0 -c 1 4 1 20 3
+if echo "$OUTPUT" | grep -q "1.00 items/lock, batch up to 1"; then
+    pass "Default → 1.00 items/lock"
+else
+    fail "Default → expected 1.00 items/lock"
+fi
+
+# 25d. Batch size above the queue limit rejected
+run 5 --batch 21 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--batch 21 → rejected"
+else
+    fail "--batch 21 → should be rejected"
+fi
+
+# =============================================================================
+# 26. RESERVED CAPACITY (--reserve)
+# =============================================================================
+section "26. Reserved Capacity (--reserve)"
+
+# 26a. Reservation is sized from the capacity and reported
+run 15 -s 1 -p 0 -c 1 --reserve 50 8 1 10 4
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "5 of 10 slots reserved for priority >= 7"; then
+    pass "--reserve 50 → 5 of 10 slots reserved"
+else
+    fail "--reserve 50 → expected 5 reserved slots in the report" "exit=$EXIT_CODE"
+fi
+
+# 26b. Under a flood the high class blocks less often than the normal class
+NORMAL_PCT=$(echo "$OUTPUT" | grep -E "^  normal +[0-9]" | awk '{print $4}' | tr -d '%')
+HIGH_PCT=$(echo "$OUTPUT" | grep -E "^  high +[0-9]" | awk '{print $4}' | tr -d '%')
+if [ -n "$NORMAL_PCT" ] && [ -n "$HIGH_PCT" ] && \
+   awk "BEGIN{exit !($HIGH_PCT < $NORMAL_PCT)}"; then
+    pass "--reserve → high class blocks less (${HIGH_PCT}% vs ${NORMAL_PCT}%)"
+else
+    fail "--reserve → high class should block less than normal" \
+         "high=${HIGH_PCT:-none} normal=${NORMAL_PCT:-none}"
+fi
+
+# 26c. Shared tokens are returned on dequeue: balance still holds
+if echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--reserve → balance check PASS"
+else
+    fail "--reserve → balance check should PASS"
+fi
+
+# 26d. Reservation above the limit rejected
+run 5 --reserve 95 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--reserve 95 → rejected"
+else
+    fail "--reserve 95 → should be rejected"
+fi
+
+# =============================================================================
+# 27. CREDIT-BASED FLOW CONTROL (--credits)
+# =============================================================================
+section "27. Credit Flow Control (--credits)"
+
+# 27a. Credit mode reported, with far fewer admission steps than semaphore mode
+run 15 -s 3 -p 0 -c 0 --credits 8 4 2 10 2
+CREDIT_STEPS=$(echo "$OUTPUT" | grep "Atomic Steps:" | grep -oE "\([0-9.]+ per message\)" | grep -oE "[0-9.]+")
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "FLOW CONTROL (credits)" && [ -n "$CREDIT_STEPS" ]; then
+    pass "--credits 8 → flow control section ($CREDIT_STEPS steps/msg)"
+else
+    fail "--credits 8 → expected FLOW CONTROL (credits) section" "exit=$EXIT_CODE"
+fi
+
+# 27b. Every credit is spent or returned: balance still holds
+if echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--credits → balance check PASS"
+else
+    fail "--credits → balance check should PASS"
+fi
+
+# 27c. Credits need fewer slot operations per message than the semaphore
+run 15 -s 3 -p 0 -c 0 4 2 10 2
+SEM_OPS=$(echo "$OUTPUT" | grep "Slot Sem Ops:" | grep -oE "\([0-9.]+ per message\)" | grep -oE "[0-9.]+")
+if [ -n "$SEM_OPS" ] && [ -n "$CREDIT_STEPS" ] && \
+   awk "BEGIN{exit !($CREDIT_STEPS < $SEM_OPS)}"; then
+    pass "--credits → $CREDIT_STEPS steps/msg vs $SEM_OPS semaphore ops/msg"
+else
+    fail "--credits → expected fewer admission steps than the semaphore" \
+         "credits=${CREDIT_STEPS:-none} sem=${SEM_OPS:-none}"
+fi
+
+# 27d. Credit batch above the queue limit rejected
+run 5 --credits 21 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--credits 21 → rejected"
+else
+    fail "--credits 21 → should be rejected"
+fi
+
+# =============================================================================
+# 28. DELAYED DELIVERY (--delay)
+# =============================================================================
+section "28. Timing Wheel (--delay)"
+
+# 28a. Delayed messages are reported with a lateness histogram
+run 15 -s 3 -p 0 -c 0 --delay 200 3 2 20 3
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "SCHEDULED DELIVERY" && \
+   echo "$OUTPUT" | grep -q "Lateness (ms):"; then
+    pass "--delay 200 → scheduled delivery section with lateness"
+else
+    fail "--delay 200 → expected SCHEDULED DELIVERY section" "exit=$EXIT_CODE"
+fi
+
+# 28b. Messages still in the wheel are counted: balance holds
+if echo "$OUTPUT" | grep -q "+ Delayed (" && echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--delay → balance check PASS (including delayed)"
+else
+    fail "--delay → balance check should PASS with a Delayed term"
+fi
+
+# 28c. Timer promotes within a few ticks of the deadline
+DELAY_P50=$(echo "$OUTPUT" | grep "Lateness (ms):" | grep -oE "p50 [0-9.]+" | awk '{print $2}')
+if [ -n "$DELAY_P50" ] && awk "BEGIN{exit !($DELAY_P50 < 20)}"; then
+    pass "--delay → p50 lateness ${DELAY_P50} ms"
+else
+    fail "--delay → p50 lateness should stay under 20 ms" "p50=${DELAY_P50:-none}"
+fi
+
+# 28d. Delay above the limit rejected
+run 5 --delay 60001 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--delay 60001 → rejected"
+else
+    fail "--delay 60001 → should be rejected"
+fi
+
+# =============================================================================
+# 29. MESSAGE TTL (--ttl)
+# =============================================================================
+section "29. Message TTL (--ttl)"
+
+# 29a. Slow consumer, fast producers: stale items expire and are reported
+run 15 -s 3 -p 0 -c 1 --ttl 200 4 1 10 4
+EXPIRED_TOTAL=$(echo "$OUTPUT" | grep -E "^  All +[0-9]+" | awk '{print $4}')
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "EXPIRED MESSAGES (TTL 200 ms)" && \
+   [ -n "$EXPIRED_TOTAL" ] && [ "$EXPIRED_TOTAL" -gt 0 ]; then
+    pass "--ttl 200 → $EXPIRED_TOTAL messages expired"
+else
+    fail "--ttl 200 → expected expired messages in the report" "total=${EXPIRED_TOTAL:-none}"
+fi
+
+# 29b. Dropped messages are accounted for: balance holds
+if echo "$OUTPUT" | grep -q "+ Expired (" && echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--ttl → balance check PASS (including expired)"
+else
+    fail "--ttl → balance check should PASS with an Expired term"
+fi
+
+# 29c. The sweeper reclaims in bounded batches
+SWEEPS=$(echo "$OUTPUT" | grep "Sweeper:" | grep -oE "[0-9]+ passes" | grep -oE "[0-9]+")
+if [ -n "$SWEEPS" ] && [ "$SWEEPS" -gt 0 ] && \
+   echo "$OUTPUT" | grep "Sweeper:" | grep -q "<= 4 items/pass"; then
+    pass "--ttl → sweeper ran $SWEEPS bounded passes"
+else
+    fail "--ttl → expected sweeper passes in the report" "sweeps=${SWEEPS:-none}"
+fi
+
+# 29d. TTL above the limit rejected
+run 5 --ttl 60001 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--ttl 60001 → rejected"
+else
+    fail "--ttl 60001 → should be rejected"
+fi
+
+# =============================================================================
+# 30. AT-LEAST-ONCE DELIVERY (--ack-timeout)
+# =============================================================================
+section "30. At-Least-Once Delivery (--ack-timeout)"
+
+# 30a. Consumers sleep past the visibility timeout: leases expire and
+#      the messages are redelivered
+run 20 -s 3 -p 0 -c 1 --ack-timeout 300 --fail-pct 30 3 2 10 4
+REDELIVERED=$(echo "$OUTPUT" | grep "Redelivered:" | grep -oE "[0-9]+")
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "^DELIVERY (at-least-once, ack within 300 ms" && \
+   [ -n "$REDELIVERED" ] && [ "$REDELIVERED" -gt 0 ]; then
+    pass "--ack-timeout 300 → $REDELIVERED redeliveries"
+else
+    fail "--ack-timeout 300 → expected redeliveries in the report" "redelivered=${REDELIVERED:-none}"
+fi
+
+# 30b. Every lease ends in exactly one ack, nack or timeout
+LEASES=$(echo "$OUTPUT" | grep "Leases:" | awk '{print $2}')
+ACKS=$(echo "$OUTPUT" | grep "Acked:" | awk '{print $2}')
+NACKS=$(echo "$OUTPUT" | grep "Nacked:" | awk '{print $2}')
+TIMEOUTS=$(echo "$OUTPUT" | grep "Timed Out:" | awk '{print $3}')
+if [ -n "$LEASES" ] && [ -n "$ACKS" ] && [ -n "$NACKS" ] && [ -n "$TIMEOUTS" ] && \
+   [ "$LEASES" -gt 0 ] && [ "$LEASES" -eq $((ACKS + NACKS + TIMEOUTS)) ]; then
+    pass "--ack-timeout → $LEASES leases = $ACKS acks + $NACKS nacks + $TIMEOUTS timeouts"
+else
+    fail "--ack-timeout → lease outcomes do not add up" \
+         "leases=${LEASES:-?} acks=${ACKS:-?} nacks=${NACKS:-?} timeouts=${TIMEOUTS:-?}"
+fi
+
+# 30c. Always failing: every message ends in the DLQ after 2 deliveries,
+#      and the balance check accounts for it
+run 20 -s 3 -p 1 -c 0 --ack-timeout 1000 --fail-pct 100 --max-deliveries 2 2 1 10 3
+DEAD=$(echo "$OUTPUT" | grep "Dead-lettered:" | awk '{print $2}')
+if [ -n "$DEAD" ] && [ "$DEAD" -gt 0 ] && echo "$OUTPUT" | grep -q "+ Dead-lettered (" && \
+   echo "$OUTPUT" | grep -q "Latest DLQ:.*2 deliveries" && echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--fail-pct 100 → $DEAD dead-lettered, balance PASS"
+else
+    fail "--fail-pct 100 → expected dead letters and a passing balance" "dead=${DEAD:-none}"
+fi
+
+# 30d. Nack injection without leases rejected
+run 5 --fail-pct 10 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--fail-pct without --ack-timeout → rejected"
+else
+    fail "--fail-pct without --ack-timeout → should be rejected"
+fi
+
+# =============================================================================
+# 31. SELECTIVE RECEIVE (--filter)
+# =============================================================================
+section "31. Selective Receive (--filter)"
+
+# 31a. Consumer 1 takes only the 7-9 band
+run 15 -s 3 -p 1 -c 0 --filter 1:7-9 --filter 2:p2/0-6 3 2 10 4
+C1_READS=$(echo "$OUTPUT" | grep -c "Consumer 1: Read")
+C1_OUTSIDE=$(echo "$OUTPUT" | grep "Consumer 1: Read" | grep -cvE "pri=[789],")
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "^SELECTIVE RECEIVE (2 filtered consumers)" && \
+   [ "$C1_READS" -gt 0 ] && [ "$C1_OUTSIDE" -eq 0 ]; then
+    pass "--filter 1:7-9 → $C1_READS reads, all priority 7-9"
+else
+    fail "--filter 1:7-9 → consumer 1 read outside its band" "reads=$C1_READS outside=$C1_OUTSIDE"
+fi
+
+# 31b. Consumer 2 takes only producer 2 below priority 7; balance holds
+C2_OUTSIDE=$(echo "$OUTPUT" | grep "Consumer 2: Read" | grep -cvE "pri=[0-6],.*from P2 ")
+if [ "$C2_OUTSIDE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--filter 2:p2/0-6 → only P2 low band, balance PASS"
+else
+    fail "--filter 2:p2/0-6 → wrong items or balance FAIL" "outside=$C2_OUTSIDE"
+fi
+
+# 31c. Indexes skip non-matching items and arrivals wake matching waiters
+CAND=$(echo "$OUTPUT" | grep "Index Lookups:" | awk '{print $3}')
+QUEUED=$(echo "$OUTPUT" | grep "Index Lookups:" | awk '{print $7}')
+WAKES=$(echo "$OUTPUT" | grep "Waits:" | grep -oE "[0-9]+ targeted" | grep -oE "[0-9]+")
+if [ -n "$CAND" ] && [ -n "$QUEUED" ] && [ -n "$WAKES" ] && [ "$WAKES" -gt 0 ] && \
+   awk -v c="$CAND" -v q="$QUEUED" 'BEGIN { exit !(c < q) }'; then
+    pass "--filter → $CAND candidates vs $QUEUED queued, $WAKES targeted wake-ups"
+else
+    fail "--filter → index lookups or targeted wake-ups missing" \
+         "cand=${CAND:-?} queued=${QUEUED:-?} wakes=${WAKES:-?}"
+fi
+
+# 31d. Inverted priority band rejected
+run 5 --filter 1:9-3 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--filter 1:9-3 → rejected"
+else
+    fail "--filter 1:9-3 → should be rejected"
+fi
+
+# =============================================================================
+# 32. KEY COALESCING (--coalesce)
+# =============================================================================
+section "32. Key Coalescing (--coalesce)"
+
+# 32a. Slow consumers: most updates fold into a queued message, balance holds
+run 15 -s 3 -p 1 -c 2 --coalesce 3 3 1 10 5
+FOLDED=$(echo "$OUTPUT" | grep -oE "\+ Coalesced \([0-9]+\)" | grep -oE "[0-9]+")
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "^KEY COALESCING (3 keys)" && \
+   [ -n "$FOLDED" ] && [ "$FOLDED" -gt 0 ] && echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--coalesce 3 → $FOLDED updates coalesced, balance PASS"
+else
+    fail "--coalesce 3 → no coalescing or balance FAIL" "coalesced=${FOLDED:-?}"
+fi
+
+# 32b. One queued message per key: depth never exceeds the key space
+MAX_DEPTH=$(echo "$OUTPUT" | grep "Producer .*: Wrote" | grep -oE "Queue: [0-9]+" | \
+            grep -oE "[0-9]+" | sort -n | tail -1)
+if [ -n "$MAX_DEPTH" ] && [ "$MAX_DEPTH" -le 3 ]; then
+    pass "--coalesce 3 → queue depth stays <= 3 (max $MAX_DEPTH)"
+else
+    fail "--coalesce 3 → more queued messages than keys" "max_depth=${MAX_DEPTH:-?}"
+fi
+
+# 32c. Consumers see folded updates; every fold saved a slot and a dequeue
+SLOTS=$(echo "$OUTPUT" | grep "Slots Saved:" | awk '{print $3}')
+DEQS=$(echo "$OUTPUT" | grep "Dequeues Saved:" | awk '{print $3}')
+if echo "$OUTPUT" | grep "Consumer .*: Read" | grep -qE "Key [0-9]+, [0-9]+ updates? folded" && \
+   [ -n "$SLOTS" ] && [ "$SLOTS" = "$FOLDED" ] && [ "$DEQS" = "$FOLDED" ]; then
+    pass "--coalesce → folded reads, $SLOTS slots and $DEQS dequeues saved"
+else
+    fail "--coalesce → savings do not match coalesced count" \
+         "slots=${SLOTS:-?} dequeues=${DEQS:-?} coalesced=${FOLDED:-?}"
+fi
+
+# 32d. Empty key space rejected
+run 5 --coalesce 0 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--coalesce 0 → rejected"
+else
+    fail "--coalesce 0 → should be rejected"
+fi
+
+# =============================================================================
+# 33. PARTITIONED DELIVERY (--partitions)
+# =============================================================================
+section "33. Partitioned Delivery (--partitions)"
+
+# 33a. Each producer's messages are read in the order they were written
+run 15 -s 3 -p 1 -c 2 --partitions 4 3 3 10 5
+ORDER_OK=1
+for P in 1 2 3; do
+    WROTE=$(echo "$OUTPUT" | grep "Producer $P: Wrote" | grep -oE "data=[0-9]+" | tr '\n' ' ')
+    READ=$(echo "$OUTPUT" | grep "Read .* from P$P " | grep -oE "data=[0-9]+" | tr '\n' ' ')
+    case "$WROTE" in
+        "$READ"*) ;;
+        *) ORDER_OK=0 ;;
+    esac
+done
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "^PARTITIONS (4, per-key FIFO" && \
+   [ "$ORDER_OK" -eq 1 ]; then
+    pass "--partitions 4 → per-producer FIFO order across 3 consumers"
+else
+    fail "--partitions 4 → a producer's messages were read out of order"
+fi
+
+# 33b. One partition lease per consumed message, balance holds
+LEASES=$(echo "$OUTPUT" | grep "Leases:" | awk '{print $2}')
+CONSUMED=$(echo "$OUTPUT" | grep -oE "Total Consumed: [0-9]+" | grep -oE "[0-9]+")
+if [ -n "$LEASES" ] && [ "$LEASES" = "$CONSUMED" ] && echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--partitions → $LEASES leases for $CONSUMED messages, balance PASS"
+else
+    fail "--partitions → lease count does not match consumed" \
+         "leases=${LEASES:-?} consumed=${CONSUMED:-?}"
+fi
+
+# 33c. Skew and hand-off cost reported
+SKEW=$(echo "$OUTPUT" | grep "Skew:" | grep -oE "[0-9.]+x")
+if [ -n "$SKEW" ] && echo "$OUTPUT" | grep -qE "hand-offs to another consumer" && \
+   echo "$OUTPUT" | grep -q "Lease Waits:"; then
+    pass "--partitions → skew $SKEW, hand-offs and lease waits reported"
+else
+    fail "--partitions → skew or hand-off cost missing"
+fi
+
+# 33d. Batching would take several items of one partition at once
+run 5 --partitions 2 --batch 2 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--partitions 2 --batch 2 → rejected"
+else
+    fail "--partitions 2 --batch 2 → should be rejected"
+fi
+
+# =============================================================================
+# 34. DISK SPILL-OVER (--spill)
+# =============================================================================
+section "34. Disk Spill-Over (--spill)"
+
+# 34a. Producers outpace the consumer: the ring overflows to disk, nobody blocks
+run 15 -s 3 -p 1 -c 2 --spill 100 3 1 2 6
+PBLOCKED=$(echo "$OUTPUT" | grep -oE "Total Produced: [0-9]+ \| Total Blocked: [0-9]+" | \
+           grep -oE "[0-9]+$")
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "^DISK SPILL-OVER (100 records" && \
+   [ "$PBLOCKED" = "0" ] && echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--spill 100 → full ring spilled, 0 producer blocks, balance PASS"
+else
+    fail "--spill 100 → producers blocked or balance FAIL" "blocked=${PBLOCKED:-?}"
+fi
+
+# 34b. Every spilled record was read back or is still on disk
+SPILLED=$(echo "$OUTPUT" | grep "Spilled:  " | awk '{print $2}')
+REFILLED=$(echo "$OUTPUT" | grep "Refilled:" | awk '{print $2}')
+ONDISK=$(echo "$OUTPUT" | grep "Refilled:" | grep -oE "\([0-9]+ still" | grep -oE "[0-9]+")
+if [ -n "$SPILLED" ] && [ -n "$REFILLED" ] && [ -n "$ONDISK" ] && \
+   [ "$SPILLED" -gt 0 ] && [ "$SPILLED" -eq $((REFILLED + ONDISK)) ] && \
+   echo "$OUTPUT" | grep -q "Disk Residence:" && echo "$OUTPUT" | grep -q "Copy Bandwidth:"; then
+    pass "--spill → $SPILLED spilled = $REFILLED refilled + $ONDISK on disk, residence reported"
+else
+    fail "--spill → spill volume does not add up" \
+         "spilled=${SPILLED:-?} refilled=${REFILLED:-?} on_disk=${ONDISK:-?}"
+fi
+
+# 34c. A full spill file falls back to blocking without losing messages
+run 15 -s 3 -p 0 -c 1 --spill 5 3 1 2 3
+FULL=$(echo "$OUTPUT" | grep "Spill File Full:" | awk '{print $4}')
+if [ "$EXIT_CODE" -eq 0 ] && [ -n "$FULL" ] && [ "$FULL" -gt 0 ] && \
+   echo "$OUTPUT" | grep -q "Result: PASS"; then
+    pass "--spill 5 → file full, $FULL enqueues blocked instead, balance PASS"
+else
+    fail "--spill 5 → no fallback to blocking or balance FAIL" "full=${FULL:-?}"
+fi
+
+# 34d. Partitioned consumers free slots under the queue mutex
+run 5 --spill 10 --partitions 2 1 1 5 5
+if [ "$EXIT_CODE" -ne 0 ]; then
+    pass "--spill 10 --partitions 2 → rejected"
+else
+    fail "--spill 10 --partitions 2 → should be rejected"
+fi
+
+# =============================================================================
+# 35. MONITOR EVENT LOOP (epoll + signalfd + timerfd)
+# =============================================================================
+section "35. Monitor Event Loop (epoll)"
+
+# 35a. A short run wakes the monitor once: for the deadline
+run 10 -s 3 1 1 5 3
+if [ "$EXIT_CODE" -eq 0 ] && \
+   echo "$OUTPUT" | grep -qE "Monitor: stopped by deadline after 3\.[0-9]+ s, 1 wake-up \(0 ticks\)"; then
+    pass "3 s run → monitor woke once, for the deadline"
+else
+    fail "3 s run → monitor should wake only for the deadline" \
+         "$(echo "$OUTPUT" | grep "Monitor:")"
+fi
+
+# 35b. Progress lines come from the tick timer, one per interval
+run 20 -s 3 1 1 5 11
+LINES=$(echo "$OUTPUT" | grep -c "seconds remaining")
+if [ "$EXIT_CODE" -eq 0 ] && [ "$LINES" -eq 1 ] && \
+   echo "$OUTPUT" | grep -q -- "--- 1 seconds remaining ---" && \
+   echo "$OUTPUT" | grep -qE "Monitor: stopped by deadline .* 2 wake-ups \(1 tick\)"; then
+    pass "11 s run → 1 progress line, 2 wake-ups (tick + deadline)"
+else
+    fail "11 s run → unexpected progress lines or wake-ups" "lines=$LINES"
+fi
+
+# 35c. SIGTERM reaches the loop at once, even with helper threads running
+$BINARY -s 42 --ttl 500 --ack-timeout 200 2 2 10 60 > /tmp/test_monitor_out 2>&1 &
+PID=$!
+sleep 1.5
+kill -TERM "$PID" 2>/dev/null
+wait "$PID" 2>/dev/null
+MON_EXIT=$?
+MON_OUTPUT=$(cat /tmp/test_monitor_out)
+STOP_S=$(echo "$MON_OUTPUT" | grep -oE "stopped by SIGTERM after [0-9.]+" | grep -oE "[0-9.]+$")
+if [ "$MON_EXIT" -eq 0 ] && [ -n "$STOP_S" ] && \
+   awk -v t="$STOP_S" 'BEGIN { exit !(t < 1.8) }' && \
+   echo "$MON_OUTPUT" | grep -q "Result: PASS"; then
+    pass "SIGTERM at 1.5 s → monitor stopped after $STOP_S s, balance PASS"
+else
+    fail "SIGTERM → not handled promptly by the monitor" "exit=$MON_EXIT stop=${STOP_S:-?}"
+fi
+
+# 35d. A second signal during shutdown is ignored
+$BINARY -s 42 2 2 10 60 > /tmp/test_monitor_out 2>&1 &
+PID=$!
+sleep 1
+kill -INT "$PID" 2>/dev/null
+sleep 0.1
+kill -INT "$PID" 2>/dev/null
+wait "$PID" 2>/dev/null
+MON_EXIT=$?
+MON_OUTPUT=$(cat /tmp/test_monitor_out)
+if [ "$MON_EXIT" -eq 0 ] && [ "$(echo "$MON_OUTPUT" | grep -c "SIGNAL.*Shutting down")" -eq 1 ] && \
+   echo "$MON_OUTPUT" | grep -q "Result: PASS"; then
+    pass "SIGINT twice → one shutdown, clean exit, balance PASS"
+else
+    fail "SIGINT twice → second signal disturbed the shutdown" "exit=$MON_EXIT"
+fi
+rm -f /tmp/test_monitor_out
+
+# =============================================================================
+# 36. EPOLL READINESS (--epoll, --wakeup-bench)
+# =============================================================================
+section "36. Epoll Readiness (eventfd)"
+
+# 36a. Edge mode: one eventfd write per message, nothing lost
+run 20 -s 42 --epoll edge -p 1 -c 1 4 2 4 3
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "EPOLL READINESS (edge-triggered eventfd)" && \
+   echo "$OUTPUT" | grep -qE "Eventfd Writes: +[0-9]+ \(1\.000 per message\)"; then
+    pass "--epoll edge → 1 eventfd write per message, balance PASS"
+else
+    fail "--epoll edge → missing section, wrong write count or imbalance" \
+         "$(echo "$OUTPUT" | grep -E "Eventfd Writes|Result:")"
+fi
+
+# 36b. Level mode: writes only on empty -> non-empty, drained on empty
+run 20 -s 42 --epoll level -p 1 -c 1 4 2 4 3
+WRITES=$(echo "$OUTPUT" | grep -oE "Eventfd Writes: +[0-9]+" | grep -oE "[0-9]+$")
+PRODUCED=$(echo "$OUTPUT" | grep -oE "Produced \([0-9]+\)" | grep -oE "[0-9]+")
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   [ -n "$WRITES" ] && [ -n "$PRODUCED" ] && [ "$WRITES" -lt "$PRODUCED" ]; then
+    pass "--epoll level → $WRITES writes for $PRODUCED messages, balance PASS"
+else
+    fail "--epoll level → expected fewer writes than messages" \
+         "writes=${WRITES:-?} produced=${PRODUCED:-?}"
+fi
+
+# 36c. Wake-up benchmark reports every path
+run 30 --wakeup-bench 200 1 1 4 2
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "WAKE-UP LATENCY (200 rounds" && \
+   echo "$OUTPUT" | grep -qE "^  sem_wait +[0-9.]+" && \
+   echo "$OUTPUT" | grep -qE "^  epoll-level +[0-9.]+" && \
+   echo "$OUTPUT" | grep -qE "^  epoll-edge +[0-9.]+ .* 1\.00 +1\.00$"; then
+    pass "--wakeup-bench 200 → sem_wait, epoll-level and epoll-edge rows"
+else
+    fail "--wakeup-bench → missing path rows" "$(echo "$OUTPUT" | grep -A6 "WAKE-UP")"
+fi
+
+# 36d. Batches count items out of the semaphore: rejected with --epoll
+run 5 --epoll edge --batch 2 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "\-\-epoll cannot be combined"; then
+    pass "--epoll edge --batch 2 → rejected"
+else
+    fail "--epoll edge --batch 2 → should be rejected" "exit=$EXIT_CODE"
+fi
+
+# =============================================================================
+# 37. FILE SINK (--sink, --sink-backend, --sink-sync)
+# =============================================================================
+section "37. File Sink (io_uring / writev)"
+
+# 37a. io_uring sink: one record per consumed message
+rm -f /tmp/test_sink.csv
+run 20 -s 42 --sink /tmp/test_sink.csv -p 1 -c 1 4 2 4 3
+CONSUMED=$(echo "$OUTPUT" | grep -oE "Total Consumed: [0-9]+" | grep -oE "[0-9]+$")
+LINES=$(wc -l < /tmp/test_sink.csv 2>/dev/null)
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -qE "FILE SINK \(/tmp/test_sink.csv via (io_uring|writev)\)" && \
+   [ -n "$CONSUMED" ] && [ "${LINES:-0}" -eq "$CONSUMED" ]; then
+    pass "--sink → $LINES records for $CONSUMED consumed, balance PASS"
+else
+    fail "--sink → record count does not match consumed" \
+         "lines=${LINES:-?} consumed=${CONSUMED:-?}"
+fi
+
+# 37b. writev backend is selectable and writes the same record format
+rm -f /tmp/test_sink.csv
+run 20 -s 42 --sink /tmp/test_sink.csv --sink-backend writev -p 1 -c 1 4 2 4 3
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "FILE SINK (/tmp/test_sink.csv via writev)" && \
+   grep -qE "^[0-9]+,[0-9]+,[0-9]+,[0-9]+,[0-9]+$" /tmp/test_sink.csv; then
+    pass "--sink-backend writev → writev section, CSV records"
+else
+    fail "--sink-backend writev → missing section or malformed records" \
+         "$(echo "$OUTPUT" | grep "FILE SINK"; head -2 /tmp/test_sink.csv 2>/dev/null)"
+fi
+
+# 37c. --sink-sync adds one fdatasync per group
+rm -f /tmp/test_sink.csv
+run 20 -s 42 --sink /tmp/test_sink.csv --sink-sync -p 1 -c 1 4 2 4 3
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "+ fdatasync)" && \
+   echo "$OUTPUT" | grep -qE "^  fdatasync: +p50 [0-9.]+ ms"; then
+    pass "--sink-sync → fdatasync latency reported, balance PASS"
+else
+    fail "--sink-sync → missing fdatasync line" "$(echo "$OUTPUT" | grep -A8 "FILE SINK")"
+fi
+
+# 37d. Sink options without a sink path are rejected
+run 5 --sink-sync 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "need --sink"; then
+    pass "--sink-sync without --sink → rejected"
+else
+    fail "--sink-sync without --sink → should be rejected" "exit=$EXIT_CODE"
+fi
+rm -f /tmp/test_sink.csv
+
+# =============================================================================
+# 38. INGESTION SOURCE (--source)
+# =============================================================================
+section "38. Ingestion Source (mmap / stdin)"
+
+# 200 messages, one comment, one blank line and two malformed lines
+{
+    echo "# data,priority"
+    for i in $(seq 1 200); do echo "$i,$((i % 10))"; done
+    echo ""
+    echo "bad,line"
+    echo "7,42"
+} > /tmp/test_ingest.txt
+
+# 38a. Regular file: mapped, parsed, drained, run ends at end of input
+run 20 -s 42 --source /tmp/test_ingest.txt -p 0 -c 0 2 2 10 15
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "INGEST SOURCE (/tmp/test_ingest.txt via mmap, 2 readers)" && \
+   echo "$OUTPUT" | grep -q "202 message lines (2 malformed, 2 blank/comment)" && \
+   echo "$OUTPUT" | grep -q "Total Consumed: 200 " && \
+   echo "$OUTPUT" | grep -q "Monitor: stopped by watched descriptor"; then
+    pass "--source file → 200 messages via mmap, 2 malformed skipped, stops at end of input"
+else
+    fail "--source file → wrong counts or the run did not stop at end of input" \
+         "$(echo "$OUTPUT" | grep -E "message lines|Total Consumed|Monitor:")"
+fi
+
+# 38b. stdin as a pipe: streamed in large reads
+run 20 -s 42 --source - -p 0 -c 0 3 2 10 15 < <(cat /tmp/test_ingest.txt)
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "INGEST SOURCE (stdin via stream, 3 readers)" && \
+   echo "$OUTPUT" | grep -q "Total Consumed: 200 " && \
+   echo "$OUTPUT" | grep -qE "^  Reads: +[0-9]+ read\(\) calls"; then
+    pass "--source - (pipe) → 200 messages streamed by 3 readers, balance PASS"
+else
+    fail "--source - (pipe) → wrong mode or count" \
+         "$(echo "$OUTPUT" | grep -E "INGEST SOURCE|Total Consumed|Reads:")"
+fi
+
+# 38c. Middle of a pipeline: stdin in, one sink record per message out
+rm -f /tmp/test_sink.csv
+run 20 -s 42 --source - --sink /tmp/test_sink.csv -p 0 -c 0 1 2 10 15 < /tmp/test_ingest.txt
+LINES=$(wc -l < /tmp/test_sink.csv 2>/dev/null)
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "Batch Enqueues:" && [ "${LINES:-0}" -eq 200 ]; then
+    pass "--source - --sink → 200 records written for 200 input lines"
+else
+    fail "--source - --sink → sink records do not match the input" "lines=${LINES:-?}"
+fi
+rm -f /tmp/test_sink.csv
+
+# 38d. Batches bypass per-message admission: credits rejected
+run 5 --source /tmp/test_ingest.txt --credits 2 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "\-\-source cannot be combined"; then
+    pass "--source with --credits → rejected"
+else
+    fail "--source with --credits → should be rejected" "exit=$EXIT_CODE"
+fi
+rm -f /tmp/test_ingest.txt
+
+# =============================================================================
+# 39. SOCKET LISTENER (--listen)
+# =============================================================================
+section "39. Socket Listener (Unix socket / loadgen)"
+
+# 39a. 8 clients x 5000 frames: every frame enqueued and consumed once
+rm -f /tmp/test_listen.sock
+./loadgen -n 5000 /tmp/test_listen.sock 8 10 > /tmp/test_loadgen.out 2>&1 &
+LOADGEN_PID=$!
+run 20 -s 42 --listen /tmp/test_listen.sock -p 0 -c 0 2 2 10 4
+wait "$LOADGEN_PID"
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "Socket listener: 40000 messages from clients" && \
+   echo "$OUTPUT" | grep -q "Total Consumed: 40000 " && \
+   echo "$OUTPUT" | grep -q "8 accepted, peak 8 at once" && \
+   grep -q "sent 40000 frames over 8 connections" /tmp/test_loadgen.out && \
+   [ ! -e /tmp/test_listen.sock ]; then
+    pass "--listen → 40000 frames from 8 clients enqueued, consumed, socket removed"
+else
+    fail "--listen → frames lost or counts wrong" \
+         "$(echo "$OUTPUT" | grep -E "Socket listener|Total Consumed|Clients:"; cat /tmp/test_loadgen.out)"
+fi
+
+# 39b. Slow consumers: the listener stops reading, clients see full buffers
+./loadgen /tmp/test_listen.sock 4 3 > /tmp/test_loadgen.out 2>&1 &
+LOADGEN_PID=$!
+run 20 -s 42 --listen /tmp/test_listen.sock -p 0 -c 1 1 1 5 3
+wait "$LOADGEN_PID"
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -qE "Back-Pressure: +[1-9][0-9]* batches waited" && \
+   grep -qE "pushback [1-9][0-9]* full-buffer writes" /tmp/test_loadgen.out; then
+    pass "--listen with a slow consumer → reading pauses, loadgen sees EAGAIN"
+else
+    fail "--listen with a slow consumer → no back-pressure seen" \
+         "$(echo "$OUTPUT" | grep "Back-Pressure"; cat /tmp/test_loadgen.out)"
+fi
+rm -f /tmp/test_loadgen.out /tmp/test_listen.sock
+
+# 39c. A regular file at the socket path is refused and left alone
+echo "keep" > /tmp/test_listen.sock
+run 5 --listen /tmp/test_listen.sock 1 1 5 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "exists and is not a socket" && \
+   [ "$(cat /tmp/test_listen.sock 2>/dev/null)" = "keep" ]; then
+    pass "--listen on a regular file → refused, file untouched"
+else
+    fail "--listen on a regular file → should be refused without removing it" "exit=$EXIT_CODE"
+fi
+rm -f /tmp/test_listen.sock
+
+# 39d. The listener replaces the producers: --source rejected
+run 5 --listen /tmp/test_listen.sock --source - 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "\-\-listen cannot be combined"; then
+    pass "--listen with --source → rejected"
+else
+    fail "--listen with --source → should be rejected" "exit=$EXIT_CODE"
+fi
+
+# =============================================================================
+# 40. REQUEST / RESPONSE (--rpc)
+# =============================================================================
+section "40. Request / Response (--rpc)"
+
+# 40a. Closed-loop clients: round trips reported, balance still holds
+run 20 -s 42 --rpc 4 -p 0 -c 0 2 2 10 3
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "REQUEST / RESPONSE (2 clients, 4 outstanding each)" && \
+   echo "$OUTPUT" | grep -qE "Sustained Rate: +[0-9.]+ req/s \(closed loop, 8 requests in flight\)" && \
+   echo "$OUTPUT" | grep -q "Round trip (to reply)"; then
+    pass "--rpc 4 → RTT distribution and sustained req/s with 8 in flight"
+else
+    fail "--rpc 4 → round-trip report missing" \
+         "$(echo "$OUTPUT" | grep -E "REQUEST|Sustained|Round trip")"
+fi
+
+# 40b. Every request is answered or still outstanding at the stop
+SENT=$(echo "$OUTPUT" | sed -n 's/.*Requests: *\([0-9]*\) sent, \([0-9]*\) replies, \([0-9]*\) unanswered.*/\1 \2 \3/p')
+read -r R_SENT R_REPLIES R_OPEN <<< "${SENT:-0 0 0}"
+if [ -n "$SENT" ] && [ "$R_SENT" -gt 0 ] && [ "$R_SENT" -eq $((R_REPLIES + R_OPEN)) ] && \
+   [ "$R_OPEN" -le 8 ]; then
+    pass "--rpc → sent ($R_SENT) == replies ($R_REPLIES) + unanswered ($R_OPEN), at most 8 unanswered"
+else
+    fail "--rpc → requests and replies do not add up" "${SENT:-no Requests line}"
+fi
+
+# 40c. One outstanding request: a client never has a second slot in use
+run 20 -s 42 --rpc 1 -p 0 -c 0 1 1 10 2
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Producer 1: Request 1 " && \
+   ! echo "$OUTPUT" | grep -q "Producer 1: Request 2 " && \
+   ! echo "$OUTPUT" | grep -qE "Producer 1: Request .*Queue: [2-9]+/"; then
+    pass "--rpc 1 → one request in flight, never two queued"
+else
+    fail "--rpc 1 → more than one request outstanding" \
+         "$(echo "$OUTPUT" | grep -m3 "Request [2-9]")"
+fi
+
+# 40d. Redelivery would answer a request twice: --ack-timeout rejected
+run 5 --rpc 2 --ack-timeout 100 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "\-\-rpc cannot be combined"; then
+    pass "--rpc with --ack-timeout → rejected"
+else
+    fail "--rpc with --ack-timeout → should be rejected" "exit=$EXIT_CODE"
+fi
+
+# =============================================================================
+# 41. PUB/SUB FAN-OUT (--groups)
+# =============================================================================
+section "41. Pub/Sub Fan-Out (--groups)"
+
+# 41a. Two groups: every message consumed once per group, stored once
+run 20 -s 42 --groups 2 -p 0 -c 0 2 4 8 3
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -qE "Produced \([0-9]+\) x Groups \(2\) == Consumed" && \
+   echo "$OUTPUT" | grep -q "TOPIC FAN-OUT (2 groups, shared log of 8 slots)" && \
+   echo "$OUTPUT" | grep -q "a queue per group would hold"; then
+    pass "--groups 2 → Produced x 2 == Consumed + Lag, shared-log memory reported"
+else
+    fail "--groups 2 → fan-out balance or report missing" \
+         "$(echo "$OUTPUT" | grep -E "Groups|TOPIC|Memory")"
+fi
+
+# 41b. Each group read everything published, less its own lag
+PUBLISHED=$(echo "$OUTPUT" | sed -n 's/.*Published: *\([0-9]*\) messages.*/\1/p')
+GROUP_OK=0
+while read -r G_READ G_LAG; do
+    [ -n "$PUBLISHED" ] && [ "$PUBLISHED" -gt 0 ] && \
+        [ $((G_READ + G_LAG)) -eq "$PUBLISHED" ] && GROUP_OK=$((GROUP_OK + 1))
+done <<< "$(echo "$OUTPUT" | sed -n 's/.*Group [0-9]* *([0-9]* c): *\([0-9]*\) read, lag now \([0-9]*\).*/\1 \2/p')"
+if [ "$GROUP_OK" -eq 2 ]; then
+    pass "--groups 2 → both groups read + lag == published ($PUBLISHED)"
+else
+    fail "--groups 2 → a group missed or repeated messages" \
+         "$(echo "$OUTPUT" | grep -E "Published:|Group [0-9]")"
+fi
+
+# 41c. Slow subscribers hold the log's oldest slot: publishers wait on them
+run 20 -s 42 --groups 2 -p 0 1 2 4 3
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "peak 4 retained" && \
+   echo "$OUTPUT" | grep -qE "slowest for [1-9][0-9]* stalls" && \
+   ! echo "$OUTPUT" | grep -qE "Retained: [5-9]/4"; then
+    pass "--groups → log never exceeds 4 slots, stalls blamed on the slowest group"
+else
+    fail "--groups → min-cursor back-pressure not observed" \
+         "$(echo "$OUTPUT" | grep -E "Log:|Group [0-9]|Retained: [5-9]")"
+fi
+
+# 41d. A group without a consumer would pin the log forever: rejected
+run 5 --groups 3 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "needs at least one consumer per group"; then
+    pass "--groups 3 with 2 consumers → rejected"
+else
+    fail "--groups 3 with 2 consumers → should be rejected" "exit=$EXIT_CODE"
+fi
+
+# =============================================================================
+# 42. DEQUEUE POLICY (--policy, --policy-bench)
+# =============================================================================
+section "42. Dequeue Policy (--policy mlfq, --policy-bench)"
+
+# 42a. Mixed short/long jobs: MLFQ demotes the long classes and the
+#      short jobs stop queueing behind them
+run 60 --policy-bench --trial-ms 1000 2 1 20 10
+SHORT=$(echo "$OUTPUT" | sed -n 's/.*Short p99: *\([0-9.]*\) -> \([0-9.]*\) ms.*/\1 \2/p')
+read -r P99_PRIO P99_MLFQ <<< "${SHORT:-0 0}"
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -qE "^  priority +[0-9.]+" && \
+   echo "$OUTPUT" | grep -qE "^  mlfq +[0-9.]+" && \
+   echo "$OUTPUT" | grep -qE "MLFQ: +[1-9][0-9]* demotions" && \
+   [ -n "$SHORT" ] && awk -v a="$P99_MLFQ" -v b="$P99_PRIO" 'BEGIN { exit !(a < b) }'; then
+    pass "--policy-bench → short-job p99 $P99_PRIO ms (priority) -> $P99_MLFQ ms (mlfq)"
+else
+    fail "--policy-bench → MLFQ did not cut the short-job tail" \
+         "$(echo "$OUTPUT" | grep -E "priority|mlfq|MLFQ|Short p99")"
+fi
+
+# 42b. Simulation under MLFQ: levels reported, balance unaffected
+run 20 -s 3 --policy mlfq --mlfq-quantum 500000 -p 0 -c 1 2 2 8 4
+if [ "$EXIT_CODE" -eq 0 ] && echo "$OUTPUT" | grep -q "Result: PASS" && \
+   echo "$OUTPUT" | grep -q "DEQUEUE POLICY (MLFQ, 4 levels)" && \
+   echo "$OUTPUT" | grep -qE "Moves: +[0-9]+ demotions, [0-9]+ promotions, [0-9]+ resets" && \
+   echo "$OUTPUT" | grep -qE "Class [0-9]: +level [0-3], [0-9]+ served"; then
+    pass "--policy mlfq → class levels and moves reported, balance PASS"
+else
+    fail "--policy mlfq → policy section or balance missing" \
+         "$(echo "$OUTPUT" | grep -A4 "DEQUEUE POLICY")"
+fi
+
+# 42c. Partition leases always take the oldest item: MLFQ rejected
+run 5 --policy mlfq --partitions 2 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "\-\-policy mlfq cannot be combined"; then
+    pass "--policy mlfq with --partitions → rejected"
+else
+    fail "--policy mlfq with --partitions → should be rejected" "exit=$EXIT_CODE"
+fi
+
+# 42d. The spill tier evicts and refills by static priority: MLFQ rejected
+run 5 --policy mlfq --spill 50 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "\-\-policy mlfq cannot be combined"; then
+    pass "--policy mlfq with --spill → rejected"
+else
+    fail "--policy mlfq with --spill → should be rejected" "exit=$EXIT_CODE"
+fi
+
+# 42e. A quantum means nothing to the priority policy
+run 5 --mlfq-quantum 2000 2 2 4 2
+if [ "$EXIT_CODE" -ne 0 ] && echo "$OUTPUT" | grep -q "\-\-mlfq-quantum needs"; then
+    pass "--mlfq-quantum without --policy mlfq → rejected"
+else
+    fail "--mlfq-quantum without --policy mlfq → should be rejected" "exit=$EXIT_CODE"
+fi
+
 # =============================================================================
 # CLEANUP
 # =============================================================================
-rm -f queue_occupancy_*.csv /tmp/test_stderr
+rm -f queue_occupancy_*.csv saturation_*.csv scaling_*.csv /tmp/test_stderr
 
 # =============================================================================
 # SUMMARY
@@ -0,0 +1,355 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * timewheel.c: Delayed Delivery (Hierarchical Timing Wheel) Implementation
+ * * Level 0 holds messages due within TW_SLOTS ticks, one slot per tick.
+ * * Higher levels hold coarser ranges; when a lower level wraps, the
+ * * matching higher slot is cascaded (re-inserted) one level down.
+ * * Expired messages are moved to a due list under the wheel lock and
+ * * enqueued outside it, so a full ready queue never stalls scheduling.
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer arguments         — all public functions check inputs
+ *   2. Mutex/cond init failures       — cascading cleanup, return -1
+ *   3. Node pool exhausted            — producer blocks until a node frees
+ *   4. Already-due / past deadlines   — expire on the next tick
+ *   5. Delays beyond the top level    — clamped to the wheel's range
+ *   6. Shutdown while blocked         — waiters woken, return -1; messages
+ *                                       not yet promoted stay counted as
+ *                                       pending so the balance check holds
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+
+#include "timewheel.h"
+#include "utils.h"
+
+/* --- Internal Helpers --- */
+
+/* Ticks covered by levels 0..level */
+#define TW_LEVEL_SPAN(level)    (1LL << (TW_SLOT_BITS * ((level) + 1)))
+
+static long long current_tick(const TimingWheel *tw)
+{
+    long long elapsed = time_now_us() - tw->base_us;
+    return elapsed > 0 ? elapsed / TIMER_TICK_US : 0;
+}
+
+/*
+ * Links node 'idx' into the slot for its due tick, relative to now_tick.
+ * Caller holds tw->mutex.
+ */
+static void insert_node(TimingWheel *tw, int idx)
+{
+    TimerNode *node = &tw->nodes[idx];
+    long long due = node->due_tick;
+    long long delta;
+    int level = 0, slot;
+
+    if (due < tw->now_tick) due = tw->now_tick;
+    delta = due - tw->now_tick;
+    if (delta >= TW_LEVEL_SPAN(TW_LEVELS - 1)) {
+        due = tw->now_tick + TW_LEVEL_SPAN(TW_LEVELS - 1) - 1;
+        delta = due - tw->now_tick;
+    }
+    while (level < TW_LEVELS - 1 && delta >= TW_LEVEL_SPAN(level)) level++;
+
+    slot = (int)((due >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK);
+    node->next = tw->slots[level][slot];
+    tw->slots[level][slot] = idx;
+}
+
+/* Re-inserts every node of one higher-level slot. Caller holds tw->mutex. */
+static void cascade(TimingWheel *tw, int level, int slot)
+{
+    int idx = tw->slots[level][slot];
+
+    tw->slots[level][slot] = -1;
+    while (idx != -1) {
+        int next = tw->nodes[idx].next;
+        insert_node(tw, idx);
+        tw->stats.cascaded++;
+        idx = next;
+    }
+}
+
+/*
+ * Expires tick now_tick: cascade each level whose lower neighbour just
+ * wrapped to slot 0, then move the level-0 slot onto the due list.
+ * Caller holds tw->mutex.
+ */
+static void advance_tick(TimingWheel *tw)
+{
+    long long t = tw->now_tick;
+    int level, idx;
+
+    for (level = 1; level < TW_LEVELS; level++) {
+        if (((t >> (TW_SLOT_BITS * (level - 1))) & TW_SLOT_MASK) != 0) break;
+        cascade(tw, level, (int)((t >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK));
+    }
+
+    idx = tw->slots[0][t & TW_SLOT_MASK];
+    tw->slots[0][t & TW_SLOT_MASK] = -1;
+    while (idx != -1) {
+        int next = tw->nodes[idx].next;
+        tw->nodes[idx].next = -1;
+        tw->wheel_count--;
+        if (tw->due_tail == -1) tw->due_head = idx;
+        else tw->nodes[tw->due_tail].next = idx;
+        tw->due_tail = idx;
+        idx = next;
+    }
+
+    tw->now_tick++;
+}
+
+/*
+ * Timer thread: advance to the current tick, then promote up to
+ * TW_PROMOTE_BATCH due messages with the wheel unlocked. Sleeps one
+ * tick when nothing is due and parks on the condvar when idle.
+ *
+ * Error handling: a failed enqueue means the queue is shutting down;
+ * the remaining messages stay in 'pending' and the thread exits.
+ */
+static void *timer_thread(void *arg)
+{
+    TimingWheel *tw = (TimingWheel *)arg;
+    Message batch[TW_PROMOTE_BATCH];
+    long long lateness[TW_PROMOTE_BATCH];
+    int n, i, promoted, blocked_count, failed = 0;
+
+    DBG(DBG_INFO, "%s", "Timer: thread started");
+
+    if (pthread_mutex_lock(&tw->mutex) != 0) {
+        fprintf(stderr, "[ERROR] timer_thread: mutex lock failed\n");
+        return NULL;
+    }
+
+    while (!tw->stop && !failed) {
+        long long cur;
+
+        if (tw->stats.pending == 0) {
+            pthread_cond_wait(&tw->changed, &tw->mutex);
+            continue;
+        }
+
+        cur = current_tick(tw);
+        while (tw->now_tick <= cur) advance_tick(tw);
+
+        n = 0;
+        while (tw->due_head != -1 && n < TW_PROMOTE_BATCH) {
+            int idx = tw->due_head;
+            tw->due_head = tw->nodes[idx].next;
+            if (tw->due_head == -1) tw->due_tail = -1;
+            batch[n++] = tw->nodes[idx].msg;
+            tw->nodes[idx].next = tw->free_head;
+            tw->free_head = idx;
+        }
+        if (n > 0) pthread_cond_broadcast(&tw->changed); /* pool has room */
+        pthread_mutex_unlock(&tw->mutex);
+
+        if (n == 0) {
+            /* Wake at the next tick boundary */
+            sleep_us(TIMER_TICK_US - (time_now_us() - tw->base_us) % TIMER_TICK_US);
+            pthread_mutex_lock(&tw->mutex);
+            continue;
+        }
+
+        promoted = 0;
+        blocked_count = 0;
+        for (i = 0; i < n; i++) {
+            int was_blocked = 0;
+
+            /* In-queue latency and aging start at release, not creation */
+            batch[i].timestamp = queue_get_time_ms();
+            if (queue_enqueue_safe(tw->queue, batch[i], &was_blocked, NULL) != 0) {
+                failed = 1;
+                break;
+            }
+            lateness[i] = time_now_us() - batch[i].not_before_us;
+            if (was_blocked) blocked_count++;
+            promoted++;
+        }
+
+        pthread_mutex_lock(&tw->mutex);
+        for (i = 0; i < promoted; i++) histogram_record(&tw->stats.lateness_us, lateness[i]);
+        tw->stats.promoted += promoted;
+        tw->stats.blocked_promotions += blocked_count;
+        tw->stats.pending -= promoted;
+    }
+
+    pthread_mutex_unlock(&tw->mutex);
+    DBG(DBG_INFO, "Timer: thread exiting (%d pending)", tw->stats.pending);
+    return NULL;
+}
+
+/* --- Public API --- */
+
+/*
+ * Error handling: cond init failure destroys the mutex that was
+ * already created, so a failed init leaves nothing to clean up.
+ */
+int timewheel_init(TimingWheel *tw, Queue *queue)
+{
+    int i, level, slot;
+
+    if (tw == NULL || queue == NULL) {
+        fprintf(stderr, "[ERROR] timewheel_init: NULL argument\n");
+        return -1;
+    }
+
+    memset(&tw->stats, 0, sizeof(tw->stats));
+    histogram_init(&tw->stats.lateness_us);
+
+    for (i = 0; i < MAX_DELAYED_MESSAGES; i++) {
+        tw->nodes[i].next = (i + 1 < MAX_DELAYED_MESSAGES) ? i + 1 : -1;
+    }
+    tw->free_head = 0;
+    for (level = 0; level < TW_LEVELS; level++) {
+        for (slot = 0; slot < TW_SLOTS; slot++) tw->slots[level][slot] = -1;
+    }
+    tw->due_head = -1;
+    tw->due_tail = -1;
+    tw->wheel_count = 0;
+    tw->base_us = time_now_us();
+    tw->now_tick = 0;
+    tw->queue = queue;
+    tw->thread_started = 0;
+    tw->stop = 0;
+
+    if (pthread_mutex_init(&tw->mutex, NULL) != 0) {
+        fprintf(stderr, "[ERROR] timewheel_init: mutex init failed\n");
+        return -1;
+    }
+    if (pthread_cond_init(&tw->changed, NULL) != 0) {
+        fprintf(stderr, "[ERROR] timewheel_init: cond init failed\n");
+        pthread_mutex_destroy(&tw->mutex);
+        return -1;
+    }
+    return 0;
+}
+
+int timewheel_start(TimingWheel *tw)
+{
+    if (tw == NULL) return -1;
+
+    if (pthread_create(&tw->thread, NULL, timer_thread, tw) != 0) {
+        fprintf(stderr, "[ERROR] timewheel_start: pthread_create failed\n");
+        return -1;
+    }
+    tw->thread_started = 1;
+    return 0;
+}
+
+/*
+ * Error handling: the pool wait re-checks the stop flag after every
+ * wake-up, so a producer parked on a full pool exits at shutdown.
+ */
+int timewheel_schedule(TimingWheel *tw, Message msg, int *was_blocked, long *wait_time_ms)
+{
+    long wait_start = 0;
+    int blocked = 0;
+    int idx;
+
+    if (was_blocked) *was_blocked = 0;
+    if (wait_time_ms) *wait_time_ms = 0;
+    if (tw == NULL) return -1;
+
+    if (pthread_mutex_lock(&tw->mutex) != 0) {
+        fprintf(stderr, "[ERROR] timewheel_schedule: mutex lock failed\n");
+        return -1;
+    }
+
+    while (tw->free_head == -1 && !tw->stop) {
+        if (!blocked) {
+            blocked = 1;
+            wait_start = queue_get_time_ms();
+            tw->stats.pool_full_waits++;
+        }
+        pthread_cond_wait(&tw->changed, &tw->mutex);
+    }
+    if (tw->stop) {
+        pthread_mutex_unlock(&tw->mutex);
+        return -1;
+    }
+
+    /* An idle wheel skips ahead instead of replaying empty ticks */
+    if (tw->wheel_count == 0) {
+        long long cur = current_tick(tw);
+        if (cur > tw->now_tick) tw->now_tick = cur;
+    }
+
+    idx = tw->free_head;
+    tw->free_head = tw->nodes[idx].next;
+    tw->nodes[idx].msg = msg;
+    tw->nodes[idx].due_tick = (msg.not_before_us - tw->base_us + TIMER_TICK_US - 1) /
+                              TIMER_TICK_US;
+    insert_node(tw, idx);
+    tw->wheel_count++;
+
+    tw->stats.scheduled++;
+    tw->stats.pending++;
+    if (tw->stats.pending > tw->stats.max_pending) tw->stats.max_pending = tw->stats.pending;
+    if (tw->stats.pending == 1) pthread_cond_broadcast(&tw->changed); /* wake the timer */
+
+    pthread_mutex_unlock(&tw->mutex);
+
+    if (was_blocked) *was_blocked = blocked;
+    if (wait_time_ms && blocked) *wait_time_ms = queue_get_time_ms() - wait_start;
+    return 0;
+}
+
+void timewheel_shutdown(TimingWheel *tw)
+{
+    if (tw == NULL) return;
+
+    pthread_mutex_lock(&tw->mutex);
+    tw->stop = 1;
+    pthread_cond_broadcast(&tw->changed);
+    pthread_mutex_unlock(&tw->mutex);
+}
+
+void timewheel_stop(TimingWheel *tw)
+{
+    if (tw == NULL || !tw->thread_started) return;
+
+    if (pthread_join(tw->thread, NULL) != 0) {
+        fprintf(stderr, "[ERROR] timewheel_stop: pthread_join failed\n");
+    }
+    tw->thread_started = 0;
+}
+
+int timewheel_stats(TimingWheel *tw, TimerStats *out)
+{
+    if (tw == NULL || out == NULL) return -1;
+
+    if (pthread_mutex_lock(&tw->mutex) != 0) return -1;
+    *out = tw->stats;
+    pthread_mutex_unlock(&tw->mutex);
+    return 0;
+}
+
+int timewheel_pending(TimingWheel *tw)
+{
+    int pending;
+
+    if (tw == NULL) return 0;
+    if (pthread_mutex_lock(&tw->mutex) != 0) return 0;
+    pending = tw->stats.pending;
+    pthread_mutex_unlock(&tw->mutex);
+    return pending;
+}
+
+void timewheel_destroy(TimingWheel *tw)
+{
+    if (tw == NULL) return;
+    pthread_cond_destroy(&tw->changed);
+    pthread_mutex_destroy(&tw->mutex);
+}
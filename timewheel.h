@@ -0,0 +1,114 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * timewheel.h: Delayed Delivery (Hierarchical Timing Wheel) Declarations
+ * * Holds messages whose not_before_us lies in the future.
+ * * A timer thread advances the wheel one tick at a time and promotes due
+ * * messages into the ready queue, so consumers never see delayed items.
+ * * Scheduling and expiry are O(1); long delays cascade down the levels.
+ */
+
+#ifndef TIMEWHEEL_H
+#define TIMEWHEEL_H
+
+#include <pthread.h>
+#include <signal.h>
+#include "config.h"
+#include "queue.h"
+#include "histogram.h"
+
+/* --- Constants --- */
+
+/*
+ * TW_LEVELS wheels of TW_SLOTS slots each. Level l covers delays up to
+ * TW_SLOTS^(l+1) ticks: 64 ms, 4 s, 4.4 min, 4.7 h at a 1 ms tick.
+ */
+#define TW_SLOT_BITS            6
+#define TW_SLOTS                (1 << TW_SLOT_BITS)
+#define TW_SLOT_MASK            (TW_SLOTS - 1)
+#define TW_LEVELS               4
+#define TW_PROMOTE_BATCH        64  // Due messages moved per wheel-lock hold
+
+/* --- Data Structures --- */
+
+/*
+ * Pool node. Slots are singly linked lists of node indices (-1 = end),
+ * so the wheel never allocates after init.
+ */
+typedef struct {
+    Message msg;
+    long long due_tick;         // Tick at which the message becomes ready
+    int next;                   // Next node in the slot / free list
+} TimerNode;
+
+/*
+ * Delivery accuracy and wheel activity.
+ * Lateness = promotion into the ready queue minus not_before_us.
+ */
+typedef struct {
+    long long scheduled;        // Messages handed to the wheel
+    long long promoted;         // Messages moved into the ready queue
+    long long cascaded;         // Node moves from a higher level to a lower one
+    long long pool_full_waits;  // Producers that had to wait for a free node
+    long long blocked_promotions; // Promotions that waited for a queue slot
+    int pending;                // Still in the wheel (scheduled - promoted)
+    int max_pending;            // Peak number of delayed messages
+    Histogram lateness_us;      // Actual minus intended delivery time
+} TimerStats;
+
+typedef struct {
+    TimerNode nodes[MAX_DELAYED_MESSAGES];
+    int free_head;              // First free node (-1 = pool exhausted)
+    int slots[TW_LEVELS][TW_SLOTS]; // Head node of each slot (-1 = empty)
+    int due_head;               // Expired, waiting for promotion (FIFO)
+    int due_tail;
+    int wheel_count;            // Nodes linked into slots (not yet due)
+    long long base_us;          // time_now_us() of tick 0
+    long long now_tick;         // Next tick to expire
+    Queue *queue;               // Ready queue that due messages go to
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;     // Wheel got work / pool got a free node
+    pthread_t thread;
+    int thread_started;
+    volatile sig_atomic_t stop; // Set by timewheel_shutdown
+    TimerStats stats;
+} TimingWheel;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Prepares an empty wheel feeding 'queue'.
+ * Returns: 0 on success, -1 on NULL input or mutex/cond init failure.
+ */
+int timewheel_init(TimingWheel *tw, Queue *queue);
+
+/* Starts the timer thread. Returns: 0 on success, -1 on failure. */
+int timewheel_start(TimingWheel *tw);
+
+/*
+ * Holds 'msg' until msg.not_before_us (already due = next tick).
+ * Blocks while the node pool is full; was_blocked/wait_time_ms report it.
+ * Returns: 0 on success, -1 on NULL input or shutdown.
+ */
+int timewheel_schedule(TimingWheel *tw, Message msg, int *was_blocked, long *wait_time_ms);
+
+/*
+ * Stops accepting and promoting messages and wakes every waiter.
+ * Only sets a flag and broadcasts, so it may run from the shutdown path.
+ */
+void timewheel_shutdown(TimingWheel *tw);
+
+/* Joins the timer thread (after timewheel_shutdown). */
+void timewheel_stop(TimingWheel *tw);
+
+/* Copies the statistics. Returns: 0 on success, -1 on failure. */
+int timewheel_stats(TimingWheel *tw, TimerStats *out);
+
+/* Messages scheduled but not yet in the ready queue. */
+int timewheel_pending(TimingWheel *tw);
+
+void timewheel_destroy(TimingWheel *tw);
+
+#endif /* TIMEWHEEL_H */
@@ -0,0 +1,226 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * topic.c: Pub/Sub Fan-Out Implementation
+ * * One mutex guards the log, the cursors and the counters. The head
+ * * of the log is the minimum over the group cursors: it only moves
+ * * when the group that was sitting on it reads on, and only then are
+ * * publishers woken. Consumers of every group wait on one condition,
+ * * which a publish broadcasts (each group wants the new message).
+ *
+ * ERROR HANDLING STRATEGY:
+ * -----------------------
+ * This file protects against:
+ *   1. NULL pointer / invalid args    — checked, return -1
+ *   2. Mutex / cond init              — reported, partial init undone,
+ *                                       return -1
+ *   3. Shutdown while waiting         — topic_shutdown broadcasts both
+ *                                       conditions, the wait returns -1
+ *   4. Unknown group                  — fetch returns -1, lag reads 0
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+
+#include "topic.h"
+#include "utils.h"
+
+/* --- Internal Helpers --- */
+
+/* Recomputes head after a group that was on it moved on. Caller holds the mutex. */
+static void reclaim(Topic *t)
+{
+    long long min = t->tail;
+    int g;
+
+    for (g = 0; g < t->num_groups; g++) {
+        if (t->groups[g].cursor < min) min = t->groups[g].cursor;
+    }
+    if (min > t->head) {
+        t->stats.reclaimed += min - t->head;
+        t->head = min;
+        pthread_cond_broadcast(&t->not_full);
+    }
+}
+
+/* --- Public API --- */
+
+int topic_init(Topic *t, int capacity, int groups)
+{
+    if (t == NULL || capacity < 1 || capacity > MAX_QUEUE_SIZE ||
+        groups < 1 || groups > MAX_GROUPS) {
+        fprintf(stderr, "[ERROR] topic_init: invalid argument\n");
+        return -1;
+    }
+
+    memset(t, 0, sizeof(*t));
+    t->capacity = capacity;
+    t->num_groups = groups;
+
+    if (pthread_mutex_init(&t->mutex, NULL) != 0) {
+        fprintf(stderr, "[ERROR] topic_init: mutex init failed\n");
+        return -1;
+    }
+    if (pthread_cond_init(&t->not_full, NULL) != 0) {
+        fprintf(stderr, "[ERROR] topic_init: cond init failed\n");
+        pthread_mutex_destroy(&t->mutex);
+        return -1;
+    }
+    if (pthread_cond_init(&t->not_empty, NULL) != 0) {
+        fprintf(stderr, "[ERROR] topic_init: cond init failed\n");
+        pthread_cond_destroy(&t->not_full);
+        pthread_mutex_destroy(&t->mutex);
+        return -1;
+    }
+    return 0;
+}
+
+void topic_subscribe(Topic *t, int group)
+{
+    if (t == NULL || group < 0 || group >= t->num_groups) return;
+    pthread_mutex_lock(&t->mutex);
+    t->groups[group].stats.consumers++;
+    pthread_mutex_unlock(&t->mutex);
+}
+
+int topic_publish(Topic *t, Message msg, int *was_blocked, long *wait_time_ms)
+{
+    long long start_ms = 0;
+    int blocked = 0, g, retained;
+
+    if (t == NULL) return -1;
+
+    pthread_mutex_lock(&t->mutex);
+    if (!t->stop && t->tail - t->head == t->capacity) {
+        /* Full: the groups still on the oldest message hold everyone up */
+        blocked = 1;
+        start_ms = queue_get_time_ms();
+        t->stats.blocked_publishes++;
+        for (g = 0; g < t->num_groups; g++) {
+            if (t->groups[g].cursor == t->head) t->groups[g].stats.stalls++;
+        }
+        while (!t->stop && t->tail - t->head == t->capacity) {
+            pthread_cond_wait(&t->not_full, &t->mutex);
+        }
+    }
+    if (t->stop) {
+        pthread_mutex_unlock(&t->mutex);
+        return -1;
+    }
+
+    msg.enqueue_us = time_now_us();
+    t->log[t->tail % t->capacity] = msg;
+    t->tail++;
+    t->stats.published++;
+
+    retained = (int)(t->tail - t->head);
+    if (retained > t->stats.peak_retained) t->stats.peak_retained = retained;
+    for (g = 0; g < t->num_groups; g++) {
+        TopicGroup *grp = &t->groups[g];
+        long long lag = t->tail - grp->cursor;
+        grp->stats.lag_sum += lag;
+        if (lag > grp->stats.max_lag) grp->stats.max_lag = lag;
+    }
+
+    pthread_cond_broadcast(&t->not_empty);
+    pthread_mutex_unlock(&t->mutex);
+
+    if (was_blocked != NULL) *was_blocked = blocked;
+    if (wait_time_ms != NULL) *wait_time_ms = blocked ? queue_get_time_ms() - start_ms : 0;
+    return 0;
+}
+
+int topic_fetch(Topic *t, int group, Message *msg, int *was_blocked, long *wait_time_ms)
+{
+    TopicGroup *grp;
+    long long start_ms = 0;
+    int blocked = 0, was_oldest;
+
+    if (t == NULL || msg == NULL || group < 0 || group >= t->num_groups) return -1;
+    grp = &t->groups[group];
+
+    pthread_mutex_lock(&t->mutex);
+    if (!t->stop && grp->cursor == t->tail) {
+        blocked = 1;
+        start_ms = queue_get_time_ms();
+        while (!t->stop && grp->cursor == t->tail) {
+            pthread_cond_wait(&t->not_empty, &t->mutex);
+        }
+    }
+    if (t->stop) {
+        pthread_mutex_unlock(&t->mutex);
+        return -1;
+    }
+
+    *msg = t->log[grp->cursor % t->capacity];
+    was_oldest = grp->cursor == t->head;
+    grp->cursor++;
+    grp->stats.delivered++;
+    if (was_oldest) reclaim(t);
+    pthread_mutex_unlock(&t->mutex);
+
+    if (was_blocked != NULL) *was_blocked = blocked;
+    if (wait_time_ms != NULL) *wait_time_ms = blocked ? queue_get_time_ms() - start_ms : 0;
+    return 0;
+}
+
+int topic_lag(Topic *t, int group)
+{
+    int lag;
+
+    if (t == NULL || group < 0 || group >= t->num_groups) return 0;
+    pthread_mutex_lock(&t->mutex);
+    lag = (int)(t->tail - t->groups[group].cursor);
+    pthread_mutex_unlock(&t->mutex);
+    return lag;
+}
+
+int topic_retained(Topic *t)
+{
+    int n;
+
+    if (t == NULL) return 0;
+    pthread_mutex_lock(&t->mutex);
+    n = (int)(t->tail - t->head);
+    pthread_mutex_unlock(&t->mutex);
+    return n;
+}
+
+void topic_shutdown(Topic *t)
+{
+    if (t == NULL) return;
+    pthread_mutex_lock(&t->mutex);
+    t->stop = 1;
+    pthread_cond_broadcast(&t->not_full);
+    pthread_cond_broadcast(&t->not_empty);
+    pthread_mutex_unlock(&t->mutex);
+}
+
+void topic_stats(Topic *t, TopicStats *out, TopicGroupStats groups[MAX_GROUPS])
+{
+    int g;
+
+    if (t == NULL) return;
+    pthread_mutex_lock(&t->mutex);
+    if (out != NULL) *out = t->stats;
+    if (groups != NULL) {
+        for (g = 0; g < t->num_groups; g++) {
+            groups[g] = t->groups[g].stats;
+            groups[g].lag = t->tail - t->groups[g].cursor;
+        }
+    }
+    pthread_mutex_unlock(&t->mutex);
+}
+
+void topic_destroy(Topic *t)
+{
+    if (t == NULL || t->capacity == 0) return;
+    pthread_cond_destroy(&t->not_empty);
+    pthread_cond_destroy(&t->not_full);
+    pthread_mutex_destroy(&t->mutex);
+    t->capacity = 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * ELE430 Coursework: Producer-Consumer Model
+ * Student: Kaung
+ * Date: Oct 17, 2026
+ *
+ * topic.h: Pub/Sub Fan-Out with Subscriber Groups (--groups)
+ * * With --groups, producers publish into one shared log instead of
+ * * the priority queue, and the consumers are split into subscriber
+ * * groups. Every group sees every message, in publish order; the
+ * * consumers of one group share the group's cursor, so each message
+ * * is handled once per group. A message is stored once, whatever the
+ * * number of groups: its slot is reclaimed when the slowest group's
+ * * cursor moves past it, and publishers block while the slowest group
+ * * is a whole log behind.
+ */
+
+#ifndef TOPIC_H
+#define TOPIC_H
+
+#include <pthread.h>
+#include "config.h"
+#include "queue.h"
+
+/* --- Data Structures --- */
+
+/* Per-group counters (protected by the topic mutex) */
+typedef struct {
+    int consumers;              // Consumer threads subscribed to the group
+    long long delivered;        // Messages read by the group
+    long long lag_sum;          // Group lag sampled at every publish
+    long long max_lag;
+    long long stalls;           // Publishes that blocked while this group was the slowest
+    long long lag;              // Unread messages (filled in by topic_stats)
+} TopicGroupStats;
+
+typedef struct {
+    long long cursor;           // Sequence number the group reads next
+    TopicGroupStats stats;
+} TopicGroup;
+
+/* Log counters (protected by the topic mutex) */
+typedef struct {
+    long long published;
+    long long blocked_publishes; // Waited for the slowest group to free a slot
+    long long reclaimed;         // Slots freed by the min cursor moving on
+    int peak_retained;           // Most messages held at once
+} TopicStats;
+
+typedef struct {
+    Message log[MAX_QUEUE_SIZE]; // Ring: sequence s lives at log[s % capacity]
+    int capacity;
+    long long head;             // Oldest retained sequence (= min over the cursors)
+    long long tail;             // Next sequence to publish
+    int num_groups;
+    TopicGroup groups[MAX_GROUPS];
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full;    // The min cursor moved: slots were reclaimed
+    pthread_cond_t not_empty;   // Something was published
+    int stop;                   // topic_shutdown: all waits return -1
+    TopicStats stats;
+} Topic;
+
+/* --- Function Prototypes --- */
+
+/*
+ * Sets up a log of 'capacity' slots read by 'groups' groups.
+ * Returns: 0 on success, -1 on invalid input or mutex/cond failure.
+ */
+int topic_init(Topic *t, int capacity, int groups);
+
+/* Counts one more consumer thread in group 'group' (0-based, for the report). */
+void topic_subscribe(Topic *t, int group);
+
+/*
+ * Appends 'msg' (stamping its enqueue time), blocking while the log
+ * is full. was_blocked / wait_time_ms as for queue_enqueue_safe.
+ * Returns: 0 on success, -1 after topic_shutdown.
+ */
+int topic_publish(Topic *t, Message msg, int *was_blocked, long *wait_time_ms);
+
+/*
+ * Takes group 'group''s next message, blocking while it has read
+ * everything. Returns: 0 on success, -1 after topic_shutdown.
+ */
+int topic_fetch(Topic *t, int group, Message *msg, int *was_blocked, long *wait_time_ms);
+
+/* Messages group 'group' has not read yet. */
+int topic_lag(Topic *t, int group);
+
+/* Messages held in the log (published, not yet read by every group). */
+int topic_retained(Topic *t);
+
+/* Wakes every waiting publisher and consumer; later calls fail at once. */
+void topic_shutdown(Topic *t);
+
+/* Copies the counters (call after the threads are joined). */
+void topic_stats(Topic *t, TopicStats *out, TopicGroupStats groups[MAX_GROUPS]);
+
+void topic_destroy(Topic *t);
+
+#endif /* TOPIC_H */
@@ -243,8 +243,15 @@ void tui_update(int num_producers, int num_consumers,
         attroff(A_BOLD | COLOR_PAIR(CP_CYAN));
         row++;
 
+        /* Live 1s EWMA from the sampler (lock-free read); before the
+         * first tick fall back to the lifetime average. */
+        AnalyticsRates rates;
+        int have_rates = (analytics_get_rates(analytics, &rates) == 0);
         double prod_rate = 0.0, cons_rate = 0.0;
-        if (elapsed > 0.5) {
+        if (have_rates) {
+            prod_rate = rates.produce_rate[EWMA_1S];
+            cons_rate = rates.consume_rate[EWMA_1S];
+        } else if (elapsed > 0.5) {
             int total_p = 0, total_c = 0;
             for (i = 0; i < num_producers; i++) total_p += p_args[i].stats.messages_produced;
             for (i = 0; i < num_consumers; i++) total_c += c_args[i].stats.messages_consumed;
@@ -286,6 +293,24 @@ void tui_update(int num_producers, int num_consumers,
             printw(" %.1f", cons_rate);
         }
         row++;
+
+        /* Sliding windows: 1s / 10s / 60s */
+        if (have_rates) {
+            attron(A_DIM);
+            mvprintw(row, 2, "EWMA 1s/10s/60s  ");
+            attroff(A_DIM);
+            printw("blocks/s P %.1f/%.1f/%.1f  C %.1f/%.1f/%.1f  "
+                   "occ %.1f/%.1f/%.1f  lat %.0f/%.0f/%.0f ms",
+                   rates.producer_block_rate[EWMA_1S], rates.producer_block_rate[EWMA_10S],
+                   rates.producer_block_rate[EWMA_60S],
+                   rates.consumer_block_rate[EWMA_1S], rates.consumer_block_rate[EWMA_10S],
+                   rates.consumer_block_rate[EWMA_60S],
+                   rates.occupancy[EWMA_1S], rates.occupancy[EWMA_10S],
+                   rates.occupancy[EWMA_60S],
+                   rates.latency_ms[EWMA_1S], rates.latency_ms[EWMA_10S],
+                   rates.latency_ms[EWMA_60S]);
+            row++;
+        }
     }
 
     /* divider */
@@ -185,4 +185,125 @@ double time_elapsed(void)
     elapsed += (current_time.tv_nsec - program_start_time.tv_nsec) / 1000000000.0;
     
     return elapsed;
-}
\ No newline at end of file
+}
+
+/*
+ * Microsecond monotonic clock.
+ * Unlike the millisecond message timestamps (CLOCK_REALTIME, used for
+ * aging), this clock never steps, so differences are always valid.
+ */
+long long time_now_us(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return 0;
+    }
+
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/*
+ * Sleeps for 'usec' microseconds.
+ * An early wake-up (EINTR) simply returns; callers re-check their
+ * deadline against time_now_us() instead of relying on the sleep.
+ */
+void sleep_us(long long usec)
+{
+    struct timespec ts;
+
+    if (usec <= 0) return;
+
+    ts.tv_sec = (time_t)(usec / 1000000LL);
+    ts.tv_nsec = (long)(usec % 1000000LL) * 1000L;
+    nanosleep(&ts, NULL);
+}
+
+/* --- Thread Start Synchronisation --- */
+
+/*
+ * Error handling: cond init failure destroys the already-created
+ * mutex (cascading cleanup, same pattern as queue_init).
+ */
+int start_gate_init(StartGate *gate)
+{
+    if (gate == NULL) return -1;
+
+    gate->arrived = 0;
+    gate->open = 0;
+    gate->release_us = 0;
+
+    if (pthread_mutex_init(&gate->mutex, NULL) != 0) {
+        fprintf(stderr, "[ERROR] start_gate_init: mutex init failed\n");
+        return -1;
+    }
+    if (pthread_cond_init(&gate->cond, NULL) != 0) {
+        fprintf(stderr, "[ERROR] start_gate_init: cond init failed\n");
+        pthread_mutex_destroy(&gate->mutex);
+        return -1;
+    }
+    return 0;
+}
+
+void start_gate_destroy(StartGate *gate)
+{
+    if (gate == NULL) return;
+    pthread_cond_destroy(&gate->cond);
+    pthread_mutex_destroy(&gate->mutex);
+}
+
+/*
+ * One condvar serves both directions: arrivals wake the main thread,
+ * the release wakes the workers. Spurious wake-ups just re-check.
+ */
+long long start_gate_arrive_and_wait(StartGate *gate)
+{
+    long long release_us;
+
+    if (gate == NULL) return 0;
+    if (pthread_mutex_lock(&gate->mutex) != 0) {
+        /* Error handling: cannot park safely — start immediately */
+        fprintf(stderr, "[WARN] start_gate: mutex lock failed, not waiting\n");
+        return 0;
+    }
+
+    gate->arrived++;
+    pthread_cond_broadcast(&gate->cond);
+    while (!gate->open) {
+        pthread_cond_wait(&gate->cond, &gate->mutex);
+    }
+    release_us = gate->release_us;
+
+    pthread_mutex_unlock(&gate->mutex);
+    return release_us;
+}
+
+void start_gate_wait_arrivals(StartGate *gate, int count)
+{
+    if (gate == NULL) return;
+    if (pthread_mutex_lock(&gate->mutex) != 0) return;
+
+    while (gate->arrived < count) {
+        pthread_cond_wait(&gate->cond, &gate->mutex);
+    }
+
+    pthread_mutex_unlock(&gate->mutex);
+}
+
+long long start_gate_open(StartGate *gate)
+{
+    long long now = time_now_us();
+
+    if (gate == NULL) return now;
+    if (pthread_mutex_lock(&gate->mutex) != 0) {
+        fprintf(stderr, "[ERROR] start_gate_open: mutex lock failed\n");
+        return now;
+    }
+
+    gate->open = 1;
+    gate->release_us = now;
+    pthread_cond_broadcast(&gate->cond);
+
+    pthread_mutex_unlock(&gate->mutex);
+    return now;
+}
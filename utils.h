@@ -13,6 +13,7 @@
 
 #include <stddef.h> /* For size_t */
 #include <stdio.h>
+#include <pthread.h>
 #include "config.h"
 
 /* --- Debug System --- */
@@ -88,4 +89,49 @@ void time_start(void);
  */
 double time_elapsed(void);
 
+/*
+ * Returns a CLOCK_MONOTONIC timestamp in microseconds.
+ * Used for latency measurement where millisecond resolution is too coarse.
+ */
+long long time_now_us(void);
+
+/*
+ * Sleeps for the given number of microseconds (no-op if <= 0).
+ * Callers needing responsive shutdown should pass short chunks.
+ */
+void sleep_us(long long usec);
+
+/* --- Thread Start Synchronisation --- */
+
+/*
+ * One-shot start gate.
+ * Workers park on the gate as soon as they are spawned; the main thread
+ * waits until every created worker has arrived and then releases them
+ * together, so no thread gets a head start on an empty system.
+ * (A mutex/condvar gate rather than pthread_barrier_t: the gate can be
+ * opened with fewer arrivals when thread creation fails part-way.)
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int arrived;                // Workers parked so far
+    int open;                   // 1 once released
+    long long release_us;       // time_now_us() at release
+} StartGate;
+
+/* Returns 0 on success, -1 if mutex/cond init fails. */
+int start_gate_init(StartGate *gate);
+void start_gate_destroy(StartGate *gate);
+
+/* Worker side: register arrival, then block until the gate opens.
+ * Returns the release timestamp (0 if the gate could not be used). */
+long long start_gate_arrive_and_wait(StartGate *gate);
+
+/* Main side: block until at least 'count' workers have arrived. */
+void start_gate_wait_arrivals(StartGate *gate, int count);
+
+/* Main side: release all parked (and future) workers.
+ * Returns the release timestamp (time_now_us). */
+long long start_gate_open(StartGate *gate);
+
 #endif /* UTILS_H */
\ No newline at end of file